@@ -22,12 +22,15 @@
 
 #include <cogl/cogl.h>
 
+#include "clutter-enums.h"
+
 G_BEGIN_DECLS
 
 typedef struct _ClutterBlur ClutterBlur;
 
-ClutterBlur * clutter_blur_new (CoglTexture *texture,
-                                float        sigma);
+ClutterBlur * clutter_blur_new (CoglTexture          *texture,
+                                float                 sigma,
+                                ClutterBlurAlgorithm  algorithm);
 
 void clutter_blur_apply (ClutterBlur *blur);
 
@@ -64,6 +64,15 @@
  *
  * https://developer.nvidia.com/gpugems/GPUGems3/gpugems3_ch40.html
  *
+ * # Dual Kawase
+ *
+ * With %CLUTTER_BLUR_ALGORITHM_DUAL_KAWASE, the texture is instead repeatedly
+ * downsampled to half its size, and then upsampled back again, sampling a
+ * fixed number of texels per pass. The number of levels is picked from the
+ * blur sigma, so the cost stays roughly constant for large radii, at the
+ * expense of only approximating a gaussian blur. The technique is described
+ * in "Bandwidth-Efficient Rendering" by Marius Bjørge, SIGGRAPH 2015.
+ *
  */
 
 static const char *gaussian_blur_glsl_declarations =
@@ -105,9 +114,44 @@ static const char *gaussian_blur_glsl =
 "                                                                          \n"
 "  cogl_texel = ret / gauss_coefficient_total;                             \n";
 
+static const char *kawase_glsl_declarations =
+"uniform vec2 half_pixel;                                                  \n"
+"uniform float offset;                                                     \n";
+
+static const char *kawase_downsample_glsl =
+"  vec2 uv = vec2 (cogl_tex_coord.st);                                     \n"
+"  vec2 step = half_pixel * offset;                                        \n"
+"                                                                          \n"
+"  vec4 ret = texture2D (cogl_sampler, uv) * 4.0;                          \n"
+"  ret += texture2D (cogl_sampler, uv - step);                             \n"
+"  ret += texture2D (cogl_sampler, uv + step);                             \n"
+"  ret += texture2D (cogl_sampler, uv + vec2 (step.x, -step.y));           \n"
+"  ret += texture2D (cogl_sampler, uv - vec2 (step.x, -step.y));           \n"
+"                                                                          \n"
+"  cogl_texel = ret / 8.0;                                                 \n";
+
+static const char *kawase_upsample_glsl =
+"  vec2 uv = vec2 (cogl_tex_coord.st);                                     \n"
+"  vec2 step = half_pixel * offset;                                        \n"
+"                                                                          \n"
+"  vec4 ret = texture2D (cogl_sampler, uv + vec2 (-step.x * 2.0, 0.0));    \n"
+"  ret += texture2D (cogl_sampler, uv + vec2 (-step.x, step.y)) * 2.0;     \n"
+"  ret += texture2D (cogl_sampler, uv + vec2 (0.0, step.y * 2.0));         \n"
+"  ret += texture2D (cogl_sampler, uv + vec2 (step.x, step.y)) * 2.0;      \n"
+"  ret += texture2D (cogl_sampler, uv + vec2 (step.x * 2.0, 0.0));         \n"
+"  ret += texture2D (cogl_sampler, uv + vec2 (step.x, -step.y)) * 2.0;     \n"
+"  ret += texture2D (cogl_sampler, uv + vec2 (0.0, -step.y * 2.0));        \n"
+"  ret += texture2D (cogl_sampler, uv + vec2 (-step.x, -step.y)) * 2.0;    \n"
+"                                                                          \n"
+"  cogl_texel = ret / 12.0;                                                \n";
+
 #define MIN_DOWNSCALE_SIZE 256.f
 #define MAX_SIGMA 6.f
 
+#define MAX_KAWASE_LEVELS 6
+#define MIN_KAWASE_LEVEL_SIZE 8.f
+#define MAX_KAWASE_OFFSET 4.f
+
 enum
 {
   VERTICAL,
@@ -119,7 +163,6 @@ typedef struct
   CoglFramebuffer *framebuffer;
   CoglPipeline *pipeline;
   CoglTexture *texture;
-  int orientation;
 } BlurPass;
 
 struct _ClutterBlur
@@ -127,20 +170,25 @@ struct _ClutterBlur
   CoglTexture *source_texture;
   float sigma;
   float downscale_factor;
+  ClutterBlurAlgorithm algorithm;
+
+  /* Sample offset of the dual kawase passes */
+  float kawase_offset;
 
-  BlurPass pass[2];
+  BlurPass *passes;
+  unsigned int n_passes;
 };
 
 static CoglPipeline*
-create_blur_pipeline (void)
+create_blur_pipeline (CoglPipelineKey *key,
+                      const char      *declarations,
+                      const char      *glsl)
 {
-  static CoglPipelineKey blur_pipeline_key = "clutter-blur-pipeline-private";
   CoglContext *ctx =
     clutter_backend_get_cogl_context (clutter_get_default_backend ());
   CoglPipeline *blur_pipeline;
 
-  blur_pipeline =
-    cogl_context_get_named_pipeline (ctx, &blur_pipeline_key);
+  blur_pipeline = cogl_context_get_named_pipeline (ctx, key);
 
   if (G_UNLIKELY (blur_pipeline == NULL))
     {
@@ -157,23 +205,56 @@ create_blur_pipeline (void)
                                          COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
 
       snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
-                                  gaussian_blur_glsl_declarations,
+                                  declarations,
                                   NULL);
-      cogl_snippet_set_replace (snippet, gaussian_blur_glsl);
+      cogl_snippet_set_replace (snippet, glsl);
       cogl_pipeline_add_layer_snippet (blur_pipeline, 0, snippet);
       cogl_object_unref (snippet);
 
-      cogl_context_set_named_pipeline (ctx, &blur_pipeline_key, blur_pipeline);
+      cogl_context_set_named_pipeline (ctx, key, blur_pipeline);
     }
 
   return cogl_pipeline_copy (blur_pipeline);
 }
 
+static CoglPipeline*
+create_gaussian_pipeline (void)
+{
+  static CoglPipelineKey gaussian_pipeline_key = "clutter-blur-pipeline-private";
+
+  return create_blur_pipeline (&gaussian_pipeline_key,
+                               gaussian_blur_glsl_declarations,
+                               gaussian_blur_glsl);
+}
+
+static CoglPipeline*
+create_kawase_downsample_pipeline (void)
+{
+  static CoglPipelineKey downsample_pipeline_key =
+    "clutter-blur-kawase-downsample-pipeline-private";
+
+  return create_blur_pipeline (&downsample_pipeline_key,
+                               kawase_glsl_declarations,
+                               kawase_downsample_glsl);
+}
+
+static CoglPipeline*
+create_kawase_upsample_pipeline (void)
+{
+  static CoglPipelineKey upsample_pipeline_key =
+    "clutter-blur-kawase-upsample-pipeline-private";
+
+  return create_blur_pipeline (&upsample_pipeline_key,
+                               kawase_glsl_declarations,
+                               kawase_upsample_glsl);
+}
+
 static void
-update_blur_uniforms (ClutterBlur *blur,
-                      BlurPass    *pass)
+update_gaussian_uniforms (ClutterBlur *blur,
+                          BlurPass    *pass,
+                          int          orientation)
 {
-  gboolean vertical = pass->orientation == VERTICAL;
+  gboolean vertical = orientation == VERTICAL;
   int sigma_uniform;
   int pixel_step_uniform;
   int direction_uniform;
@@ -219,28 +300,52 @@ update_blur_uniforms (ClutterBlur *blur,
     }
 }
 
+static void
+update_kawase_uniforms (ClutterBlur *blur,
+                        BlurPass    *pass,
+                        CoglTexture *input)
+{
+  int half_pixel_uniform;
+  int offset_uniform;
+
+  half_pixel_uniform =
+    cogl_pipeline_get_uniform_location (pass->pipeline, "half_pixel");
+  if (half_pixel_uniform > -1)
+    {
+      float half_pixel[2] = {
+        0.5f / cogl_texture_get_width (input),
+        0.5f / cogl_texture_get_height (input),
+      };
+
+      cogl_pipeline_set_uniform_float (pass->pipeline,
+                                       half_pixel_uniform,
+                                       2, 1,
+                                       half_pixel);
+    }
+
+  offset_uniform = cogl_pipeline_get_uniform_location (pass->pipeline, "offset");
+  if (offset_uniform > -1)
+    {
+      cogl_pipeline_set_uniform_1f (pass->pipeline,
+                                    offset_uniform,
+                                    blur->kawase_offset);
+    }
+}
+
 static gboolean
-create_fbo (ClutterBlur *blur,
-            BlurPass    *pass)
+create_fbo (BlurPass *pass,
+            float     width,
+            float     height)
 {
   CoglContext *ctx =
     clutter_backend_get_cogl_context (clutter_get_default_backend ());
-  float scaled_height;
-  float scaled_width;
-  float height;
-  float width;
 
   g_clear_pointer (&pass->texture, cogl_object_unref);
   g_clear_object (&pass->framebuffer);
 
-  width = cogl_texture_get_width (blur->source_texture);
-  height = cogl_texture_get_height (blur->source_texture);
-  scaled_width = floorf (width / blur->downscale_factor);
-  scaled_height = floorf (height / blur->downscale_factor);
-
   pass->texture = COGL_TEXTURE (cogl_texture_2d_new_with_size (ctx,
-                                                               scaled_width,
-                                                               scaled_height));
+                                                               width,
+                                                               height));
   if (!pass->texture)
     return FALSE;
 
@@ -254,27 +359,23 @@ create_fbo (ClutterBlur *blur,
 
   cogl_framebuffer_orthographic (pass->framebuffer,
                                  0.0, 0.0,
-                                 scaled_width,
-                                 scaled_height,
+                                 width,
+                                 height,
                                  0.0, 1.0);
   return TRUE;
 }
 
 static gboolean
-setup_blur_pass (ClutterBlur *blur,
-                 BlurPass    *pass,
-                 int          orientation,
-                 CoglTexture *texture)
+setup_blur_pass (BlurPass     *pass,
+                 CoglPipeline *pipeline,
+                 CoglTexture  *texture,
+                 float         width,
+                 float         height)
 {
-  pass->orientation = orientation;
-  pass->pipeline = create_blur_pipeline ();
+  pass->pipeline = pipeline;
   cogl_pipeline_set_layer_texture (pass->pipeline, 0, texture);
 
-  if (!create_fbo (blur, pass))
-    return FALSE;
-
-  update_blur_uniforms (blur, pass);
-  return TRUE;
+  return create_fbo (pass, width, height);
 }
 
 static float
@@ -305,6 +406,110 @@ calculate_downscale_factor (float width,
   return downscale_factor;
 }
 
+static unsigned int
+calculate_kawase_levels (float  width,
+                         float  height,
+                         float  sigma,
+                         float *out_offset)
+{
+  unsigned int n_levels = 1;
+
+  /* Every level doubles the blur radius, and the sample offset fine tunes it
+   * in between levels, which roughly matches a gaussian blur of @sigma. The
+   * number of samples per level is fixed, so the cost mostly depends on the
+   * texture size rather than on @sigma.
+   */
+  while (n_levels < MAX_KAWASE_LEVELS &&
+         (float) (1 << (n_levels + 1)) <= sigma &&
+         width / (1 << (n_levels + 1)) >= MIN_KAWASE_LEVEL_SIZE &&
+         height / (1 << (n_levels + 1)) >= MIN_KAWASE_LEVEL_SIZE)
+    n_levels++;
+
+  *out_offset = CLAMP (sigma / (1 << n_levels), 0.5f, MAX_KAWASE_OFFSET);
+
+  return n_levels;
+}
+
+static gboolean
+setup_gaussian_passes (ClutterBlur *blur)
+{
+  BlurPass *vpass;
+  BlurPass *hpass;
+  float width;
+  float height;
+
+  width = floorf (cogl_texture_get_width (blur->source_texture) /
+                  blur->downscale_factor);
+  height = floorf (cogl_texture_get_height (blur->source_texture) /
+                   blur->downscale_factor);
+
+  blur->n_passes = 2;
+  blur->passes = g_new0 (BlurPass, blur->n_passes);
+
+  vpass = &blur->passes[VERTICAL];
+  hpass = &blur->passes[HORIZONTAL];
+
+  if (!setup_blur_pass (vpass, create_gaussian_pipeline (),
+                        blur->source_texture, width, height))
+    return FALSE;
+  update_gaussian_uniforms (blur, vpass, VERTICAL);
+
+  if (!setup_blur_pass (hpass, create_gaussian_pipeline (),
+                        vpass->texture, width, height))
+    return FALSE;
+  update_gaussian_uniforms (blur, hpass, HORIZONTAL);
+
+  return TRUE;
+}
+
+static gboolean
+setup_kawase_passes (ClutterBlur *blur)
+{
+  unsigned int n_levels;
+  unsigned int i;
+  float width;
+  float height;
+
+  width = cogl_texture_get_width (blur->source_texture);
+  height = cogl_texture_get_height (blur->source_texture);
+  n_levels = calculate_kawase_levels (width, height, blur->sigma,
+                                      &blur->kawase_offset);
+
+  /* Downsample into levels 1 … n, then upsample back into levels n - 1 … 0 */
+  blur->n_passes = 2 * n_levels;
+  blur->passes = g_new0 (BlurPass, blur->n_passes);
+
+  for (i = 0; i < blur->n_passes; i++)
+    {
+      BlurPass *pass = &blur->passes[i];
+      CoglTexture *input;
+      CoglPipeline *pipeline;
+      unsigned int level;
+
+      if (i < n_levels)
+        {
+          level = i + 1;
+          pipeline = create_kawase_downsample_pipeline ();
+        }
+      else
+        {
+          level = 2 * n_levels - i - 1;
+          pipeline = create_kawase_upsample_pipeline ();
+        }
+
+      input = i == 0 ? blur->source_texture : blur->passes[i - 1].texture;
+
+      if (!setup_blur_pass (pass, pipeline, input,
+                            MAX (floorf (width / (1 << level)), 1.f),
+                            MAX (floorf (height / (1 << level)), 1.f)))
+        return FALSE;
+
+      update_kawase_uniforms (blur, pass, input);
+    }
+
+  return TRUE;
+}
+
 static void
 apply_blur_pass (BlurPass *pass)
 {
@@ -335,20 +540,21 @@ clear_blur_pass (BlurPass *pass)
  * clutter_blur_new:
  * @texture: a #CoglTexture
  * @sigma: blur sigma
+ * @algorithm: the #ClutterBlurAlgorithm to use
  *
  * Creates a new #ClutterBlur.
  *
  * Returns: (transfer full) (nullable): A newly created #ClutterBlur
  */
 ClutterBlur *
-clutter_blur_new (CoglTexture *texture,
-                  float        sigma)
+clutter_blur_new (CoglTexture          *texture,
+                  float                 sigma,
+                  ClutterBlurAlgorithm  algorithm)
 {
   ClutterBlur *blur;
   unsigned int height;
   unsigned int width;
-  BlurPass *hpass;
-  BlurPass *vpass;
+  gboolean success = FALSE;
 
   g_return_val_if_fail (texture != NULL, NULL);
   g_return_val_if_fail (sigma >= 0.0, NULL);
@@ -358,17 +564,30 @@ clutter_blur_new (CoglTexture *texture,
 
   blur = g_new0 (ClutterBlur, 1);
   blur->sigma = sigma;
+  blur->algorithm = algorithm;
   blur->source_texture = cogl_object_ref (texture);
-  blur->downscale_factor = calculate_downscale_factor (width, height, sigma);
 
   if (G_APPROX_VALUE (sigma, 0.0, FLT_EPSILON))
     goto out;
 
-  vpass = &blur->pass[VERTICAL];
-  hpass = &blur->pass[HORIZONTAL];
+  switch (algorithm)
+    {
+    case CLUTTER_BLUR_ALGORITHM_GAUSSIAN:
+      blur->downscale_factor = calculate_downscale_factor (width, height, sigma);
+      success = setup_gaussian_passes (blur);
+      break;
+
+    case CLUTTER_BLUR_ALGORITHM_DUAL_KAWASE:
+      /* The pyramid does all the downscaling by itself */
+      blur->downscale_factor = 1.f;
+      success = setup_kawase_passes (blur);
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
 
-  if (!setup_blur_pass (blur, vpass, VERTICAL, texture) ||
-      !setup_blur_pass (blur, hpass, HORIZONTAL, vpass->texture))
+  if (!success)
     {
       clutter_blur_free (blur);
       return NULL;
@@ -388,11 +607,13 @@ out:
 void
 clutter_blur_apply (ClutterBlur *blur)
 {
+  unsigned int i;
+
   if (G_APPROX_VALUE (blur->sigma, 0.0, FLT_EPSILON))
     return;
 
-  apply_blur_pass (&blur->pass[VERTICAL]);
-  apply_blur_pass (&blur->pass[HORIZONTAL]);
+  for (i = 0; i < blur->n_passes; i++)
+    apply_blur_pass (&blur->passes[i]);
 }
 
 /**
@@ -410,7 +631,7 @@ clutter_blur_get_texture (ClutterBlur *blur)
   if (G_APPROX_VALUE (blur->sigma, 0.0, FLT_EPSILON))
     return blur->source_texture;
   else
-    return blur->pass[HORIZONTAL].texture;
+    return blur->passes[blur->n_passes - 1].texture;
 }
 
 /**
@@ -422,10 +643,13 @@ clutter_blur_get_texture (ClutterBlur *blur)
 void
 clutter_blur_free (ClutterBlur *blur)
 {
+  unsigned int i;
+
   g_assert (blur);
 
-  clear_blur_pass (&blur->pass[VERTICAL]);
-  clear_blur_pass (&blur->pass[HORIZONTAL]);
+  for (i = 0; i < blur->n_passes; i++)
+    clear_blur_pass (&blur->passes[i]);
+  g_free (blur->passes);
   cogl_clear_object (&blur->source_texture);
   g_free (blur);
 }
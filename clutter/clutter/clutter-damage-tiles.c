@@ -0,0 +1,481 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Detection of which tiles of a damage region actually changed between two
+ * CPU mapped copies of a framebuffer. Scanlines are compared with a vector
+ * kernel picked at runtime, and large damage regions are split into bands
+ * of tile rows that are scanned in parallel.
+ */
+
+#include "clutter-build-config.h"
+
+#include "clutter-damage-tiles.h"
+
+#include <string.h>
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HAVE_X86_KERNELS
+#include <immintrin.h>
+#elif defined (__ARM_NEON)
+#define HAVE_NEON_KERNEL
+#include <arm_neon.h>
+#endif
+
+#include "clutter-private.h"
+
+/* Don't bother waking up workers for less than this many candidate tiles,
+ * roughly a 512x512 area. */
+#define MIN_PARALLEL_TILES 1024
+#define MAX_WORKERS 3
+
+typedef gboolean (* SpansEqualFunc) (const uint8_t *a,
+                                     const uint8_t *b,
+                                     size_t         len);
+
+typedef struct _TileScan
+{
+  const uint8_t *current_data;
+  const uint8_t *prev_data;
+  int stride;
+  int bpp;
+  cairo_rectangle_int_t fb_rect;
+  const cairo_region_t *damage_region;
+  SpansEqualFunc spans_equal;
+
+  int tile_x_min;
+  int tile_y_min;
+  int n_tiles_x;
+  int n_tiles_y;
+  uint8_t *dirty_tiles;
+
+  GMutex mutex;
+  GCond cond;
+  int pending_bands;
+} TileScan;
+
+typedef struct _TileBand
+{
+  TileScan *scan;
+  int tile_row_begin;
+  int tile_row_end;
+} TileBand;
+
+static gboolean
+spans_equal_generic (const uint8_t *a,
+                     const uint8_t *b,
+                     size_t         len)
+{
+  return memcmp (a, b, len) == 0;
+}
+
+#ifdef HAVE_X86_KERNELS
+#define XOR_SSE2(offset) \
+  _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) (a + i + (offset))), \
+                 _mm_loadu_si128 ((const __m128i *) (b + i + (offset))))
+
+__attribute__ ((target ("sse2")))
+static gboolean
+spans_equal_sse2 (const uint8_t *a,
+                  const uint8_t *b,
+                  size_t         len)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64)
+    {
+      __m128i diff;
+
+      diff = _mm_or_si128 (_mm_or_si128 (XOR_SSE2 (0), XOR_SSE2 (16)),
+                           _mm_or_si128 (XOR_SSE2 (32), XOR_SSE2 (48)));
+      if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (diff, zero)) != 0xffff)
+        return FALSE;
+    }
+
+  for (; i + 16 <= len; i += 16)
+    {
+      if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (XOR_SSE2 (0), zero)) != 0xffff)
+        return FALSE;
+    }
+
+  return memcmp (a + i, b + i, len - i) == 0;
+}
+
+#undef XOR_SSE2
+
+#define XOR_AVX2(offset) \
+  _mm256_xor_si256 (_mm256_loadu_si256 ((const __m256i *) (a + i + (offset))), \
+                    _mm256_loadu_si256 ((const __m256i *) (b + i + (offset))))
+
+__attribute__ ((target ("avx2")))
+static gboolean
+spans_equal_avx2 (const uint8_t *a,
+                  const uint8_t *b,
+                  size_t         len)
+{
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64)
+    {
+      __m256i diff;
+
+      diff = _mm256_or_si256 (XOR_AVX2 (0), XOR_AVX2 (32));
+      if (!_mm256_testz_si256 (diff, diff))
+        return FALSE;
+    }
+
+  for (; i + 32 <= len; i += 32)
+    {
+      __m256i diff;
+
+      diff = XOR_AVX2 (0);
+      if (!_mm256_testz_si256 (diff, diff))
+        return FALSE;
+    }
+
+  return memcmp (a + i, b + i, len - i) == 0;
+}
+
+#undef XOR_AVX2
+#endif /* HAVE_X86_KERNELS */
+
+#ifdef HAVE_NEON_KERNEL
+#define XOR_NEON(offset) \
+  veorq_u8 (vld1q_u8 (a + i + (offset)), vld1q_u8 (b + i + (offset)))
+
+static gboolean
+is_zero_neon (uint8x16_t v)
+{
+  uint64x2_t v64 = vreinterpretq_u64_u8 (v);
+
+  return (vgetq_lane_u64 (v64, 0) | vgetq_lane_u64 (v64, 1)) == 0;
+}
+
+static gboolean
+spans_equal_neon (const uint8_t *a,
+                  const uint8_t *b,
+                  size_t         len)
+{
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64)
+    {
+      uint8x16_t diff;
+
+      diff = vorrq_u8 (vorrq_u8 (XOR_NEON (0), XOR_NEON (16)),
+                       vorrq_u8 (XOR_NEON (32), XOR_NEON (48)));
+      if (!is_zero_neon (diff))
+        return FALSE;
+    }
+
+  for (; i + 16 <= len; i += 16)
+    {
+      if (!is_zero_neon (XOR_NEON (0)))
+        return FALSE;
+    }
+
+  return memcmp (a + i, b + i, len - i) == 0;
+}
+
+#undef XOR_NEON
+#endif /* HAVE_NEON_KERNEL */
+
+static SpansEqualFunc
+get_spans_equal_func (void)
+{
+  static gsize spans_equal_func = 0;
+
+  if (g_once_init_enter (&spans_equal_func))
+    {
+      SpansEqualFunc func = spans_equal_generic;
+
+#if defined (HAVE_X86_KERNELS)
+      __builtin_cpu_init ();
+      if (__builtin_cpu_supports ("avx2"))
+        func = spans_equal_avx2;
+      else if (__builtin_cpu_supports ("sse2"))
+        func = spans_equal_sse2;
+#elif defined (HAVE_NEON_KERNEL)
+      func = spans_equal_neon;
+#endif
+
+      g_once_init_leave (&spans_equal_func, (gsize) func);
+    }
+
+  return (SpansEqualFunc) spans_equal_func;
+}
+
+static gboolean
+is_tile_dirty (TileScan              *scan,
+               cairo_rectangle_int_t *tile)
+{
+  size_t offset = (size_t) tile->y * scan->stride + tile->x * scan->bpp;
+  size_t len = (size_t) tile->width * scan->bpp;
+  int y;
+
+  for (y = 0; y < tile->height; y++)
+    {
+      if (!scan->spans_equal (scan->current_data + offset,
+                              scan->prev_data + offset,
+                              len))
+        return TRUE;
+
+      offset += scan->stride;
+    }
+
+  return FALSE;
+}
+
+static void
+scan_tile_rows (TileScan *scan,
+                int       tile_row_begin,
+                int       tile_row_end)
+{
+  int tile_row, tile_col;
+
+  for (tile_row = tile_row_begin; tile_row < tile_row_end; tile_row++)
+    {
+      for (tile_col = 0; tile_col < scan->n_tiles_x; tile_col++)
+        {
+          cairo_rectangle_int_t tile = {
+            .x = (scan->tile_x_min + tile_col) * CLUTTER_DAMAGE_TILE_SIZE,
+            .y = (scan->tile_y_min + tile_row) * CLUTTER_DAMAGE_TILE_SIZE,
+            .width = CLUTTER_DAMAGE_TILE_SIZE,
+            .height = CLUTTER_DAMAGE_TILE_SIZE,
+          };
+
+          if (cairo_region_contains_rectangle (scan->damage_region, &tile) ==
+              CAIRO_REGION_OVERLAP_OUT)
+            continue;
+
+          if (!_clutter_util_rectangle_intersection (&tile, &scan->fb_rect,
+                                                     &tile))
+            continue;
+
+          if (is_tile_dirty (scan, &tile))
+            scan->dirty_tiles[tile_row * scan->n_tiles_x + tile_col] = TRUE;
+        }
+    }
+}
+
+static void
+finish_band (TileScan *scan)
+{
+  g_mutex_lock (&scan->mutex);
+  if (--scan->pending_bands == 0)
+    g_cond_signal (&scan->cond);
+  g_mutex_unlock (&scan->mutex);
+}
+
+static void
+scan_band_in_thread (gpointer data,
+                     gpointer user_data)
+{
+  TileBand *band = data;
+  TileScan *scan = band->scan;
+
+  scan_tile_rows (scan, band->tile_row_begin, band->tile_row_end);
+  g_free (band);
+
+  finish_band (scan);
+}
+
+static GThreadPool *
+get_worker_pool (void)
+{
+  static gsize worker_pool = 0;
+
+  if (g_once_init_enter (&worker_pool))
+    {
+      GThreadPool *pool = NULL;
+      int n_workers;
+
+      n_workers = MIN ((int) g_get_num_processors () - 1, MAX_WORKERS);
+      if (n_workers > 0)
+        {
+          pool = g_thread_pool_new (scan_band_in_thread, NULL,
+                                    n_workers, FALSE, NULL);
+        }
+
+      g_once_init_leave (&worker_pool, (gsize) pool);
+    }
+
+  return (GThreadPool *) worker_pool;
+}
+
+static void
+scan_tiles (TileScan *scan)
+{
+  GThreadPool *pool = NULL;
+  int n_bands = 1;
+  int band_height;
+  int tile_row;
+
+  if (scan->n_tiles_x * scan->n_tiles_y >= MIN_PARALLEL_TILES)
+    pool = get_worker_pool ();
+
+  if (pool)
+    {
+      n_bands = MIN ((int) g_thread_pool_get_max_threads (pool) + 1,
+                     scan->n_tiles_y);
+    }
+
+  band_height = (scan->n_tiles_y + n_bands - 1) / n_bands;
+
+  g_mutex_init (&scan->mutex);
+  g_cond_init (&scan->cond);
+  scan->pending_bands = 1;
+
+  /* The first band is scanned by the calling thread once the others have
+   * been handed out. */
+  for (tile_row = band_height; tile_row < scan->n_tiles_y;
+       tile_row += band_height)
+    {
+      TileBand *band;
+
+      band = g_new0 (TileBand, 1);
+      band->scan = scan;
+      band->tile_row_begin = tile_row;
+      band->tile_row_end = MIN (tile_row + band_height, scan->n_tiles_y);
+
+      g_mutex_lock (&scan->mutex);
+      scan->pending_bands++;
+      g_mutex_unlock (&scan->mutex);
+
+      if (!g_thread_pool_push (pool, band, NULL))
+        scan_band_in_thread (band, NULL);
+    }
+
+  scan_tile_rows (scan, 0, MIN (band_height, scan->n_tiles_y));
+  finish_band (scan);
+
+  g_mutex_lock (&scan->mutex);
+  while (scan->pending_bands > 0)
+    g_cond_wait (&scan->cond, &scan->mutex);
+  g_mutex_unlock (&scan->mutex);
+
+  g_cond_clear (&scan->cond);
+  g_mutex_clear (&scan->mutex);
+}
+
+static cairo_region_t *
+create_dirty_tiles_region (TileScan *scan)
+{
+  cairo_region_t *region;
+  int tile_row, tile_col;
+
+  region = cairo_region_create ();
+
+  for (tile_row = 0; tile_row < scan->n_tiles_y; tile_row++)
+    {
+      uint8_t *row = &scan->dirty_tiles[tile_row * scan->n_tiles_x];
+
+      tile_col = 0;
+      while (tile_col < scan->n_tiles_x)
+        {
+          cairo_rectangle_int_t rect;
+          int run_begin;
+
+          if (!row[tile_col])
+            {
+              tile_col++;
+              continue;
+            }
+
+          run_begin = tile_col;
+          while (tile_col < scan->n_tiles_x && row[tile_col])
+            tile_col++;
+
+          rect = (cairo_rectangle_int_t) {
+            .x = (scan->tile_x_min + run_begin) * CLUTTER_DAMAGE_TILE_SIZE,
+            .y = (scan->tile_y_min + tile_row) * CLUTTER_DAMAGE_TILE_SIZE,
+            .width = (tile_col - run_begin) * CLUTTER_DAMAGE_TILE_SIZE,
+            .height = CLUTTER_DAMAGE_TILE_SIZE,
+          };
+          cairo_region_union_rectangle (region, &rect);
+        }
+    }
+
+  return region;
+}
+
+/**
+ * clutter_damage_tiles_find: (skip)
+ * @current_data: the mapped pixels of the current frame
+ * @prev_data: the mapped pixels of the previous frame
+ * @width: the width of both buffers in pixels
+ * @height: the height of both buffers in pixels
+ * @stride: the stride of both buffers in bytes
+ * @bpp: the number of bytes per pixel
+ * @damage_region: the region that may have changed
+ *
+ * Compares the two buffers in tiles of %CLUTTER_DAMAGE_TILE_SIZE pixels
+ * within @damage_region, and returns the part of @damage_region covered by
+ * tiles whose contents differ.
+ *
+ * Returns: (transfer full): the region that actually changed
+ */
+cairo_region_t *
+clutter_damage_tiles_find (const uint8_t        *current_data,
+                           const uint8_t        *prev_data,
+                           int                   width,
+                           int                   height,
+                           int                   stride,
+                           int                   bpp,
+                           const cairo_region_t *damage_region)
+{
+  cairo_rectangle_int_t damage_extents;
+  cairo_region_t *tile_damage_region;
+  TileScan scan = { 0 };
+  int tile_x_end, tile_y_end;
+
+  scan.current_data = current_data;
+  scan.prev_data = prev_data;
+  scan.stride = stride;
+  scan.bpp = bpp;
+  scan.fb_rect = (cairo_rectangle_int_t) {
+    .width = width,
+    .height = height,
+  };
+  scan.damage_region = damage_region;
+  scan.spans_equal = get_spans_equal_func ();
+
+  cairo_region_get_extents (damage_region, &damage_extents);
+  if (!_clutter_util_rectangle_intersection (&damage_extents, &scan.fb_rect,
+                                             &damage_extents))
+    return cairo_region_create ();
+
+  scan.tile_x_min = damage_extents.x / CLUTTER_DAMAGE_TILE_SIZE;
+  scan.tile_y_min = damage_extents.y / CLUTTER_DAMAGE_TILE_SIZE;
+  tile_x_end = ((damage_extents.x + damage_extents.width +
+                 CLUTTER_DAMAGE_TILE_SIZE - 1) / CLUTTER_DAMAGE_TILE_SIZE);
+  tile_y_end = ((damage_extents.y + damage_extents.height +
+                 CLUTTER_DAMAGE_TILE_SIZE - 1) / CLUTTER_DAMAGE_TILE_SIZE);
+  scan.n_tiles_x = tile_x_end - scan.tile_x_min;
+  scan.n_tiles_y = tile_y_end - scan.tile_y_min;
+  scan.dirty_tiles = g_new0 (uint8_t, scan.n_tiles_x * scan.n_tiles_y);
+
+  scan_tiles (&scan);
+
+  tile_damage_region = create_dirty_tiles_region (&scan);
+  g_free (scan.dirty_tiles);
+
+  cairo_region_intersect (tile_damage_region, damage_region);
+
+  return tile_damage_region;
+}
@@ -1628,6 +1628,21 @@ typedef enum
   CLUTTER_PHASE_BUBBLE,
 } ClutterEventPhase;
 
+/**
+ * ClutterBlurAlgorithm:
+ * @CLUTTER_BLUR_ALGORITHM_GAUSSIAN: two pass separable gaussian blur,
+ *   the number of texture samples grows with the blur sigma
+ * @CLUTTER_BLUR_ALGORITHM_DUAL_KAWASE: dual kawase blur, downsampling and
+ *   upsampling a texture pyramid with a fixed number of samples per level
+ *
+ * The algorithm used to blur the contents of a #ClutterBlurNode.
+ */
+typedef enum
+{
+  CLUTTER_BLUR_ALGORITHM_GAUSSIAN,
+  CLUTTER_BLUR_ALGORITHM_DUAL_KAWASE,
+} ClutterBlurAlgorithm;
+
 G_END_DECLS
 
 #endif /* __CLUTTER_ENUMS_H__ */
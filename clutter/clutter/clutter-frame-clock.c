@@ -45,8 +45,37 @@ typedef struct _EstimateQueue
   int next_index;
 } EstimateQueue;
 
+/* The render time history holds the total render time of the last few
+ * seconds worth of frames, which the max render time is predicted from.
+ * Each sample weighs this much less than the one after it, so that older
+ * samples fade out with a half-life of about a second at 60 Hz.
+ */
+#define RENDER_TIME_HISTORY_LENGTH 128
+#define RENDER_TIME_HISTORY_DECAY 0.99
+
+typedef struct _RenderTimeHistory
+{
+  int64_t values[RENDER_TIME_HISTORY_LENGTH];
+  int next_index;
+  int n_values;
+} RenderTimeHistory;
+
+/* Timings of the last few presented frames, for inspection and tracing. */
+#define FRAME_TIMINGS_LENGTH 256
+
 #define SYNC_DELAY_FALLBACK_FRACTION 0.875
 
+/* With triple buffering, a second frame may be dispatched while the first
+ * one is still waiting to be presented.
+ */
+#define MAX_PENDING_FRAMES 2
+
+/* Triple buffering is turned off again once a frame comfortably fits
+ * within this fraction of the refresh interval, so that it doesn't flip
+ * back and forth for frames that barely make it.
+ */
+#define TRIPLE_BUFFERING_DISABLE_FRACTION 0.75
+
 typedef struct _ClutterFrameListener
 {
   const ClutterFrameListenerIface *iface;
@@ -105,9 +134,42 @@ struct _ClutterFrameClock
   /* If we got new measurements last frame. */
   gboolean got_measurements_last_frame;
 
+  /* Total render time of the last frames, and the weighted percentile of it
+   * the max render time is currently based on. */
+  RenderTimeHistory render_time_us;
+  int64_t predicted_render_time_us;
+  int predicted_render_time_percentile;
+  /* Replaces the percentile based prediction if set. */
+  ClutterRenderTimePredictor render_time_predictor;
+  gpointer render_time_predictor_data;
+  GDestroyNotify render_time_predictor_destroy;
+  /* Max render time the last update got scheduled with. */
+  int64_t last_max_render_time_us;
+
+  ClutterFrameTimings frame_timings[FRAME_TIMINGS_LENGTH];
+  int next_frame_timings_index;
+  int n_frame_timings;
+
+  /* Presentation time the last dispatched frame was scheduled for, or 0. */
+  int64_t last_target_presentation_time_us;
+  /* Presented frames that missed the refresh cycle they were scheduled for. */
+  uint64_t n_missed_deadlines;
+
   gboolean pending_reschedule;
   gboolean pending_reschedule_now;
 
+  /* Whether the backend can queue a second frame behind one waiting for
+   * presentation, and whether it currently does because frames take too
+   * long to render to keep up otherwise.
+   */
+  gboolean allow_triple_buffering;
+  gboolean triple_buffering;
+
+  /* Frames waiting to be presented, oldest first. Only the dispatch
+   * related fields of the timings are filled in. */
+  ClutterFrameTimings pending_frames[MAX_PENDING_FRAMES];
+  int n_pending_frames;
+
   int inhibit_count;
 
   GList *timelines;
@@ -124,6 +186,388 @@ estimate_queue_add_value (EstimateQueue *queue,
   queue->next_index = (queue->next_index + 1) % ESTIMATE_QUEUE_LENGTH;
 }
 
+static void
+render_time_history_add_value (RenderTimeHistory *history,
+                               int64_t            value)
+{
+  history->values[history->next_index] = value;
+  history->next_index = (history->next_index + 1) % RENDER_TIME_HISTORY_LENGTH;
+  history->n_values = MIN (history->n_values + 1, RENDER_TIME_HISTORY_LENGTH);
+}
+
+typedef struct _WeightedSample
+{
+  int64_t value;
+  double weight;
+} WeightedSample;
+
+static int
+compare_weighted_samples (gconstpointer a,
+                          gconstpointer b,
+                          gpointer      user_data)
+{
+  const WeightedSample *sample_a = a;
+  const WeightedSample *sample_b = b;
+
+  if (sample_a->value < sample_b->value)
+    return -1;
+  else if (sample_a->value > sample_b->value)
+    return 1;
+  else
+    return 0;
+}
+
+/*
+ * Returns the smallest render time that, weighing recent frames more than
+ * older ones, at least the given percentage of frames fit within. Unlike
+ * the maximum, a single slow frame (e.g. compiling a shader) doesn't
+ * inflate it for as long as it stays in the history, while the decay still
+ * lets it follow a steady increase quickly.
+ */
+static int64_t
+render_time_history_get_percentile (RenderTimeHistory *history,
+                                    int                percentile)
+{
+  WeightedSample samples[RENDER_TIME_HISTORY_LENGTH];
+  double total_weight = 0.0;
+  double weight = 1.0;
+  double target_weight;
+  int i;
+
+  if (history->n_values == 0)
+    return 0;
+
+  for (i = 0; i < history->n_values; i++)
+    {
+      int index;
+
+      index = (history->next_index - 1 - i + RENDER_TIME_HISTORY_LENGTH) %
+              RENDER_TIME_HISTORY_LENGTH;
+      samples[i] = (WeightedSample) {
+        .value = history->values[index],
+        .weight = weight,
+      };
+
+      total_weight += weight;
+      weight *= RENDER_TIME_HISTORY_DECAY;
+    }
+
+  g_qsort_with_data (samples, history->n_values, sizeof (WeightedSample),
+                     compare_weighted_samples, NULL);
+
+  target_weight = total_weight * percentile / 100.0;
+  for (i = 0; i < history->n_values - 1; i++)
+    {
+      target_weight -= samples[i].weight;
+      if (target_weight <= 0.0)
+        break;
+    }
+
+  return samples[i].value;
+}
+
+static int64_t
+predict_render_time_us (ClutterFrameClock *frame_clock)
+{
+  RenderTimeHistory *history = &frame_clock->render_time_us;
+  int64_t values[RENDER_TIME_HISTORY_LENGTH];
+  int i;
+
+  for (i = 0; i < history->n_values; i++)
+    {
+      int index;
+
+      index = (history->next_index - 1 - i + RENDER_TIME_HISTORY_LENGTH) %
+              RENDER_TIME_HISTORY_LENGTH;
+      values[i] = history->values[index];
+    }
+
+  return MAX (frame_clock->render_time_predictor (values,
+                                                  history->n_values,
+                                                  frame_clock->render_time_predictor_data),
+              0);
+}
+
+/* The prediction is cached until a new render time is added, or the
+ * percentile changes. A custom predictor is cached as percentile -1.
+ */
+static int64_t
+get_predicted_render_time_us (ClutterFrameClock *frame_clock)
+{
+  int percentile;
+
+  if (frame_clock->render_time_predictor)
+    percentile = -1;
+  else
+    percentile = CLAMP (clutter_max_render_time_percentile, 1, 100);
+
+  if (frame_clock->predicted_render_time_percentile != percentile)
+    {
+      if (frame_clock->render_time_predictor)
+        {
+          frame_clock->predicted_render_time_us =
+            predict_render_time_us (frame_clock);
+        }
+      else
+        {
+          frame_clock->predicted_render_time_us =
+            render_time_history_get_percentile (&frame_clock->render_time_us,
+                                                percentile);
+        }
+      frame_clock->predicted_render_time_percentile = percentile;
+    }
+
+  return frame_clock->predicted_render_time_us;
+}
+
+/**
+ * clutter_frame_clock_set_render_time_predictor: (skip)
+ * @frame_clock: a #ClutterFrameClock
+ * @predictor: (nullable): the predictor, or %NULL for the default one
+ * @user_data: user data passed to @predictor
+ * @destroy: (nullable): called on @user_data when the predictor is replaced
+ *   or the frame clock is destroyed
+ *
+ * Replaces the weighted percentile the render time of the next frame is
+ * predicted from by default. The max render time is the predicted render
+ * time plus the vblank duration and a constant slop.
+ */
+void
+clutter_frame_clock_set_render_time_predictor (ClutterFrameClock          *frame_clock,
+                                               ClutterRenderTimePredictor  predictor,
+                                               gpointer                    user_data,
+                                               GDestroyNotify              destroy)
+{
+  if (frame_clock->render_time_predictor_destroy)
+    {
+      frame_clock->render_time_predictor_destroy (
+        frame_clock->render_time_predictor_data);
+    }
+
+  frame_clock->render_time_predictor = predictor;
+  frame_clock->render_time_predictor_data = user_data;
+  frame_clock->render_time_predictor_destroy = destroy;
+  frame_clock->predicted_render_time_percentile = 0;
+}
+
+static void
+add_frame_timings (ClutterFrameClock         *frame_clock,
+                   const ClutterFrameTimings *timings)
+{
+  frame_clock->frame_timings[frame_clock->next_frame_timings_index] = *timings;
+  frame_clock->next_frame_timings_index =
+    (frame_clock->next_frame_timings_index + 1) % FRAME_TIMINGS_LENGTH;
+  frame_clock->n_frame_timings =
+    MIN (frame_clock->n_frame_timings + 1, FRAME_TIMINGS_LENGTH);
+
+#ifdef COGL_HAS_TRACING
+  if (G_UNLIKELY (cogl_is_tracing_enabled ()))
+    {
+      g_autofree char *description = NULL;
+
+      COGL_TRACE_BEGIN (ClutterFrameClockPresented,
+                        "Frame Clock (presented)");
+      description =
+        g_strdup_printf ("frame: %" G_GINT64_FORMAT ", "
+                         "max render time: %" G_GINT64_FORMAT " µs, "
+                         "dispatch to swap: %" G_GINT64_FORMAT " µs, "
+                         "swap to rendering done: %" G_GINT64_FORMAT " µs, "
+                         "swap to flip: %" G_GINT64_FORMAT " µs, "
+                         "dispatch to presentation: %" G_GINT64_FORMAT " µs",
+                         timings->frame_count,
+                         timings->max_render_time_us,
+                         timings->dispatch_to_swap_us,
+                         timings->swap_to_rendering_done_us,
+                         timings->swap_to_flip_us,
+                         timings->presentation_time_us -
+                         timings->dispatch_time_us);
+      COGL_TRACE_DESCRIBE (ClutterFrameClockPresented, description);
+      COGL_TRACE_END (ClutterFrameClockPresented);
+    }
+#endif
+}
+
+/**
+ * clutter_frame_clock_get_frame_timings: (skip)
+ * @frame_clock: a #ClutterFrameClock
+ * @timings: (out caller-allocates): array to fill in
+ * @n_timings: the length of @timings
+ *
+ * Retrieves the timings of the most recently presented frames, oldest
+ * first. The frame clock keeps track of the last 256 frames.
+ *
+ * Returns: the number of frame timings filled in
+ */
+int
+clutter_frame_clock_get_frame_timings (ClutterFrameClock   *frame_clock,
+                                       ClutterFrameTimings *timings,
+                                       int                  n_timings)
+{
+  int first_index;
+  int i;
+
+  n_timings = MIN (n_timings, frame_clock->n_frame_timings);
+  first_index = frame_clock->next_frame_timings_index - n_timings +
+                FRAME_TIMINGS_LENGTH;
+
+  for (i = 0; i < n_timings; i++)
+    {
+      timings[i] =
+        frame_clock->frame_timings[(first_index + i) % FRAME_TIMINGS_LENGTH];
+    }
+
+  return n_timings;
+}
+
+static void
+get_max_estimates (ClutterFrameClock *frame_clock,
+                   int64_t           *max_dispatch_to_swap_us,
+                   int64_t           *max_swap_to_rendering_done_us,
+                   int64_t           *max_swap_to_flip_us)
+{
+  int i;
+
+  *max_dispatch_to_swap_us = 0;
+  *max_swap_to_rendering_done_us = 0;
+  *max_swap_to_flip_us = 0;
+
+  for (i = 0; i < ESTIMATE_QUEUE_LENGTH; ++i)
+    {
+      *max_dispatch_to_swap_us =
+        MAX (*max_dispatch_to_swap_us,
+             frame_clock->dispatch_to_swap_us.values[i]);
+      *max_swap_to_rendering_done_us =
+        MAX (*max_swap_to_rendering_done_us,
+             frame_clock->swap_to_rendering_done_us.values[i]);
+      *max_swap_to_flip_us =
+        MAX (*max_swap_to_flip_us,
+             frame_clock->swap_to_flip_us.values[i]);
+    }
+}
+
+static int
+get_max_pending_frames (ClutterFrameClock *frame_clock)
+{
+  return frame_clock->triple_buffering ? MAX_PENDING_FRAMES : 1;
+}
+
+static void
+init_dispatched_frame_timings (ClutterFrameClock   *frame_clock,
+                               int64_t              frame_count,
+                               ClutterFrameTimings *timings)
+{
+  *timings = (ClutterFrameTimings) {
+    .frame_count = frame_count,
+    .dispatch_time_us = frame_clock->last_dispatch_time_us,
+    .target_presentation_time_us =
+      frame_clock->last_target_presentation_time_us,
+    .max_render_time_us = frame_clock->last_max_render_time_us,
+  };
+}
+
+static void
+push_pending_frame (ClutterFrameClock *frame_clock,
+                    int64_t            frame_count)
+{
+  ClutterFrameTimings *timings;
+
+  g_return_if_fail (frame_clock->n_pending_frames < MAX_PENDING_FRAMES);
+
+  timings = &frame_clock->pending_frames[frame_clock->n_pending_frames++];
+  init_dispatched_frame_timings (frame_clock, frame_count, timings);
+}
+
+/* Takes the oldest frame waiting for presentation. If the frame being
+ * presented never made it to the queue because it completed while still
+ * being dispatched, it is the last dispatched one.
+ */
+static gboolean
+pop_pending_frame (ClutterFrameClock   *frame_clock,
+                   ClutterFrameTimings *timings)
+{
+  int i;
+
+  if (frame_clock->n_pending_frames == 0)
+    {
+      init_dispatched_frame_timings (frame_clock,
+                                     frame_clock->frame_count - 1,
+                                     timings);
+      return FALSE;
+    }
+
+  *timings = frame_clock->pending_frames[0];
+  frame_clock->n_pending_frames--;
+
+  for (i = 0; i < frame_clock->n_pending_frames; i++)
+    frame_clock->pending_frames[i] = frame_clock->pending_frames[i + 1];
+
+  return TRUE;
+}
+
+/*
+ * Double buffering drops to half the refresh rate as soon as a frame takes
+ * longer than a refresh interval from dispatch to GPU rendering finish, as
+ * the next one can only start once the previous one got presented. Queue a
+ * second frame in that case, and stop again once frames are fast enough.
+ */
+static void
+update_triple_buffering (ClutterFrameClock *frame_clock)
+{
+  int64_t render_time_us;
+  gboolean triple_buffering;
+
+  if (!frame_clock->allow_triple_buffering)
+    {
+      frame_clock->triple_buffering = FALSE;
+      return;
+    }
+
+  render_time_us =
+    get_predicted_render_time_us (frame_clock) +
+    frame_clock->vblank_duration_us +
+    clutter_max_render_time_constant_us;
+
+  if (frame_clock->triple_buffering)
+    {
+      triple_buffering =
+        render_time_us >= (frame_clock->refresh_interval_us *
+                           TRIPLE_BUFFERING_DISABLE_FRACTION);
+    }
+  else
+    {
+      triple_buffering = render_time_us > frame_clock->refresh_interval_us;
+    }
+
+  if (triple_buffering != frame_clock->triple_buffering)
+    {
+      CLUTTER_NOTE (FRAME_TIMINGS, "%s triple buffering, render time %ld µs",
+                    triple_buffering ? "Enabling" : "Disabling",
+                    render_time_us);
+      frame_clock->triple_buffering = triple_buffering;
+    }
+}
+
+/**
+ * clutter_frame_clock_set_allow_triple_buffering: (skip)
+ * @frame_clock: a #ClutterFrameClock
+ * @allow: whether a second frame may be dispatched while one is waiting
+ *   for presentation
+ *
+ * Lets the frame clock queue a second frame while the previous one is still
+ * waiting to be presented, whenever frames take too long to render to make
+ * it within one refresh interval. The backend must be able to handle a
+ * second frame being swapped before the previous one got presented.
+ */
+void
+clutter_frame_clock_set_allow_triple_buffering (ClutterFrameClock *frame_clock,
+                                                gboolean           allow)
+{
+  frame_clock->allow_triple_buffering = allow;
+
+  if (!allow)
+    frame_clock->triple_buffering = FALSE;
+}
+
 float
 clutter_frame_clock_get_refresh_rate (ClutterFrameClock *frame_clock)
 {
@@ -224,12 +668,67 @@ maybe_reschedule_update (ClutterFrameClock *frame_clock)
     }
 }
 
+static void
+finish_pending_frame (ClutterFrameClock *frame_clock,
+                      gboolean           was_pending)
+{
+  switch (frame_clock->state)
+    {
+    case CLUTTER_FRAME_CLOCK_STATE_INIT:
+      g_warn_if_reached ();
+      break;
+    case CLUTTER_FRAME_CLOCK_STATE_IDLE:
+    case CLUTTER_FRAME_CLOCK_STATE_SCHEDULED:
+      /* Only a frame queued behind another one can complete while the
+       * clock is free to dispatch. */
+      g_warn_if_fail (was_pending);
+      maybe_reschedule_update (frame_clock);
+      break;
+    case CLUTTER_FRAME_CLOCK_STATE_DISPATCHING:
+      /* An earlier frame completing doesn't affect the one being
+       * dispatched */
+      if (was_pending)
+        break;
+
+      G_GNUC_FALLTHROUGH;
+    case CLUTTER_FRAME_CLOCK_STATE_PENDING_PRESENTED:
+      /* Triple buffering may have been turned off with two frames queued */
+      if (frame_clock->n_pending_frames >= get_max_pending_frames (frame_clock))
+        break;
+
+      frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_IDLE;
+      maybe_reschedule_update (frame_clock);
+      break;
+    }
+}
+
 void
 clutter_frame_clock_notify_presented (ClutterFrameClock *frame_clock,
                                       ClutterFrameInfo  *frame_info)
 {
+  ClutterFrameTimings timings;
+  gboolean was_pending;
+
+  was_pending = pop_pending_frame (frame_clock, &timings);
+  timings.presentation_time_us = frame_info->presentation_time;
+
   frame_clock->last_presentation_time_us = frame_info->presentation_time;
 
+  /* Presentation happens on refresh cycle boundaries, so anything past
+   * half a cycle after the target landed on a later cycle. */
+  if (timings.target_presentation_time_us != 0 &&
+      timings.presentation_time_us >
+      timings.target_presentation_time_us +
+      frame_clock->refresh_interval_us / 2)
+    {
+      CLUTTER_NOTE (FRAME_TIMINGS,
+                    "Frame %ld missed its deadline by %ld µs",
+                    timings.frame_count,
+                    timings.presentation_time_us -
+                    timings.target_presentation_time_us);
+      frame_clock->n_missed_deadlines++;
+    }
+
   frame_clock->got_measurements_last_frame = FALSE;
 
   if (frame_info->cpu_time_before_buffer_swap_us != 0 &&
@@ -239,7 +738,7 @@ clutter_frame_clock_notify_presented (ClutterFrameClock *frame_clock,
 
       dispatch_to_swap_us =
         frame_info->cpu_time_before_buffer_swap_us -
-        frame_clock->last_dispatch_time_us;
+        timings.dispatch_time_us;
       swap_to_rendering_done_us =
         frame_info->gpu_rendering_duration_ns / 1000;
       swap_to_flip_us =
@@ -259,57 +758,49 @@ clutter_frame_clock_notify_presented (ClutterFrameClock *frame_clock,
       estimate_queue_add_value (&frame_clock->swap_to_flip_us,
                                 swap_to_flip_us);
 
+      render_time_history_add_value (&frame_clock->render_time_us,
+                                     dispatch_to_swap_us +
+                                     MAX (swap_to_rendering_done_us,
+                                          swap_to_flip_us));
+      frame_clock->predicted_render_time_percentile = 0;
+
+      timings.dispatch_to_swap_us = dispatch_to_swap_us;
+      timings.swap_to_rendering_done_us = swap_to_rendering_done_us;
+      timings.swap_to_flip_us = swap_to_flip_us;
+
       frame_clock->got_measurements_last_frame = TRUE;
     }
 
+  add_frame_timings (frame_clock, &timings);
+
   if (frame_info->refresh_rate > 1)
     {
       clutter_frame_clock_set_refresh_rate (frame_clock,
                                             frame_info->refresh_rate);
     }
 
-  switch (frame_clock->state)
-    {
-    case CLUTTER_FRAME_CLOCK_STATE_INIT:
-    case CLUTTER_FRAME_CLOCK_STATE_IDLE:
-    case CLUTTER_FRAME_CLOCK_STATE_SCHEDULED:
-      g_warn_if_reached ();
-      break;
-    case CLUTTER_FRAME_CLOCK_STATE_DISPATCHING:
-    case CLUTTER_FRAME_CLOCK_STATE_PENDING_PRESENTED:
-      frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_IDLE;
-      maybe_reschedule_update (frame_clock);
-      break;
-    }
+  if (frame_clock->got_measurements_last_frame)
+    update_triple_buffering (frame_clock);
+
+  finish_pending_frame (frame_clock, was_pending);
 }
 
 void
 clutter_frame_clock_notify_ready (ClutterFrameClock *frame_clock)
 {
-  switch (frame_clock->state)
-    {
-    case CLUTTER_FRAME_CLOCK_STATE_INIT:
-    case CLUTTER_FRAME_CLOCK_STATE_IDLE:
-    case CLUTTER_FRAME_CLOCK_STATE_SCHEDULED:
-      g_warn_if_reached ();
-      break;
-    case CLUTTER_FRAME_CLOCK_STATE_DISPATCHING:
-    case CLUTTER_FRAME_CLOCK_STATE_PENDING_PRESENTED:
-      frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_IDLE;
-      maybe_reschedule_update (frame_clock);
-      break;
-    }
+  ClutterFrameTimings timings;
+  gboolean was_pending;
+
+  was_pending = pop_pending_frame (frame_clock, &timings);
+
+  finish_pending_frame (frame_clock, was_pending);
 }
 
 static int64_t
 clutter_frame_clock_compute_max_render_time_us (ClutterFrameClock *frame_clock)
 {
   int64_t refresh_interval_us;
-  int64_t max_dispatch_to_swap_us = 0;
-  int64_t max_swap_to_rendering_done_us = 0;
-  int64_t max_swap_to_flip_us = 0;
   int64_t max_render_time_us;
-  int i;
 
   refresh_interval_us = frame_clock->refresh_interval_us;
 
@@ -318,36 +809,27 @@ clutter_frame_clock_compute_max_render_time_us (ClutterFrameClock *frame_clock)
                   CLUTTER_DEBUG_DISABLE_DYNAMIC_MAX_RENDER_TIME))
     return refresh_interval_us * SYNC_DELAY_FALLBACK_FRACTION;
 
-  for (i = 0; i < ESTIMATE_QUEUE_LENGTH; ++i)
-    {
-      max_dispatch_to_swap_us =
-        MAX (max_dispatch_to_swap_us,
-             frame_clock->dispatch_to_swap_us.values[i]);
-      max_swap_to_rendering_done_us =
-        MAX (max_swap_to_rendering_done_us,
-             frame_clock->swap_to_rendering_done_us.values[i]);
-      max_swap_to_flip_us =
-        MAX (max_swap_to_flip_us,
-             frame_clock->swap_to_flip_us.values[i]);
-    }
-
   /* Max render time shows how early the frame clock needs to be dispatched
    * to make it to the predicted next presentation time. It is composed of:
-   * - An estimate of duration from dispatch start to buffer swap.
-   * - Maximum between estimates of duration from buffer swap to GPU rendering
-   *   finish and duration from buffer swap to buffer submission to KMS. This
+   * - A prediction, by default a percentile, of the recent render times,
+   *   each being the duration from dispatch start to buffer swap, plus the
+   *   maximum between the duration from buffer swap to GPU rendering finish
+   *   and the duration from buffer swap to buffer submission to KMS. This
    *   is because both of these things need to happen before the vblank, and
    *   they are done in parallel.
    * - Duration of the vblank.
    * - A constant to account for variations in the above estimates.
    */
   max_render_time_us =
-    max_dispatch_to_swap_us +
-    MAX (max_swap_to_rendering_done_us, max_swap_to_flip_us) +
+    get_predicted_render_time_us (frame_clock) +
     frame_clock->vblank_duration_us +
     clutter_max_render_time_constant_us;
 
-  max_render_time_us = CLAMP (max_render_time_us, 0, refresh_interval_us);
+  /* With triple buffering, a frame may take up to two refresh intervals
+   * as the one before it is presented in the meantime. */
+  max_render_time_us = CLAMP (max_render_time_us, 0,
+                              refresh_interval_us *
+                              get_max_pending_frames (frame_clock));
 
   return max_render_time_us;
 }
@@ -380,12 +862,14 @@ calculate_next_update_time_us (ClutterFrameClock *frame_clock,
         now_us;
 
       *out_next_presentation_time_us = 0;
+      frame_clock->last_max_render_time_us = 0;
       return;
     }
 
   min_render_time_allowed_us = refresh_interval_us / 2;
   max_render_time_allowed_us =
     clutter_frame_clock_compute_max_render_time_us (frame_clock);
+  frame_clock->last_max_render_time_us = max_render_time_allowed_us;
 
   if (min_render_time_allowed_us > max_render_time_allowed_us)
     min_render_time_allowed_us = max_render_time_allowed_us;
@@ -489,6 +973,18 @@ calculate_next_update_time_us (ClutterFrameClock *frame_clock,
         frame_clock->next_presentation_time_us + refresh_interval_us;
     }
 
+  /*
+   * With a frame still waiting to be presented, the next one can at the
+   * earliest be presented on the refresh cycle after it.
+   */
+  if (frame_clock->n_pending_frames > 0 &&
+      frame_clock->is_next_presentation_time_valid)
+    {
+      next_presentation_time_us =
+        MAX (next_presentation_time_us,
+             frame_clock->next_presentation_time_us + refresh_interval_us);
+    }
+
   while (next_presentation_time_us < now_us + min_render_time_allowed_us)
     next_presentation_time_us += refresh_interval_us;
 
@@ -628,6 +1124,16 @@ clutter_frame_clock_dispatch (ClutterFrameClock *frame_clock,
   frame_clock->last_dispatch_time_us = time_us;
   g_source_set_ready_time (frame_clock->source, -1);
 
+  if (frame_clock->is_next_presentation_time_valid)
+    {
+      frame_clock->last_target_presentation_time_us =
+        frame_clock->next_presentation_time_us;
+    }
+  else
+    {
+      frame_clock->last_target_presentation_time_us = 0;
+    }
+
   frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_DISPATCHING;
 
   frame_count = frame_clock->frame_count++;
@@ -666,7 +1172,17 @@ clutter_frame_clock_dispatch (ClutterFrameClock *frame_clock,
       switch (result)
         {
         case CLUTTER_FRAME_RESULT_PENDING_PRESENTED:
-          frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_PENDING_PRESENTED;
+          push_pending_frame (frame_clock, frame_count);
+
+          if (frame_clock->n_pending_frames < get_max_pending_frames (frame_clock))
+            {
+              frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_IDLE;
+              maybe_reschedule_update (frame_clock);
+            }
+          else
+            {
+              frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_PENDING_PRESENTED;
+            }
           break;
         case CLUTTER_FRAME_RESULT_IDLE:
           frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_IDLE;
@@ -687,11 +1203,114 @@ frame_clock_source_dispatch (GSource     *source,
   int64_t dispatch_time_us;
 
   dispatch_time_us = g_source_get_time (source);
-  clutter_frame_clock_dispatch (frame_clock, dispatch_time_us);
+
+  /* The update may already have been dispatched earlier during this main
+   * loop iteration, along with the one of another frame clock. */
+  if (frame_clock->state != CLUTTER_FRAME_CLOCK_STATE_SCHEDULED ||
+      g_source_get_ready_time (source) > dispatch_time_us)
+    return G_SOURCE_CONTINUE;
+
+  if (frame_clock->listener.iface->dispatch)
+    {
+      frame_clock->listener.iface->dispatch (frame_clock,
+                                             dispatch_time_us,
+                                             frame_clock->listener.user_data);
+    }
+  else
+    {
+      clutter_frame_clock_dispatch (frame_clock, dispatch_time_us);
+    }
 
   return G_SOURCE_CONTINUE;
 }
 
+/**
+ * clutter_frame_clock_get_next_update_time_us: (skip)
+ * @frame_clock: a #ClutterFrameClock
+ *
+ * Returns: the time the scheduled update is to be dispatched at, or -1 if no
+ *   update is scheduled
+ */
+int64_t
+clutter_frame_clock_get_next_update_time_us (ClutterFrameClock *frame_clock)
+{
+  if (!frame_clock->source ||
+      frame_clock->state != CLUTTER_FRAME_CLOCK_STATE_SCHEDULED)
+    return -1;
+
+  return g_source_get_ready_time (frame_clock->source);
+}
+
+/**
+ * clutter_frame_clock_get_deadline_us: (skip)
+ * @frame_clock: a #ClutterFrameClock
+ *
+ * Retrieves the time the scheduled update must have been submitted to the
+ * display by to be presented when intended. Updates scheduled to happen as
+ * soon as possible have their dispatch time as deadline.
+ *
+ * Returns: the deadline of the scheduled update, or -1 if no update is
+ *   scheduled
+ */
+int64_t
+clutter_frame_clock_get_deadline_us (ClutterFrameClock *frame_clock)
+{
+  if (!frame_clock->source ||
+      frame_clock->state != CLUTTER_FRAME_CLOCK_STATE_SCHEDULED)
+    return -1;
+
+  if (!frame_clock->is_next_presentation_time_valid)
+    return g_source_get_ready_time (frame_clock->source);
+
+  return (frame_clock->next_presentation_time_us -
+          frame_clock->vblank_duration_us);
+}
+
+/**
+ * clutter_frame_clock_dispatch_now: (skip)
+ * @frame_clock: a #ClutterFrameClock
+ * @time_us: the dispatch time
+ *
+ * Dispatches the scheduled update right away, even if it is not due yet.
+ * Meant to be used by #ClutterFrameListenerIface.dispatch implementations.
+ */
+void
+clutter_frame_clock_dispatch_now (ClutterFrameClock *frame_clock,
+                                  int64_t            time_us)
+{
+  g_return_if_fail (frame_clock->source);
+  g_return_if_fail (frame_clock->state == CLUTTER_FRAME_CLOCK_STATE_SCHEDULED);
+
+  clutter_frame_clock_dispatch (frame_clock, time_us);
+}
+
+/**
+ * clutter_frame_clock_get_target_presentation_time_us: (skip)
+ * @frame_clock: a #ClutterFrameClock
+ *
+ * Returns: the time the frame currently or last dispatched is expected to be
+ *   presented at, or 0 if unknown
+ */
+int64_t
+clutter_frame_clock_get_target_presentation_time_us (ClutterFrameClock *frame_clock)
+{
+  return frame_clock->last_target_presentation_time_us;
+}
+
+/**
+ * clutter_frame_clock_get_missed_deadlines: (skip)
+ * @frame_clock: a #ClutterFrameClock
+ *
+ * Returns: the number of frames that were presented more than half a
+ *   refresh cycle after their target presentation time, i.e. on a later
+ *   refresh cycle than the one they were scheduled for
+ */
+uint64_t
+clutter_frame_clock_get_missed_deadlines (ClutterFrameClock *frame_clock)
+{
+  return frame_clock->n_missed_deadlines;
+}
+
 void
 clutter_frame_clock_record_flip_time (ClutterFrameClock *frame_clock,
                                       int64_t            flip_time_us)
@@ -702,10 +1321,9 @@ clutter_frame_clock_record_flip_time (ClutterFrameClock *frame_clock,
 GString *
 clutter_frame_clock_get_max_render_time_debug_info (ClutterFrameClock *frame_clock)
 {
-  int64_t max_dispatch_to_swap_us = 0;
-  int64_t max_swap_to_rendering_done_us = 0;
-  int64_t max_swap_to_flip_us = 0;
-  int i;
+  int64_t max_dispatch_to_swap_us;
+  int64_t max_swap_to_rendering_done_us;
+  int64_t max_swap_to_flip_us;
   GString *string;
 
   string = g_string_new (NULL);
@@ -717,18 +1335,10 @@ clutter_frame_clock_get_max_render_time_debug_info (ClutterFrameClock *frame_clo
   else
     g_string_append_printf (string, " (no measurements last frame)");
 
-  for (i = 0; i < ESTIMATE_QUEUE_LENGTH; ++i)
-    {
-      max_dispatch_to_swap_us =
-        MAX (max_dispatch_to_swap_us,
-             frame_clock->dispatch_to_swap_us.values[i]);
-      max_swap_to_rendering_done_us =
-        MAX (max_swap_to_rendering_done_us,
-             frame_clock->swap_to_rendering_done_us.values[i]);
-      max_swap_to_flip_us =
-        MAX (max_swap_to_flip_us,
-             frame_clock->swap_to_flip_us.values[i]);
-    }
+  get_max_estimates (frame_clock,
+                     &max_dispatch_to_swap_us,
+                     &max_swap_to_rendering_done_us,
+                     &max_swap_to_flip_us);
 
   g_string_append_printf (string, "\nVblank duration: %ld µs +",
                           frame_clock->vblank_duration_us);
@@ -740,6 +1350,15 @@ clutter_frame_clock_get_max_render_time_debug_info (ClutterFrameClock *frame_clo
                           max_swap_to_flip_us);
   g_string_append_printf (string, "\nConstant: %d µs",
                           clutter_max_render_time_constant_us);
+  g_string_append_printf (string, "\nPredicted render time (p%d): %ld µs",
+                          CLAMP (clutter_max_render_time_percentile, 1, 100),
+                          get_predicted_render_time_us (frame_clock));
+  g_string_append_printf (string, "\nMissed deadlines: %" G_GUINT64_FORMAT,
+                          frame_clock->n_missed_deadlines);
+  g_string_append_printf (string, "\nTriple buffering: %s",
+                          frame_clock->triple_buffering ? "yes" :
+                          frame_clock->allow_triple_buffering ? "no" :
+                          "unsupported");
 
   return string;
 }
@@ -813,6 +1432,8 @@ clutter_frame_clock_dispose (GObject *object)
       g_clear_pointer (&frame_clock->source, g_source_unref);
     }
 
+  clutter_frame_clock_set_render_time_predictor (frame_clock, NULL, NULL, NULL);
+
   G_OBJECT_CLASS (clutter_frame_clock_parent_class)->dispose (object);
 }
 
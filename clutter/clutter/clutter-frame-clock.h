@@ -40,8 +40,39 @@ G_DECLARE_FINAL_TYPE (ClutterFrameClock, clutter_frame_clock,
                       CLUTTER, FRAME_CLOCK,
                       GObject)
 
+/**
+ * ClutterFrameTimings: (skip)
+ * @frame_count: the frame counter value the frame was dispatched with
+ * @dispatch_time_us: when the frame was dispatched
+ * @target_presentation_time_us: when the frame was scheduled to be presented,
+ *   or 0 if it was dispatched as soon as possible
+ * @presentation_time_us: when the frame was presented
+ * @max_render_time_us: the max render time the frame was scheduled with
+ * @dispatch_to_swap_us: duration from dispatch start to buffer swap
+ * @swap_to_rendering_done_us: duration from buffer swap to GPU rendering
+ *   finish
+ * @swap_to_flip_us: duration from buffer swap to buffer submission to KMS
+ *
+ * Timings of a presented frame. The durations are 0 if the backend didn't
+ * provide measurements for the frame.
+ */
+typedef struct _ClutterFrameTimings
+{
+  int64_t frame_count;
+  int64_t dispatch_time_us;
+  int64_t target_presentation_time_us;
+  int64_t presentation_time_us;
+  int64_t max_render_time_us;
+  int64_t dispatch_to_swap_us;
+  int64_t swap_to_rendering_done_us;
+  int64_t swap_to_flip_us;
+} ClutterFrameTimings;
+
 /**
  * ClutterFrameListenerIface: (skip)
+ * @dispatch: optional; called instead of dispatching a due update right away,
+ *   so that it can be dispatched along with updates of other frame clocks
+ *   using clutter_frame_clock_dispatch_now()
  */
 typedef struct _ClutterFrameListenerIface
 {
@@ -51,8 +82,24 @@ typedef struct _ClutterFrameListenerIface
   ClutterFrameResult (* frame) (ClutterFrameClock *frame_clock,
                                 int64_t            frame_count,
                                 gpointer           user_data);
+  void (* dispatch) (ClutterFrameClock *frame_clock,
+                     int64_t            time_us,
+                     gpointer           user_data);
 } ClutterFrameListenerIface;
 
+/**
+ * ClutterRenderTimePredictor: (skip)
+ * @render_times_us: total render times of the most recent frames, newest
+ *   first
+ * @n_render_times: the length of @render_times_us
+ * @user_data: user data
+ *
+ * Returns: the expected render time of the next frame
+ */
+typedef int64_t (* ClutterRenderTimePredictor) (const int64_t *render_times_us,
+                                                int            n_render_times,
+                                                gpointer       user_data);
+
 CLUTTER_EXPORT
 ClutterFrameClock * clutter_frame_clock_new (float                            refresh_rate,
                                              int64_t                          vblank_duration_us,
@@ -75,6 +122,19 @@ void clutter_frame_clock_schedule_update (ClutterFrameClock *frame_clock);
 CLUTTER_EXPORT
 void clutter_frame_clock_schedule_update_now (ClutterFrameClock *frame_clock);
 
+CLUTTER_EXPORT
+int64_t clutter_frame_clock_get_next_update_time_us (ClutterFrameClock *frame_clock);
+
+CLUTTER_EXPORT
+int64_t clutter_frame_clock_get_deadline_us (ClutterFrameClock *frame_clock);
+
+CLUTTER_EXPORT
+void clutter_frame_clock_dispatch_now (ClutterFrameClock *frame_clock,
+                                       int64_t            time_us);
+
+CLUTTER_EXPORT
+int64_t clutter_frame_clock_get_target_presentation_time_us (ClutterFrameClock *frame_clock);
+
 CLUTTER_EXPORT
 void clutter_frame_clock_inhibit (ClutterFrameClock *frame_clock);
 
@@ -95,4 +155,22 @@ void clutter_frame_clock_record_flip_time (ClutterFrameClock *frame_clock,
 
 GString * clutter_frame_clock_get_max_render_time_debug_info (ClutterFrameClock *frame_clock);
 
+CLUTTER_EXPORT
+int clutter_frame_clock_get_frame_timings (ClutterFrameClock   *frame_clock,
+                                           ClutterFrameTimings *timings,
+                                           int                  n_timings);
+
+CLUTTER_EXPORT
+uint64_t clutter_frame_clock_get_missed_deadlines (ClutterFrameClock *frame_clock);
+
+CLUTTER_EXPORT
+void clutter_frame_clock_set_render_time_predictor (ClutterFrameClock          *frame_clock,
+                                                    ClutterRenderTimePredictor  predictor,
+                                                    gpointer                    user_data,
+                                                    GDestroyNotify              destroy);
+
+CLUTTER_EXPORT
+void clutter_frame_clock_set_allow_triple_buffering (ClutterFrameClock *frame_clock,
+                                                     gboolean           allow);
+
 #endif /* CLUTTER_FRAME_CLOCK_H */
@@ -96,6 +96,11 @@ guint clutter_pick_debug_flags  = 0;
  */
 int clutter_max_render_time_constant_us = 2000;
 
+/* The percentile of recent render times the heuristic max render time is
+ * based on. 100 makes it the maximum.
+ */
+int clutter_max_render_time_percentile = 95;
+
 #ifdef CLUTTER_ENABLE_DEBUG
 static const GDebugKey clutter_debug_keys[] = {
   { "misc", CLUTTER_DEBUG_MISC },
@@ -587,6 +592,17 @@ init_clutter_debug (ClutterMainContext *clutter_context)
   env_string = g_getenv ("CLUTTER_DISABLE_MIPMAPPED_TEXT");
   if (env_string)
     clutter_disable_mipmap_text = TRUE;
+
+  env_string = g_getenv ("CLUTTER_MAX_RENDER_TIME_PERCENTILE");
+  if (env_string)
+    {
+      int percentile = atoi (env_string);
+
+      if (percentile >= 1 && percentile <= 100)
+        clutter_max_render_time_percentile = percentile;
+      else
+        g_warning ("Invalid max render time percentile '%s'", env_string);
+    }
 }
 
 ClutterContext *
@@ -1498,6 +1514,13 @@ clutter_debug_set_max_render_time_constant (int max_render_time_constant_us)
   clutter_max_render_time_constant_us = max_render_time_constant_us;
 }
 
+void
+clutter_debug_set_max_render_time_percentile (int max_render_time_percentile)
+{
+  clutter_max_render_time_percentile = CLAMP (max_render_time_percentile,
+                                              1, 100);
+}
+
 void
 clutter_get_debug_flags (ClutterDebugFlag     *debug_flags,
                          ClutterDrawDebugFlag *draw_flags,
@@ -28,6 +28,7 @@
 #include "clutter-backend.h"
 #include "clutter-backend-private.h"
 #include "clutter-damage-history.h"
+#include "clutter-damage-tiles.h"
 #include "clutter-event-private.h"
 #include "clutter-input-device-private.h"
 #include "clutter-input-pointer-a11y-private.h"
@@ -74,6 +75,28 @@ gboolean clutter_actor_is_effectively_on_stage_view (ClutterActor     *self,
 CLUTTER_EXPORT
 int64_t clutter_stage_get_frame_counter (ClutterStage *stage);
 
+CLUTTER_EXPORT
+uint64_t clutter_stage_get_tick_serial (ClutterStage *stage);
+
+typedef void (* ClutterStageDamageFunc) (ClutterActor                *actor,
+                                         const cairo_rectangle_int_t *rect,
+                                         gpointer                     user_data);
+
+CLUTTER_EXPORT
+void clutter_stage_track_damage_history (ClutterStage *stage);
+
+CLUTTER_EXPORT
+void clutter_stage_untrack_damage_history (ClutterStage *stage);
+
+CLUTTER_EXPORT
+uint64_t clutter_stage_get_damage_serial (ClutterStage *stage);
+
+CLUTTER_EXPORT
+gboolean clutter_stage_foreach_damage_since (ClutterStage           *stage,
+                                             uint64_t                serial,
+                                             ClutterStageDamageFunc  func,
+                                             gpointer                user_data);
+
 CLUTTER_EXPORT
 void clutter_stage_capture_view_into (ClutterStage          *stage,
                                       ClutterStageView      *view,
@@ -1913,6 +1913,29 @@ ClutterPaintNode *
 clutter_blur_node_new (unsigned int width,
                        unsigned int height,
                        float        sigma)
+{
+  return clutter_blur_node_new_with_algorithm (width, height, sigma,
+                                               CLUTTER_BLUR_ALGORITHM_GAUSSIAN);
+}
+
+/**
+ * clutter_blur_node_new_with_algorithm:
+ * @width width of the blur layer
+ * @height: height of the blur layer
+ * @sigma: sigma value of the blur
+ * @algorithm: the #ClutterBlurAlgorithm used to blur
+ *
+ * Creates a new #ClutterBlurNode, like clutter_blur_node_new(), blurring
+ * using @algorithm.
+ *
+ * Return value: (transfer full): the newly created #ClutterBlurNode.
+ *   Use clutter_paint_node_unref() when done.
+ */
+ClutterPaintNode *
+clutter_blur_node_new_with_algorithm (unsigned int         width,
+                                      unsigned int         height,
+                                      float                sigma,
+                                      ClutterBlurAlgorithm algorithm)
 {
   g_autoptr (CoglOffscreen) offscreen = NULL;
   g_autoptr (GError) error = NULL;
@@ -1942,7 +1965,7 @@ clutter_blur_node_new (unsigned int width,
       goto out;
     }
 
-  blur = clutter_blur_new (texture, sigma);
+  blur = clutter_blur_new (texture, sigma, algorithm);
   blur_node->blur = blur;
 
   if (!blur)
@@ -79,6 +79,11 @@ void                clutter_stage_update_devices         (ClutterStage
                                                           GSList                *devices);
 void                clutter_stage_finish_layout          (ClutterStage          *stage);
 
+void     clutter_stage_dispatch_tick_group (ClutterStage      *stage,
+                                            ClutterFrameClock *frame_clock,
+                                            int64_t            time_us);
+gboolean clutter_stage_begin_tick_update   (ClutterStage      *stage);
+
 CLUTTER_EXPORT
 void     _clutter_stage_queue_event                       (ClutterStage *stage,
                                                            ClutterEvent *event,
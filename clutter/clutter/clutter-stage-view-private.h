@@ -23,7 +23,11 @@
 
 CLUTTER_EXPORT
 void clutter_stage_view_after_paint (ClutterStageView *view,
-                                     cairo_region_t   *redraw_clip);
+                                     cairo_region_t   *redraw_clip,
+                                     cairo_region_t   *repair_clip);
+
+CLUTTER_EXPORT
+gboolean clutter_stage_view_has_persistent_framebuffer (ClutterStageView *view);
 
 CLUTTER_EXPORT
 void clutter_stage_view_before_swap_buffer (ClutterStageView     *view,
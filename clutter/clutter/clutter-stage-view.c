@@ -24,6 +24,7 @@
 #include <math.h>
 
 #include "clutter/clutter-damage-history.h"
+#include "clutter/clutter-damage-tiles.h"
 #include "clutter/clutter-frame-clock.h"
 #include "clutter/clutter-frame-private.h"
 #include "clutter/clutter-private.h"
@@ -228,21 +229,17 @@ paint_transformed_framebuffer (ClutterStageView     *view,
   unsigned int n_rectangles, i;
   int dst_width, dst_height;
   cairo_rectangle_int_t view_layout;
-  cairo_rectangle_int_t onscreen_layout;
+  cairo_rectangle_int_t src_fb_rect;
   float view_scale;
   float *coordinates;
 
   dst_width = cogl_framebuffer_get_width (dst_framebuffer);
   dst_height = cogl_framebuffer_get_height (dst_framebuffer);
+  src_fb_rect = (cairo_rectangle_int_t) {
+    .width = cogl_framebuffer_get_width (COGL_FRAMEBUFFER (src_framebuffer)),
+    .height = cogl_framebuffer_get_height (COGL_FRAMEBUFFER (src_framebuffer)),
+  };
   clutter_stage_view_get_layout (view, &view_layout);
-  clutter_stage_view_transform_rect_to_onscreen (view,
-                                                 &(cairo_rectangle_int_t) {
-                                                   .width = view_layout.width,
-                                                   .height = view_layout.height,
-                                                 },
-                                                 view_layout.width,
-                                                 view_layout.height,
-                                                 &onscreen_layout);
   view_scale = clutter_stage_view_get_scale (view);
 
   cogl_framebuffer_push_matrix (dst_framebuffer);
@@ -266,6 +263,7 @@ paint_transformed_framebuffer (ClutterStageView     *view,
     {
       cairo_rectangle_int_t src_rect;
       cairo_rectangle_int_t dst_rect;
+      graphene_rect_t scaled_rect;
 
       cairo_region_get_rectangle (redraw_clip, i, &src_rect);
       _clutter_util_rectangle_offset (&src_rect,
@@ -273,27 +271,33 @@ paint_transformed_framebuffer (ClutterStageView     *view,
                                       -view_layout.y,
                                       &src_rect);
 
+      /* Transform in framebuffer pixels, so that each blitted rectangle
+       * stays pixel aligned and within the damage of the destination with
+       * fractional scales too. */
+      _clutter_util_rect_from_rectangle (&src_rect, &scaled_rect);
+      graphene_rect_scale (&scaled_rect, view_scale, view_scale, &scaled_rect);
+      _clutter_util_rectangle_int_extents (&scaled_rect, &src_rect);
+      if (!_clutter_util_rectangle_intersection (&src_rect, &src_fb_rect,
+                                                 &src_rect))
+        src_rect = (cairo_rectangle_int_t) { 0 };
+
       clutter_stage_view_transform_rect_to_onscreen (view,
                                                      &src_rect,
-                                                     onscreen_layout.width,
-                                                     onscreen_layout.height,
+                                                     dst_width,
+                                                     dst_height,
                                                      &dst_rect);
 
-      coordinates[i * 8 + 0] = (float) dst_rect.x * view_scale;
-      coordinates[i * 8 + 1] = (float) dst_rect.y * view_scale;
-      coordinates[i * 8 + 2] = ((float) (dst_rect.x + dst_rect.width) *
-                                view_scale);
-      coordinates[i * 8 + 3] = ((float) (dst_rect.y + dst_rect.height) *
-                                view_scale);
-
-      coordinates[i * 8 + 4] = (((float) dst_rect.x / (float) dst_width) *
-                                view_scale);
-      coordinates[i * 8 + 5] = (((float) dst_rect.y / (float) dst_height) *
-                                view_scale);
+      coordinates[i * 8 + 0] = (float) dst_rect.x;
+      coordinates[i * 8 + 1] = (float) dst_rect.y;
+      coordinates[i * 8 + 2] = (float) (dst_rect.x + dst_rect.width);
+      coordinates[i * 8 + 3] = (float) (dst_rect.y + dst_rect.height);
+
+      coordinates[i * 8 + 4] = (float) dst_rect.x / (float) dst_width;
+      coordinates[i * 8 + 5] = (float) dst_rect.y / (float) dst_height;
       coordinates[i * 8 + 6] = ((float) (dst_rect.x + dst_rect.width) /
-                                (float) dst_width) * view_scale;
+                                (float) dst_width);
       coordinates[i * 8 + 7] = ((float) (dst_rect.y + dst_rect.height) /
-                                (float) dst_height) * view_scale;
+                                (float) dst_height);
     }
 
   cogl_framebuffer_draw_textured_rectangles (dst_framebuffer,
@@ -313,6 +317,24 @@ is_shadowfb_double_buffered (ClutterStageView *view)
   return priv->shadow.dma_buf.handles[0] && priv->shadow.dma_buf.handles[1];
 }
 
+/*
+ * Whether the framebuffer the stage is painted into keeps its contents
+ * from one frame to the next, i.e. whether only the damage of the current
+ * frame needs to be painted, with older damage only to be repaired on the
+ * onscreen.
+ */
+gboolean
+clutter_stage_view_has_persistent_framebuffer (ClutterStageView *view)
+{
+  ClutterStageViewPrivate *priv =
+    clutter_stage_view_get_instance_private (view);
+
+  if (priv->offscreen)
+    return TRUE;
+
+  return priv->shadow.framebuffer && !is_shadowfb_double_buffered (view);
+}
+
 static gboolean
 init_dma_buf_shadowfbs (ClutterStageView  *view,
                         CoglContext       *cogl_context,
@@ -452,9 +474,15 @@ init_shadowfb (ClutterStageView *view)
     }
 }
 
+/*
+ * @redraw_clip is the region painted this frame, and @repair_clip the
+ * possibly larger region that must be brought up to date on the onscreen
+ * given its buffer age. Both are in stage coordinates.
+ */
 void
 clutter_stage_view_after_paint (ClutterStageView *view,
-                                cairo_region_t   *redraw_clip)
+                                cairo_region_t   *redraw_clip,
+                                cairo_region_t   *repair_clip)
 {
   ClutterStageViewPrivate *priv =
     clutter_stage_view_get_instance_private (view);
@@ -468,11 +496,14 @@ clutter_stage_view_after_paint (ClutterStageView *view,
           CoglFramebuffer *shadowfb =
             COGL_FRAMEBUFFER (priv->shadow.framebuffer);
 
+          /* A single shadow framebuffer keeps its contents, the onscreen is
+           * repaired from it before swapping. */
           paint_transformed_framebuffer (view,
                                          priv->offscreen_pipeline,
                                          priv->offscreen,
                                          shadowfb,
-                                         redraw_clip);
+                                         is_shadowfb_double_buffered (view) ?
+                                         repair_clip : redraw_clip);
         }
       else
         {
@@ -480,31 +511,11 @@ clutter_stage_view_after_paint (ClutterStageView *view,
                                          priv->offscreen_pipeline,
                                          priv->offscreen,
                                          priv->framebuffer,
-                                         redraw_clip);
+                                         repair_clip);
         }
     }
 }
 
-static gboolean
-is_tile_dirty (cairo_rectangle_int_t *tile,
-               uint8_t               *current_data,
-               uint8_t               *prev_data,
-               int                    bpp,
-               int                    stride)
-{
-  int y;
-
-  for (y = tile->y; y < tile->y + tile->height; y++)
-    {
-      if (memcmp (prev_data + y * stride + tile->x * bpp,
-                  current_data + y * stride + tile->x * bpp,
-                  tile->width * bpp) != 0)
-        return TRUE;
-    }
-
-  return FALSE;
-}
-
 static int
 flip_dma_buf_idx (int idx)
 {
@@ -519,8 +530,6 @@ find_damaged_tiles (ClutterStageView      *view,
   ClutterStageViewPrivate *priv =
     clutter_stage_view_get_instance_private (view);
   cairo_region_t *tile_damage_region;
-  cairo_rectangle_int_t damage_extents;
-  cairo_rectangle_int_t fb_rect;
   int prev_dma_buf_idx;
   CoglDmaBufHandle *prev_dma_buf_handle;
   uint8_t *prev_data;
@@ -528,10 +537,6 @@ find_damaged_tiles (ClutterStageView      *view,
   CoglDmaBufHandle *current_dma_buf_handle;
   uint8_t *current_data;
   int width, height, stride, bpp;
-  int tile_x_min, tile_x_max;
-  int tile_y_min, tile_y_max;
-  int tile_x, tile_y;
-  const int tile_size = 16;
 
   prev_dma_buf_idx = flip_dma_buf_idx (priv->shadow.dma_buf.current_idx);
   prev_dma_buf_handle = priv->shadow.dma_buf.handles[prev_dma_buf_idx];
@@ -559,43 +564,10 @@ find_damaged_tiles (ClutterStageView      *view,
   if (!current_data)
     goto err_mmap_current;
 
-  fb_rect = (cairo_rectangle_int_t) {
-    .width = width,
-    .height = height,
-  };
-
-  cairo_region_get_extents (damage_region, &damage_extents);
-
-  tile_x_min = damage_extents.x / tile_size;
-  tile_x_max = ((damage_extents.x + damage_extents.width + tile_size - 1) /
-                tile_size);
-  tile_y_min = damage_extents.y / tile_size;
-  tile_y_max = ((damage_extents.y + damage_extents.height + tile_size - 1) /
-                tile_size);
-
-  tile_damage_region = cairo_region_create ();
-
-  for (tile_y = tile_y_min; tile_y <= tile_y_max; tile_y++)
-    {
-      for (tile_x = tile_x_min; tile_x <= tile_x_max; tile_x++)
-        {
-          cairo_rectangle_int_t tile = {
-            .x = tile_x * tile_size,
-            .y = tile_y * tile_size,
-            .width = tile_size,
-            .height = tile_size,
-          };
-
-          if (cairo_region_contains_rectangle (damage_region, &tile) ==
-              CAIRO_REGION_OVERLAP_OUT)
-            continue;
-
-          _clutter_util_rectangle_intersection (&tile, &fb_rect, &tile);
-
-          if (is_tile_dirty (&tile, current_data, prev_data, bpp, stride))
-            cairo_region_union_rectangle (tile_damage_region, &tile);
-        }
-    }
+  tile_damage_region = clutter_damage_tiles_find (current_data, prev_data,
+                                                  width, height,
+                                                  stride, bpp,
+                                                  damage_region);
 
   if (!cogl_dma_buf_handle_sync_read_end (prev_dma_buf_handle, error))
     {
@@ -614,8 +586,6 @@ find_damaged_tiles (ClutterStageView      *view,
   cogl_dma_buf_handle_munmap (prev_dma_buf_handle, prev_data, NULL);
   cogl_dma_buf_handle_munmap (current_dma_buf_handle, current_data, NULL);
 
-  cairo_region_intersect (tile_damage_region, damage_region);
-
   return tile_damage_region;
 
 err_mmap_current:
@@ -1067,6 +1037,18 @@ clutter_stage_view_get_frame_clock (ClutterStageView *view)
   return priv->frame_clock;
 }
 
+static void
+handle_frame_clock_dispatch (ClutterFrameClock *frame_clock,
+                             int64_t            time_us,
+                             gpointer           user_data)
+{
+  ClutterStageView *view = user_data;
+  ClutterStageViewPrivate *priv =
+    clutter_stage_view_get_instance_private (view);
+
+  clutter_stage_dispatch_tick_group (priv->stage, frame_clock, time_us);
+}
+
 static void
 handle_frame_clock_before_frame (ClutterFrameClock *frame_clock,
                                  int64_t            frame_count,
@@ -1168,7 +1150,8 @@ handle_frame_clock_frame (ClutterFrameClock *frame_clock,
   if (_clutter_context_get_show_fps ())
     begin_frame_timing_measurement (view);
 
-  _clutter_run_repaint_functions (CLUTTER_REPAINT_FLAGS_PRE_PAINT);
+  if (clutter_stage_begin_tick_update (stage))
+    _clutter_run_repaint_functions (CLUTTER_REPAINT_FLAGS_PRE_PAINT);
   clutter_stage_emit_before_update (stage, view);
 
   clutter_stage_maybe_relayout (CLUTTER_ACTOR (stage));
@@ -1208,6 +1191,7 @@ handle_frame_clock_frame (ClutterFrameClock *frame_clock,
 }
 
 static const ClutterFrameListenerIface frame_clock_listener_iface = {
+  .dispatch = handle_frame_clock_dispatch,
   .before_frame = handle_frame_clock_before_frame,
   .frame = handle_frame_clock_frame,
 };
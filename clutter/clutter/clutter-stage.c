@@ -99,6 +99,22 @@ typedef struct _PointerDeviceEntry
   cairo_region_t *clear_area;
 } PointerDeviceEntry;
 
+typedef struct _DamageEntry
+{
+  uint64_t serial;
+  /* Weak pointer, the history must not keep destroyed actors alive */
+  ClutterActor *actor;
+  gboolean has_rect;
+  cairo_rectangle_int_t rect;
+} DamageEntry;
+
+/* Upper bound of damage entries kept around for damage history users */
+#define MAX_DAMAGE_HISTORY 256
+
+/* Updates of other views due within this much of the one being dispatched
+ * are pulled forward and dispatched along with it. */
+#define TICK_GROUP_WINDOW_US 1000
+
 struct _ClutterStagePrivate
 {
   /* the stage implementation */
@@ -125,6 +141,14 @@ struct _ClutterStagePrivate
   gboolean needs_update_devices;
   gboolean pending_finish_queue_redraws;
 
+  GQueue damage_history;
+  int damage_history_users;
+  uint64_t damage_serial;
+  uint64_t damage_history_start;
+
+  uint64_t tick_serial;
+  uint64_t updated_tick_serial;
+
   GHashTable *pointer_devices;
   GHashTable *touch_sequences;
 
@@ -167,6 +191,7 @@ static const ClutterColor default_stage_color = { 255, 255, 255, 255 };
 
 static void free_queue_redraw_entry (QueueRedrawEntry *entry);
 static void free_pointer_device_entry (PointerDeviceEntry *entry);
+static void free_damage_entry (DamageEntry *entry);
 static void clutter_stage_update_view_perspective (ClutterStage *stage);
 static void clutter_stage_set_viewport (ClutterStage *stage,
                                         float         width,
@@ -243,6 +268,41 @@ clutter_stage_add_redraw_clip (ClutterStage          *stage,
     }
 }
 
+static void
+clutter_stage_record_damage (ClutterStage                *stage,
+                             ClutterActor                *actor,
+                             const cairo_rectangle_int_t *rect)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  DamageEntry *entry;
+
+  if (priv->damage_history_users == 0)
+    return;
+
+  entry = g_new0 (DamageEntry, 1);
+  entry->serial = ++priv->damage_serial;
+  if (actor)
+    {
+      entry->actor = actor;
+      g_object_add_weak_pointer (G_OBJECT (actor), (gpointer *) &entry->actor);
+    }
+  if (rect)
+    {
+      entry->has_rect = TRUE;
+      entry->rect = *rect;
+    }
+
+  g_queue_push_tail (&priv->damage_history, entry);
+
+  while (g_queue_get_length (&priv->damage_history) > MAX_DAMAGE_HISTORY)
+    {
+      DamageEntry *oldest = g_queue_pop_head (&priv->damage_history);
+
+      priv->damage_history_start = oldest->serial;
+      free_damage_entry (oldest);
+    }
+}
+
 static inline void
 queue_full_redraw (ClutterStage *stage)
 {
@@ -261,6 +321,7 @@ queue_full_redraw (ClutterStage *stage)
   if (stage_window == NULL)
     return;
 
+  clutter_stage_record_damage (stage, NULL, NULL);
   clutter_stage_add_redraw_clip (stage, NULL);
 }
 
@@ -854,6 +915,117 @@ clutter_stage_find_updated_devices (ClutterStage *stage)
   return updating;
 }
 
+static int
+compare_frame_clock_deadlines (gconstpointer a,
+                               gconstpointer b)
+{
+  ClutterFrameClock *frame_clock_a = *((ClutterFrameClock **) a);
+  ClutterFrameClock *frame_clock_b = *((ClutterFrameClock **) b);
+  int64_t deadline_a_us = clutter_frame_clock_get_deadline_us (frame_clock_a);
+  int64_t deadline_b_us = clutter_frame_clock_get_deadline_us (frame_clock_b);
+
+  if (deadline_a_us < deadline_b_us)
+    return -1;
+  else if (deadline_a_us > deadline_b_us)
+    return 1;
+  else
+    return 0;
+}
+
+/*
+ * Dispatches the due update of @frame_clock together with the updates of all
+ * other stage views that are due at about the same time, forming a tick
+ * group. The view independent part of the stage update only runs for the
+ * first view of a tick group, see clutter_stage_begin_tick_update(), and the
+ * views are painted in the order of their deadlines, so that a view close to
+ * its deadline isn't held up by one that still has time to spare.
+ */
+void
+clutter_stage_dispatch_tick_group (ClutterStage      *stage,
+                                   ClutterFrameClock *frame_clock,
+                                   int64_t            time_us)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  g_autoptr (GPtrArray) frame_clocks = NULL;
+  GList *l;
+  unsigned int i;
+
+  COGL_TRACE_BEGIN_SCOPED (ClutterStageDispatchTickGroup,
+                           "Dispatch tick group");
+
+  frame_clocks = g_ptr_array_new_with_free_func (g_object_unref);
+  g_ptr_array_add (frame_clocks, g_object_ref (frame_clock));
+
+  for (l = clutter_stage_peek_stage_views (stage); l; l = l->next)
+    {
+      ClutterStageView *view = l->data;
+      ClutterFrameClock *view_frame_clock =
+        clutter_stage_view_get_frame_clock (view);
+      int64_t next_update_time_us;
+
+      if (view_frame_clock == frame_clock)
+        continue;
+
+      next_update_time_us =
+        clutter_frame_clock_get_next_update_time_us (view_frame_clock);
+      if (next_update_time_us == -1 ||
+          next_update_time_us > time_us + TICK_GROUP_WINDOW_US)
+        continue;
+
+      g_ptr_array_add (frame_clocks, g_object_ref (view_frame_clock));
+    }
+
+  g_ptr_array_sort (frame_clocks, compare_frame_clock_deadlines);
+
+  priv->tick_serial++;
+
+  for (i = 0; i < frame_clocks->len; i++)
+    {
+      ClutterFrameClock *group_frame_clock = g_ptr_array_index (frame_clocks, i);
+
+      /* Painting an earlier view may have rebuilt the stage views */
+      if (clutter_frame_clock_get_next_update_time_us (group_frame_clock) == -1)
+        continue;
+
+      clutter_frame_clock_dispatch_now (group_frame_clock, time_us);
+    }
+}
+
+/*
+ * Returns whether the view independent part of the stage update still needs to
+ * run during the current tick group, and marks it as done if so.
+ */
+gboolean
+clutter_stage_begin_tick_update (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+
+  if (priv->updated_tick_serial == priv->tick_serial)
+    return FALSE;
+
+  priv->updated_tick_serial = priv->tick_serial;
+  return TRUE;
+}
+
+/**
+ * clutter_stage_get_tick_serial:
+ * @stage: a #ClutterStage
+ *
+ * Retrieves the serial of the current tick group, i.e. the stage views that
+ * are updated together within a single main loop iteration. Can be used by
+ * #ClutterStage::before-update handlers to do view independent work only once
+ * per tick group.
+ *
+ * Returns: the serial of the current tick group
+ */
+uint64_t
+clutter_stage_get_tick_serial (ClutterStage *stage)
+{
+  g_return_val_if_fail (CLUTTER_IS_STAGE (stage), 0);
+
+  return stage->priv->tick_serial;
+}
+
 void
 clutter_stage_finish_layout (ClutterStage *stage)
 {
@@ -1177,6 +1349,9 @@ clutter_stage_dispose (GObject *object)
 
   g_hash_table_remove_all (priv->pending_queue_redraws);
 
+  g_queue_clear_full (&priv->damage_history,
+                      (GDestroyNotify) free_damage_entry);
+
   g_slist_free_full (priv->pending_relayouts,
                      (GDestroyNotify) g_object_unref);
   priv->pending_relayouts = NULL;
@@ -2587,8 +2762,20 @@ clutter_stage_dequeue_actor_redraw (ClutterStage *self,
   g_hash_table_remove (self->priv->pending_queue_redraws, actor);
 }
 
+static void
+free_damage_entry (DamageEntry *entry)
+{
+  if (entry->actor)
+    {
+      g_object_remove_weak_pointer (G_OBJECT (entry->actor),
+                                    (gpointer *) &entry->actor);
+    }
+  g_free (entry);
+}
+
 static void
 add_to_stage_clip (ClutterStage       *stage,
+                   ClutterActor       *actor,
                    ClutterPaintVolume *redraw_clip)
 {
   ClutterStageWindow *stage_window;
@@ -2603,11 +2790,16 @@ add_to_stage_clip (ClutterStage       *stage,
   if (stage_window == NULL)
     return;
 
-  if (is_full_stage_redraw_queued (stage))
+  /* Damage history users still need to know who got damaged, even if the
+   * stage itself is about to be fully redrawn anyway.
+   */
+  if (stage->priv->damage_history_users == 0 &&
+      is_full_stage_redraw_queued (stage))
     return;
 
   if (redraw_clip == NULL)
     {
+      clutter_stage_record_damage (stage, actor, NULL);
       clutter_stage_add_redraw_clip (stage, NULL);
       return;
     }
@@ -2639,6 +2831,7 @@ add_to_stage_clip (ClutterStage       *stage,
   stage_clip.width = intersection_box.x2 - stage_clip.x;
   stage_clip.height = intersection_box.y2 - stage_clip.y;
 
+  clutter_stage_record_damage (stage, actor, &stage_clip);
   clutter_stage_add_redraw_clip (stage, &stage_clip);
 }
 
@@ -2673,7 +2866,7 @@ clutter_stage_maybe_finish_queue_redraws (ClutterStage *stage)
 
           if (entry->has_clip)
             {
-              add_to_stage_clip (stage, &entry->clip);
+              add_to_stage_clip (stage, redraw_actor, &entry->clip);
             }
           else if (clutter_actor_get_redraw_clip (redraw_actor,
                                                   &old_actor_pv,
@@ -2686,15 +2879,15 @@ clutter_stage_maybe_finish_queue_redraws (ClutterStage *stage)
                * The former we do to ensure the old texture on the screen
                * will be fully painted over in case the actor was moved.
                */
-              add_to_stage_clip (stage, &old_actor_pv);
-              add_to_stage_clip (stage, &new_actor_pv);
+              add_to_stage_clip (stage, redraw_actor, &old_actor_pv);
+              add_to_stage_clip (stage, redraw_actor, &new_actor_pv);
             }
           else
             {
               /* If there's no clip we can use, we have to trigger an
                * unclipped full stage redraw.
                */
-              add_to_stage_clip (stage, NULL);
+              add_to_stage_clip (stage, redraw_actor, NULL);
             }
         }
 
@@ -2891,6 +3084,122 @@ clutter_stage_get_frame_counter (ClutterStage          *stage)
   return _clutter_stage_window_get_frame_counter (stage_window);
 }
 
+/**
+ * clutter_stage_track_damage_history:
+ * @stage: a #ClutterStage
+ *
+ * Starts recording which actors damaged which parts of the stage, so that
+ * the history can later be queried using
+ * clutter_stage_foreach_damage_since(). Every call must be balanced by a
+ * call to clutter_stage_untrack_damage_history().
+ */
+void
+clutter_stage_track_damage_history (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_STAGE (stage));
+
+  priv = stage->priv;
+
+  if (priv->damage_history_users++ == 0)
+    priv->damage_history_start = priv->damage_serial;
+}
+
+/**
+ * clutter_stage_untrack_damage_history:
+ * @stage: a #ClutterStage
+ *
+ * Stops recording damage history started by
+ * clutter_stage_track_damage_history().
+ */
+void
+clutter_stage_untrack_damage_history (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_STAGE (stage));
+
+  priv = stage->priv;
+
+  g_return_if_fail (priv->damage_history_users > 0);
+
+  if (--priv->damage_history_users == 0)
+    {
+      g_queue_clear_full (&priv->damage_history,
+                          (GDestroyNotify) free_damage_entry);
+    }
+}
+
+/**
+ * clutter_stage_get_damage_serial:
+ * @stage: a #ClutterStage
+ *
+ * Returns: the serial of the most recently recorded damage
+ */
+uint64_t
+clutter_stage_get_damage_serial (ClutterStage *stage)
+{
+  g_return_val_if_fail (CLUTTER_IS_STAGE (stage), 0);
+
+  return stage->priv->damage_serial;
+}
+
+/**
+ * clutter_stage_foreach_damage_since:
+ * @stage: a #ClutterStage
+ * @serial: a serial previously returned by clutter_stage_get_damage_serial()
+ * @func: (scope call): function called for each recorded damage
+ * @user_data: user data passed to @func
+ *
+ * Calls @func for every damage recorded after @serial. The actor passed to
+ * @func is %NULL if the damage wasn't caused by any actor in particular, or
+ * if the actor is no longer part of @stage, and the rectangle is %NULL if
+ * the whole stage was damaged. The history doesn't keep damaging actors
+ * alive.
+ *
+ * Returns: %FALSE if the history doesn't reach back to @serial, in which
+ *   case the caller must assume everything was damaged
+ */
+gboolean
+clutter_stage_foreach_damage_since (ClutterStage           *stage,
+                                    uint64_t                serial,
+                                    ClutterStageDamageFunc  func,
+                                    gpointer                user_data)
+{
+  ClutterStagePrivate *priv;
+  GList *l;
+
+  g_return_val_if_fail (CLUTTER_IS_STAGE (stage), FALSE);
+
+  priv = stage->priv;
+
+  if (priv->damage_history_users == 0 ||
+      serial < priv->damage_history_start)
+    return FALSE;
+
+  for (l = g_queue_peek_tail_link (&priv->damage_history); l; l = l->prev)
+    {
+      DamageEntry *entry = l->data;
+      ClutterActor *actor = entry->actor;
+
+      if (entry->serial <= serial)
+        break;
+
+      /* Actors that were since destroyed or removed from the stage can't
+       * be placed in the paint order anymore, so report their damage as
+       * not coming from any actor in particular. */
+      if (actor &&
+          (CLUTTER_ACTOR_IN_DESTRUCTION (actor) ||
+           clutter_actor_get_stage (actor) != CLUTTER_ACTOR (stage)))
+        actor = NULL;
+
+      func (actor, entry->has_rect ? &entry->rect : NULL, user_data);
+    }
+
+  return TRUE;
+}
+
 void
 clutter_stage_presented (ClutterStage     *stage,
                          ClutterStageView *view,
@@ -459,6 +459,15 @@ meta_cursor_renderer_update_position (MetaCursorRenderer *renderer)
   meta_cursor_renderer_update_cursor (renderer, priv->displayed_cursor);
 }
 
+gboolean
+meta_cursor_renderer_is_painted_on_stage (MetaCursorRenderer *renderer)
+{
+  MetaCursorRendererPrivate *priv =
+    meta_cursor_renderer_get_instance_private (renderer);
+
+  return priv->displayed_cursor && !priv->handled_by_backend;
+}
+
 MetaCursorSprite *
 meta_cursor_renderer_get_cursor (MetaCursorRenderer *renderer)
 {
@@ -21,8 +21,10 @@
 #include "backends/meta-monitor-manager-private.h"
 #include "backends/meta-stage-impl-private.h"
 #include "backends/meta-stage-view-private.h"
+#include "core/util-private.h"
 
 #define META_TYPE_RENDERER_VIEW (meta_renderer_view_get_type ())
+META_EXPORT_TEST
 G_DECLARE_FINAL_TYPE (MetaRendererView, meta_renderer_view,
                       META, RENDERER_VIEW,
                       MetaStageView)
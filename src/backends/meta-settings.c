@@ -275,6 +275,8 @@ experimental_features_handler (GVariant *features_variant,
         feature = META_EXPERIMENTAL_FEATURE_DMA_BUF_SCREEN_SHARING;
       else if (g_str_equal (feature_str, "autoclose-xwayland"))
         feature = META_EXPERIMENTAL_FEATURE_AUTOCLOSE_XWAYLAND;
+      else if (g_str_equal (feature_str, "triple-buffering"))
+        feature = META_EXPERIMENTAL_FEATURE_TRIPLE_BUFFERING;
 
       if (feature)
         g_message ("Enabling experimental feature '%s'", feature_str);
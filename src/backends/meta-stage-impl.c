@@ -199,6 +199,35 @@ paint_damage_region (ClutterStageWindow *stage_window,
   cogl_framebuffer_pop_matrix (framebuffer);
 }
 
+static cairo_region_t *
+transform_swap_region_to_onscreen (ClutterStageView *stage_view,
+                                   cairo_region_t   *swap_region)
+{
+  CoglFramebuffer *onscreen = clutter_stage_view_get_onscreen (stage_view);
+  int n_rects, i;
+  cairo_rectangle_int_t *rects;
+  cairo_region_t *transformed_region;
+  int width, height;
+
+  width = cogl_framebuffer_get_width (onscreen);
+  height = cogl_framebuffer_get_height (onscreen);
+
+  n_rects = cairo_region_num_rectangles (swap_region);
+  rects = g_newa (cairo_rectangle_int_t, n_rects);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_region_get_rectangle (swap_region, i, &rects[i]);
+      clutter_stage_view_transform_rect_to_onscreen (stage_view,
+                                                     &rects[i],
+                                                     width,
+                                                     height,
+                                                     &rects[i]);
+    }
+  transformed_region = cairo_region_create_rectangles (rects, n_rects);
+
+  return transformed_region;
+}
+
 static void
 queue_damage_region (ClutterStageWindow *stage_window,
                      ClutterStageView   *stage_view,
@@ -206,6 +235,7 @@ queue_damage_region (ClutterStageWindow *stage_window,
 {
   int *damage, n_rects, i;
   g_autofree int *freeme = NULL;
+  cairo_region_t *onscreen_damage_region = NULL;
   CoglFramebuffer *framebuffer;
   CoglOnscreen *onscreen;
 
@@ -218,6 +248,15 @@ queue_damage_region (ClutterStageWindow *stage_window,
 
   onscreen = COGL_ONSCREEN (framebuffer);
 
+  /* The damage is in the coordinates of the view framebuffer, which are
+   * rotated or flipped with respect to the onscreen for transformed views. */
+  if (framebuffer != clutter_stage_view_get_framebuffer (stage_view))
+    {
+      onscreen_damage_region =
+        transform_swap_region_to_onscreen (stage_view, damage_region);
+      damage_region = onscreen_damage_region;
+    }
+
   n_rects = cairo_region_num_rectangles (damage_region);
 
   if (n_rects < MAX_STACK_RECTS)
@@ -239,6 +278,8 @@ queue_damage_region (ClutterStageWindow *stage_window,
     }
 
   cogl_onscreen_queue_damage_region (onscreen, damage, n_rects);
+
+  g_clear_pointer (&onscreen_damage_region, cairo_region_destroy);
 }
 
 static void
@@ -390,43 +431,15 @@ scale_offset_and_clamp_region (const cairo_region_t *region,
 static void
 paint_stage (MetaStageImpl    *stage_impl,
              ClutterStageView *stage_view,
-             cairo_region_t   *redraw_clip)
+             cairo_region_t   *redraw_clip,
+             cairo_region_t   *repair_clip)
 {
   ClutterStage *stage = stage_impl->wrapper;
 
   _clutter_stage_maybe_setup_viewport (stage, stage_view);
   clutter_stage_paint_view (stage, stage_view, redraw_clip);
 
-  clutter_stage_view_after_paint (stage_view, redraw_clip);
-}
-
-static cairo_region_t *
-transform_swap_region_to_onscreen (ClutterStageView *stage_view,
-                                   cairo_region_t   *swap_region)
-{
-  CoglFramebuffer *onscreen = clutter_stage_view_get_onscreen (stage_view);
-  int n_rects, i;
-  cairo_rectangle_int_t *rects;
-  cairo_region_t *transformed_region;
-  int width, height;
-
-  width = cogl_framebuffer_get_width (onscreen);
-  height = cogl_framebuffer_get_height (onscreen);
-
-  n_rects = cairo_region_num_rectangles (swap_region);
-  rects = g_newa (cairo_rectangle_int_t, n_rects);
-  for (i = 0; i < n_rects; i++)
-    {
-      cairo_region_get_rectangle (swap_region, i, &rects[i]);
-      clutter_stage_view_transform_rect_to_onscreen (stage_view,
-                                                     &rects[i],
-                                                     width,
-                                                     height,
-                                                     &rects[i]);
-    }
-  transformed_region = cairo_region_create_rectangles (rects, n_rects);
-
-  return transformed_region;
+  clutter_stage_view_after_paint (stage_view, redraw_clip, repair_clip);
 }
 
 static void
@@ -445,8 +458,10 @@ meta_stage_impl_redraw_view_primary (MetaStageImpl    *stage_impl,
   gboolean has_buffer_age;
   gboolean swap_with_damage;
   cairo_region_t *redraw_clip;
+  cairo_region_t *paint_redraw_clip = NULL;
   cairo_region_t *queued_redraw_clip = NULL;
   cairo_region_t *fb_clip_region;
+  cairo_region_t *paint_fb_clip_region = NULL;
   cairo_region_t *swap_region;
   ClutterDrawDebugFlag paint_debug_flags;
   ClutterDamageHistory *damage_history;
@@ -536,6 +551,13 @@ meta_stage_impl_redraw_view_primary (MetaStageImpl    *stage_impl,
 
   g_return_if_fail (!cairo_region_is_empty (fb_clip_region));
 
+  /* A framebuffer that keeps its contents only needs this frame's damage
+   * painted; the damage of older frames is only repaired on the onscreen,
+   * from what was retained. */
+  if (use_clipped_redraw &&
+      clutter_stage_view_has_persistent_framebuffer (stage_view))
+    paint_fb_clip_region = cairo_region_copy (fb_clip_region);
+
   swap_with_damage = FALSE;
   if (has_buffer_age)
     {
@@ -580,6 +602,15 @@ meta_stage_impl_redraw_view_primary (MetaStageImpl    *stage_impl,
                                                    1.0 / fb_scale,
                                                    view_rect.x,
                                                    view_rect.y);
+
+      if (paint_fb_clip_region)
+        {
+          paint_redraw_clip =
+            scale_offset_and_clamp_region (paint_fb_clip_region,
+                                           1.0 / fb_scale,
+                                           view_rect.x,
+                                           view_rect.y);
+        }
     }
 
   if (paint_debug_flags & CLUTTER_DEBUG_PAINT_DAMAGE_REGION)
@@ -587,16 +618,30 @@ meta_stage_impl_redraw_view_primary (MetaStageImpl    *stage_impl,
       cairo_region_t *debug_redraw_clip;
 
       debug_redraw_clip = cairo_region_create_rectangle (&view_rect);
-      paint_stage (stage_impl, stage_view, debug_redraw_clip);
+      paint_stage (stage_impl, stage_view,
+                   debug_redraw_clip, debug_redraw_clip);
       cairo_region_destroy (debug_redraw_clip);
     }
   else if (use_clipped_redraw)
     {
       queue_damage_region (stage_window, stage_view, fb_clip_region);
 
-      cogl_framebuffer_push_region_clip (fb, fb_clip_region);
+      if (paint_fb_clip_region)
+        {
+          meta_topic (META_DEBUG_BACKEND,
+                      "Painting %d of %d damage rects into persistent "
+                      "framebuffer",
+                      cairo_region_num_rectangles (paint_fb_clip_region),
+                      cairo_region_num_rectangles (fb_clip_region));
 
-      paint_stage (stage_impl, stage_view, redraw_clip);
+          cogl_framebuffer_push_region_clip (fb, paint_fb_clip_region);
+          paint_stage (stage_impl, stage_view, paint_redraw_clip, redraw_clip);
+        }
+      else
+        {
+          cogl_framebuffer_push_region_clip (fb, fb_clip_region);
+          paint_stage (stage_impl, stage_view, redraw_clip, redraw_clip);
+        }
 
       cogl_framebuffer_pop_clip (fb);
     }
@@ -604,7 +649,7 @@ meta_stage_impl_redraw_view_primary (MetaStageImpl    *stage_impl,
     {
       meta_topic (META_DEBUG_BACKEND, "Unclipped stage paint");
 
-      paint_stage (stage_impl, stage_view, redraw_clip);
+      paint_stage (stage_impl, stage_view, redraw_clip, redraw_clip);
     }
 
   /* XXX: It seems there will be a race here in that the stage
@@ -621,7 +666,9 @@ meta_stage_impl_redraw_view_primary (MetaStageImpl    *stage_impl,
     swap_region = cairo_region_create ();
 
   g_clear_pointer (&redraw_clip, cairo_region_destroy);
+  g_clear_pointer (&paint_redraw_clip, cairo_region_destroy);
   g_clear_pointer (&fb_clip_region, cairo_region_destroy);
+  g_clear_pointer (&paint_fb_clip_region, cairo_region_destroy);
 
   COGL_TRACE_BEGIN_SCOPED (MetaStageImplRedrawViewSwapFramebuffer,
                            "Paint (swap framebuffer)");
@@ -224,6 +224,8 @@ meta_backend_native_post_init (MetaBackend *backend)
 
       if (rtkit_proxy)
         {
+          MetaBackendNative *backend_native = META_BACKEND_NATIVE (backend);
+          pid_t kms_thread_id;
           uint32_t priority;
 
           priority = sched_get_priority_min (SCHED_RR);
@@ -232,6 +234,18 @@ meta_backend_native_post_init (MetaBackend *backend)
                                                                   priority,
                                                                   NULL,
                                                                   &error);
+
+          /* Page flip events and cursor updates are handled by the KMS
+           * thread, which shouldn't be starved by other processes either. */
+          kms_thread_id = meta_kms_get_impl_thread_id (backend_native->kms);
+          if (!error && kms_thread_id)
+            {
+              meta_dbus_realtime_kit1_call_make_thread_realtime_sync (rtkit_proxy,
+                                                                      kms_thread_id,
+                                                                      priority,
+                                                                      NULL,
+                                                                      &error);
+            }
         }
 
       if (error)
@@ -580,6 +594,8 @@ meta_backend_native_initable_init (GInitable     *initable,
   kms_flags = META_KMS_FLAG_NONE;
   if (native->is_headless)
     kms_flags |= META_KMS_FLAG_NO_MODE_SETTING;
+  if (g_strcmp0 (g_getenv ("MUTTER_DEBUG_KMS_THREAD"), "0") == 0)
+    kms_flags |= META_KMS_FLAG_NO_IMPL_THREAD;
 
   native->kms = meta_kms_new (META_BACKEND (native), kms_flags, error);
   if (!native->kms)
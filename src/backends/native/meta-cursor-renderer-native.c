@@ -42,6 +42,7 @@
 #include "backends/native/meta-crtc-kms.h"
 #include "backends/native/meta-device-pool.h"
 #include "backends/native/meta-drm-buffer-gbm.h"
+#include "backends/native/meta-kms-cursor-manager.h"
 #include "backends/native/meta-kms-device.h"
 #include "backends/native/meta-kms-plane.h"
 #include "backends/native/meta-kms-update.h"
@@ -99,6 +100,14 @@ struct _MetaCursorRendererNativePrivate
 
   MetaCursorSprite *last_cursor;
   guint animation_timeout_id;
+
+  struct {
+    MetaCursorSprite *sprite;
+    CoglTexture *texture;
+    int hot_x;
+    int hot_y;
+    float texture_scale;
+  } shown_sprite;
 };
 typedef struct _MetaCursorRendererNativePrivate MetaCursorRendererNativePrivate;
 
@@ -282,11 +291,22 @@ ensure_crtc_cursor_data (MetaCrtcKms *crtc_kms)
   return crtc_cursor_data;
 }
 
+static MetaKmsCursorManager *
+get_kms_cursor_manager (MetaCursorRendererNative *native)
+{
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+  MetaBackendNative *backend_native = META_BACKEND_NATIVE (priv->backend);
+  MetaKms *kms = meta_backend_native_get_kms (backend_native);
+
+  return meta_kms_get_cursor_manager (kms);
+}
+
 static void
 assign_cursor_plane (MetaCursorRendererNative *native,
                      MetaCrtcKms              *crtc_kms,
-                     int                       x,
-                     int                       y,
+                     MetaKmsCursorPlacement   *placement,
+                     const graphene_point_t   *position,
                      MetaCursorSprite         *cursor_sprite)
 {
   MetaCrtc *crtc = META_CRTC (crtc_kms);
@@ -296,12 +316,14 @@ assign_cursor_plane (MetaCursorRendererNative *native,
     meta_cursor_renderer_native_gpu_data_from_gpu (gpu_kms);
   MetaCursorNativeGpuState *cursor_gpu_state =
     get_cursor_gpu_state (cursor_priv, gpu_kms);
+  MetaKmsCursorManager *kms_cursor_manager = get_kms_cursor_manager (native);
   MetaKmsCrtc *kms_crtc;
   MetaKmsDevice *kms_device;
   MetaKmsPlane *cursor_plane;
   MetaDrmBuffer *buffer;
   int cursor_width, cursor_height;
   MetaFixed16Rectangle src_rect;
+  MetaRectangle cursor_rect;
   MetaRectangle dst_rect;
   MetaDrmBuffer *crtc_buffer;
   MetaKmsAssignPlaneFlag flags;
@@ -321,8 +343,25 @@ assign_cursor_plane (MetaCursorRendererNative *native,
   cursor_plane = meta_kms_device_get_cursor_plane_for (kms_device, kms_crtc);
   g_return_if_fail (cursor_plane);
 
+  calculate_crtc_cursor_hotspot (cursor_sprite,
+                                 &cursor_hotspot_x,
+                                 &cursor_hotspot_y);
+
   cursor_width = cursor_renderer_gpu_data->cursor_width;
   cursor_height = cursor_renderer_gpu_data->cursor_height;
+  placement->buffer_width = cursor_width;
+  placement->buffer_height = cursor_height;
+  placement->buffer_hotspot_x = cursor_hotspot_x;
+  placement->buffer_hotspot_y = cursor_hotspot_y;
+
+  meta_kms_cursor_manager_update_sprite (kms_cursor_manager,
+                                         kms_crtc,
+                                         cursor_plane,
+                                         buffer,
+                                         placement);
+
+  cursor_rect = meta_kms_cursor_placement_calculate_rect (placement, position);
+
   src_rect = (MetaFixed16Rectangle) {
     .x = meta_fixed_16_from_int (0),
     .y = meta_fixed_16_from_int (0),
@@ -330,8 +369,8 @@ assign_cursor_plane (MetaCursorRendererNative *native,
     .height = meta_fixed_16_from_int (cursor_height),
   };
   dst_rect = (MetaRectangle) {
-    .x = x,
-    .y = y,
+    .x = cursor_rect.x,
+    .y = cursor_rect.y,
     .width = cursor_width,
     .height = cursor_height,
   };
@@ -353,9 +392,6 @@ assign_cursor_plane (MetaCursorRendererNative *native,
                                                    dst_rect,
                                                    flags);
 
-  calculate_crtc_cursor_hotspot (cursor_sprite,
-                                 &cursor_hotspot_x,
-                                 &cursor_hotspot_y);
   meta_kms_plane_assignment_set_cursor_hotspot (plane_assignment,
                                                 cursor_hotspot_x,
                                                 cursor_hotspot_y);
@@ -402,75 +438,68 @@ set_crtc_cursor (MetaCursorRendererNative *cursor_renderer_native,
   MetaLogicalMonitor *logical_monitor =
     meta_monitor_get_logical_monitor (monitor);
   const MetaCrtcConfig *crtc_config = meta_crtc_get_config (crtc);
+  MetaKmsCursorManager *kms_cursor_manager =
+    get_kms_cursor_manager (cursor_renderer_native);
   graphene_rect_t rect;
-  graphene_rect_t local_crtc_rect;
-  graphene_rect_t local_cursor_rect;
-  float view_scale;
-  float crtc_cursor_x, crtc_cursor_y;
+  graphene_point_t position;
   CoglTexture *texture;
   int tex_width, tex_height;
+  int hot_x, hot_y;
+  float texture_scale;
   float cursor_crtc_scale;
-  MetaRectangle cursor_rect;
   MetaMonitorTransform transform;
-  MetaMonitorTransform inverted_transform;
   MetaMonitorMode *monitor_mode;
   MetaMonitorCrtcMode *monitor_crtc_mode;
   const MetaCrtcModeInfo *crtc_mode_info;
-
-  view_scale = clutter_stage_view_get_scale (CLUTTER_STAGE_VIEW (view));
-
-  rect = meta_cursor_renderer_calculate_rect (cursor_renderer, cursor_sprite);
-  local_cursor_rect =
-    GRAPHENE_RECT_INIT (rect.origin.x - logical_monitor->rect.x,
-                        rect.origin.y - logical_monitor->rect.y,
-                        rect.size.width,
-                        rect.size.height);
-
-  local_crtc_rect = crtc_config->layout;
-  graphene_rect_offset (&local_crtc_rect,
-                        -logical_monitor->rect.x,
-                        -logical_monitor->rect.y);
-
-  crtc_cursor_x = (local_cursor_rect.origin.x -
-                   local_crtc_rect.origin.x) * view_scale;
-  crtc_cursor_y = (local_cursor_rect.origin.y -
-                   local_crtc_rect.origin.y) * view_scale;
+  MetaKmsCursorPlacement placement;
 
   texture = meta_cursor_sprite_get_cogl_texture (cursor_sprite);
   tex_width = cogl_texture_get_width (texture);
   tex_height = cogl_texture_get_height (texture);
 
+  meta_cursor_sprite_get_hotspot (cursor_sprite, &hot_x, &hot_y);
+  texture_scale = meta_cursor_sprite_get_texture_scale (cursor_sprite);
+
   cursor_crtc_scale =
     calculate_cursor_crtc_sprite_scale (cursor_sprite,
                                         logical_monitor);
 
-  cursor_rect = (MetaRectangle) {
-    .x = floorf (crtc_cursor_x),
-    .y = floorf (crtc_cursor_y),
-    .width = roundf (tex_width * cursor_crtc_scale),
-    .height = roundf (tex_height * cursor_crtc_scale)
-  };
-
   transform = meta_logical_monitor_get_transform (logical_monitor);
   transform = meta_monitor_logical_to_crtc_transform (monitor, transform);
 
-  inverted_transform = meta_monitor_transform_invert (transform);
-
   monitor_mode = meta_monitor_get_current_mode (monitor);
   monitor_crtc_mode = meta_monitor_get_crtc_mode_for_output (monitor,
                                                              monitor_mode,
                                                              output);
   crtc_mode_info = meta_crtc_mode_get_info (monitor_crtc_mode->crtc_mode);
-  meta_rectangle_transform (&cursor_rect,
-                            inverted_transform,
-                            crtc_mode_info->width,
-                            crtc_mode_info->height,
-                            &cursor_rect);
+
+  placement = (MetaKmsCursorPlacement) {
+    .layout = crtc_config->layout,
+    .scale = clutter_stage_view_get_scale (CLUTTER_STAGE_VIEW (view)),
+    .transform = meta_monitor_transform_invert (transform),
+    .mode_width = crtc_mode_info->width,
+    .mode_height = crtc_mode_info->height,
+    .hotspot = GRAPHENE_POINT_INIT (hot_x * texture_scale,
+                                    hot_y * texture_scale),
+    .width = roundf (tex_width * cursor_crtc_scale),
+    .height = roundf (tex_height * cursor_crtc_scale),
+  };
+
+  /* Prefer the position most recently reported by the input thread, which may
+   * already have moved the cursor plane past the position of the motion
+   * event being processed here. */
+  if (!meta_kms_cursor_manager_get_position (kms_cursor_manager, &position))
+    {
+      rect = meta_cursor_renderer_calculate_rect (cursor_renderer,
+                                                  cursor_sprite);
+      position = GRAPHENE_POINT_INIT (rect.origin.x + placement.hotspot.x,
+                                      rect.origin.y + placement.hotspot.y);
+    }
 
   assign_cursor_plane (cursor_renderer_native,
                        META_CRTC_KMS (crtc),
-                       cursor_rect.x,
-                       cursor_rect.y,
+                       &placement,
+                       &position,
                        cursor_sprite);
 }
 
@@ -499,6 +528,11 @@ unset_crtc_cursor (MetaCursorRendererNative *native,
       MetaKms *kms = meta_kms_device_get_kms (kms_device);
       MetaKmsUpdate *kms_update;
 
+      meta_kms_cursor_manager_update_sprite (get_kms_cursor_manager (native),
+                                             kms_crtc,
+                                             cursor_plane,
+                                             NULL, NULL);
+
       kms_update = meta_kms_ensure_pending_update (kms, kms_device);
       meta_kms_update_unassign_plane (kms_update, kms_crtc, cursor_plane);
     }
@@ -522,6 +556,22 @@ disable_hw_cursor_for_crtc (MetaKmsCrtc  *kms_crtc,
   cursor_renderer_gpu_data->hw_cursor_broken = TRUE;
 }
 
+static void
+update_shown_sprite (MetaCursorRendererNative *native,
+                     MetaCursorSprite         *cursor_sprite)
+{
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+
+  priv->shown_sprite.sprite = cursor_sprite;
+  priv->shown_sprite.texture = meta_cursor_sprite_get_cogl_texture (cursor_sprite);
+  meta_cursor_sprite_get_hotspot (cursor_sprite,
+                                  &priv->shown_sprite.hot_x,
+                                  &priv->shown_sprite.hot_y);
+  priv->shown_sprite.texture_scale =
+    meta_cursor_sprite_get_texture_scale (cursor_sprite);
+}
+
 void
 meta_cursor_renderer_native_prepare_frame (MetaCursorRendererNative *cursor_renderer_native,
                                            MetaRendererView         *view)
@@ -568,6 +618,7 @@ meta_cursor_renderer_native_prepare_frame (MetaCursorRendererNative *cursor_rend
     goto unset_cursor;
 
   set_crtc_cursor (cursor_renderer_native, view, crtc, cursor_sprite);
+  update_shown_sprite (cursor_renderer_native, cursor_sprite);
 
   meta_cursor_renderer_emit_painted (cursor_renderer,
                                      cursor_sprite,
@@ -1062,6 +1113,101 @@ schedule_sync_position (MetaCursorRendererNative *cursor_renderer_native)
     }
 }
 
+static gboolean
+is_shown_sprite (MetaCursorRendererNative *native,
+                 MetaCursorSprite         *cursor_sprite)
+{
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+  MetaCursorNativePrivate *cursor_priv;
+  MetaCursorNativeGpuState *cursor_gpu_state;
+  GHashTableIter iter;
+  int hot_x, hot_y;
+
+  if (priv->shown_sprite.sprite != cursor_sprite ||
+      priv->shown_sprite.texture !=
+      meta_cursor_sprite_get_cogl_texture (cursor_sprite) ||
+      priv->shown_sprite.texture_scale !=
+      meta_cursor_sprite_get_texture_scale (cursor_sprite))
+    return FALSE;
+
+  meta_cursor_sprite_get_hotspot (cursor_sprite, &hot_x, &hot_y);
+  if (priv->shown_sprite.hot_x != hot_x ||
+      priv->shown_sprite.hot_y != hot_y)
+    return FALSE;
+
+  cursor_priv = get_cursor_priv (cursor_sprite);
+  if (!cursor_priv)
+    return FALSE;
+
+  g_hash_table_iter_init (&iter, cursor_priv->gpu_states);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &cursor_gpu_state))
+    {
+      if (cursor_gpu_state->pending_buffer_state !=
+          META_CURSOR_BUFFER_STATE_NONE)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+can_skip_sync_position (MetaCursorRendererNative *native,
+                        MetaCursorSprite         *cursor_sprite)
+{
+  MetaCursorRenderer *renderer = META_CURSOR_RENDERER (native);
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+  MetaRenderer *meta_renderer = meta_backend_get_renderer (priv->backend);
+  graphene_point_t position;
+  graphene_rect_t cursor_rect;
+  GList *l;
+
+  if (!priv->has_hw_cursor || !cursor_sprite)
+    return FALSE;
+
+  /* Position changes are only handled by the input thread once it reported
+   * a position. */
+  if (!meta_kms_cursor_manager_get_position (get_kms_cursor_manager (native),
+                                             &position))
+    return FALSE;
+
+  if (!is_shown_sprite (native, cursor_sprite))
+    return FALSE;
+
+  cursor_rect = meta_cursor_renderer_calculate_rect (renderer, cursor_sprite);
+
+  for (l = meta_renderer_get_views (meta_renderer); l; l = l->next)
+    {
+      MetaRendererView *view = l->data;
+      MetaCrtc *crtc = meta_renderer_view_get_crtc (view);
+      CrtcCursorData *crtc_cursor_data;
+      cairo_rectangle_int_t view_layout;
+      graphene_rect_t view_rect;
+      gboolean is_shown;
+      gboolean should_be_shown;
+
+      if (!meta_crtc_get_gpu (crtc))
+        continue;
+
+      crtc_cursor_data = ensure_crtc_cursor_data (META_CRTC_KMS (crtc));
+      if (crtc_cursor_data->hw_state_invalidated)
+        return FALSE;
+
+      clutter_stage_view_get_layout (CLUTTER_STAGE_VIEW (view), &view_layout);
+      view_rect = GRAPHENE_RECT_INIT (view_layout.x, view_layout.y,
+                                      view_layout.width, view_layout.height);
+
+      is_shown = crtc_cursor_data->buffer != NULL;
+      should_be_shown = graphene_rect_intersection (&cursor_rect, &view_rect,
+                                                    NULL);
+      if (is_shown != should_be_shown)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 static gboolean
 meta_cursor_renderer_native_update_cursor (MetaCursorRenderer *renderer,
                                            MetaCursorSprite   *cursor_sprite)
@@ -1087,8 +1233,13 @@ meta_cursor_renderer_native_update_cursor (MetaCursorRenderer *renderer,
 
   priv->has_hw_cursor = should_have_hw_cursor (renderer, cursor_sprite, gpus);
 
-  schedule_sync_position (native);
-  clutter_stage_schedule_update (stage);
+  /* The input thread moves the cursor planes by itself; only sprite changes
+   * and the cursor entering or leaving a CRTC need a new frame. */
+  if (!can_skip_sync_position (native, cursor_sprite))
+    {
+      schedule_sync_position (native);
+      clutter_stage_schedule_update (stage);
+    }
 
   return (priv->has_hw_cursor ||
           !cursor_sprite ||
@@ -1791,9 +1942,22 @@ force_update_hw_cursor (MetaCursorRendererNative *native)
         }
     }
 
+  meta_kms_cursor_manager_reset (get_kms_cursor_manager (native));
   meta_cursor_renderer_force_update (renderer);
 }
 
+static void
+on_cursor_position_update_failed (MetaKmsCursorManager     *kms_cursor_manager,
+                                  MetaCursorRendererNative *native)
+{
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+  ClutterStage *stage = CLUTTER_STAGE (meta_backend_get_stage (priv->backend));
+
+  schedule_sync_position (native);
+  clutter_stage_schedule_update (stage);
+}
+
 static void
 on_monitors_changed (MetaMonitorManager       *monitors,
                      MetaCursorRendererNative *native)
@@ -1874,6 +2038,11 @@ meta_cursor_renderer_native_new (MetaBackend        *backend,
 
   priv->backend = backend;
 
+  g_signal_connect_object (get_kms_cursor_manager (cursor_renderer_native),
+                           "position-update-failed",
+                           G_CALLBACK (on_cursor_position_update_failed),
+                           cursor_renderer_native, 0);
+
   if (g_strcmp0 (getenv ("MUTTER_DEBUG_DISABLE_HW_CURSORS"), "1"))
     init_hw_cursor_support (cursor_renderer_native);
   else
@@ -0,0 +1,499 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/**
+ * SECTION:kms-cursor-manager
+ * @short description: Cursor plane position updates from the input thread
+ * @title: KMS cursor manager
+ *
+ * The cursor manager lets pointer motion move the hardware cursor without
+ * involving the main thread. The cursor renderer publishes, from the main
+ * thread, the cursor plane buffer and the placement parameters of each CRTC
+ * the cursor is currently shown on, i.e. whenever the sprite, the hotspot or
+ * the monitor configuration changes. The input thread reports every new
+ * pointer position, which is then turned into a position only cursor plane
+ * update in the KMS impl context.
+ *
+ * Showing and hiding the cursor on a CRTC is still left to the cursor
+ * renderer, as part of the regular frame updates. If moving a cursor plane
+ * fails, e.g. due to a pending page flip, the manager emits
+ * #MetaKmsCursorManager::position-update-failed in the main context, so that
+ * the next frame places the cursor instead.
+ */
+
+#include "config.h"
+
+#include "backends/native/meta-kms-cursor-manager.h"
+
+#include <math.h>
+
+#include "backends/native/meta-kms-crtc.h"
+#include "backends/native/meta-kms-device.h"
+#include "backends/native/meta-kms-impl.h"
+#include "backends/native/meta-kms-plane.h"
+#include "backends/native/meta-kms-private.h"
+#include "backends/native/meta-kms-update.h"
+#include "core/boxes-private.h"
+#include "meta/util.h"
+
+typedef struct _CrtcCursorState
+{
+  MetaKmsCrtc *crtc;
+  MetaKmsPlane *cursor_plane;
+  MetaDrmBuffer *buffer;
+  MetaKmsCursorPlacement placement;
+
+  gboolean has_rect;
+  MetaRectangle rect;
+} CrtcCursorState;
+
+struct _MetaKmsCursorManager
+{
+  GObject parent;
+
+  MetaKms *kms;
+
+  GMutex mutex;
+
+  /* Protected by 'mutex' */
+  GHashTable *crtc_states;
+  graphene_point_t position;
+  gboolean has_position;
+  gboolean update_queued;
+  gboolean is_shutting_down;
+};
+
+enum
+{
+  POSITION_UPDATE_FAILED,
+
+  N_SIGNALS
+};
+
+static guint signals[N_SIGNALS];
+
+G_DEFINE_TYPE (MetaKmsCursorManager, meta_kms_cursor_manager, G_TYPE_OBJECT)
+
+static void
+crtc_cursor_state_free (CrtcCursorState *crtc_state)
+{
+  g_clear_object (&crtc_state->crtc);
+  g_clear_object (&crtc_state->cursor_plane);
+  g_clear_object (&crtc_state->buffer);
+  g_free (crtc_state);
+}
+
+MetaRectangle
+meta_kms_cursor_placement_calculate_rect (const MetaKmsCursorPlacement *placement,
+                                          const graphene_point_t       *position)
+{
+  float crtc_cursor_x, crtc_cursor_y;
+  MetaRectangle cursor_rect;
+
+  crtc_cursor_x = (position->x - placement->hotspot.x -
+                   placement->layout.origin.x) * placement->scale;
+  crtc_cursor_y = (position->y - placement->hotspot.y -
+                   placement->layout.origin.y) * placement->scale;
+
+  cursor_rect = (MetaRectangle) {
+    .x = floorf (crtc_cursor_x),
+    .y = floorf (crtc_cursor_y),
+    .width = placement->width,
+    .height = placement->height,
+  };
+
+  meta_rectangle_transform (&cursor_rect,
+                            placement->transform,
+                            placement->mode_width,
+                            placement->mode_height,
+                            &cursor_rect);
+
+  return cursor_rect;
+}
+
+typedef struct _CursorPlaneUpdate
+{
+  MetaKmsCrtc *crtc;
+  MetaKmsPlane *cursor_plane;
+  MetaDrmBuffer *buffer;
+  MetaKmsCursorPlacement placement;
+  MetaRectangle rect;
+} CursorPlaneUpdate;
+
+static void
+cursor_plane_update_free (CursorPlaneUpdate *plane_update)
+{
+  g_object_unref (plane_update->crtc);
+  g_object_unref (plane_update->cursor_plane);
+  g_object_unref (plane_update->buffer);
+  g_free (plane_update);
+}
+
+static GList *
+take_cursor_plane_updates (MetaKmsCursorManager *cursor_manager)
+{
+  GList *plane_updates = NULL;
+  GHashTableIter iter;
+  CrtcCursorState *crtc_state;
+
+  g_mutex_lock (&cursor_manager->mutex);
+
+  cursor_manager->update_queued = FALSE;
+
+  g_hash_table_iter_init (&iter, cursor_manager->crtc_states);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &crtc_state))
+    {
+      CursorPlaneUpdate *plane_update;
+      MetaRectangle rect;
+
+      rect = meta_kms_cursor_placement_calculate_rect (&crtc_state->placement,
+                                                       &cursor_manager->position);
+      if (crtc_state->has_rect &&
+          meta_rectangle_equal (&rect, &crtc_state->rect))
+        continue;
+
+      crtc_state->rect = rect;
+      crtc_state->has_rect = TRUE;
+
+      plane_update = g_new0 (CursorPlaneUpdate, 1);
+      *plane_update = (CursorPlaneUpdate) {
+        .crtc = g_object_ref (crtc_state->crtc),
+        .cursor_plane = g_object_ref (crtc_state->cursor_plane),
+        .buffer = g_object_ref (crtc_state->buffer),
+        .placement = crtc_state->placement,
+        .rect = rect,
+      };
+      plane_updates = g_list_prepend (plane_updates, plane_update);
+    }
+
+  g_mutex_unlock (&cursor_manager->mutex);
+
+  return plane_updates;
+}
+
+static void
+forget_crtc_rect (MetaKmsCursorManager *cursor_manager,
+                  MetaKmsCrtc          *crtc)
+{
+  CrtcCursorState *crtc_state;
+
+  g_mutex_lock (&cursor_manager->mutex);
+  crtc_state = g_hash_table_lookup (cursor_manager->crtc_states, crtc);
+  if (crtc_state)
+    crtc_state->has_rect = FALSE;
+  g_mutex_unlock (&cursor_manager->mutex);
+}
+
+static void
+notify_position_update_failed (MetaKms  *kms,
+                               gpointer  user_data)
+{
+  MetaKmsCursorManager *cursor_manager = user_data;
+
+  g_signal_emit (cursor_manager, signals[POSITION_UPDATE_FAILED], 0);
+}
+
+static gpointer
+update_cursor_planes_in_impl (MetaKmsImpl  *impl,
+                              gpointer      user_data,
+                              GError      **error)
+{
+  MetaKmsCursorManager *cursor_manager = user_data;
+  g_autoptr (GHashTable) updates = NULL;
+  GList *plane_updates;
+  GHashTableIter iter;
+  MetaKmsUpdate *update;
+  gboolean has_failed = FALSE;
+  GList *l;
+
+  plane_updates = take_cursor_plane_updates (cursor_manager);
+  if (!plane_updates)
+    return GINT_TO_POINTER (TRUE);
+
+  updates = g_hash_table_new_full (NULL, NULL,
+                                   NULL,
+                                   (GDestroyNotify) meta_kms_update_free);
+
+  for (l = plane_updates; l; l = l->next)
+    {
+      CursorPlaneUpdate *plane_update = l->data;
+      const MetaKmsCursorPlacement *placement = &plane_update->placement;
+      MetaKmsDevice *device = meta_kms_crtc_get_device (plane_update->crtc);
+      MetaKmsPlaneAssignment *plane_assignment;
+      MetaFixed16Rectangle src_rect;
+      MetaRectangle dst_rect;
+
+      if (!meta_kms_crtc_is_active (plane_update->crtc))
+        continue;
+
+      update = g_hash_table_lookup (updates, device);
+      if (!update)
+        {
+          update = meta_kms_update_new (device);
+          g_hash_table_insert (updates, device, update);
+        }
+
+      src_rect = (MetaFixed16Rectangle) {
+        .x = meta_fixed_16_from_int (0),
+        .y = meta_fixed_16_from_int (0),
+        .width = meta_fixed_16_from_int (placement->buffer_width),
+        .height = meta_fixed_16_from_int (placement->buffer_height),
+      };
+      dst_rect = (MetaRectangle) {
+        .x = plane_update->rect.x,
+        .y = plane_update->rect.y,
+        .width = placement->buffer_width,
+        .height = placement->buffer_height,
+      };
+
+      plane_assignment =
+        meta_kms_update_assign_plane (update,
+                                      plane_update->crtc,
+                                      plane_update->cursor_plane,
+                                      plane_update->buffer,
+                                      src_rect,
+                                      dst_rect,
+                                      (META_KMS_ASSIGN_PLANE_FLAG_FB_UNCHANGED |
+                                       META_KMS_ASSIGN_PLANE_FLAG_ALLOW_FAIL));
+      meta_kms_plane_assignment_set_cursor_hotspot (plane_assignment,
+                                                    placement->buffer_hotspot_x,
+                                                    placement->buffer_hotspot_y);
+    }
+
+  g_hash_table_iter_init (&iter, updates);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &update))
+    {
+      g_autoptr (MetaKmsFeedback) feedback = NULL;
+
+      feedback = meta_kms_impl_process_update (impl, update,
+                                               META_KMS_UPDATE_FLAG_NONE);
+      if (meta_kms_feedback_get_result (feedback) != META_KMS_FEEDBACK_PASSED ||
+          meta_kms_feedback_get_failed_planes (feedback))
+        {
+          const GError *feedback_error = meta_kms_feedback_get_error (feedback);
+          GList *failed_planes = meta_kms_feedback_get_failed_planes (feedback);
+
+          if (!feedback_error && failed_planes)
+            {
+              MetaKmsPlaneFeedback *plane_feedback = failed_planes->data;
+
+              feedback_error = plane_feedback->error;
+            }
+
+          /* Most likely a frame update is still pending on the CRTC; let the
+           * main thread place the cursor as part of the next frame instead. */
+          meta_topic (META_DEBUG_KMS,
+                      "Failed to move cursor from the input thread: %s",
+                      feedback_error->message);
+          has_failed = TRUE;
+
+          for (l = plane_updates; l; l = l->next)
+            {
+              CursorPlaneUpdate *plane_update = l->data;
+
+              if (meta_kms_crtc_get_device (plane_update->crtc) ==
+                  meta_kms_update_get_device (update))
+                forget_crtc_rect (cursor_manager, plane_update->crtc);
+            }
+        }
+    }
+
+  g_list_free_full (plane_updates, (GDestroyNotify) cursor_plane_update_free);
+
+  if (has_failed)
+    {
+      meta_kms_queue_callback (cursor_manager->kms,
+                               notify_position_update_failed,
+                               g_object_ref (cursor_manager),
+                               g_object_unref);
+    }
+
+  return GINT_TO_POINTER (TRUE);
+}
+
+/**
+ * meta_kms_cursor_manager_update_sprite:
+ * @cursor_manager: a #MetaKmsCursorManager
+ * @crtc: the #MetaKmsCrtc the cursor is shown on
+ * @cursor_plane: the cursor plane of @crtc
+ * @buffer: (nullable): the cursor plane buffer, or %NULL if the cursor is not
+ *   shown on @crtc
+ * @placement: (nullable): how to place @buffer given a pointer position
+ *
+ * Publishes the cursor sprite state of a CRTC, to be used when the input thread
+ * moves the cursor. Must be called from the main thread.
+ */
+void
+meta_kms_cursor_manager_update_sprite (MetaKmsCursorManager         *cursor_manager,
+                                       MetaKmsCrtc                  *crtc,
+                                       MetaKmsPlane                 *cursor_plane,
+                                       MetaDrmBuffer                *buffer,
+                                       const MetaKmsCursorPlacement *placement)
+{
+  CrtcCursorState *crtc_state;
+
+  g_mutex_lock (&cursor_manager->mutex);
+
+  if (!buffer || cursor_manager->is_shutting_down)
+    {
+      g_hash_table_remove (cursor_manager->crtc_states, crtc);
+      g_mutex_unlock (&cursor_manager->mutex);
+      return;
+    }
+
+  crtc_state = g_hash_table_lookup (cursor_manager->crtc_states, crtc);
+  if (!crtc_state)
+    {
+      crtc_state = g_new0 (CrtcCursorState, 1);
+      crtc_state->crtc = g_object_ref (crtc);
+      g_hash_table_insert (cursor_manager->crtc_states, crtc, crtc_state);
+    }
+
+  g_set_object (&crtc_state->cursor_plane, cursor_plane);
+  g_set_object (&crtc_state->buffer, buffer);
+  crtc_state->placement = *placement;
+  crtc_state->has_rect = FALSE;
+
+  g_mutex_unlock (&cursor_manager->mutex);
+}
+
+/**
+ * meta_kms_cursor_manager_reset:
+ * @cursor_manager: a #MetaKmsCursorManager
+ *
+ * Forgets the cursor sprite state of all CRTCs, e.g. when the monitor
+ * configuration changed, until it is published again.
+ */
+void
+meta_kms_cursor_manager_reset (MetaKmsCursorManager *cursor_manager)
+{
+  g_mutex_lock (&cursor_manager->mutex);
+  g_hash_table_remove_all (cursor_manager->crtc_states);
+  g_mutex_unlock (&cursor_manager->mutex);
+}
+
+gboolean
+meta_kms_cursor_manager_get_position (MetaKmsCursorManager *cursor_manager,
+                                      graphene_point_t     *position)
+{
+  gboolean has_position;
+
+  g_mutex_lock (&cursor_manager->mutex);
+  has_position = cursor_manager->has_position;
+  if (has_position)
+    *position = cursor_manager->position;
+  g_mutex_unlock (&cursor_manager->mutex);
+
+  return has_position;
+}
+
+/**
+ * meta_kms_cursor_manager_position_changed_in_input_impl:
+ * @cursor_manager: a #MetaKmsCursorManager
+ * @position: the new pointer position in stage coordinates
+ *
+ * Moves the cursor planes of all CRTCs the cursor is shown on. Called from the
+ * input thread; the plane updates are processed asynchronously in the KMS
+ * impl context, with consecutive positions coalesced.
+ */
+void
+meta_kms_cursor_manager_position_changed_in_input_impl (MetaKmsCursorManager   *cursor_manager,
+                                                        const graphene_point_t *position)
+{
+  gboolean queue_update = FALSE;
+
+  g_mutex_lock (&cursor_manager->mutex);
+
+  cursor_manager->position = *position;
+  cursor_manager->has_position = TRUE;
+
+  if (!cursor_manager->update_queued &&
+      g_hash_table_size (cursor_manager->crtc_states) > 0)
+    {
+      cursor_manager->update_queued = TRUE;
+      queue_update = TRUE;
+    }
+
+  g_mutex_unlock (&cursor_manager->mutex);
+
+  if (queue_update)
+    {
+      meta_kms_run_impl_task_async (cursor_manager->kms,
+                                    update_cursor_planes_in_impl,
+                                    g_object_ref (cursor_manager),
+                                    g_object_unref);
+    }
+}
+
+void
+meta_kms_cursor_manager_prepare_shutdown (MetaKmsCursorManager *cursor_manager)
+{
+  g_mutex_lock (&cursor_manager->mutex);
+  cursor_manager->is_shutting_down = TRUE;
+  g_hash_table_remove_all (cursor_manager->crtc_states);
+  g_mutex_unlock (&cursor_manager->mutex);
+}
+
+MetaKmsCursorManager *
+meta_kms_cursor_manager_new (MetaKms *kms)
+{
+  MetaKmsCursorManager *cursor_manager;
+
+  cursor_manager = g_object_new (META_TYPE_KMS_CURSOR_MANAGER, NULL);
+  cursor_manager->kms = kms;
+
+  return cursor_manager;
+}
+
+static void
+meta_kms_cursor_manager_finalize (GObject *object)
+{
+  MetaKmsCursorManager *cursor_manager = META_KMS_CURSOR_MANAGER (object);
+
+  g_clear_pointer (&cursor_manager->crtc_states, g_hash_table_unref);
+  g_mutex_clear (&cursor_manager->mutex);
+
+  G_OBJECT_CLASS (meta_kms_cursor_manager_parent_class)->finalize (object);
+}
+
+static void
+meta_kms_cursor_manager_init (MetaKmsCursorManager *cursor_manager)
+{
+  g_mutex_init (&cursor_manager->mutex);
+  cursor_manager->crtc_states =
+    g_hash_table_new_full (NULL, NULL,
+                           NULL,
+                           (GDestroyNotify) crtc_cursor_state_free);
+}
+
+static void
+meta_kms_cursor_manager_class_init (MetaKmsCursorManagerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = meta_kms_cursor_manager_finalize;
+
+  signals[POSITION_UPDATE_FAILED] =
+    g_signal_new ("position-update-failed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 0);
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_KMS_CURSOR_MANAGER_H
+#define META_KMS_CURSOR_MANAGER_H
+
+#include <glib-object.h>
+#include <graphene.h>
+
+#include "backends/meta-monitor-transform.h"
+#include "backends/native/meta-drm-buffer.h"
+#include "backends/native/meta-kms-types.h"
+#include "core/util-private.h"
+#include "meta/boxes.h"
+
+typedef struct _MetaKmsCursorPlacement
+{
+  /* CRTC layout in stage coordinates and the scale of its stage view */
+  graphene_rect_t layout;
+  float scale;
+
+  /* Stage view to CRTC transform, and the size of the current mode */
+  MetaMonitorTransform transform;
+  int mode_width;
+  int mode_height;
+
+  /* Sprite hotspot in stage coordinates, and sprite size in CRTC pixels */
+  graphene_point_t hotspot;
+  int width;
+  int height;
+
+  /* Cursor plane buffer size and hotspot in buffer pixels */
+  int buffer_width;
+  int buffer_height;
+  int buffer_hotspot_x;
+  int buffer_hotspot_y;
+} MetaKmsCursorPlacement;
+
+#define META_TYPE_KMS_CURSOR_MANAGER (meta_kms_cursor_manager_get_type ())
+G_DECLARE_FINAL_TYPE (MetaKmsCursorManager, meta_kms_cursor_manager,
+                      META, KMS_CURSOR_MANAGER, GObject)
+
+META_EXPORT_TEST
+MetaRectangle meta_kms_cursor_placement_calculate_rect (const MetaKmsCursorPlacement *placement,
+                                                        const graphene_point_t       *position);
+
+void meta_kms_cursor_manager_update_sprite (MetaKmsCursorManager         *cursor_manager,
+                                            MetaKmsCrtc                  *crtc,
+                                            MetaKmsPlane                 *cursor_plane,
+                                            MetaDrmBuffer                *buffer,
+                                            const MetaKmsCursorPlacement *placement);
+
+void meta_kms_cursor_manager_reset (MetaKmsCursorManager *cursor_manager);
+
+gboolean meta_kms_cursor_manager_get_position (MetaKmsCursorManager *cursor_manager,
+                                               graphene_point_t     *position);
+
+void meta_kms_cursor_manager_position_changed_in_input_impl (MetaKmsCursorManager   *cursor_manager,
+                                                             const graphene_point_t *position);
+
+void meta_kms_cursor_manager_prepare_shutdown (MetaKmsCursorManager *cursor_manager);
+
+MetaKmsCursorManager * meta_kms_cursor_manager_new (MetaKms *kms);
+
+#endif /* META_KMS_CURSOR_MANAGER_H */
@@ -20,11 +20,14 @@
 #ifndef META_KMS_DEVICE_PRIVATE_H
 #define META_KMS_DEVICE_PRIVATE_H
 
+#include "backends/native/meta-kms-plane-config-cache.h"
 #include "backends/native/meta-kms-types.h"
 #include "backends/native/meta-kms-update-private.h"
 
 MetaKmsImplDevice * meta_kms_device_get_impl_device (MetaKmsDevice *device);
 
+MetaKmsPlaneConfigCache * meta_kms_device_get_plane_config_cache (MetaKmsDevice *device);
+
 MetaKmsUpdateChanges meta_kms_device_update_states_in_impl (MetaKmsDevice *device,
                                                             uint32_t       crtc_id,
                                                             uint32_t       connector_id);
@@ -37,6 +37,7 @@
 #include "backends/native/meta-kms-impl-device-simple.h"
 #include "backends/native/meta-kms-impl-device.h"
 #include "backends/native/meta-kms-impl.h"
+#include "backends/native/meta-kms-plane-config-cache.h"
 #include "backends/native/meta-kms-plane.h"
 #include "backends/native/meta-kms-private.h"
 
@@ -60,6 +61,8 @@ struct _MetaKmsDevice
   MetaKmsDeviceCaps caps;
 
   GList *fallback_modes;
+
+  MetaKmsPlaneConfigCache *plane_config_cache;
 };
 
 G_DEFINE_TYPE (MetaKmsDevice, meta_kms_device, G_TYPE_OBJECT);
@@ -76,6 +79,16 @@ meta_kms_device_get_impl_device (MetaKmsDevice *device)
   return device->impl_device;
 }
 
+/*
+ * Results of plane-only test commits on this device. Shared between the
+ * main thread and the impl thread, see #MetaKmsPlaneConfigCache.
+ */
+MetaKmsPlaneConfigCache *
+meta_kms_device_get_plane_config_cache (MetaKmsDevice *device)
+{
+  return device->plane_config_cache;
+}
+
 const char *
 meta_kms_device_get_path (MetaKmsDevice *device)
 {
@@ -129,6 +142,12 @@ meta_kms_device_uses_monotonic_clock (MetaKmsDevice *device)
   return device->caps.uses_monotonic_clock;
 }
 
+gboolean
+meta_kms_device_supports_test_commits (MetaKmsDevice *device)
+{
+  return device->caps.supports_test_commits;
+}
+
 GList *
 meta_kms_device_get_connectors (MetaKmsDevice *device)
 {
@@ -475,12 +494,16 @@ meta_kms_device_finalize (GObject *object)
                                    NULL);
     }
 
+  g_clear_pointer (&device->plane_config_cache,
+                   meta_kms_plane_config_cache_free);
+
   G_OBJECT_CLASS (meta_kms_device_parent_class)->finalize (object);
 }
 
 static void
 meta_kms_device_init (MetaKmsDevice *device)
 {
+  device->plane_config_cache = meta_kms_plane_config_cache_new ();
 }
 
 static void
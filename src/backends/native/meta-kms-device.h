@@ -47,6 +47,8 @@ gboolean meta_kms_device_prefers_shadow_buffer (MetaKmsDevice *device);
 
 gboolean meta_kms_device_uses_monotonic_clock (MetaKmsDevice *device);
 
+gboolean meta_kms_device_supports_test_commits (MetaKmsDevice *device);
+
 GList * meta_kms_device_get_connectors (MetaKmsDevice *device);
 
 GList * meta_kms_device_get_crtcs (MetaKmsDevice *device);
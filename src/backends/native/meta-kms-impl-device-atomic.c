@@ -19,6 +19,8 @@
 
 #include "config.h"
 
+#include <errno.h>
+
 #include "backends/native/meta-kms-impl-device-atomic.h"
 
 #include "backends/native/meta-backend-native-private.h"
@@ -26,6 +28,7 @@
 #include "backends/native/meta-kms-crtc-private.h"
 #include "backends/native/meta-kms-device-private.h"
 #include "backends/native/meta-kms-mode-private.h"
+#include "backends/native/meta-kms-plane-config-cache.h"
 #include "backends/native/meta-kms-plane-private.h"
 #include "backends/native/meta-kms-private.h"
 #include "backends/native/meta-kms-update-private.h"
@@ -775,7 +778,7 @@ static const char *
 commit_flags_string (uint32_t commit_flags)
 {
   static char static_commit_flags_string[255];
-  const char *commit_flag_strings[4] = { NULL };
+  const char *commit_flag_strings[5] = { NULL };
   int i = 0;
   g_autofree char *commit_flags_string = NULL;
 
@@ -785,6 +788,8 @@ commit_flags_string (uint32_t commit_flags)
     commit_flag_strings[i++] = "ATOMIC_ALLOW_MODESET";
   if (commit_flags & DRM_MODE_PAGE_FLIP_EVENT)
     commit_flag_strings[i++] = "PAGE_FLIP_EVENT";
+  if (commit_flags & DRM_MODE_ATOMIC_TEST_ONLY)
+    commit_flag_strings[i++] = "ATOMIC_TEST_ONLY";
 
   commit_flags_string = g_strjoinv ("|", (char **) commit_flag_strings);
   strncpy (static_commit_flags_string, commit_flags_string,
@@ -901,25 +906,69 @@ process_power_save (MetaKmsImplDevice *impl_device,
   return TRUE;
 }
 
+static MetaKmsPlaneConfigCache *
+get_plane_config_cache (MetaKmsImplDevice *impl_device)
+{
+  MetaKmsDevice *device = meta_kms_impl_device_get_device (impl_device);
+
+  return meta_kms_device_get_plane_config_cache (device);
+}
+
 static MetaKmsFeedback *
 meta_kms_impl_device_atomic_process_update (MetaKmsImplDevice *impl_device,
                                             MetaKmsUpdate     *update,
                                             MetaKmsUpdateFlag  flags)
 {
+  MetaKmsPlaneConfigCache *plane_config_cache =
+    get_plane_config_cache (impl_device);
   GError *error = NULL;
   GList *failed_planes = NULL;
   drmModeAtomicReq *req;
   g_autoptr (GArray) blob_ids = NULL;
+  g_autoptr (GArray) plane_configs = NULL;
   int fd;
   uint32_t commit_flags = 0;
   int ret;
 
-  blob_ids = g_array_new (FALSE, TRUE, sizeof (uint32_t));
-
   meta_topic (META_DEBUG_KMS,
               "[atomic] Processing update %" G_GUINT64_FORMAT,
               meta_kms_update_get_sequence_number (update));
 
+  if (flags & META_KMS_UPDATE_FLAG_TEST_ONLY)
+    plane_configs = meta_kms_update_collect_plane_configs (update);
+
+  if (plane_configs)
+    {
+      switch (meta_kms_plane_config_cache_lookup (plane_config_cache,
+                                                  (MetaKmsPlaneConfig *) plane_configs->data,
+                                                  plane_configs->len))
+        {
+        case META_KMS_PLANE_CONFIG_RESULT_UNKNOWN:
+          break;
+        case META_KMS_PLANE_CONFIG_RESULT_PASSED:
+          meta_topic (META_DEBUG_KMS,
+                      "[atomic] Plane configuration of update %" G_GUINT64_FORMAT
+                      " known to pass",
+                      meta_kms_update_get_sequence_number (update));
+          return meta_kms_feedback_new_passed (NULL);
+        case META_KMS_PLANE_CONFIG_RESULT_REJECTED:
+          meta_topic (META_DEBUG_KMS,
+                      "[atomic] Plane configuration of update %" G_GUINT64_FORMAT
+                      " known to be rejected",
+                      meta_kms_update_get_sequence_number (update));
+          g_set_error (&error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                       "Plane configuration previously rejected");
+          return meta_kms_feedback_new_failed (NULL, error);
+        }
+    }
+  else if (meta_kms_update_get_mode_sets (update) &&
+           !(flags & META_KMS_UPDATE_FLAG_TEST_ONLY))
+    {
+      meta_kms_plane_config_cache_clear (plane_config_cache);
+    }
+
+  blob_ids = g_array_new (FALSE, TRUE, sizeof (uint32_t));
+
   req = drmModeAtomicAlloc ();
   if (!req)
     {
@@ -945,6 +994,8 @@ meta_kms_impl_device_atomic_process_update (MetaKmsImplDevice *impl_device,
         goto err;
 
       commit_flags = DRM_MODE_ATOMIC_ALLOW_MODESET;
+      if (flags & META_KMS_UPDATE_FLAG_TEST_ONLY)
+        commit_flags |= DRM_MODE_ATOMIC_TEST_ONLY;
       goto commit;
     }
 
@@ -990,11 +1041,19 @@ meta_kms_impl_device_atomic_process_update (MetaKmsImplDevice *impl_device,
 
   if (meta_kms_update_get_mode_sets (update))
     commit_flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+
+  if (flags & META_KMS_UPDATE_FLAG_TEST_ONLY)
+    {
+      commit_flags |= DRM_MODE_ATOMIC_TEST_ONLY;
+    }
   else
-    commit_flags |= DRM_MODE_ATOMIC_NONBLOCK;
+    {
+      if (!meta_kms_update_get_mode_sets (update))
+        commit_flags |= DRM_MODE_ATOMIC_NONBLOCK;
 
-  if (meta_kms_update_get_page_flip_listeners (update))
-    commit_flags |= DRM_MODE_PAGE_FLIP_EVENT;
+      if (meta_kms_update_get_page_flip_listeners (update))
+        commit_flags |= DRM_MODE_PAGE_FLIP_EVENT;
+    }
 
 commit:
   meta_topic (META_DEBUG_KMS,
@@ -1005,6 +1064,19 @@ commit:
   fd = meta_kms_impl_device_get_fd (impl_device);
   ret = drmModeAtomicCommit (fd, req, commit_flags, impl_device);
   drmModeAtomicFree (req);
+
+  /* Only remember definite verdicts on the configuration itself, not
+   * transient failures such as a busy CRTC or lost DRM master. */
+  if (plane_configs && (ret == 0 || ret == -EINVAL))
+    {
+      meta_kms_plane_config_cache_store (plane_config_cache,
+                                         (MetaKmsPlaneConfig *) plane_configs->data,
+                                         plane_configs->len,
+                                         ret == 0 ?
+                                         META_KMS_PLANE_CONFIG_RESULT_PASSED :
+                                         META_KMS_PLANE_CONFIG_RESULT_REJECTED);
+    }
+
   if (ret < 0)
     {
       g_set_error (&error, G_IO_ERROR, g_io_error_from_errno (-ret),
@@ -1012,6 +1084,12 @@ commit:
       goto err;
     }
 
+  if (flags & META_KMS_UPDATE_FLAG_TEST_ONLY)
+    {
+      release_blob_ids (impl_device, blob_ids);
+      return meta_kms_feedback_new_passed (NULL);
+    }
+
   process_entries (impl_device,
                    update,
                    req,
@@ -1028,7 +1106,8 @@ commit:
 err:
   meta_topic (META_DEBUG_KMS, "[atomic] KMS update failed: %s", error->message);
 
-  if (!(flags & META_KMS_UPDATE_FLAG_PRESERVE_ON_ERROR))
+  if (!(flags & (META_KMS_UPDATE_FLAG_PRESERVE_ON_ERROR |
+                 META_KMS_UPDATE_FLAG_TEST_ONLY)))
     {
       process_entries (impl_device,
                        update,
@@ -1057,6 +1136,12 @@ meta_kms_impl_device_atomic_discard_pending_page_flips (MetaKmsImplDevice *impl_
 {
 }
 
+static void
+meta_kms_impl_device_atomic_states_changed (MetaKmsImplDevice *impl_device)
+{
+  meta_kms_plane_config_cache_clear (get_plane_config_cache (impl_device));
+}
+
 static gboolean
 dispose_page_flip_data (gpointer key,
                         gpointer value,
@@ -1231,4 +1316,6 @@ meta_kms_impl_device_atomic_class_init (MetaKmsImplDeviceAtomicClass *klass)
     meta_kms_impl_device_atomic_discard_pending_page_flips;
   impl_device_class->prepare_shutdown =
     meta_kms_impl_device_atomic_prepare_shutdown;
+  impl_device_class->states_changed =
+    meta_kms_impl_device_atomic_states_changed;
 }
@@ -1409,6 +1409,13 @@ meta_kms_impl_device_simple_process_update (MetaKmsImplDevice *impl_device,
               "[simple] Processing update %" G_GUINT64_FORMAT,
               meta_kms_update_get_sequence_number (update));
 
+  if (flags & META_KMS_UPDATE_FLAG_TEST_ONLY)
+    {
+      g_set_error (&error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                   "Test commits not supported with legacy mode setting");
+      return meta_kms_feedback_new_failed (NULL, error);
+    }
+
   if (meta_kms_update_is_power_save (update))
     {
       if (!process_power_save (impl_device, &error))
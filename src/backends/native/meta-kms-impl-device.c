@@ -325,6 +325,11 @@ init_caps (MetaKmsImplDevice *impl_device)
     {
       priv->caps.uses_monotonic_clock = uses_monotonic_clock;
     }
+
+  priv->caps.supports_test_commits =
+    !!meta_device_file_has_tag (priv->device_file,
+                                META_DEVICE_FILE_TAG_KMS,
+                                META_KMS_DEVICE_FILE_TAG_ATOMIC);
 }
 
 static void
@@ -702,6 +707,15 @@ clear_latched_fd_hold (MetaKmsImplDevice *impl_device)
     }
 }
 
+static void
+notify_states_changed (MetaKmsImplDevice *impl_device)
+{
+  MetaKmsImplDeviceClass *klass = META_KMS_IMPL_DEVICE_GET_CLASS (impl_device);
+
+  if (klass->states_changed)
+    klass->states_changed (impl_device);
+}
+
 MetaKmsUpdateChanges
 meta_kms_impl_device_update_states (MetaKmsImplDevice *impl_device,
                                     uint32_t           crtc_id,
@@ -762,6 +776,9 @@ meta_kms_impl_device_update_states (MetaKmsImplDevice *impl_device,
 
   drmModeFreeResources (drm_resources);
 
+  if (changes != META_KMS_UPDATE_CHANGE_NONE)
+    notify_states_changed (impl_device);
+
   return changes;
 
 err:
@@ -769,6 +786,8 @@ err:
   g_clear_list (&priv->crtcs, g_object_unref);
   g_clear_list (&priv->connectors, g_object_unref);
 
+  notify_states_changed (impl_device);
+
   return META_KMS_UPDATE_CHANGE_FULL;
 }
 
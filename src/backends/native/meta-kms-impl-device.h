@@ -40,6 +40,7 @@ typedef struct _MetaKmsDeviceCaps
 
   gboolean prefers_shadow_buffer;
   gboolean uses_monotonic_clock;
+  gboolean supports_test_commits;
 } MetaKmsDeviceCaps;
 
 typedef struct _MetaKmsProp MetaKmsProp;
@@ -79,6 +80,7 @@ struct _MetaKmsImplDeviceClass
                                       MetaKmsPageFlipData *page_flip_data);
   void (* discard_pending_page_flips) (MetaKmsImplDevice *impl_device);
   void (* prepare_shutdown) (MetaKmsImplDevice *impl_device);
+  void (* states_changed) (MetaKmsImplDevice *impl_device);
 };
 
 enum
@@ -29,6 +29,7 @@
 G_DECLARE_FINAL_TYPE (MetaKmsImpl, meta_kms_impl,
                       META, KMS_IMPL, GObject)
 
+META_EXPORT_TEST
 MetaKms * meta_kms_impl_get_kms (MetaKmsImpl *impl);
 
 MetaKmsFeedback * meta_kms_impl_process_update (MetaKmsImpl       *impl,
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/**
+ * SECTION:meta-kms-plane-config-cache
+ * @short_description: Cache of test committed plane configurations
+ *
+ * Remembers whether a combination of plane configurations was accepted or
+ * rejected by a test commit, so that repeated attempts to put the same kind
+ * of buffers on the same planes don't need another round trip to the
+ * kernel. A configuration is identified by the CRTC, plane, buffer format
+ * and modifier, source rectangle, destination size, whether the plane
+ * reaches past the edge of the CRTC, and rotation of every plane it touches.
+ *
+ * Accepted configurations are remembered regardless of where on the CRTC the
+ * planes are placed, so moving a plane around doesn't require another test
+ * commit, unless that moves it partially off-screen. Rejected configurations
+ * only match at the same destination positions.
+ *
+ * The cache is shared between the main thread, which consults it before
+ * issuing a test commit, and the KMS impl thread, which stores the results,
+ * so all access is serialized.
+ *
+ * The cache must be cleared whenever the result of a test commit could
+ * change for other reasons, e.g. after a mode set or a hotplug.
+ */
+
+#include "config.h"
+
+#include "backends/native/meta-kms-plane-config-cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Plenty for the handful of buffer configurations seen per CRTC; when
+ * exceeded, the cache simply starts over.
+ */
+#define MAX_CACHED_CONFIGS 64
+
+struct _MetaKmsPlaneConfigCache
+{
+  GMutex mutex;
+
+  /* Sets of GBytes (sorted MetaKmsPlaneConfig array); passed ones are
+   * keyed without destination positions, rejected ones with them */
+  GHashTable *passed;
+  GHashTable *rejected;
+};
+
+static int
+compare_plane_configs (gconstpointer a,
+                       gconstpointer b)
+{
+  const MetaKmsPlaneConfig *config_a = a;
+  const MetaKmsPlaneConfig *config_b = b;
+
+  if (config_a->plane_id < config_b->plane_id)
+    return -1;
+  else if (config_a->plane_id > config_b->plane_id)
+    return 1;
+  else
+    return 0;
+}
+
+static GBytes *
+create_key (const MetaKmsPlaneConfig *configs,
+            int                       n_configs,
+            gboolean                  with_position)
+{
+  MetaKmsPlaneConfig *sorted_configs;
+  int i;
+
+  /* Copy field by field into zeroed memory, so that struct padding doesn't
+   * end up in the hashed and compared key.
+   */
+  sorted_configs = g_new0 (MetaKmsPlaneConfig, n_configs);
+  for (i = 0; i < n_configs; i++)
+    {
+      sorted_configs[i].crtc_id = configs[i].crtc_id;
+      sorted_configs[i].plane_id = configs[i].plane_id;
+      sorted_configs[i].format = configs[i].format;
+      sorted_configs[i].modifier = configs[i].modifier;
+      sorted_configs[i].src_x = configs[i].src_x;
+      sorted_configs[i].src_y = configs[i].src_y;
+      sorted_configs[i].src_width = configs[i].src_width;
+      sorted_configs[i].src_height = configs[i].src_height;
+      if (with_position)
+        {
+          sorted_configs[i].dst_x = configs[i].dst_x;
+          sorted_configs[i].dst_y = configs[i].dst_y;
+        }
+      sorted_configs[i].dst_width = configs[i].dst_width;
+      sorted_configs[i].dst_height = configs[i].dst_height;
+      sorted_configs[i].is_partially_offscreen =
+        configs[i].is_partially_offscreen;
+      sorted_configs[i].rotation = configs[i].rotation;
+    }
+
+  qsort (sorted_configs, n_configs, sizeof (MetaKmsPlaneConfig),
+         compare_plane_configs);
+
+  return g_bytes_new_take (sorted_configs,
+                           n_configs * sizeof (MetaKmsPlaneConfig));
+}
+
+MetaKmsPlaneConfigResult
+meta_kms_plane_config_cache_lookup (MetaKmsPlaneConfigCache  *cache,
+                                    const MetaKmsPlaneConfig *configs,
+                                    int                       n_configs)
+{
+  g_autoptr (GBytes) rejected_key = NULL;
+  g_autoptr (GBytes) passed_key = NULL;
+  MetaKmsPlaneConfigResult result;
+
+  if (n_configs == 0)
+    return META_KMS_PLANE_CONFIG_RESULT_UNKNOWN;
+
+  rejected_key = create_key (configs, n_configs, TRUE);
+  passed_key = create_key (configs, n_configs, FALSE);
+
+  g_mutex_lock (&cache->mutex);
+  if (g_hash_table_contains (cache->rejected, rejected_key))
+    result = META_KMS_PLANE_CONFIG_RESULT_REJECTED;
+  else if (g_hash_table_contains (cache->passed, passed_key))
+    result = META_KMS_PLANE_CONFIG_RESULT_PASSED;
+  else
+    result = META_KMS_PLANE_CONFIG_RESULT_UNKNOWN;
+  g_mutex_unlock (&cache->mutex);
+
+  return result;
+}
+
+void
+meta_kms_plane_config_cache_store (MetaKmsPlaneConfigCache  *cache,
+                                   const MetaKmsPlaneConfig *configs,
+                                   int                       n_configs,
+                                   MetaKmsPlaneConfigResult  result)
+{
+  g_autoptr (GBytes) rejected_key = NULL;
+  GHashTable *results = NULL;
+  GBytes *key = NULL;
+
+  g_return_if_fail (result != META_KMS_PLANE_CONFIG_RESULT_UNKNOWN);
+
+  if (n_configs == 0)
+    return;
+
+  g_mutex_lock (&cache->mutex);
+
+  switch (result)
+    {
+    case META_KMS_PLANE_CONFIG_RESULT_UNKNOWN:
+      g_assert_not_reached ();
+      break;
+    case META_KMS_PLANE_CONFIG_RESULT_PASSED:
+      rejected_key = create_key (configs, n_configs, TRUE);
+      g_hash_table_remove (cache->rejected, rejected_key);
+
+      results = cache->passed;
+      key = create_key (configs, n_configs, FALSE);
+      break;
+    case META_KMS_PLANE_CONFIG_RESULT_REJECTED:
+      results = cache->rejected;
+      key = create_key (configs, n_configs, TRUE);
+      break;
+    }
+
+  if (g_hash_table_size (results) >= MAX_CACHED_CONFIGS)
+    g_hash_table_remove_all (results);
+
+  g_hash_table_add (results, key);
+
+  g_mutex_unlock (&cache->mutex);
+}
+
+void
+meta_kms_plane_config_cache_clear (MetaKmsPlaneConfigCache *cache)
+{
+  g_mutex_lock (&cache->mutex);
+  g_hash_table_remove_all (cache->passed);
+  g_hash_table_remove_all (cache->rejected);
+  g_mutex_unlock (&cache->mutex);
+}
+
+MetaKmsPlaneConfigCache *
+meta_kms_plane_config_cache_new (void)
+{
+  MetaKmsPlaneConfigCache *cache;
+
+  cache = g_new0 (MetaKmsPlaneConfigCache, 1);
+  g_mutex_init (&cache->mutex);
+  cache->passed = g_hash_table_new_full (g_bytes_hash,
+                                         g_bytes_equal,
+                                         (GDestroyNotify) g_bytes_unref,
+                                         NULL);
+  cache->rejected = g_hash_table_new_full (g_bytes_hash,
+                                           g_bytes_equal,
+                                           (GDestroyNotify) g_bytes_unref,
+                                           NULL);
+
+  return cache;
+}
+
+void
+meta_kms_plane_config_cache_free (MetaKmsPlaneConfigCache *cache)
+{
+  g_hash_table_destroy (cache->passed);
+  g_hash_table_destroy (cache->rejected);
+  g_mutex_clear (&cache->mutex);
+  g_free (cache);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_KMS_PLANE_CONFIG_CACHE_H
+#define META_KMS_PLANE_CONFIG_CACHE_H
+
+#include <glib.h>
+#include <stdint.h>
+
+#include "backends/native/meta-kms-types.h"
+#include "core/util-private.h"
+
+typedef struct _MetaKmsPlaneConfigCache MetaKmsPlaneConfigCache;
+
+typedef enum _MetaKmsPlaneConfigResult
+{
+  META_KMS_PLANE_CONFIG_RESULT_UNKNOWN,
+  META_KMS_PLANE_CONFIG_RESULT_PASSED,
+  META_KMS_PLANE_CONFIG_RESULT_REJECTED,
+} MetaKmsPlaneConfigResult;
+
+typedef struct _MetaKmsPlaneConfig
+{
+  uint32_t crtc_id;
+  uint32_t plane_id;
+  uint32_t format;
+  uint64_t modifier;
+  int32_t src_x;
+  int32_t src_y;
+  int32_t src_width;
+  int32_t src_height;
+  int32_t dst_x;
+  int32_t dst_y;
+  int32_t dst_width;
+  int32_t dst_height;
+  gboolean is_partially_offscreen;
+  uint64_t rotation;
+} MetaKmsPlaneConfig;
+
+META_EXPORT_TEST
+MetaKmsPlaneConfigCache * meta_kms_plane_config_cache_new (void);
+
+META_EXPORT_TEST
+void meta_kms_plane_config_cache_free (MetaKmsPlaneConfigCache *cache);
+
+META_EXPORT_TEST
+MetaKmsPlaneConfigResult meta_kms_plane_config_cache_lookup (MetaKmsPlaneConfigCache  *cache,
+                                                             const MetaKmsPlaneConfig *configs,
+                                                             int                       n_configs);
+
+META_EXPORT_TEST
+void meta_kms_plane_config_cache_store (MetaKmsPlaneConfigCache  *cache,
+                                        const MetaKmsPlaneConfig *configs,
+                                        int                       n_configs,
+                                        MetaKmsPlaneConfigResult  result);
+
+META_EXPORT_TEST
+void meta_kms_plane_config_cache_clear (MetaKmsPlaneConfigCache *cache);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MetaKmsPlaneConfigCache,
+                               meta_kms_plane_config_cache_free)
+
+#endif /* META_KMS_PLANE_CONFIG_CACHE_H */
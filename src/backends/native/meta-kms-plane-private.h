@@ -25,6 +25,7 @@
 
 #include "backends/native/meta-kms-plane.h"
 #include "backends/native/meta-kms-types.h"
+#include "core/util-private.h"
 
 typedef enum _MetaKmsPlaneProp
 {
@@ -53,6 +54,13 @@ MetaKmsPlane * meta_kms_plane_new (MetaKmsPlaneType         type,
 MetaKmsPlane * meta_kms_plane_new_fake (MetaKmsPlaneType  type,
                                         MetaKmsCrtc      *crtc);
 
+META_EXPORT_TEST
+MetaKmsPlane * meta_kms_plane_new_mock (MetaKmsPlaneType  type,
+                                        MetaKmsDevice    *device,
+                                        uint32_t          possible_crtcs,
+                                        const uint32_t   *formats,
+                                        size_t            n_formats);
+
 uint32_t meta_kms_plane_get_prop_id (MetaKmsPlane     *plane,
                                      MetaKmsPlaneProp  prop);
 
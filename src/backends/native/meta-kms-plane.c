@@ -181,11 +181,48 @@ meta_kms_plane_is_format_supported (MetaKmsPlane *plane,
                                        NULL, NULL);
 }
 
+gboolean
+meta_kms_plane_is_format_modifier_supported (MetaKmsPlane *plane,
+                                             uint32_t      drm_format,
+                                             uint64_t      drm_modifier)
+{
+  GArray *modifiers;
+  unsigned int i;
+
+  if (!g_hash_table_lookup_extended (plane->formats_modifiers,
+                                     GUINT_TO_POINTER (drm_format),
+                                     NULL, (gpointer *) &modifiers))
+    return FALSE;
+
+  if (drm_modifier == DRM_FORMAT_MOD_INVALID)
+    return TRUE;
+
+  /* Without a modifier list, only the linear layout is known to work */
+  if (!modifiers)
+    return drm_modifier == DRM_FORMAT_MOD_LINEAR;
+
+  for (i = 0; i < modifiers->len; i++)
+    {
+      if (g_array_index (modifiers, uint64_t, i) == drm_modifier)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+gboolean
+meta_kms_plane_is_usable_with_crtc_idx (MetaKmsPlane *plane,
+                                        int           crtc_idx)
+{
+  return !!(plane->possible_crtcs & (1 << crtc_idx));
+}
+
 gboolean
 meta_kms_plane_is_usable_with (MetaKmsPlane *plane,
                                MetaKmsCrtc  *crtc)
 {
-  return !!(plane->possible_crtcs & (1 << meta_kms_crtc_get_idx (crtc)));
+  return meta_kms_plane_is_usable_with_crtc_idx (plane,
+                                                 meta_kms_crtc_get_idx (crtc));
 }
 
 static void
@@ -513,6 +550,26 @@ meta_kms_plane_new_fake (MetaKmsPlaneType  type,
   return plane;
 }
 
+MetaKmsPlane *
+meta_kms_plane_new_mock (MetaKmsPlaneType  type,
+                         MetaKmsDevice    *device,
+                         uint32_t          possible_crtcs,
+                         const uint32_t   *formats,
+                         size_t            n_formats)
+{
+  MetaKmsPlane *plane;
+
+  plane = g_object_new (META_TYPE_KMS_PLANE, NULL);
+  plane->type = type;
+  plane->is_fake = TRUE;
+  plane->possible_crtcs = possible_crtcs;
+  plane->device = device;
+
+  set_formats_from_array (plane, formats, n_formats);
+
+  return plane;
+}
+
 static void
 meta_kms_plane_finalize (GObject *object)
 {
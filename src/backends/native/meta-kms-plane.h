@@ -55,6 +55,13 @@ GArray * meta_kms_plane_copy_drm_format_list (MetaKmsPlane *plane);
 gboolean meta_kms_plane_is_format_supported (MetaKmsPlane *plane,
                                              uint32_t      format);
 
+gboolean meta_kms_plane_is_format_modifier_supported (MetaKmsPlane *plane,
+                                                      uint32_t      drm_format,
+                                                      uint64_t      drm_modifier);
+
+gboolean meta_kms_plane_is_usable_with_crtc_idx (MetaKmsPlane *plane,
+                                                 int           crtc_idx);
+
 gboolean meta_kms_plane_is_usable_with (MetaKmsPlane *plane,
                                         MetaKmsCrtc  *crtc);
 
@@ -31,16 +31,24 @@ typedef gpointer (* MetaKmsImplTaskFunc) (MetaKmsImpl  *impl,
                                           gpointer      user_data,
                                           GError      **error);
 
+META_EXPORT_TEST
 void meta_kms_queue_callback (MetaKms         *kms,
                               MetaKmsCallback  callback,
                               gpointer         user_data,
                               GDestroyNotify   user_data_destroy);
 
+META_EXPORT_TEST
 gpointer meta_kms_run_impl_task_sync (MetaKms              *kms,
                                       MetaKmsImplTaskFunc   func,
                                       gpointer              user_data,
                                       GError              **error);
 
+META_EXPORT_TEST
+void meta_kms_run_impl_task_async (MetaKms             *kms,
+                                   MetaKmsImplTaskFunc  func,
+                                   gpointer             user_data,
+                                   GDestroyNotify       user_data_destroy);
+
 GSource * meta_kms_add_source_in_impl (MetaKms        *kms,
                                        GSourceFunc     func,
                                        gpointer        user_data,
@@ -51,8 +59,10 @@ GSource * meta_kms_register_fd_in_impl (MetaKms             *kms,
                                         MetaKmsImplTaskFunc  dispatch,
                                         gpointer             user_data);
 
+META_EXPORT_TEST
 gboolean meta_kms_in_impl_task (MetaKms *kms);
 
+META_EXPORT_TEST
 gboolean meta_kms_is_waiting_for_impl_task (MetaKms *kms);
 
 #define meta_assert_in_kms_impl(kms) \
@@ -40,6 +40,8 @@ typedef struct _MetaKmsFeedback MetaKmsFeedback;
 typedef struct _MetaKmsPageFlipListenerVtable MetaKmsPageFlipListenerVtable;
 typedef enum _MetaKmsPageFlipListenerFlag MetaKmsPageFlipListenerFlag;
 
+typedef struct _MetaKmsCursorManager MetaKmsCursorManager;
+
 typedef struct _MetaKmsImpl MetaKmsImpl;
 typedef struct _MetaKmsImplDevice MetaKmsImplDevice;
 
@@ -141,6 +141,8 @@ GList * meta_kms_update_get_crtc_gammas (MetaKmsUpdate *update);
 
 gboolean meta_kms_update_is_power_save (MetaKmsUpdate *update);
 
+GArray * meta_kms_update_collect_plane_configs (MetaKmsUpdate *update);
+
 MetaKmsCustomPageFlip * meta_kms_update_take_custom_page_flip_func (MetaKmsUpdate *update);
 
 void meta_kms_update_drop_plane_assignment (MetaKmsUpdate *update,
@@ -23,9 +23,11 @@
 #include "backends/native/meta-kms-update-private.h"
 
 #include "backends/meta-display-config-shared.h"
+#include "backends/native/meta-drm-buffer.h"
 #include "backends/native/meta-kms-connector.h"
 #include "backends/native/meta-kms-crtc.h"
 #include "backends/native/meta-kms-mode-private.h"
+#include "backends/native/meta-kms-plane-config-cache.h"
 #include "backends/native/meta-kms-plane.h"
 
 struct _MetaKmsUpdate
@@ -258,6 +260,74 @@ meta_kms_update_unassign_plane (MetaKmsUpdate *update,
   return plane_assignment;
 }
 
+static gboolean
+is_plane_assigned (MetaKmsUpdate *update,
+                   MetaKmsPlane  *plane)
+{
+  GList *l;
+
+  for (l = update->plane_assignments; l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+
+      if (plane_assignment->plane == plane)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/**
+ * meta_kms_update_find_overlay_plane:
+ * @update: The update the plane will be assigned in
+ * @planes: (element-type MetaKmsPlane): Planes to choose from
+ * @crtc_idx: Index of the CRTC the plane will be assigned to
+ * @drm_format: DRM format of the buffer to scan out
+ * @drm_modifier: DRM modifier of the buffer to scan out
+ *
+ * Finds an overlay plane that can scan out a buffer with the given format
+ * and modifier on the CRTC, and that is not already assigned in @update.
+ * The plane list is taken in order, so that repeated lookups with the same
+ * buffer parameters prefer the same plane.
+ *
+ * Whether the display controller actually accepts the resulting update still
+ * has to be checked, e.g. with a test commit.
+ *
+ * Returns: (transfer none) (nullable): An overlay plane, or %NULL.
+ */
+MetaKmsPlane *
+meta_kms_update_find_overlay_plane (MetaKmsUpdate *update,
+                                    GList         *planes,
+                                    int            crtc_idx,
+                                    uint32_t       drm_format,
+                                    uint64_t       drm_modifier)
+{
+  GList *l;
+
+  for (l = planes; l; l = l->next)
+    {
+      MetaKmsPlane *plane = l->data;
+
+      if (meta_kms_plane_get_plane_type (plane) != META_KMS_PLANE_TYPE_OVERLAY)
+        continue;
+
+      if (!meta_kms_plane_is_usable_with_crtc_idx (plane, crtc_idx))
+        continue;
+
+      if (is_plane_assigned (update, plane))
+        continue;
+
+      if (!meta_kms_plane_is_format_modifier_supported (plane,
+                                                        drm_format,
+                                                        drm_modifier))
+        continue;
+
+      return plane;
+    }
+
+  return NULL;
+}
+
 void
 meta_kms_update_mode_set (MetaKmsUpdate *update,
                           MetaKmsCrtc   *crtc,
@@ -576,6 +646,74 @@ meta_kms_update_get_plane_assignments (MetaKmsUpdate *update)
   return update->plane_assignments;
 }
 
+static gboolean
+is_partially_offscreen (MetaKmsCrtc         *crtc,
+                        const MetaRectangle *dst_rect)
+{
+  const MetaKmsCrtcState *crtc_state = meta_kms_crtc_get_current_state (crtc);
+
+  if (!crtc_state->is_drm_mode_valid)
+    return FALSE;
+
+  return (dst_rect->x < 0 ||
+          dst_rect->y < 0 ||
+          dst_rect->x + dst_rect->width > crtc_state->drm_mode.hdisplay ||
+          dst_rect->y + dst_rect->height > crtc_state->drm_mode.vdisplay);
+}
+
+/*
+ * Describes the planes of an update for a #MetaKmsPlaneConfigCache. Returns
+ * NULL if the update changes more than plane assignments, as whether such
+ * an update passes doesn't depend on the planes alone.
+ */
+GArray *
+meta_kms_update_collect_plane_configs (MetaKmsUpdate *update)
+{
+  GArray *plane_configs;
+  GList *l;
+
+  if (update->power_save ||
+      update->mode_sets ||
+      update->connector_updates ||
+      update->crtc_gammas ||
+      !update->plane_assignments)
+    return NULL;
+
+  plane_configs = g_array_new (FALSE, TRUE, sizeof (MetaKmsPlaneConfig));
+
+  for (l = update->plane_assignments; l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+      MetaDrmBuffer *buffer = plane_assignment->buffer;
+      MetaKmsPlaneConfig plane_config = { 0 };
+
+      plane_config.plane_id = meta_kms_plane_get_id (plane_assignment->plane);
+
+      if (buffer)
+        {
+          plane_config.crtc_id = meta_kms_crtc_get_id (plane_assignment->crtc);
+          plane_config.format = meta_drm_buffer_get_format (buffer);
+          plane_config.modifier = meta_drm_buffer_get_modifier (buffer);
+          plane_config.src_x = plane_assignment->src_rect.x;
+          plane_config.src_y = plane_assignment->src_rect.y;
+          plane_config.src_width = plane_assignment->src_rect.width;
+          plane_config.src_height = plane_assignment->src_rect.height;
+          plane_config.dst_x = plane_assignment->dst_rect.x;
+          plane_config.dst_y = plane_assignment->dst_rect.y;
+          plane_config.dst_width = plane_assignment->dst_rect.width;
+          plane_config.dst_height = plane_assignment->dst_rect.height;
+          plane_config.is_partially_offscreen =
+            is_partially_offscreen (plane_assignment->crtc,
+                                    &plane_assignment->dst_rect);
+          plane_config.rotation = plane_assignment->rotation;
+        }
+
+      g_array_append_val (plane_configs, plane_config);
+    }
+
+  return plane_configs;
+}
+
 GList *
 meta_kms_update_get_mode_sets (MetaKmsUpdate *update)
 {
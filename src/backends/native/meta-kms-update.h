@@ -28,6 +28,7 @@
 #include "backends/meta-monitor-transform.h"
 #include "backends/native/meta-drm-buffer.h"
 #include "backends/native/meta-kms-types.h"
+#include "core/util-private.h"
 #include "meta/boxes.h"
 
 typedef enum _MetaKmsFeedbackResult
@@ -89,8 +90,10 @@ GList * meta_kms_feedback_get_failed_planes (const MetaKmsFeedback *feedback);
 
 const GError * meta_kms_feedback_get_error (const MetaKmsFeedback *feedback);
 
+META_EXPORT_TEST
 MetaKmsUpdate * meta_kms_update_new (MetaKmsDevice *device);
 
+META_EXPORT_TEST
 void meta_kms_update_free (MetaKmsUpdate *update);
 
 void meta_kms_update_set_underscanning (MetaKmsUpdate    *update,
@@ -131,6 +134,13 @@ MetaKmsPlaneAssignment * meta_kms_update_unassign_plane (MetaKmsUpdate *update,
                                                          MetaKmsCrtc   *crtc,
                                                          MetaKmsPlane  *plane);
 
+META_EXPORT_TEST
+MetaKmsPlane * meta_kms_update_find_overlay_plane (MetaKmsUpdate *update,
+                                                   GList         *planes,
+                                                   int            crtc_idx,
+                                                   uint32_t       drm_format,
+                                                   uint64_t       drm_modifier);
+
 void meta_kms_update_add_page_flip_listener (MetaKmsUpdate                       *update,
                                              MetaKmsCrtc                         *crtc,
                                              const MetaKmsPageFlipListenerVtable *vtable,
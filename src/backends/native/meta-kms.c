@@ -22,7 +22,10 @@
 
 #include "backends/native/meta-kms-private.h"
 
+#include <unistd.h>
+
 #include "backends/native/meta-backend-native.h"
+#include "backends/native/meta-kms-cursor-manager.h"
 #include "backends/native/meta-kms-device-private.h"
 #include "backends/native/meta-kms-impl.h"
 #include "backends/native/meta-kms-update-private.h"
@@ -45,12 +48,17 @@
  * runs in. It uses the main GLib main loop and main context and always runs in
  * the main thread.
  *
- * The impl context is where all underlying API is being executed. While in the
- * current state, it always runs in the main thread, the aim is to be able to
- * execute the impl context in a dedicated thread.
+ * The impl context is where all underlying API is being executed. It runs in
+ * a dedicated thread with its own main context, so that page flip events are
+ * handled in time even when the main thread is busy. Unless
+ * #META_KMS_FLAG_NO_IMPL_THREAD is passed, in which case it runs in the main
+ * thread as well.
  *
  * The public facing MetaKms API is always assumed to be executed from the main
- * context.
+ * context. Crossing over to the impl context is done either synchronously using
+ * meta_kms_run_impl_task_sync(), blocking the main thread until the task
+ * completed, or from the impl context by queuing callbacks using
+ * meta_kms_queue_callback(), which are invoked in the main context.
  *
  * The KMS abstraction consists of the following public components:
  *
@@ -139,6 +147,19 @@ typedef struct _MetaKmsCallbackData
   GDestroyNotify user_data_destroy;
 } MetaKmsCallbackData;
 
+typedef struct _MetaKmsImplTask
+{
+  MetaKms *kms;
+
+  MetaKmsImplTaskFunc func;
+  gpointer user_data;
+  GDestroyNotify user_data_destroy;
+  GError **error;
+
+  gpointer ret;
+  gboolean done;
+} MetaKmsImplTask;
+
 typedef struct _MetaKmsSimpleImplSource
 {
   GSource source;
@@ -168,13 +189,27 @@ struct _MetaKms
   gulong removed_handler_id;
 
   MetaKmsImpl *impl;
-  gboolean in_impl_task;
-  gboolean waiting_for_impl_task;
+  /* Written from the impl thread and read from the main thread, or the
+   * other way around, so only accessed atomically. */
+  int in_impl_task;
+  int waiting_for_impl_task;
+
+  GThread *impl_thread;
+  pid_t impl_thread_id;
+  GMainContext *impl_main_context;
+  GMainLoop *impl_main_loop;
+  gboolean impl_thread_initialized;
+
+  GMutex impl_mutex;
+  GCond impl_cond;
 
   GList *devices;
 
+  MetaKmsCursorManager *cursor_manager;
+
   GList *pending_updates;
 
+  GMutex callbacks_mutex;
   GList *pending_callbacks;
   guint callback_source_id;
 };
@@ -257,8 +292,11 @@ meta_kms_process_update_in_impl (MetaKmsImpl  *impl,
   MetaKmsFeedback *feedback;
 
   feedback = meta_kms_impl_process_update (impl, data->update, data->flags);
-  meta_kms_device_predict_states_in_impl (meta_kms_update_get_device (update),
-                                          update);
+  if (!(data->flags & META_KMS_UPDATE_FLAG_TEST_ONLY))
+    {
+      meta_kms_device_predict_states_in_impl (meta_kms_update_get_device (update),
+                                              update);
+    }
 
   return feedback;
 }
@@ -292,6 +330,15 @@ meta_kms_post_pending_update_sync (MetaKms           *kms,
                                           &data,
                                           NULL);
 
+  /* A test commit only checks whether the update would be accepted; the
+   * update is kept pending, so that it can be adjusted and posted. */
+  if (flags & META_KMS_UPDATE_FLAG_TEST_ONLY)
+    {
+      meta_kms_update_unlock (update);
+      meta_kms_add_pending_update (kms, update);
+      return feedback;
+    }
+
   result_listeners = meta_kms_update_take_result_listeners (update);
 
   if (feedback->error &&
@@ -376,14 +423,18 @@ meta_kms_callback_data_free (MetaKmsCallbackData *callback_data)
 static int
 flush_callbacks (MetaKms *kms)
 {
+  GList *callbacks;
   GList *l;
   int callback_count = 0;
 
   meta_assert_not_in_kms_impl (kms);
 
+  g_mutex_lock (&kms->callbacks_mutex);
   g_clear_handle_id (&kms->callback_source_id, g_source_remove);
+  callbacks = g_steal_pointer (&kms->pending_callbacks);
+  g_mutex_unlock (&kms->callbacks_mutex);
 
-  for (l = kms->pending_callbacks; l; l = l->next)
+  for (l = callbacks; l; l = l->next)
     {
       MetaKmsCallbackData *callback_data = l->data;
 
@@ -392,8 +443,7 @@ flush_callbacks (MetaKms *kms)
       callback_count++;
     }
 
-  g_list_free (kms->pending_callbacks);
-  kms->pending_callbacks = NULL;
+  g_list_free (callbacks);
 
   return callback_count;
 }
@@ -403,9 +453,12 @@ callback_idle (gpointer user_data)
 {
   MetaKms *kms = user_data;
 
+  g_mutex_lock (&kms->callbacks_mutex);
+  kms->callback_source_id = 0;
+  g_mutex_unlock (&kms->callbacks_mutex);
+
   flush_callbacks (kms);
 
-  kms->callback_source_id = 0;
   return G_SOURCE_REMOVE;
 }
 
@@ -423,10 +476,33 @@ meta_kms_queue_callback (MetaKms         *kms,
     .user_data = user_data,
     .user_data_destroy = user_data_destroy,
   };
+
+  /* May be called from the impl thread, while the callbacks are always
+   * invoked from the main thread. */
+  g_mutex_lock (&kms->callbacks_mutex);
   kms->pending_callbacks = g_list_append (kms->pending_callbacks,
                                           callback_data);
   if (!kms->callback_source_id)
     kms->callback_source_id = g_idle_add (callback_idle, kms);
+  g_mutex_unlock (&kms->callbacks_mutex);
+}
+
+static gboolean
+run_impl_task_in_thread (gpointer user_data)
+{
+  MetaKmsImplTask *task = user_data;
+  MetaKms *kms = task->kms;
+  gpointer ret;
+
+  ret = task->func (kms->impl, task->user_data, task->error);
+
+  g_mutex_lock (&kms->impl_mutex);
+  task->ret = ret;
+  task->done = TRUE;
+  g_cond_broadcast (&kms->impl_cond);
+  g_mutex_unlock (&kms->impl_mutex);
+
+  return G_SOURCE_REMOVE;
 }
 
 gpointer
@@ -435,15 +511,112 @@ meta_kms_run_impl_task_sync (MetaKms              *kms,
                              gpointer              user_data,
                              GError              **error)
 {
+  MetaKmsImplTask task;
+  GSource *source;
   gpointer ret;
 
-  kms->in_impl_task = TRUE;
-  kms->waiting_for_impl_task = TRUE;
-  ret = func (kms->impl, user_data, error);
-  kms->waiting_for_impl_task = FALSE;
-  kms->in_impl_task = FALSE;
+  if (!kms->impl_thread)
+    {
+      g_atomic_int_set (&kms->in_impl_task, TRUE);
+      g_atomic_int_set (&kms->waiting_for_impl_task, TRUE);
+      ret = func (kms->impl, user_data, error);
+      g_atomic_int_set (&kms->waiting_for_impl_task, FALSE);
+      g_atomic_int_set (&kms->in_impl_task, FALSE);
 
-  return ret;
+      return ret;
+    }
+
+  g_assert (g_thread_self () != kms->impl_thread);
+
+  task = (MetaKmsImplTask) {
+    .kms = kms,
+    .func = func,
+    .user_data = user_data,
+    .error = error,
+  };
+
+  g_atomic_int_set (&kms->waiting_for_impl_task, TRUE);
+
+  source = g_idle_source_new ();
+  g_source_set_priority (source, G_PRIORITY_HIGH);
+  g_source_set_callback (source, run_impl_task_in_thread, &task, NULL);
+  g_source_attach (source, kms->impl_main_context);
+  g_source_unref (source);
+
+  g_mutex_lock (&kms->impl_mutex);
+  while (!task.done)
+    g_cond_wait (&kms->impl_cond, &kms->impl_mutex);
+  g_mutex_unlock (&kms->impl_mutex);
+
+  g_atomic_int_set (&kms->waiting_for_impl_task, FALSE);
+
+  return task.ret;
+}
+
+static void
+meta_kms_impl_task_free (MetaKmsImplTask *task)
+{
+  if (task->user_data_destroy)
+    task->user_data_destroy (task->user_data);
+  g_free (task);
+}
+
+static gboolean
+run_impl_task_async (gpointer user_data)
+{
+  MetaKmsImplTask *task = user_data;
+  MetaKms *kms = task->kms;
+  gpointer ret;
+  GError *error = NULL;
+
+  g_atomic_int_set (&kms->in_impl_task, TRUE);
+  ret = task->func (kms->impl, task->user_data, &error);
+  g_atomic_int_set (&kms->in_impl_task, FALSE);
+
+  if (!GPOINTER_TO_INT (ret))
+    {
+      g_warning ("Failed to run impl task: %s",
+                 error ? error->message : "unknown error");
+      g_clear_error (&error);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * meta_kms_run_impl_task_async:
+ * @kms: a #MetaKms
+ * @func: the task function, returning %FALSE on failure
+ * @user_data: data passed to @func
+ * @user_data_destroy: destroy notify for @user_data
+ *
+ * Queues @func to be run in the impl context without waiting for it to
+ * complete. Unlike meta_kms_run_impl_task_sync(), this may be called from any
+ * thread, e.g. the input thread.
+ */
+void
+meta_kms_run_impl_task_async (MetaKms             *kms,
+                              MetaKmsImplTaskFunc  func,
+                              gpointer             user_data,
+                              GDestroyNotify       user_data_destroy)
+{
+  MetaKmsImplTask *task;
+  GSource *source;
+
+  task = g_new0 (MetaKmsImplTask, 1);
+  *task = (MetaKmsImplTask) {
+    .kms = kms,
+    .func = func,
+    .user_data = user_data,
+    .user_data_destroy = user_data_destroy,
+  };
+
+  source = g_idle_source_new ();
+  g_source_set_priority (source, G_PRIORITY_HIGH);
+  g_source_set_callback (source, run_impl_task_async, task,
+                         (GDestroyNotify) meta_kms_impl_task_free);
+  g_source_attach (source, kms->impl_main_context);
+  g_source_unref (source);
 }
 
 static gboolean
@@ -456,9 +629,9 @@ simple_impl_source_dispatch (GSource     *source,
   MetaKms *kms = simple_impl_source->kms;
   gboolean ret;
 
-  kms->in_impl_task = TRUE;
+  g_atomic_int_set (&kms->in_impl_task, TRUE);
   ret = callback (user_data);
-  kms->in_impl_task = FALSE;
+  g_atomic_int_set (&kms->in_impl_task, FALSE);
 
   return ret;
 }
@@ -508,11 +681,11 @@ meta_kms_fd_impl_source_dispatch (GSource     *source,
   gpointer ret;
   GError *error = NULL;
 
-  kms->in_impl_task = TRUE;
+  g_atomic_int_set (&kms->in_impl_task, TRUE);
   ret = fd_impl_source->dispatch (kms->impl,
                                   fd_impl_source->user_data,
                                   &error);
-  kms->in_impl_task = FALSE;
+  g_atomic_int_set (&kms->in_impl_task, FALSE);
 
   if (!GPOINTER_TO_INT (ret))
     {
@@ -556,13 +729,16 @@ meta_kms_register_fd_in_impl (MetaKms             *kms,
 gboolean
 meta_kms_in_impl_task (MetaKms *kms)
 {
-  return kms->in_impl_task;
+  if (kms->impl_thread)
+    return g_thread_self () == kms->impl_thread;
+  else
+    return g_atomic_int_get (&kms->in_impl_task);
 }
 
 gboolean
 meta_kms_is_waiting_for_impl_task (MetaKms *kms)
 {
-  return kms->waiting_for_impl_task;
+  return g_atomic_int_get (&kms->waiting_for_impl_task);
 }
 
 typedef struct _UpdateStatesData
@@ -713,6 +889,81 @@ meta_kms_create_device (MetaKms            *kms,
   return device;
 }
 
+MetaKmsCursorManager *
+meta_kms_get_cursor_manager (MetaKms *kms)
+{
+  return kms->cursor_manager;
+}
+
+/**
+ * meta_kms_get_impl_thread_id:
+ * @kms: a #MetaKms
+ *
+ * Returns: the kernel thread ID of the impl thread, e.g. to change its
+ * scheduling policy, or 0 if the impl context runs in the main thread.
+ */
+pid_t
+meta_kms_get_impl_thread_id (MetaKms *kms)
+{
+  return kms->impl_thread_id;
+}
+
+static gpointer
+impl_thread_func (gpointer user_data)
+{
+  MetaKms *kms = user_data;
+
+  g_main_context_push_thread_default (kms->impl_main_context);
+
+  g_mutex_lock (&kms->impl_mutex);
+  kms->impl_thread_id = gettid ();
+  kms->impl_thread_initialized = TRUE;
+  g_cond_broadcast (&kms->impl_cond);
+  g_mutex_unlock (&kms->impl_mutex);
+
+  g_main_loop_run (kms->impl_main_loop);
+
+  g_main_context_pop_thread_default (kms->impl_main_context);
+
+  return NULL;
+}
+
+static gboolean
+start_impl_thread (MetaKms  *kms,
+                   GError  **error)
+{
+  kms->impl_main_context = g_main_context_new ();
+  kms->impl_main_loop = g_main_loop_new (kms->impl_main_context, FALSE);
+
+  kms->impl_thread = g_thread_try_new ("Mutter KMS Thread",
+                                       impl_thread_func,
+                                       kms,
+                                       error);
+  if (!kms->impl_thread)
+    return FALSE;
+
+  g_mutex_lock (&kms->impl_mutex);
+  while (!kms->impl_thread_initialized)
+    g_cond_wait (&kms->impl_cond, &kms->impl_mutex);
+  g_mutex_unlock (&kms->impl_mutex);
+
+  return TRUE;
+}
+
+static void
+stop_impl_thread (MetaKms *kms)
+{
+  if (kms->impl_thread)
+    {
+      g_main_loop_quit (kms->impl_main_loop);
+      g_clear_pointer (&kms->impl_thread, g_thread_join);
+      kms->impl_thread_id = 0;
+    }
+
+  g_clear_pointer (&kms->impl_main_loop, g_main_loop_unref);
+  g_clear_pointer (&kms->impl_main_context, g_main_context_unref);
+}
+
 MetaKms *
 meta_kms_new (MetaBackend   *backend,
               MetaKmsFlags   flags,
@@ -732,6 +983,15 @@ meta_kms_new (MetaBackend   *backend,
       return NULL;
     }
 
+  kms->cursor_manager = meta_kms_cursor_manager_new (kms);
+
+  if (!(flags & META_KMS_FLAG_NO_IMPL_THREAD) &&
+      !start_impl_thread (kms, error))
+    {
+      g_object_unref (kms);
+      return NULL;
+    }
+
   if (!(flags & META_KMS_FLAG_NO_MODE_SETTING))
     {
       kms->hotplug_handler_id =
@@ -757,6 +1017,7 @@ prepare_shutdown_in_impl (MetaKmsImpl  *impl,
 void
 meta_kms_prepare_shutdown (MetaKms *kms)
 {
+  meta_kms_cursor_manager_prepare_shutdown (kms->cursor_manager);
   meta_kms_run_impl_task_sync (kms, prepare_shutdown_in_impl, NULL, NULL);
   flush_callbacks (kms);
 }
@@ -769,23 +1030,34 @@ meta_kms_finalize (GObject *object)
   MetaUdev *udev = meta_backend_native_get_udev (backend_native);
   GList *l;
 
+  g_list_free_full (kms->devices, g_object_unref);
+
+  stop_impl_thread (kms);
+
+  g_clear_object (&kms->cursor_manager);
+
   for (l = kms->pending_callbacks; l; l = l->next)
     meta_kms_callback_data_free (l->data);
   g_list_free (kms->pending_callbacks);
 
   g_clear_handle_id (&kms->callback_source_id, g_source_remove);
 
-  g_list_free_full (kms->devices, g_object_unref);
-
   g_clear_signal_handler (&kms->hotplug_handler_id, udev);
   g_clear_signal_handler (&kms->removed_handler_id, udev);
 
+  g_mutex_clear (&kms->impl_mutex);
+  g_cond_clear (&kms->impl_cond);
+  g_mutex_clear (&kms->callbacks_mutex);
+
   G_OBJECT_CLASS (meta_kms_parent_class)->finalize (object);
 }
 
 static void
 meta_kms_init (MetaKms *kms)
 {
+  g_mutex_init (&kms->impl_mutex);
+  g_cond_init (&kms->impl_cond);
+  g_mutex_init (&kms->callbacks_mutex);
 }
 
 static void
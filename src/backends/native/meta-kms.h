@@ -21,6 +21,7 @@
 #define META_KMS_H
 
 #include <glib-object.h>
+#include <sys/types.h>
 
 #include "backends/meta-backend-private.h"
 #include "backends/native/meta-kms-types.h"
@@ -29,12 +30,14 @@ typedef enum _MetaKmsFlags
 {
   META_KMS_FLAG_NONE = 0,
   META_KMS_FLAG_NO_MODE_SETTING = 1 << 0,
+  META_KMS_FLAG_NO_IMPL_THREAD = 1 << 1,
 } MetaKmsFlags;
 
 typedef enum _MetaKmsUpdateFlag
 {
   META_KMS_UPDATE_FLAG_NONE = 0,
   META_KMS_UPDATE_FLAG_PRESERVE_ON_ERROR = 1 << 0,
+  META_KMS_UPDATE_FLAG_TEST_ONLY = 1 << 1,
 } MetaKmsUpdateFlag;
 
 #define META_TYPE_KMS (meta_kms_get_type ())
@@ -67,6 +70,11 @@ MetaKmsDevice * meta_kms_create_device (MetaKms            *kms,
 
 void meta_kms_prepare_shutdown (MetaKms *kms);
 
+MetaKmsCursorManager * meta_kms_get_cursor_manager (MetaKms *kms);
+
+META_EXPORT_TEST
+pid_t meta_kms_get_impl_thread_id (MetaKms *kms);
+
 MetaKms * meta_kms_new (MetaBackend   *backend,
                         MetaKmsFlags   flags,
                         GError       **error);
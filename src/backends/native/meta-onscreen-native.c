@@ -39,7 +39,10 @@
 #include "backends/native/meta-drm-buffer-gbm.h"
 #include "backends/native/meta-drm-buffer-import.h"
 #include "backends/native/meta-drm-buffer.h"
+#include "backends/native/meta-kms-device-private.h"
 #include "backends/native/meta-kms-device.h"
+#include "backends/native/meta-kms-plane.h"
+#include "backends/native/meta-kms-update-private.h"
 #include "backends/native/meta-kms-utils.h"
 #include "backends/native/meta-kms.h"
 #include "backends/native/meta-output-kms.h"
@@ -81,6 +84,15 @@ typedef struct _MetaOnscreenNativeSecondaryGpuState
   MetaSharedFramebufferImportStatus import_status;
 } MetaOnscreenNativeSecondaryGpuState;
 
+typedef struct _MetaOnscreenNativeOverlayConfig
+{
+  uint32_t format;
+  uint64_t modifier;
+  int width;
+  int height;
+  MetaRectangle dst_rect;
+} MetaOnscreenNativeOverlayConfig;
+
 struct _MetaOnscreenNative
 {
   CoglOnscreenEgl parent;
@@ -96,8 +108,25 @@ struct _MetaOnscreenNative
     struct gbm_surface *surface;
     MetaDrmBuffer *current_fb;
     MetaDrmBuffer *next_fb;
+    /* Swapped while next_fb was still waiting to be flipped */
+    MetaDrmBuffer *queued_fb;
   } gbm;
 
+  struct {
+    /* Client buffer to put on an overlay plane with the next flip */
+    MetaDrmBuffer *pending_fb;
+    MetaRectangle pending_dst_rect;
+
+    MetaKmsPlane *plane;
+    MetaDrmBuffer *current_fb;
+    MetaDrmBuffer *next_fb;
+
+    /* The last configuration checked with a test commit, and its result */
+    MetaOnscreenNativeOverlayConfig tested_config;
+    gboolean has_tested_config;
+    gboolean tested_config_passed;
+  } overlay;
+
 #ifdef HAVE_EGL_DEVICE
   struct {
     EGLStreamKHR stream;
@@ -167,6 +196,10 @@ meta_onscreen_native_swap_drm_fb (CoglOnscreen *onscreen)
   g_set_object (&onscreen_native->gbm.current_fb, onscreen_native->gbm.next_fb);
   g_clear_object (&onscreen_native->gbm.next_fb);
 
+  g_set_object (&onscreen_native->overlay.current_fb,
+                onscreen_native->overlay.next_fb);
+  g_clear_object (&onscreen_native->overlay.next_fb);
+
   swap_secondary_drm_fb (onscreen);
 }
 
@@ -205,13 +238,31 @@ meta_onscreen_native_notify_frame_complete (CoglOnscreen *onscreen)
 
   info = cogl_onscreen_pop_head_frame_info (onscreen);
 
-  g_assert (!cogl_onscreen_peek_head_frame_info (onscreen));
-
   _cogl_onscreen_notify_frame_sync (onscreen, info);
   _cogl_onscreen_notify_complete (onscreen, info);
   cogl_object_unref (info);
 }
 
+static void post_latest_swap (CoglOnscreen *onscreen,
+                              const int    *rectangles,
+                              int           n_rectangles);
+
+static void
+maybe_post_queued_frame (CoglOnscreen *onscreen)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+
+  if (!onscreen_native->gbm.queued_fb || onscreen_native->gbm.next_fb)
+    return;
+
+  onscreen_native->gbm.next_fb =
+    g_steal_pointer (&onscreen_native->gbm.queued_fb);
+
+  /* The damage of the queued frame is relative to the one it was queued
+   * behind, which only just got flipped, so post it in full. */
+  post_latest_swap (onscreen, NULL, 0);
+}
+
 static void
 notify_view_crtc_presented (MetaRendererView *view,
                             MetaKmsCrtc      *kms_crtc,
@@ -233,6 +284,7 @@ notify_view_crtc_presented (MetaRendererView *view,
 
   meta_onscreen_native_notify_frame_complete (onscreen);
   meta_onscreen_native_swap_drm_fb (onscreen);
+  maybe_post_queued_frame (onscreen);
 }
 
 static int64_t
@@ -339,11 +391,15 @@ page_flip_feedback_discarded (MetaKmsCrtc  *kms_crtc,
                         G_IO_ERROR_PERMISSION_DENIED))
     g_warning ("Page flip discarded: %s", error->message);
 
+  /* The overlay configuration may be what made the commit fail */
+  META_ONSCREEN_NATIVE (onscreen)->overlay.has_tested_config = FALSE;
+
   frame_info = cogl_onscreen_peek_head_frame_info (onscreen);
   frame_info->flags |= COGL_FRAME_INFO_FLAG_SYMBOLIC;
 
   meta_onscreen_native_notify_frame_complete (onscreen);
   meta_onscreen_native_swap_drm_fb (onscreen);
+  maybe_post_queued_frame (onscreen);
 }
 
 static const MetaKmsPageFlipListenerVtable page_flip_listener_vtable = {
@@ -416,6 +472,128 @@ meta_onscreen_native_dummy_power_save_page_flip (CoglOnscreen *onscreen)
   meta_onscreen_native_notify_frame_complete (onscreen);
 }
 
+static void
+init_overlay_config (MetaOnscreenNativeOverlayConfig *config,
+                     MetaDrmBuffer                   *buffer,
+                     const MetaRectangle             *dst_rect)
+{
+  *config = (MetaOnscreenNativeOverlayConfig) {
+    .format = meta_drm_buffer_get_format (buffer),
+    .modifier = meta_drm_buffer_get_modifier (buffer),
+    .width = meta_drm_buffer_get_width (buffer),
+    .height = meta_drm_buffer_get_height (buffer),
+    .dst_rect = *dst_rect,
+  };
+}
+
+static gboolean
+overlay_config_equal (const MetaOnscreenNativeOverlayConfig *config,
+                      const MetaOnscreenNativeOverlayConfig *other_config)
+{
+  return (config->format == other_config->format &&
+          config->modifier == other_config->modifier &&
+          config->width == other_config->width &&
+          config->height == other_config->height &&
+          meta_rectangle_equal (&config->dst_rect, &other_config->dst_rect));
+}
+
+static void
+assign_overlay_plane (CoglOnscreen  *onscreen,
+                      MetaKmsCrtc   *kms_crtc,
+                      MetaKmsUpdate *kms_update)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  MetaRendererNative *renderer_native = onscreen_native->renderer_native;
+  MetaKmsDevice *kms_device = meta_kms_crtc_get_device (kms_crtc);
+  MetaKms *kms = meta_kms_device_get_kms (kms_device);
+  g_autoptr (MetaDrmBuffer) buffer = NULL;
+  MetaKmsPlane *old_plane;
+  MetaKmsPlane *plane = NULL;
+  MetaFixed16Rectangle src_rect;
+  MetaOnscreenNativeOverlayConfig config;
+  g_autoptr (MetaKmsFeedback) kms_feedback = NULL;
+
+  buffer = g_steal_pointer (&onscreen_native->overlay.pending_fb);
+  old_plane = g_steal_pointer (&onscreen_native->overlay.plane);
+
+  if (meta_renderer_native_has_pending_mode_set (renderer_native))
+    onscreen_native->overlay.has_tested_config = FALSE;
+  else if (buffer)
+    {
+      plane =
+        meta_kms_update_find_overlay_plane (kms_update,
+                                            meta_kms_device_get_planes (kms_device),
+                                            meta_kms_crtc_get_idx (kms_crtc),
+                                            meta_drm_buffer_get_format (buffer),
+                                            meta_drm_buffer_get_modifier (buffer));
+    }
+
+  if (old_plane && old_plane != plane)
+    meta_kms_update_unassign_plane (kms_update, kms_crtc, old_plane);
+
+  if (!plane)
+    return;
+
+  src_rect = (MetaFixed16Rectangle) {
+    .x = meta_fixed_16_from_int (0),
+    .y = meta_fixed_16_from_int (0),
+    .width = meta_fixed_16_from_int (meta_drm_buffer_get_width (buffer)),
+    .height = meta_fixed_16_from_int (meta_drm_buffer_get_height (buffer)),
+  };
+  meta_kms_update_assign_plane (kms_update,
+                                kms_crtc,
+                                plane,
+                                buffer,
+                                src_rect,
+                                onscreen_native->overlay.pending_dst_rect,
+                                META_KMS_ASSIGN_PLANE_FLAG_NONE);
+
+  init_overlay_config (&config, buffer,
+                       &onscreen_native->overlay.pending_dst_rect);
+
+  /* A configuration that is already on the plane only changes the buffer,
+   * so there is no need to block on another test commit every frame. */
+  if (old_plane != plane ||
+      !onscreen_native->overlay.has_tested_config ||
+      !onscreen_native->overlay.tested_config_passed ||
+      !overlay_config_equal (&config, &onscreen_native->overlay.tested_config))
+    {
+      /* The primary plane is already assigned, so the test commit checks
+       * the complete plane configuration that is about to be posted. */
+      kms_feedback =
+        meta_kms_post_pending_update_sync (kms, kms_device,
+                                           META_KMS_UPDATE_FLAG_TEST_ONLY);
+
+      onscreen_native->overlay.tested_config = config;
+      onscreen_native->overlay.has_tested_config = TRUE;
+      onscreen_native->overlay.tested_config_passed =
+        meta_kms_feedback_get_result (kms_feedback) == META_KMS_FEEDBACK_PASSED;
+
+      if (!onscreen_native->overlay.tested_config_passed)
+        {
+          meta_topic (META_DEBUG_KMS,
+                      "Overlay plane rejected on CRTC %u (%s): %s",
+                      meta_kms_crtc_get_id (kms_crtc),
+                      meta_kms_device_get_path (kms_device),
+                      meta_kms_feedback_get_error (kms_feedback)->message);
+
+          meta_kms_update_drop_plane_assignment (kms_update, plane);
+          if (old_plane == plane)
+            meta_kms_update_unassign_plane (kms_update, kms_crtc, plane);
+          return;
+        }
+    }
+
+  meta_topic (META_DEBUG_KMS,
+              "Assigning client buffer to overlay plane %u on CRTC %u (%s)",
+              meta_kms_plane_get_id (plane),
+              meta_kms_crtc_get_id (kms_crtc),
+              meta_kms_device_get_path (kms_device));
+
+  onscreen_native->overlay.plane = plane;
+  g_set_object (&onscreen_native->overlay.next_fb, buffer);
+}
+
 static void
 meta_onscreen_native_flip_crtc (CoglOnscreen                *onscreen,
                                 MetaRendererView            *view,
@@ -472,6 +650,8 @@ meta_onscreen_native_flip_crtc (CoglOnscreen                *onscreen,
           meta_kms_plane_assignment_set_fb_damage (plane_assignment,
                                                    rectangles, n_rectangles);
         }
+
+      assign_overlay_plane (onscreen, kms_crtc, kms_update);
       break;
     case META_RENDERER_NATIVE_MODE_SURFACELESS:
       g_assert_not_reached ();
@@ -1031,15 +1211,12 @@ ensure_crtc_modes (CoglOnscreen *onscreen)
 }
 
 static void
-meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
-                                               const int     *rectangles,
-                                               int            n_rectangles,
-                                               CoglFrameInfo *frame_info,
-                                               gpointer       user_data)
+post_latest_swap (CoglOnscreen *onscreen,
+                  const int    *rectangles,
+                  int           n_rectangles)
 {
   CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
   CoglContext *cogl_context = cogl_framebuffer_get_context (framebuffer);
-  CoglDisplay *cogl_display = cogl_context_get_display (cogl_context);
   CoglRenderer *cogl_renderer = cogl_context->display->renderer;
   CoglRendererEGL *cogl_renderer_egl = cogl_renderer->winsys;
   MetaRendererNativeGpuData *renderer_gpu_data = cogl_renderer_egl->platform;
@@ -1051,84 +1228,16 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
     meta_backend_get_monitor_manager (backend);
   MetaKms *kms = meta_backend_native_get_kms (backend_native);
   MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
-  MetaGpuKms *render_gpu = onscreen_native->render_gpu;
-  MetaDeviceFile *render_device_file;
-  ClutterFrame *frame = user_data;
-  CoglOnscreenClass *parent_class;
-  gboolean egl_context_changed = FALSE;
   MetaPowerSave power_save_mode;
-  g_autoptr (GError) error = NULL;
-  MetaDrmBufferFlags buffer_flags;
-  MetaDrmBufferGbm *buffer_gbm;
   MetaKmsCrtc *kms_crtc;
   MetaKmsDevice *kms_device;
   MetaKmsUpdateFlag flags;
   g_autoptr (MetaKmsFeedback) kms_feedback = NULL;
   const GError *feedback_error;
 
-  COGL_TRACE_BEGIN_SCOPED (MetaRendererNativeSwapBuffers,
-                           "Onscreen (swap-buffers)");
-
-  update_secondary_gpu_state_pre_swap_buffers (onscreen,
-                                               rectangles,
-                                               n_rectangles);
-
-  parent_class = COGL_ONSCREEN_CLASS (meta_onscreen_native_parent_class);
-  parent_class->swap_buffers_with_damage (onscreen,
-                                          rectangles,
-                                          n_rectangles,
-                                          frame_info,
-                                          user_data);
-
-  renderer_gpu_data = meta_renderer_native_get_gpu_data (renderer_native,
-                                                         render_gpu);
-  render_device_file =
-    meta_render_device_get_device_file (renderer_gpu_data->render_device);
-  switch (renderer_gpu_data->mode)
-    {
-    case META_RENDERER_NATIVE_MODE_GBM:
-      g_warn_if_fail (onscreen_native->gbm.next_fb == NULL);
-      g_clear_object (&onscreen_native->gbm.next_fb);
-
-      buffer_flags = META_DRM_BUFFER_FLAG_NONE;
-      if (!meta_renderer_native_use_modifiers (renderer_native))
-        buffer_flags |= META_DRM_BUFFER_FLAG_DISABLE_MODIFIERS;
-
-      buffer_gbm =
-        meta_drm_buffer_gbm_new_lock_front (render_device_file,
-                                            onscreen_native->gbm.surface,
-                                            buffer_flags,
-                                            &error);
-      if (!buffer_gbm)
-        {
-          g_warning ("Failed to lock front buffer on %s: %s",
-                     meta_device_file_get_path (render_device_file),
-                     error->message);
-          return;
-        }
-
-      onscreen_native->gbm.next_fb = META_DRM_BUFFER (buffer_gbm);
-
-      break;
-    case META_RENDERER_NATIVE_MODE_SURFACELESS:
-      g_assert_not_reached ();
-      break;
-#ifdef HAVE_EGL_DEVICE
-    case META_RENDERER_NATIVE_MODE_EGL_DEVICE:
-      break;
-#endif
-    }
-
-  update_secondary_gpu_state_post_swap_buffers (onscreen, &egl_context_changed);
-
-  /*
-   * If we changed EGL context, cogl will have the wrong idea about what is
-   * current, making it fail to set it when it needs to. Avoid that by making
-   * EGL_NO_CONTEXT current now, making cogl eventually set the correct
-   * context.
-   */
-  if (egl_context_changed)
-    _cogl_winsys_egl_ensure_current (cogl_display);
+  renderer_gpu_data =
+    meta_renderer_native_get_gpu_data (renderer_native,
+                                       onscreen_native->render_gpu);
 
   power_save_mode = meta_monitor_manager_get_power_save_mode (monitor_manager);
   if (power_save_mode == META_POWER_SAVE_ON)
@@ -1145,8 +1254,6 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
     {
       meta_renderer_native_queue_power_save_page_flip (renderer_native,
                                                        onscreen);
-      clutter_frame_set_result (frame,
-                                CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
       return;
     }
 
@@ -1165,8 +1272,6 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
                       meta_kms_crtc_get_id (kms_crtc),
                       meta_kms_device_get_path (kms_device));
 
-          clutter_frame_set_result (frame,
-                                    CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
           return;
         }
       else if (meta_renderer_native_has_pending_mode_set (renderer_native))
@@ -1176,8 +1281,6 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
 
           meta_renderer_native_notify_mode_sets_reset (renderer_native);
           meta_renderer_native_post_mode_set_updates (renderer_native);
-          clutter_frame_set_result (frame,
-                                    CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
           return;
         }
       break;
@@ -1190,8 +1293,6 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
         {
           meta_renderer_native_notify_mode_sets_reset (renderer_native);
           meta_renderer_native_post_mode_set_updates (renderer_native);
-          clutter_frame_set_result (frame,
-                                    CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
           return;
         }
       break;
@@ -1209,13 +1310,8 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
   switch (meta_kms_feedback_get_result (kms_feedback))
     {
     case META_KMS_FEEDBACK_PASSED:
-      clutter_frame_set_result (frame,
-                                CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
       break;
     case META_KMS_FEEDBACK_FAILED:
-      clutter_frame_set_result (frame,
-                                CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
-
       feedback_error = meta_kms_feedback_get_error (kms_feedback);
       if (!g_error_matches (feedback_error,
                             G_IO_ERROR,
@@ -1225,6 +1321,110 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
     }
 }
 
+static void
+meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
+                                               const int     *rectangles,
+                                               int            n_rectangles,
+                                               CoglFrameInfo *frame_info,
+                                               gpointer       user_data)
+{
+  CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
+  CoglContext *cogl_context = cogl_framebuffer_get_context (framebuffer);
+  CoglDisplay *cogl_display = cogl_context_get_display (cogl_context);
+  CoglRenderer *cogl_renderer = cogl_context->display->renderer;
+  CoglRendererEGL *cogl_renderer_egl = cogl_renderer->winsys;
+  MetaRendererNativeGpuData *renderer_gpu_data = cogl_renderer_egl->platform;
+  MetaRendererNative *renderer_native = renderer_gpu_data->renderer_native;
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  MetaGpuKms *render_gpu = onscreen_native->render_gpu;
+  MetaDeviceFile *render_device_file;
+  ClutterFrame *frame = user_data;
+  CoglOnscreenClass *parent_class;
+  gboolean egl_context_changed = FALSE;
+  g_autoptr (GError) error = NULL;
+  MetaDrmBufferFlags buffer_flags;
+  MetaDrmBufferGbm *buffer_gbm;
+
+  COGL_TRACE_BEGIN_SCOPED (MetaRendererNativeSwapBuffers,
+                           "Onscreen (swap-buffers)");
+
+  update_secondary_gpu_state_pre_swap_buffers (onscreen,
+                                               rectangles,
+                                               n_rectangles);
+
+  parent_class = COGL_ONSCREEN_CLASS (meta_onscreen_native_parent_class);
+  parent_class->swap_buffers_with_damage (onscreen,
+                                          rectangles,
+                                          n_rectangles,
+                                          frame_info,
+                                          user_data);
+
+  renderer_gpu_data = meta_renderer_native_get_gpu_data (renderer_native,
+                                                         render_gpu);
+  render_device_file =
+    meta_render_device_get_device_file (renderer_gpu_data->render_device);
+  switch (renderer_gpu_data->mode)
+    {
+    case META_RENDERER_NATIVE_MODE_GBM:
+      g_warn_if_fail (onscreen_native->gbm.queued_fb == NULL);
+      g_clear_object (&onscreen_native->gbm.queued_fb);
+
+      buffer_flags = META_DRM_BUFFER_FLAG_NONE;
+      if (!meta_renderer_native_use_modifiers (renderer_native))
+        buffer_flags |= META_DRM_BUFFER_FLAG_DISABLE_MODIFIERS;
+
+      buffer_gbm =
+        meta_drm_buffer_gbm_new_lock_front (render_device_file,
+                                            onscreen_native->gbm.surface,
+                                            buffer_flags,
+                                            &error);
+      if (!buffer_gbm)
+        {
+          g_warning ("Failed to lock front buffer on %s: %s",
+                     meta_device_file_get_path (render_device_file),
+                     error->message);
+          return;
+        }
+
+      if (onscreen_native->gbm.next_fb)
+        {
+          /* With triple buffering, the previous frame may still be waiting
+           * to be flipped. Queue this one behind it; it is posted as soon
+           * as the previous one got presented. */
+          onscreen_native->gbm.queued_fb = META_DRM_BUFFER (buffer_gbm);
+          clutter_frame_set_result (frame,
+                                    CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
+          return;
+        }
+
+      onscreen_native->gbm.next_fb = META_DRM_BUFFER (buffer_gbm);
+
+      break;
+    case META_RENDERER_NATIVE_MODE_SURFACELESS:
+      g_assert_not_reached ();
+      break;
+#ifdef HAVE_EGL_DEVICE
+    case META_RENDERER_NATIVE_MODE_EGL_DEVICE:
+      break;
+#endif
+    }
+
+  update_secondary_gpu_state_post_swap_buffers (onscreen, &egl_context_changed);
+
+  /*
+   * If we changed EGL context, cogl will have the wrong idea about what is
+   * current, making it fail to set it when it needs to. Avoid that by making
+   * EGL_NO_CONTEXT current now, making cogl eventually set the correct
+   * context.
+   */
+  if (egl_context_changed)
+    _cogl_winsys_egl_ensure_current (cogl_display);
+
+  clutter_frame_set_result (frame, CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
+
+  post_latest_swap (onscreen, rectangles, n_rectangles);
+}
+
 gboolean
 meta_onscreen_native_is_buffer_scanout_compatible (CoglOnscreen *onscreen,
                                                    uint32_t      drm_format,
@@ -1268,6 +1468,166 @@ meta_onscreen_native_is_buffer_scanout_compatible (CoglOnscreen *onscreen,
   return TRUE;
 }
 
+gboolean
+meta_onscreen_native_is_buffer_overlay_compatible (CoglOnscreen *onscreen,
+                                                   uint32_t      drm_format,
+                                                   uint64_t      drm_modifier)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  const MetaCrtcConfig *crtc_config;
+  MetaKmsCrtc *kms_crtc;
+  MetaKmsDevice *kms_device;
+  GList *l;
+
+  crtc_config = meta_crtc_get_config (onscreen_native->crtc);
+  if (crtc_config->transform != META_MONITOR_TRANSFORM_NORMAL)
+    return FALSE;
+
+  if (onscreen_native->secondary_gpu_state)
+    return FALSE;
+
+  if (!onscreen_native->gbm.surface)
+    return FALSE;
+
+  kms_crtc = meta_crtc_kms_get_kms_crtc (META_CRTC_KMS (onscreen_native->crtc));
+  kms_device = meta_kms_crtc_get_device (kms_crtc);
+
+  /* Overlay assignments are validated with test commits before posting */
+  if (!meta_kms_device_supports_test_commits (kms_device))
+    return FALSE;
+
+  for (l = meta_kms_device_get_planes (kms_device); l; l = l->next)
+    {
+      MetaKmsPlane *plane = l->data;
+
+      if (meta_kms_plane_get_plane_type (plane) != META_KMS_PLANE_TYPE_OVERLAY)
+        continue;
+
+      if (!meta_kms_plane_is_usable_with (plane, kms_crtc))
+        continue;
+
+      if (meta_kms_plane_is_format_modifier_supported (plane,
+                                                       drm_format,
+                                                       drm_modifier))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/**
+ * meta_onscreen_native_queue_overlay_scanout:
+ * @onscreen: A #CoglOnscreen
+ * @scanout: (nullable): Scanout buffer acquired for an overlay plane
+ * @dst_rect: (nullable): Destination of the buffer in CRTC coordinates
+ *
+ * Queues a client buffer to be put on an overlay plane, above the composited
+ * primary plane, with the next flip. The overlay plane is released again on
+ * the first flip without a queued buffer, so this should be called before
+ * every frame that is to keep the buffer on an overlay plane.
+ *
+ * A configuration that already failed a test commit is not queued again.
+ *
+ * Returns: %TRUE if the same configuration is already on an overlay plane,
+ *   so the buffer will be shown there with the next flip without another
+ *   test commit, and doesn't need to be composited on the primary plane
+ */
+gboolean
+meta_onscreen_native_queue_overlay_scanout (CoglOnscreen        *onscreen,
+                                            CoglScanout         *scanout,
+                                            const MetaRectangle *dst_rect)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  MetaOnscreenNativeOverlayConfig config;
+
+  g_clear_object (&onscreen_native->overlay.pending_fb);
+
+  if (!scanout)
+    return FALSE;
+
+  init_overlay_config (&config, META_DRM_BUFFER (scanout), dst_rect);
+
+  if (onscreen_native->overlay.has_tested_config &&
+      !onscreen_native->overlay.tested_config_passed &&
+      overlay_config_equal (&config, &onscreen_native->overlay.tested_config))
+    return FALSE;
+
+  g_set_object (&onscreen_native->overlay.pending_fb,
+                META_DRM_BUFFER (scanout));
+  onscreen_native->overlay.pending_dst_rect = *dst_rect;
+
+  return (onscreen_native->overlay.plane &&
+          onscreen_native->overlay.has_tested_config &&
+          onscreen_native->overlay.tested_config_passed &&
+          overlay_config_equal (&config,
+                                &onscreen_native->overlay.tested_config));
+}
+
+static gboolean
+test_direct_scanout (CoglOnscreen  *onscreen,
+                     MetaKmsCrtc   *kms_crtc,
+                     GError       **error)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  MetaKmsDevice *kms_device = meta_kms_crtc_get_device (kms_crtc);
+  MetaKms *kms = meta_kms_device_get_kms (kms_device);
+  MetaKmsPlaneConfigCache *plane_config_cache =
+    meta_kms_device_get_plane_config_cache (kms_device);
+  g_autoptr (MetaKmsFeedback) kms_feedback = NULL;
+  g_autoptr (GArray) plane_configs = NULL;
+  g_autoptr (GError) local_error = NULL;
+  MetaKmsUpdate *kms_update;
+  MetaKmsPlaneAssignment *plane_assignment;
+
+  kms_update = meta_kms_get_pending_update (kms, kms_device);
+
+  /* Only block on a test commit for configurations that haven't been seen
+   * before; a known rejection is dropped right away. */
+  plane_configs = meta_kms_update_collect_plane_configs (kms_update);
+  if (plane_configs)
+    {
+      switch (meta_kms_plane_config_cache_lookup (plane_config_cache,
+                                                  (MetaKmsPlaneConfig *) plane_configs->data,
+                                                  plane_configs->len))
+        {
+        case META_KMS_PLANE_CONFIG_RESULT_UNKNOWN:
+          break;
+        case META_KMS_PLANE_CONFIG_RESULT_PASSED:
+          return TRUE;
+        case META_KMS_PLANE_CONFIG_RESULT_REJECTED:
+          local_error = g_error_new_literal (G_IO_ERROR,
+                                             G_IO_ERROR_INVALID_ARGUMENT,
+                                             "Plane configuration previously rejected");
+          goto rejected;
+        }
+    }
+
+  kms_feedback =
+    meta_kms_post_pending_update_sync (kms, kms_device,
+                                       META_KMS_UPDATE_FLAG_TEST_ONLY);
+  if (meta_kms_feedback_get_result (kms_feedback) == META_KMS_FEEDBACK_PASSED)
+    return TRUE;
+
+  local_error = g_error_copy (meta_kms_feedback_get_error (kms_feedback));
+  kms_update = meta_kms_get_pending_update (kms, kms_device);
+
+rejected:
+  plane_assignment =
+    meta_kms_update_get_primary_plane_assignment (kms_update, kms_crtc);
+  if (plane_assignment)
+    meta_kms_update_drop_plane_assignment (kms_update, plane_assignment->plane);
+  meta_kms_update_drop_defunct_page_flip_listeners (kms_update);
+
+  g_clear_object (&onscreen_native->gbm.next_fb);
+
+  g_set_error (error,
+               COGL_SCANOUT_ERROR,
+               COGL_SCANOUT_ERROR_INHIBITED,
+               "Direct scanout configuration rejected: %s",
+               local_error->message);
+  return FALSE;
+}
+
 static gboolean
 meta_onscreen_native_direct_scanout (CoglOnscreen   *onscreen,
                                      CoglScanout    *scanout,
@@ -1318,14 +1678,25 @@ meta_onscreen_native_direct_scanout (CoglOnscreen   *onscreen,
       return FALSE;
     }
 
+  if (onscreen_native->gbm.next_fb)
+    {
+      g_set_error_literal (error,
+                           COGL_SCANOUT_ERROR,
+                           COGL_SCANOUT_ERROR_INHIBITED,
+                           "Direct scanout is inhibited while a flip is pending");
+      return FALSE;
+    }
+
   renderer_gpu_data = meta_renderer_native_get_gpu_data (renderer_native,
                                                          render_gpu);
 
   g_warn_if_fail (renderer_gpu_data->mode == META_RENDERER_NATIVE_MODE_GBM);
-  g_warn_if_fail (!onscreen_native->gbm.next_fb);
 
   g_set_object (&onscreen_native->gbm.next_fb, META_DRM_BUFFER (scanout));
 
+  /* The scanout buffer covers the whole CRTC, no overlay is needed on top */
+  g_clear_object (&onscreen_native->overlay.pending_fb);
+
   /* Try to get a measurement of GPU rendering time on the scanout buffer.
    *
    * The successful operation here adds ~0.4 ms to a ~0.1 ms total frame clock
@@ -1369,6 +1740,10 @@ meta_onscreen_native_direct_scanout (CoglOnscreen   *onscreen,
               meta_kms_crtc_get_id (kms_crtc),
               meta_kms_device_get_path (kms_device));
 
+  if (meta_kms_device_supports_test_commits (kms_device) &&
+      !test_direct_scanout (onscreen, kms_crtc, error))
+    return FALSE;
+
   flags = META_KMS_UPDATE_FLAG_PRESERVE_ON_ERROR;
   kms_feedback = meta_kms_post_pending_update_sync (kms, kms_device, flags);
   switch (meta_kms_feedback_get_result (kms_feedback))
@@ -2165,6 +2540,14 @@ meta_onscreen_native_dispose (GObject *object)
       /* flip state takes a reference on the onscreen so there should
        * never be outstanding flips when we reach here. */
       g_warn_if_fail (onscreen_native->gbm.next_fb == NULL);
+      g_warn_if_fail (onscreen_native->gbm.queued_fb == NULL);
+      g_clear_object (&onscreen_native->gbm.queued_fb);
+
+      g_clear_object (&onscreen_native->overlay.pending_fb);
+      g_clear_object (&onscreen_native->overlay.next_fb);
+      g_clear_object (&onscreen_native->overlay.current_fb);
+      onscreen_native->overlay.plane = NULL;
+      onscreen_native->overlay.has_tested_config = FALSE;
 
       free_current_bo (onscreen);
       break;
@@ -2220,6 +2603,23 @@ meta_onscreen_native_class_init (MetaOnscreenNativeClass *klass)
   onscreen_class->direct_scanout = meta_onscreen_native_direct_scanout;
 }
 
+gboolean
+meta_onscreen_native_supports_triple_buffering (MetaOnscreenNative *onscreen_native)
+{
+  MetaRendererNativeGpuData *renderer_gpu_data;
+
+  /* Copying to secondary GPUs and EGLStreams assume a single frame in
+   * flight. */
+  if (onscreen_native->secondary_gpu_state)
+    return FALSE;
+
+  renderer_gpu_data =
+    meta_renderer_native_get_gpu_data (onscreen_native->renderer_native,
+                                       onscreen_native->render_gpu);
+
+  return renderer_gpu_data->mode == META_RENDERER_NATIVE_MODE_GBM;
+}
+
 MetaCrtc *
 meta_onscreen_native_get_crtc (MetaOnscreenNative *onscreen_native)
 {
@@ -27,6 +27,7 @@
 #include "backends/native/meta-backend-native-types.h"
 #include "clutter/clutter.h"
 #include "cogl/cogl.h"
+#include "meta/boxes.h"
 
 #define META_TYPE_ONSCREEN_NATIVE (meta_onscreen_native_get_type ())
 G_DECLARE_FINAL_TYPE (MetaOnscreenNative, meta_onscreen_native,
@@ -45,6 +46,14 @@ gboolean meta_onscreen_native_is_buffer_scanout_compatible (CoglOnscreen *onscre
                                                             uint64_t      drm_modifier,
                                                             uint32_t      stride);
 
+gboolean meta_onscreen_native_is_buffer_overlay_compatible (CoglOnscreen *onscreen,
+                                                            uint32_t      drm_format,
+                                                            uint64_t      drm_modifier);
+
+gboolean meta_onscreen_native_queue_overlay_scanout (CoglOnscreen        *onscreen,
+                                                     CoglScanout         *scanout,
+                                                     const MetaRectangle *dst_rect);
+
 void meta_onscreen_native_set_view (CoglOnscreen     *onscreen,
                                     MetaRendererView *view);
 
@@ -56,6 +65,8 @@ MetaOnscreenNative * meta_onscreen_native_new (MetaRendererNative *renderer_nati
                                                int                 width,
                                                int                 height);
 
+gboolean meta_onscreen_native_supports_triple_buffering (MetaOnscreenNative *onscreen_native);
+
 MetaCrtc * meta_onscreen_native_get_crtc (MetaOnscreenNative *onscreen_native);
 
 #endif /* META_ONSCREEN_NATIVE_H */
@@ -1201,6 +1201,7 @@ meta_renderer_native_create_view (MetaRenderer       *renderer,
 {
   MetaRendererNative *renderer_native = META_RENDERER_NATIVE (renderer);
   MetaBackend *backend = meta_renderer_get_backend (renderer);
+  MetaSettings *settings = meta_backend_get_settings (backend);
   MetaMonitorManager *monitor_manager =
     meta_backend_get_monitor_manager (backend);
   CoglContext *cogl_context =
@@ -1349,6 +1350,17 @@ meta_renderer_native_create_view (MetaRenderer       *renderer,
 
       meta_onscreen_native_set_view (COGL_ONSCREEN (framebuffer), view);
 
+      if (meta_settings_is_experimental_feature_enabled (
+            settings, META_EXPERIMENTAL_FEATURE_TRIPLE_BUFFERING) &&
+          meta_onscreen_native_supports_triple_buffering (
+            META_ONSCREEN_NATIVE (framebuffer)))
+        {
+          ClutterFrameClock *frame_clock =
+            clutter_stage_view_get_frame_clock (CLUTTER_STAGE_VIEW (view));
+
+          clutter_frame_clock_set_allow_triple_buffering (frame_clock, TRUE);
+        }
+
       /* Ensure we don't point to stale surfaces when creating the offscreen */
       cogl_display_egl = cogl_display->winsys;
       onscreen_egl = COGL_ONSCREEN_EGL (framebuffer);
@@ -559,6 +559,13 @@ new_absolute_motion_event (MetaSeatImpl       *seat_impl,
 
   g_rw_lock_writer_unlock (&seat_impl->state_lock);
 
+  if (seat_impl->kms_cursor_manager &&
+      clutter_input_device_get_device_type (input_device) != CLUTTER_TABLET_DEVICE)
+    {
+      meta_kms_cursor_manager_position_changed_in_input_impl (seat_impl->kms_cursor_manager,
+                                                              &GRAPHENE_POINT_INIT (x, y));
+    }
+
   return event;
 }
 
@@ -2953,6 +2960,7 @@ destroy_in_impl (GTask *task)
   meta_seat_impl_clear_repeat_source (seat_impl);
 
   g_clear_pointer (&priv->device_files, g_hash_table_destroy);
+  g_clear_object (&seat_impl->kms_cursor_manager);
 
   g_main_loop_quit (seat_impl->input_loop);
   g_task_return_boolean (task, TRUE);
@@ -3541,6 +3549,42 @@ meta_seat_impl_set_viewports (MetaSeatImpl     *seat_impl,
   g_object_unref (task);
 }
 
+static gboolean
+set_kms_cursor_manager (GTask *task)
+{
+  MetaSeatImpl *seat_impl = g_task_get_source_object (task);
+  MetaKmsCursorManager *kms_cursor_manager = g_task_get_task_data (task);
+
+  g_set_object (&seat_impl->kms_cursor_manager, kms_cursor_manager);
+  g_task_return_boolean (task, TRUE);
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * meta_seat_impl_set_kms_cursor_manager:
+ * @seat_impl: a #MetaSeatImpl
+ * @kms_cursor_manager: the #MetaKmsCursorManager to report pointer motion to
+ *
+ * Makes the input thread move the hardware cursor directly on pointer motion,
+ * without waiting for the main thread to process the motion event.
+ */
+void
+meta_seat_impl_set_kms_cursor_manager (MetaSeatImpl         *seat_impl,
+                                       MetaKmsCursorManager *kms_cursor_manager)
+{
+  GTask *task;
+
+  g_return_if_fail (META_IS_SEAT_IMPL (seat_impl));
+
+  task = g_task_new (seat_impl, NULL, NULL, NULL);
+  g_task_set_task_data (task, g_object_ref (kms_cursor_manager),
+                        g_object_unref);
+  meta_seat_impl_run_input_task (seat_impl, task,
+                                 (GSourceFunc) set_kms_cursor_manager);
+  g_object_unref (task);
+}
+
 MetaSeatImpl *
 meta_seat_impl_new (MetaSeatNative     *seat_native,
                     const char         *seat_id,
@@ -36,6 +36,7 @@
 #include "backends/native/meta-backend-native-types.h"
 #include "backends/native/meta-barrier-native.h"
 #include "backends/native/meta-cursor-renderer-native.h"
+#include "backends/native/meta-kms-cursor-manager.h"
 #include "backends/native/meta-keymap-native.h"
 #include "backends/native/meta-pointer-constraint-native.h"
 #include "backends/native/meta-xkb-utils.h"
@@ -96,6 +97,7 @@ struct _MetaSeatImpl
   MetaInputSettings *input_settings;
 
   MetaViewportInfo *viewports;
+  MetaKmsCursorManager *kms_cursor_manager;
 
   gboolean tablet_mode_switch_state;
   gboolean has_touchscreen;
@@ -222,6 +224,9 @@ void meta_seat_impl_set_pointer_constraint (MetaSeatImpl              *seat_impl
 void meta_seat_impl_set_viewports (MetaSeatImpl     *seat_impl,
                                    MetaViewportInfo *viewports);
 
+void meta_seat_impl_set_kms_cursor_manager (MetaSeatImpl         *seat_impl,
+                                            MetaKmsCursorManager *kms_cursor_manager);
+
 void meta_seat_impl_warp_pointer (MetaSeatImpl *seat_impl,
                                   int           x,
                                   int           y);
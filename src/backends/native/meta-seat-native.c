@@ -30,9 +30,11 @@
 
 #include "backends/meta-cursor-tracker-private.h"
 #include "backends/meta-keymap-utils.h"
+#include "backends/native/meta-backend-native.h"
 #include "backends/native/meta-barrier-native.h"
 #include "backends/native/meta-input-thread.h"
 #include "backends/native/meta-keymap-native.h"
+#include "backends/native/meta-kms.h"
 #include "backends/native/meta-virtual-input-device-native.h"
 #include "clutter/clutter-mutter.h"
 #include "core/bell.h"
@@ -607,13 +609,19 @@ meta_seat_native_maybe_ensure_cursor_renderer (MetaSeatNative     *seat_native,
     {
       if (!seat_native->cursor_renderer)
         {
+          MetaBackend *backend = meta_get_backend ();
+          MetaKms *kms =
+            meta_backend_native_get_kms (META_BACKEND_NATIVE (backend));
           MetaCursorRendererNative *cursor_renderer_native;
 
           cursor_renderer_native =
-            meta_cursor_renderer_native_new (meta_get_backend (),
+            meta_cursor_renderer_native_new (backend,
                                              seat_native->core_pointer);
           seat_native->cursor_renderer =
             META_CURSOR_RENDERER (cursor_renderer_native);
+
+          meta_seat_impl_set_kms_cursor_manager (seat_native->impl,
+                                                 meta_kms_get_cursor_manager (kms));
         }
 
       return seat_native->cursor_renderer;
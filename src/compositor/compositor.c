@@ -661,7 +661,6 @@ meta_compositor_queue_frame_drawn (MetaCompositor *compositor,
   MetaWindowActor *window_actor = meta_window_actor_from_window (window);
 
   meta_window_actor_queue_frame_drawn (window_actor, no_delay_frame);
-  meta_compositor_update_blur_behind(compositor);
 }
 
 void
@@ -993,20 +992,6 @@ meta_compositor_sync_stack (MetaCompositor  *compositor,
 
   sync_actor_stacking (compositor);
 
-  MetaWorkspaceManager *manager = priv->display->workspace_manager;
-  MetaWorkspace *active_workspace = manager->active_workspace;
-
-  for (GList *l = priv->windows; l; l = l->next)
-    {
-      MetaWindow *window = meta_window_actor_get_meta_window(l->data);
-      MetaWorkspace *workspace = meta_window_get_workspace(window);
-      if (workspace == active_workspace)
-        {
-          meta_window_actor_set_blur_behind(l->data);
-          meta_window_actor_update_blur_position_size(l->data);
-        }
-    }
-
   top_window_actor = get_top_visible_window_actor (compositor);
 
   if (priv->top_window_actor == top_window_actor)
@@ -1041,13 +1026,7 @@ meta_compositor_sync_window_geometry (MetaCompositor *compositor,
     if (meta_window_actor_should_clip(window_actor))
       meta_window_actor_update_clipped_bounds(window_actor);
     meta_plugin_manager_event_size_changed (priv->plugin_mgr, window_actor);
-    meta_window_actor_update_blur_position_size(window_actor);
   }
-
-  if (changes & META_WINDOW_ACTOR_CHANGE_POSITION)
-    meta_window_actor_update_blur_position_size(window_actor);
-
-  meta_compositor_update_blur_behind(compositor);
 }
 
 static void
@@ -1231,8 +1210,11 @@ prefs_changed_cb(MetaPreference pref,
     case META_PREF_BORDER_WIDTH:
     case META_PREF_BORDER_BRIGHTNESS:
       if (pref == META_PREF_CLIP_EDGE_PADDING)
-        meta_window_actor_update_clip_padding (l->data);
-      
+        {
+          meta_window_actor_update_clip_padding (l->data);
+          meta_window_actor_update_blur_position_size (l->data);
+        }
+
       meta_window_actor_update_clipped_bounds (l->data);
       meta_window_actor_update_glsl (l->data);
       clutter_actor_queue_redraw (CLUTTER_ACTOR (l->data));
@@ -1246,6 +1228,12 @@ prefs_changed_cb(MetaPreference pref,
     case META_PREF_BLUR_WINDOW_OPACITY:
       meta_window_actor_update_blur_window_opacity (l->data);
       break;
+    case META_PREF_BLUR_ALGORITHM:
+      meta_window_actor_update_blur_algorithm (l->data);
+      break;
+    case META_PREF_BLUR_LIST:
+      meta_window_actor_update_blur_list (l->data);
+      break;
     default:
       break;
     }
@@ -1644,20 +1632,3 @@ meta_compositor_get_laters (MetaCompositor *compositor)
 
   return priv->laters;
 }
-
-void meta_compositor_update_blur_behind(MetaCompositor *compositor)
-{
-  MetaCompositorPrivate *priv =
-    meta_compositor_get_instance_private (compositor);
-
-  MetaWorkspaceManager *manager = priv->display->workspace_manager;
-  MetaWorkspace *active_workspace = manager->active_workspace;
-
-  for (GList *l = priv->windows; l; l = l->next)
-    {
-      MetaWindow *window = meta_window_actor_get_meta_window(l->data);
-      MetaWorkspace *workspace = meta_window_get_workspace(window);
-      if (workspace == active_workspace)
-        meta_window_actor_set_blur_behind(l->data);
-    }
-}
@@ -22,15 +22,26 @@
 
 #include "compositor/meta-compositor-native.h"
 
+#include <math.h>
+
+#include "backends/meta-backend-private.h"
+#include "backends/meta-cursor-renderer.h"
 #include "backends/meta-logical-monitor.h"
 #include "backends/native/meta-crtc-kms.h"
+#include "backends/native/meta-drm-buffer.h"
+#include "backends/native/meta-onscreen-native.h"
+#include "compositor/meta-shaped-texture-private.h"
 #include "compositor/meta-surface-actor-wayland.h"
+#include "core/boxes-private.h"
 
 struct _MetaCompositorNative
 {
   MetaCompositorServer parent;
 
   MetaWaylandSurface *current_scanout_candidate;
+
+  /* Surface actor left out of the stage paint of its overlay view */
+  MetaSurfaceActor *overlay_surface_actor;
 };
 
 G_DEFINE_TYPE (MetaCompositorNative, meta_compositor_native,
@@ -62,6 +73,31 @@ get_window_view (MetaRenderer *renderer,
   return view_found;
 }
 
+/*
+ * Whether the surface actor is all that the window actor shows. The blur
+ * actor beneath it doesn't count while it's hidden, or covered by an
+ * opaque window.
+ */
+static gboolean
+shows_only_surface (MetaWindowActor *window_actor)
+{
+  ClutterActor *blur_actor = meta_window_actor_get_blur_actor (window_actor);
+  int n_children;
+
+  n_children = clutter_actor_get_n_children (CLUTTER_ACTOR (window_actor));
+
+  if (blur_actor)
+    {
+      if (clutter_actor_is_visible (blur_actor) &&
+          !meta_window_actor_is_opaque (window_actor))
+        return FALSE;
+
+      n_children--;
+    }
+
+  return n_children == 1;
+}
+
 static void
 maybe_assign_primary_plane (MetaCompositor *compositor)
 {
@@ -95,7 +131,7 @@ maybe_assign_primary_plane (MetaCompositor *compositor)
   if (clutter_actor_has_transitions (CLUTTER_ACTOR (window_actor)))
     goto done;
 
-  if (clutter_actor_get_n_children (CLUTTER_ACTOR (window_actor)) != 1)
+  if (!shows_only_surface (window_actor))
     goto done;
 
   window = meta_window_actor_get_meta_window (window_actor);
@@ -149,6 +185,238 @@ done:
     }
 }
 
+static gboolean
+is_actor_covered (ClutterActor          *actor,
+                  const graphene_rect_t *rect)
+{
+  ClutterActor *parent;
+
+  while ((parent = clutter_actor_get_parent (actor)))
+    {
+      ClutterActor *sibling;
+
+      for (sibling = clutter_actor_get_next_sibling (actor);
+           sibling;
+           sibling = clutter_actor_get_next_sibling (sibling))
+        {
+          ClutterActorBox paint_box;
+          graphene_rect_t sibling_rect;
+
+          if (!clutter_actor_is_mapped (sibling))
+            continue;
+
+          /* Without a paint box, the sibling may paint anywhere */
+          if (!clutter_actor_get_paint_box (sibling, &paint_box))
+            return TRUE;
+
+          sibling_rect =
+            GRAPHENE_RECT_INIT (paint_box.x1, paint_box.y1,
+                                clutter_actor_box_get_width (&paint_box),
+                                clutter_actor_box_get_height (&paint_box));
+          if (graphene_rect_intersection (rect, &sibling_rect, NULL))
+            return TRUE;
+        }
+
+      actor = parent;
+    }
+
+  return FALSE;
+}
+
+/*
+ * Whether the surface looks the same on an overlay plane as it does when
+ * composited: fully opaque, and not changed by the rounded clip or any
+ * effect, such as an opacity or blur effect.
+ */
+static gboolean
+is_surface_overlay_compatible (MetaWindowActor  *window_actor,
+                               MetaSurfaceActor *surface_actor)
+{
+  MetaShapedTexture *stex = meta_surface_actor_get_texture (surface_actor);
+
+  if (!meta_surface_actor_is_opaque (surface_actor))
+    return FALSE;
+
+  if (clutter_actor_get_paint_opacity (CLUTTER_ACTOR (surface_actor)) != 0xff)
+    return FALSE;
+
+  if (clutter_actor_has_effects (CLUTTER_ACTOR (window_actor)) ||
+      clutter_actor_has_effects (CLUTTER_ACTOR (surface_actor)))
+    return FALSE;
+
+  if (meta_shaped_texture_has_rounded_clip (stex))
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+add_actor_redraw_clip (ClutterStageView *stage_view,
+                       ClutterActor     *actor)
+{
+  ClutterActorBox box;
+  cairo_rectangle_int_t rect;
+
+  if (!clutter_actor_get_paint_box (actor, &box))
+    {
+      clutter_stage_view_add_redraw_clip (stage_view, NULL);
+      return;
+    }
+
+  rect = (cairo_rectangle_int_t) {
+    .x = floorf (box.x1),
+    .y = floorf (box.y1),
+    .width = ceilf (box.x2) - floorf (box.x1),
+    .height = ceilf (box.y2) - floorf (box.y1),
+  };
+  clutter_stage_view_add_redraw_clip (stage_view, &rect);
+}
+
+static void
+set_overlay_surface_actor (MetaCompositorNative *compositor_native,
+                           ClutterStageView     *stage_view,
+                           MetaSurfaceActor     *surface_actor)
+{
+  MetaSurfaceActor *old_surface_actor =
+    compositor_native->overlay_surface_actor;
+
+  if (old_surface_actor)
+    {
+      ClutterStageView *old_view =
+        meta_surface_actor_get_overlay_view (old_surface_actor);
+
+      if (old_surface_actor == surface_actor && old_view == stage_view)
+        return;
+
+      /* Other views decide about their own overlay planes */
+      if (!surface_actor && old_view && old_view != stage_view)
+        return;
+
+      meta_surface_actor_set_overlay_view (old_surface_actor, NULL);
+
+      /* The surface has to be composited again in the frame that drops
+       * the overlay plane, which on this view is the one about to be
+       * painted. */
+      if (old_view)
+        {
+          add_actor_redraw_clip (old_view, CLUTTER_ACTOR (old_surface_actor));
+          if (old_view != stage_view)
+            clutter_stage_view_schedule_update (old_view);
+        }
+    }
+
+  if (surface_actor)
+    meta_surface_actor_set_overlay_view (surface_actor, stage_view);
+
+  g_set_weak_pointer (&compositor_native->overlay_surface_actor,
+                      surface_actor);
+}
+
+static void
+maybe_assign_overlay_plane (MetaCompositor   *compositor,
+                            ClutterStageView *stage_view)
+{
+  MetaCompositorNative *compositor_native = META_COMPOSITOR_NATIVE (compositor);
+  MetaBackend *backend = meta_get_backend ();
+  MetaCursorRenderer *cursor_renderer =
+    meta_backend_get_cursor_renderer (backend);
+  CoglFramebuffer *framebuffer;
+  CoglOnscreen *onscreen;
+  MetaWindowActor *window_actor;
+  MetaWindow *window;
+  MetaRectangle view_layout;
+  graphene_rect_t window_rect;
+  float view_scale;
+  MetaRectangle dst_rect;
+  MetaSurfaceActor *surface_actor;
+  MetaDrmBuffer *buffer;
+  g_autoptr (CoglScanout) scanout = NULL;
+
+  framebuffer = clutter_stage_view_get_onscreen (stage_view);
+  if (!META_IS_ONSCREEN_NATIVE (framebuffer))
+    return;
+
+  onscreen = COGL_ONSCREEN (framebuffer);
+
+  if (meta_compositor_is_unredirect_inhibited (compositor))
+    goto out;
+
+  /* A cursor painted on the stage would end up below the overlay plane */
+  if (cursor_renderer &&
+      meta_cursor_renderer_is_painted_on_stage (cursor_renderer))
+    goto out;
+
+  window_actor = meta_compositor_get_top_window_actor (compositor);
+  if (!window_actor)
+    goto out;
+
+  if (meta_window_actor_effect_in_progress (window_actor))
+    goto out;
+
+  if (clutter_actor_has_transitions (CLUTTER_ACTOR (window_actor)))
+    goto out;
+
+  if (!shows_only_surface (window_actor))
+    goto out;
+
+  window = meta_window_actor_get_meta_window (window_actor);
+  if (!window)
+    goto out;
+
+  clutter_stage_view_get_layout (stage_view, &view_layout);
+  if (!meta_rectangle_contains_rect (&view_layout, &window->buffer_rect))
+    goto out;
+
+  /* The overlay plane is stacked above the primary plane, so panels,
+   * popups and other actors stacked above the window must not overlap it.
+   */
+  window_rect = meta_rectangle_to_graphene_rect (&window->buffer_rect);
+  if (is_actor_covered (CLUTTER_ACTOR (window_actor), &window_rect))
+    goto out;
+
+  surface_actor = meta_window_actor_get_surface (window_actor);
+  if (!META_IS_SURFACE_ACTOR_WAYLAND (surface_actor))
+    goto out;
+
+  /* The overlay plane replaces the composited surface, so it must look
+   * exactly the same. */
+  if (!is_surface_overlay_compatible (window_actor, surface_actor))
+    goto out;
+
+  scanout =
+    meta_surface_actor_wayland_try_acquire_overlay_scanout (META_SURFACE_ACTOR_WAYLAND (surface_actor),
+                                                            onscreen);
+  if (!scanout)
+    goto out;
+
+  view_scale = clutter_stage_view_get_scale (stage_view);
+  dst_rect = (MetaRectangle) {
+    .x = roundf ((window->buffer_rect.x - view_layout.x) * view_scale),
+    .y = roundf ((window->buffer_rect.y - view_layout.y) * view_scale),
+    .width = roundf (window->buffer_rect.width * view_scale),
+    .height = roundf (window->buffer_rect.height * view_scale),
+  };
+
+  /* Surface cropping and scaling are not carried over to the plane */
+  buffer = META_DRM_BUFFER (scanout);
+  if (meta_drm_buffer_get_width (buffer) != dst_rect.width ||
+      meta_drm_buffer_get_height (buffer) != dst_rect.height)
+    goto out;
+
+  /* Leave the surface out of the stage paint only once its configuration
+   * passed a test commit, so a rejected overlay never leaves a hole. Until
+   * then it is shown on both, which looks the same as it is opaque. */
+  if (meta_onscreen_native_queue_overlay_scanout (onscreen, scanout, &dst_rect))
+    set_overlay_surface_actor (compositor_native, stage_view, surface_actor);
+  else
+    set_overlay_surface_actor (compositor_native, stage_view, NULL);
+  return;
+
+out:
+  meta_onscreen_native_queue_overlay_scanout (onscreen, NULL, NULL);
+  set_overlay_surface_actor (compositor_native, stage_view, NULL);
+}
+
 static void
 meta_compositor_native_before_paint (MetaCompositor   *compositor,
                                      ClutterStageView *stage_view)
@@ -156,6 +424,7 @@ meta_compositor_native_before_paint (MetaCompositor   *compositor,
   MetaCompositorClass *parent_class;
 
   maybe_assign_primary_plane (compositor);
+  maybe_assign_overlay_plane (compositor, stage_view);
 
   parent_class = META_COMPOSITOR_CLASS (meta_compositor_native_parent_class);
   parent_class->before_paint (compositor, stage_view);
@@ -177,6 +446,7 @@ meta_compositor_native_finalize (GObject *object)
   MetaCompositorNative *compositor_native = META_COMPOSITOR_NATIVE (object);
 
   g_clear_weak_pointer (&compositor_native->current_scanout_candidate);
+  g_clear_weak_pointer (&compositor_native->overlay_surface_actor);
 
   G_OBJECT_CLASS (meta_compositor_native_parent_class)->finalize (object);
 }
@@ -27,6 +27,20 @@
 #include "compositor/meta-cullable.h"
 
 G_DEFINE_INTERFACE (MetaCullable, meta_cullable, CLUTTER_TYPE_ACTOR);
+G_DEFINE_INTERFACE (MetaCullableEffect, meta_cullable_effect, CLUTTER_TYPE_EFFECT);
+
+/* Big enough to contain anything a child may paint, small enough to survive
+ * being scaled by the geometry scale. */
+#define UNCLIPPED_REGION_SIZE (1 << 24)
+
+typedef struct
+{
+  /* Intersection of the opaque regions of all effects, or NULL */
+  cairo_region_t *opaque_region;
+  /* Union of the background regions of all effects, or NULL */
+  cairo_region_t *background_region;
+  gboolean caches_actor;
+} EffectsCullState;
 
 static gboolean
 has_active_effects (ClutterActor *actor)
@@ -44,6 +58,146 @@ has_active_effects (ClutterActor *actor)
   return FALSE;
 }
 
+/* Returns FALSE if any of the enabled effects doesn't know how it changes
+ * the painting of the actor, in which case the actor can't be culled. */
+static gboolean
+get_effects_cull_state (ClutterActor     *actor,
+                        EffectsCullState *state)
+{
+  g_autoptr (GList) effects = NULL;
+  GList *l;
+
+  *state = (EffectsCullState) { 0, };
+
+  effects = clutter_actor_get_effects (actor);
+  for (l = effects; l != NULL; l = l->next)
+    {
+      MetaCullableEffect *effect;
+      cairo_region_t *region;
+
+      if (!clutter_actor_meta_get_enabled (CLUTTER_ACTOR_META (l->data)))
+        continue;
+
+      if (!META_IS_CULLABLE_EFFECT (l->data))
+        {
+          g_clear_pointer (&state->opaque_region, cairo_region_destroy);
+          g_clear_pointer (&state->background_region, cairo_region_destroy);
+          return FALSE;
+        }
+
+      effect = META_CULLABLE_EFFECT (l->data);
+
+      region = meta_cullable_effect_get_opaque_region (effect);
+      if (region && state->opaque_region)
+        {
+          cairo_region_intersect (state->opaque_region, region);
+          cairo_region_destroy (region);
+        }
+      else if (region)
+        {
+          state->opaque_region = region;
+        }
+
+      region = meta_cullable_effect_get_background_region (effect);
+      if (region && state->background_region)
+        {
+          cairo_region_union (state->background_region, region);
+          cairo_region_destroy (region);
+        }
+      else if (region)
+        {
+          state->background_region = region;
+        }
+
+      if (meta_cullable_effect_caches_actor (effect))
+        state->caches_actor = TRUE;
+    }
+
+  return TRUE;
+}
+
+static void
+clear_effects_cull_state (EffectsCullState *state)
+{
+  g_clear_pointer (&state->opaque_region, cairo_region_destroy);
+  g_clear_pointer (&state->background_region, cairo_region_destroy);
+}
+
+/* Puts back what the child subtracted outside of the opaque region of its
+ * effects, as those parts are not opaque anymore once painted. */
+static void
+restore_translucent_region (cairo_region_t *region,
+                            cairo_region_t *region_before,
+                            cairo_region_t *opaque_region)
+{
+  cairo_region_subtract (region_before, opaque_region);
+  cairo_region_union (region, region_before);
+}
+
+static void
+cull_out_child_with_effects (MetaCullable     *child,
+                             EffectsCullState *state,
+                             cairo_region_t   *unobscured_region,
+                             cairo_region_t   *clip_region)
+{
+  cairo_region_t *unobscured_before;
+  cairo_region_t *child_clip_region;
+  cairo_region_t *clip_before;
+
+  if (!state->opaque_region && !state->caches_actor)
+    {
+      meta_cullable_cull_out (child, unobscured_region, clip_region);
+      return;
+    }
+
+  /* An effect caching the painted actor may reuse parts that we would clip
+   * away now, so let the child paint everything, and only take what it
+   * would have subtracted from the clip region. */
+  if (state->caches_actor)
+    {
+      cairo_rectangle_int_t unclipped = {
+        -UNCLIPPED_REGION_SIZE / 2,
+        -UNCLIPPED_REGION_SIZE / 2,
+        UNCLIPPED_REGION_SIZE,
+        UNCLIPPED_REGION_SIZE
+      };
+
+      child_clip_region = cairo_region_create_rectangle (&unclipped);
+    }
+  else
+    {
+      child_clip_region = cairo_region_reference (clip_region);
+    }
+
+  unobscured_before = cairo_region_copy (unobscured_region);
+  clip_before = cairo_region_copy (child_clip_region);
+
+  meta_cullable_cull_out (child, unobscured_region, child_clip_region);
+
+  if (state->opaque_region)
+    {
+      restore_translucent_region (unobscured_region, unobscured_before,
+                                  state->opaque_region);
+    }
+
+  if (state->caches_actor)
+    {
+      cairo_region_subtract (clip_before, child_clip_region);
+      if (state->opaque_region)
+        cairo_region_intersect (clip_before, state->opaque_region);
+      cairo_region_subtract (clip_region, clip_before);
+    }
+  else
+    {
+      restore_translucent_region (clip_region, clip_before,
+                                  state->opaque_region);
+    }
+
+  cairo_region_destroy (unobscured_before);
+  cairo_region_destroy (clip_before);
+  cairo_region_destroy (child_clip_region);
+}
+
 /**
  * SECTION:meta-cullable
  * @title: MetaCullable
@@ -61,6 +215,11 @@ has_active_effects (ClutterActor *actor)
  * and ask each actor to "cull itself out". We pass in a region it can copy
  * to clip its drawing to, and the actor can subtract its fully opaque pixels
  * so that actors underneath know not to draw there as well.
+ *
+ * Effects normally prevent an actor from being culled, since they may
+ * change what the actor paints. Effects implementing #MetaCullableEffect
+ * describe how they change the opacity of the actor and which pixels
+ * beneath it they read, so actors using them can still be culled.
  */
 
 /**
@@ -86,37 +245,38 @@ meta_cullable_cull_out_children (MetaCullable   *cullable,
   clutter_actor_iter_init (&iter, actor);
   while (clutter_actor_iter_prev (&iter, &child))
     {
+      EffectsCullState effects_state = { 0, };
       float x, y;
       gboolean needs_culling;
+      gboolean is_cullable;
 
-      if (!META_IS_CULLABLE (child))
-        continue;
+      is_cullable = META_IS_CULLABLE (child);
 
       needs_culling = (unobscured_region != NULL && clip_region != NULL);
 
       if (needs_culling && !CLUTTER_ACTOR_IS_VISIBLE (child))
         needs_culling = FALSE;
 
+      /* Actors that aren't cullable are painted as they are, but effects on
+       * them may still read what is beneath them. */
+      if (!is_cullable && (!needs_culling || !has_active_effects (child)))
+        continue;
+
       /* If an actor has effects applied, then that can change the area
        * it paints and the opacity, so we no longer can figure out what
        * portion of the actor is obscured and what portion of the screen
-       * it obscures, so we skip the actor.
-       *
-       * This has a secondary beneficial effect: if a ClutterOffscreenEffect
-       * is applied to an actor, then our clipped redraws interfere with the
-       * caching of the FBO - even if we only need to draw a small portion
-       * of the window right now, ClutterOffscreenEffect may use other portions
-       * of the FBO later. So, skipping actors with effects applied also
-       * prevents these bugs.
+       * it obscures, so we skip the actor, unless all of its effects
+       * tell us how they change it.
        *
        * Theoretically, we should check clutter_actor_get_offscreen_redirect()
        * as well for the same reason, but omitted for simplicity in the
        * hopes that no-one will do that.
        */
-      if (needs_culling && has_active_effects (child))
+      if (needs_culling && !get_effects_cull_state (child, &effects_state))
         needs_culling = FALSE;
 
-      if (needs_culling && !meta_cullable_is_untransformed (META_CULLABLE (child)))
+      if (needs_culling && is_cullable &&
+          !meta_cullable_is_untransformed (META_CULLABLE (child)))
         needs_culling = FALSE;
 
       if (needs_culling)
@@ -127,15 +287,31 @@ meta_cullable_cull_out_children (MetaCullable   *cullable,
           cairo_region_translate (unobscured_region, - x, - y);
           cairo_region_translate (clip_region, - x, - y);
 
-          meta_cullable_cull_out (META_CULLABLE (child), unobscured_region, clip_region);
+          if (is_cullable)
+            cull_out_child_with_effects (META_CULLABLE (child),
+                                         &effects_state,
+                                         unobscured_region,
+                                         clip_region);
+
+          /* Whatever is beneath the area read by an effect has to be
+           * painted, even if it ends up being covered. */
+          if (effects_state.background_region)
+            {
+              cairo_region_union (unobscured_region,
+                                  effects_state.background_region);
+              cairo_region_union (clip_region,
+                                  effects_state.background_region);
+            }
 
           cairo_region_translate (unobscured_region, x, y);
           cairo_region_translate (clip_region, x, y);
         }
-      else
+      else if (is_cullable)
         {
           meta_cullable_cull_out (META_CULLABLE (child), NULL, NULL);
         }
+
+      clear_effects_cull_state (&effects_state);
     }
 }
 
@@ -243,3 +419,79 @@ meta_cullable_reset_culling (MetaCullable *cullable)
 {
   META_CULLABLE_GET_IFACE (cullable)->reset_culling (cullable);
 }
+
+static cairo_region_t *
+meta_cullable_effect_default_get_opaque_region (MetaCullableEffect *effect)
+{
+  return NULL;
+}
+
+static cairo_region_t *
+meta_cullable_effect_default_get_background_region (MetaCullableEffect *effect)
+{
+  return NULL;
+}
+
+static gboolean
+meta_cullable_effect_default_caches_actor (MetaCullableEffect *effect)
+{
+  return CLUTTER_IS_OFFSCREEN_EFFECT (effect);
+}
+
+static void
+meta_cullable_effect_default_init (MetaCullableEffectInterface *iface)
+{
+  iface->get_opaque_region = meta_cullable_effect_default_get_opaque_region;
+  iface->get_background_region =
+    meta_cullable_effect_default_get_background_region;
+  iface->caches_actor = meta_cullable_effect_default_caches_actor;
+}
+
+/**
+ * meta_cullable_effect_get_opaque_region:
+ * @effect: The #MetaCullableEffect
+ *
+ * Effects implementing #MetaCullableEffect promise not to paint outside of
+ * the allocation of their actor. Opaque pixels of the actor stay opaque
+ * inside the region returned here, in the actor's coordinate space, and
+ * are considered translucent outside of it.
+ *
+ * Returns: (transfer full) (nullable): the region where the effect keeps
+ *   the actor's opacity, or %NULL if it doesn't change it anywhere.
+ */
+cairo_region_t *
+meta_cullable_effect_get_opaque_region (MetaCullableEffect *effect)
+{
+  return META_CULLABLE_EFFECT_GET_IFACE (effect)->get_opaque_region (effect);
+}
+
+/**
+ * meta_cullable_effect_get_background_region:
+ * @effect: The #MetaCullableEffect
+ *
+ * Gets the region, in the actor's coordinate space, of the framebuffer
+ * contents beneath the actor the effect reads while painting. Actors
+ * below are not culled there.
+ *
+ * Returns: (transfer full) (nullable): the region read by the effect
+ */
+cairo_region_t *
+meta_cullable_effect_get_background_region (MetaCullableEffect *effect)
+{
+  return META_CULLABLE_EFFECT_GET_IFACE (effect)->get_background_region (effect);
+}
+
+/**
+ * meta_cullable_effect_caches_actor:
+ * @effect: The #MetaCullableEffect
+ *
+ * Whether the effect keeps the painted actor around and may reuse it in
+ * later frames, such as #ClutterOffscreenEffect. The actor of such an
+ * effect is never clipped to the unobscured parts, as the clip would end up
+ * in the cached contents.
+ */
+gboolean
+meta_cullable_effect_caches_actor (MetaCullableEffect *effect)
+{
+  return META_CULLABLE_EFFECT_GET_IFACE (effect)->caches_actor (effect);
+}
@@ -26,10 +26,12 @@
 #define __META_CULLABLE_H__
 
 #include "clutter/clutter.h"
+#include "core/util-private.h"
 
 G_BEGIN_DECLS
 
 #define META_TYPE_CULLABLE (meta_cullable_get_type ())
+META_EXPORT_TEST
 G_DECLARE_INTERFACE (MetaCullable, meta_cullable, META, CULLABLE, ClutterActor)
 
 struct _MetaCullableInterface
@@ -43,6 +45,7 @@ struct _MetaCullableInterface
   void (* reset_culling) (MetaCullable  *cullable);
 };
 
+META_EXPORT_TEST
 void meta_cullable_cull_out (MetaCullable   *cullable,
                              cairo_region_t *unobscured_region,
                              cairo_region_t *clip_region);
@@ -50,11 +53,31 @@ gboolean meta_cullable_is_untransformed (MetaCullable *cullable);
 void meta_cullable_reset_culling (MetaCullable *cullable);
 
 /* Utility methods for implementations */
+META_EXPORT_TEST
 void meta_cullable_cull_out_children (MetaCullable   *cullable,
                                       cairo_region_t *unobscured_region,
                                       cairo_region_t *clip_region);
+META_EXPORT_TEST
 void meta_cullable_reset_culling_children (MetaCullable *cullable);
 
+#define META_TYPE_CULLABLE_EFFECT (meta_cullable_effect_get_type ())
+META_EXPORT_TEST
+G_DECLARE_INTERFACE (MetaCullableEffect, meta_cullable_effect,
+                     META, CULLABLE_EFFECT, ClutterEffect)
+
+struct _MetaCullableEffectInterface
+{
+  GTypeInterface g_iface;
+
+  cairo_region_t * (* get_opaque_region) (MetaCullableEffect *effect);
+  cairo_region_t * (* get_background_region) (MetaCullableEffect *effect);
+  gboolean (* caches_actor) (MetaCullableEffect *effect);
+};
+
+cairo_region_t * meta_cullable_effect_get_opaque_region (MetaCullableEffect *effect);
+cairo_region_t * meta_cullable_effect_get_background_region (MetaCullableEffect *effect);
+gboolean meta_cullable_effect_caches_actor (MetaCullableEffect *effect);
+
 G_END_DECLS
 
 #endif /* __META_CULLABLE_H__ */
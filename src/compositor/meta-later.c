@@ -38,6 +38,9 @@ typedef struct _MetaLater
 
   guint source_id;
   gboolean run_once;
+
+  /* Stage tick group the later last ran during */
+  uint64_t tick_serial;
 } MetaLater;
 
 #define META_LATER_N_TYPES (META_LATER_IDLE + 1)
@@ -136,7 +139,8 @@ remove_later_from_list (unsigned int   later_id,
 }
 
 static void
-run_repaint_laters (GSList **laters_list)
+run_repaint_laters (GSList   **laters_list,
+                    uint64_t   tick_serial)
 {
   g_autoptr (GSList) laters_copy = NULL;
   GSList *l;
@@ -145,6 +149,11 @@ run_repaint_laters (GSList **laters_list)
     {
       MetaLater *later = l->data;
 
+      /* Views updated together share the result of a later that already
+       * ran for an earlier one of them. */
+      if (later->tick_serial == tick_serial)
+        continue;
+
       if (!later->source_id ||
           (later->when <= META_LATER_BEFORE_REDRAW && !later->run_once))
         laters_copy = g_slist_prepend (laters_copy, meta_later_ref (later));
@@ -155,6 +164,8 @@ run_repaint_laters (GSList **laters_list)
     {
       MetaLater *later = l->data;
 
+      later->tick_serial = tick_serial;
+
       if (!later->func)
         remove_later_from_list (later->id, laters_list);
       else if (!meta_later_invoke (later))
@@ -169,12 +180,13 @@ on_before_update (ClutterStage     *stage,
                   ClutterStageView *stage_view,
                   MetaLaters       *laters)
 {
+  uint64_t tick_serial = clutter_stage_get_tick_serial (stage);
   unsigned int i;
   GSList *l;
   gboolean needs_schedule_update = FALSE;
 
   for (i = 0; i < G_N_ELEMENTS (laters->laters); i++)
-    run_repaint_laters (&laters->laters[i]);
+    run_repaint_laters (&laters->laters[i], tick_serial);
 
   for (i = 0; i < G_N_ELEMENTS (laters->laters); i++)
     {
@@ -0,0 +1,30 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright 2010 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_SHADOW_FACTORY_PRIVATE_H
+#define META_SHADOW_FACTORY_PRIVATE_H
+
+#include "meta/meta-shadow-factory.h"
+
+CoglTexture * meta_shadow_factory_get_corner_mask (MetaShadowFactory *factory,
+                                                   int                radius,
+                                                   int                border_width,
+                                                   double             border_brightness,
+                                                   float              scale);
+
+#endif /* META_SHADOW_FACTORY_PRIVATE_H */
@@ -28,8 +28,8 @@
 #include <string.h>
 
 #include "compositor/cogl-utils.h"
+#include "compositor/meta-shadow-factory-private.h"
 #include "compositor/region-utils.h"
-#include "meta/meta-shadow-factory.h"
 #include "meta/util.h"
 
 /* This file implements blurring the shape of a window to produce a
@@ -50,10 +50,18 @@
  *   in blocks, blur rows again, and then transpose back.
  *
  * - We approximate the 1D gaussian blur as 3 successive box filters.
+ *
+ * The factory also keeps the corner masks used to paint rounded window
+ * corners, see meta_shadow_factory_get_corner_mask().
  */
 
+/* Enough for a few corner radius and monitor scale combinations */
+#define MAX_CORNER_MASKS 8
+
 typedef struct _MetaShadowCacheKey  MetaShadowCacheKey;
 typedef struct _MetaShadowClassInfo MetaShadowClassInfo;
+typedef struct _MetaCornerMaskKey   MetaCornerMaskKey;
+typedef struct _MetaCornerMask      MetaCornerMask;
 
 struct _MetaShadowCacheKey
 {
@@ -94,6 +102,21 @@ struct _MetaShadowClassInfo
   MetaShadowParams unfocused;
 };
 
+struct _MetaCornerMaskKey
+{
+  int radius;
+  int border_width;
+  int border_brightness;
+  float scale;
+};
+
+struct _MetaCornerMask
+{
+  MetaCornerMaskKey key;
+  CoglTexture *texture;
+  GList link;
+};
+
 struct _MetaShadowFactory
 {
   GObject parent_instance;
@@ -104,6 +127,13 @@ struct _MetaShadowFactory
 
   /* class name => MetaShadowClassInfo */
   GHashTable *shadow_classes;
+
+  /* MetaCornerMaskKey => MetaCornerMask; the masks are not referenced
+   * by their users, which set them on their pipelines while painting, so
+   * only the MAX_CORNER_MASKS most recently used ones are kept */
+  GHashTable *corner_masks;
+  /* The masks in corner_masks, most recently used first */
+  GQueue corner_mask_lru;
 };
 
 enum
@@ -383,6 +413,35 @@ meta_shadow_get_bounds  (MetaShadow            *shadow,
   bounds->height = window_height + shadow->outer_border_top + shadow->outer_border_bottom;
 }
 
+static guint
+meta_corner_mask_key_hash (gconstpointer val)
+{
+  const MetaCornerMaskKey *key = val;
+
+  return (59 * key->radius + 67 * key->border_width +
+          73 * key->border_brightness + 79 * (int) (key->scale * 8));
+}
+
+static gboolean
+meta_corner_mask_key_equal (gconstpointer a,
+                            gconstpointer b)
+{
+  const MetaCornerMaskKey *key_a = a;
+  const MetaCornerMaskKey *key_b = b;
+
+  return (key_a->radius == key_b->radius &&
+          key_a->border_width == key_b->border_width &&
+          key_a->border_brightness == key_b->border_brightness &&
+          key_a->scale == key_b->scale);
+}
+
+static void
+meta_corner_mask_free (MetaCornerMask *mask)
+{
+  cogl_clear_object (&mask->texture);
+  g_free (mask);
+}
+
 static void
 meta_shadow_class_info_free (MetaShadowClassInfo *class_info)
 {
@@ -403,6 +462,11 @@ meta_shadow_factory_init (MetaShadowFactory *factory)
                                                    NULL,
                                                    (GDestroyNotify)meta_shadow_class_info_free);
 
+  factory->corner_masks = g_hash_table_new_full (meta_corner_mask_key_hash,
+                                                 meta_corner_mask_key_equal,
+                                                 NULL,
+                                                 (GDestroyNotify)meta_corner_mask_free);
+
   for (i = 0; i < G_N_ELEMENTS (default_shadow_classes); i++)
     {
       MetaShadowClassInfo *class_info = g_new0 (MetaShadowClassInfo, 1);
@@ -433,6 +497,7 @@ meta_shadow_factory_finalize (GObject *object)
 
   g_hash_table_destroy (factory->shadows);
   g_hash_table_destroy (factory->shadow_classes);
+  g_hash_table_destroy (factory->corner_masks);
 
   G_OBJECT_CLASS (meta_shadow_factory_parent_class)->finalize (object);
 }
@@ -1064,3 +1129,191 @@ meta_shadow_factory_get_params (MetaShadowFactory *factory,
 
 G_DEFINE_BOXED_TYPE (MetaShadow, meta_shadow,
                      meta_shadow_ref, meta_shadow_unref)
+
+/* The coverage functions below mirror ellipsis_dist(), ellipsis_coverage()
+ * and rounded_rect_coverage() from shader.h, for the top left corner of a
+ * rectangle starting at (@bound, @bound) whose corner centers are at
+ * (@center, @center).
+ */
+static float
+corner_ellipsis_coverage (float x,
+                          float y,
+                          float center,
+                          float radius)
+{
+  float p0x, p0y, p1x, p1y;
+  float d;
+
+  if (radius == 0)
+    return 0.5f;
+
+  p0x = (x - center) / radius;
+  p0y = (y - center) / radius;
+  p1x = 2.0f * p0x / radius;
+  p1y = 2.0f * p0y / radius;
+
+  d = (p0x * p0x + p0y * p0y - 1.0f) / sqrtf (p1x * p1x + p1y * p1y);
+
+  return CLAMP (0.5f - d, 0.0f, 1.0f);
+}
+
+static float
+corner_coverage (float x,
+                 float y,
+                 float bound,
+                 float center)
+{
+  if (x < bound || y < bound)
+    return 0.0f;
+
+  if (x >= center || y >= center)
+    return 1.0f;
+
+  return corner_ellipsis_coverage (x, y, center, center - bound);
+}
+
+static float
+smoothstep (float edge0,
+            float edge1,
+            float x)
+{
+  float t = CLAMP ((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+
+  return t * t * (3.0f - 2.0f * t);
+}
+
+static void
+make_corner_mask (MetaCornerMask *mask)
+{
+  ClutterBackend *backend = clutter_get_default_backend ();
+  CoglContext *ctx = clutter_backend_get_cogl_context (backend);
+  GError *error = NULL;
+  float radius = mask->key.radius;
+  float border = mask->key.border_width;
+  float brightness = mask->key.border_brightness / 255.0f;
+  int size;
+  guchar *buffer;
+  int i, j;
+
+  size = (int) ceilf (MAX (radius, border) * mask->key.scale);
+  buffer = g_malloc (size * size * 4);
+
+  /* The red channel is what's left of the window, the green channel
+   * the coverage of the border and the blue channel the premultiplied
+   * border color, see ROUNDED_CLIP_FRAGMENT_SHADER_CODE_MASK.
+   */
+  for (j = 0; j < size; j++)
+    {
+      for (i = 0; i < size; i++)
+        {
+          guchar *texel = buffer + (j * size + i) * 4;
+          float x = (i + 0.5f) / mask->key.scale;
+          float y = (j + 0.5f) / mask->key.scale;
+          float outer_alpha = corner_coverage (x, y, 0, radius);
+          float content_alpha;
+          float border_alpha;
+
+          if (border > 0)
+            {
+              float inner_alpha = corner_coverage (x, y, border, radius);
+
+              border_alpha = CLAMP (outer_alpha - inner_alpha, 0.0f, 1.0f);
+              content_alpha = (smoothstep (0.0f, 0.6f, inner_alpha) *
+                               (1.0f - border_alpha));
+            }
+          else
+            {
+              border_alpha = 0.0f;
+              content_alpha = outer_alpha;
+            }
+
+          texel[0] = (guchar) (content_alpha * 255.0f + 0.5f);
+          texel[1] = (guchar) (border_alpha * 255.0f + 0.5f);
+          texel[2] = (guchar) (border_alpha * brightness * 255.0f + 0.5f);
+          texel[3] = 255;
+        }
+    }
+
+  mask->texture = COGL_TEXTURE (cogl_texture_2d_new_from_data (ctx,
+                                                               size, size,
+                                                               COGL_PIXEL_FORMAT_RGBA_8888,
+                                                               size * 4,
+                                                               buffer,
+                                                               &error));
+
+  if (error)
+    {
+      meta_warning ("Failed to allocate corner mask texture: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (buffer);
+}
+
+/**
+ * meta_shadow_factory_get_corner_mask: (skip)
+ * @factory: a #MetaShadowFactory
+ * @radius: the corner radius, in logical pixels
+ * @border_width: the width of the border, in logical pixels
+ * @border_brightness: the brightness of the border, from 0 to 1
+ * @scale: the number of texels per logical pixel
+ *
+ * Gets a pre-rendered mask for the top left corner of a rectangle with
+ * rounded corners, matching what the rounded clip shader in shader.h
+ * computes. It covers a square of MAX (@radius, @border_width) logical
+ * pixels; the texture size is that times @scale, rounded up. The other
+ * corners are painted by mirroring the texture coordinates.
+ *
+ * The masks are shared by every window using the same parameters. Only
+ * a few recently used masks are cached, so the returned texture must be
+ * referenced if it is kept beyond the current paint.
+ *
+ * Return value: (transfer none) (nullable): the corner mask texture
+ */
+CoglTexture *
+meta_shadow_factory_get_corner_mask (MetaShadowFactory *factory,
+                                     int                radius,
+                                     int                border_width,
+                                     double             border_brightness,
+                                     float              scale)
+{
+  MetaCornerMaskKey key;
+  MetaCornerMask *mask;
+
+  g_return_val_if_fail (META_IS_SHADOW_FACTORY (factory), NULL);
+  g_return_val_if_fail (scale > 0, NULL);
+
+  if (radius <= 0 && border_width <= 0)
+    return NULL;
+
+  key.radius = MAX (radius, 0);
+  key.border_width = MAX (border_width, 0);
+  key.border_brightness = (int) (CLAMP (border_brightness, 0.0, 1.0) * 255 + 0.5);
+  key.scale = scale;
+
+  mask = g_hash_table_lookup (factory->corner_masks, &key);
+  if (mask)
+    {
+      g_queue_unlink (&factory->corner_mask_lru, &mask->link);
+      g_queue_push_head_link (&factory->corner_mask_lru, &mask->link);
+      return mask->texture;
+    }
+
+  if (g_queue_get_length (&factory->corner_mask_lru) >= MAX_CORNER_MASKS)
+    {
+      MetaCornerMask *oldest = g_queue_peek_tail (&factory->corner_mask_lru);
+
+      g_queue_pop_tail_link (&factory->corner_mask_lru);
+      g_hash_table_remove (factory->corner_masks, &oldest->key);
+    }
+
+  mask = g_new0 (MetaCornerMask, 1);
+  mask->key = key;
+  mask->link.data = mask;
+  make_corner_mask (mask);
+
+  g_hash_table_insert (factory->corner_masks, &mask->key, mask);
+  g_queue_push_head_link (&factory->corner_mask_lru, &mask->link);
+
+  return mask->texture;
+}
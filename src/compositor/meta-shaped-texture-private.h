@@ -28,9 +28,12 @@
 #define __META_SHAPED_TEXTURE_PRIVATE_H__
 
 #include "backends/meta-monitor-manager-private.h"
+#include "core/util-private.h"
 #include "meta/meta-shaped-texture.h"
 
+META_EXPORT_TEST
 MetaShapedTexture * meta_shaped_texture_new (void);
+META_EXPORT_TEST
 void meta_shaped_texture_set_texture (MetaShapedTexture *stex,
                                       CoglTexture       *texture);
 void meta_shaped_texture_set_is_y_inverted (MetaShapedTexture *stex,
@@ -41,6 +44,13 @@ void meta_shaped_texture_set_fallback_size (MetaShapedTexture *stex,
                                             int                fallback_width,
                                             int                fallback_height);
 cairo_region_t * meta_shaped_texture_get_opaque_region (MetaShapedTexture *stex);
+cairo_region_t * meta_shaped_texture_get_clipped_opaque_region (MetaShapedTexture *stex);
+META_EXPORT_TEST
+void meta_shaped_texture_set_rounded_clip (MetaShapedTexture           *stex,
+                                           const cairo_rectangle_int_t *bounds,
+                                           float                        radius);
+void meta_shaped_texture_unset_rounded_clip (MetaShapedTexture *stex);
+gboolean meta_shaped_texture_has_rounded_clip (MetaShapedTexture *stex);
 gboolean meta_shaped_texture_is_opaque (MetaShapedTexture *stex);
 gboolean meta_shaped_texture_has_alpha (MetaShapedTexture *stex);
 void meta_shaped_texture_set_transform (MetaShapedTexture    *stex,
@@ -68,6 +78,7 @@ int meta_shaped_texture_get_height (MetaShapedTexture *stex);
 
 void meta_shaped_texture_set_clip_region (MetaShapedTexture *stex,
                                           cairo_region_t    *clip_region);
+META_EXPORT_TEST
 void meta_shaped_texture_set_opaque_region (MetaShapedTexture *stex,
                                             cairo_region_t    *opaque_region);
 
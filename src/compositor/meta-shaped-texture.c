@@ -38,13 +38,19 @@
 
 #include <gdk/gdk.h>
 #include <math.h>
+#include <string.h>
 
 #include "cogl/cogl.h"
 #include "compositor/clutter-utils.h"
+#include "compositor/meta-shadow-factory-private.h"
 #include "compositor/meta-texture-tower.h"
 #include "compositor/region-utils.h"
 #include "core/boxes-private.h"
 #include "meta/meta-shaped-texture.h"
+#include "meta/prefs.h"
+
+#include "meta_clip_effect.h"
+#include "shader.h"
 
 /* MAX_MIPMAPPING_FPS needs to be as small as possible for the best GPU
  * performance, but higher than the refresh rate of commonly slow updating
@@ -91,6 +97,13 @@ struct _MetaShapedTexture
   CoglPipeline *base_pipeline;
   CoglPipeline *masked_pipeline;
   CoglPipeline *unblended_pipeline;
+  CoglPipeline *unclipped_unblended_pipeline;
+  CoglPipeline *corner_mask_pipeline;
+
+  /* Rounded clip uniforms last set on each of the pipelines above */
+  MetaRoundedClipUniforms base_clip_uniforms;
+  MetaRoundedClipUniforms masked_clip_uniforms;
+  MetaRoundedClipUniforms unblended_clip_uniforms;
 
   gboolean is_y_inverted;
 
@@ -100,6 +113,14 @@ struct _MetaShapedTexture
   /* MetaCullable regions, see that documentation for more details */
   cairo_region_t *clip_region;
 
+  /* Rounded corners applied directly on the paint pipelines, in the same
+   * coordinate space as the opaque region */
+  gboolean has_rounded_clip;
+  cairo_rectangle_int_t rounded_clip_bounds;
+  float rounded_clip_radius;
+  /* The opaque region minus what the rounded clip cuts away, lazily built */
+  cairo_region_t *rounded_clip_opaque_region;
+
   gboolean size_invalid;
   MetaMonitorTransform transform;
   gboolean has_viewport_src_rect;
@@ -242,6 +263,12 @@ meta_shaped_texture_reset_pipelines (MetaShapedTexture *stex)
   g_clear_pointer (&stex->base_pipeline, cogl_object_unref);
   g_clear_pointer (&stex->masked_pipeline, cogl_object_unref);
   g_clear_pointer (&stex->unblended_pipeline, cogl_object_unref);
+  g_clear_pointer (&stex->unclipped_unblended_pipeline, cogl_object_unref);
+  g_clear_pointer (&stex->corner_mask_pipeline, cogl_object_unref);
+
+  meta_rounded_clip_uniforms_reset (&stex->base_clip_uniforms);
+  meta_rounded_clip_uniforms_reset (&stex->masked_clip_uniforms);
+  meta_rounded_clip_uniforms_reset (&stex->unblended_clip_uniforms);
 }
 
 static void
@@ -262,6 +289,7 @@ meta_shaped_texture_dispose (GObject *object)
 
   g_clear_pointer (&stex->opaque_region, cairo_region_destroy);
   g_clear_pointer (&stex->clip_region, cairo_region_destroy);
+  g_clear_pointer (&stex->rounded_clip_opaque_region, cairo_region_destroy);
 
   g_clear_pointer (&stex->snippet, cogl_object_unref);
 
@@ -269,15 +297,12 @@ meta_shaped_texture_dispose (GObject *object)
 }
 
 static CoglPipeline *
-get_base_pipeline (MetaShapedTexture *stex,
-                   CoglContext       *ctx)
+create_base_pipeline (MetaShapedTexture *stex,
+                      CoglContext       *ctx)
 {
   CoglPipeline *pipeline;
   graphene_matrix_t matrix;
 
-  if (stex->base_pipeline)
-    return stex->base_pipeline;
-
   pipeline = cogl_pipeline_new (ctx);
   cogl_pipeline_set_layer_wrap_mode_s (pipeline, 0,
                                        COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
@@ -381,6 +406,48 @@ get_base_pipeline (MetaShapedTexture *stex,
   if (stex->snippet)
     cogl_pipeline_add_layer_snippet (pipeline, 0, stex->snippet);
 
+  return pipeline;
+}
+
+static CoglPipeline *
+get_base_pipeline (MetaShapedTexture *stex,
+                   CoglContext       *ctx)
+{
+  CoglPipeline *pipeline;
+
+  if (stex->base_pipeline)
+    return stex->base_pipeline;
+
+  pipeline = create_base_pipeline (stex, ctx);
+
+  if (stex->has_rounded_clip)
+    {
+      static CoglSnippet *rounded_clip_vertex_snippet;
+      static CoglSnippet *rounded_clip_fragment_snippet;
+
+      /* Share the snippets so Cogl can reuse the same program for
+       * every window with rounded corners.
+       */
+      if (!rounded_clip_vertex_snippet)
+        {
+          rounded_clip_vertex_snippet =
+            cogl_snippet_new (COGL_SNIPPET_HOOK_VERTEX,
+                              ROUNDED_CLIP_VERTEX_SHADER_DECLARATIONS_DIRECT,
+                              ROUNDED_CLIP_VERTEX_SHADER_CODE_DIRECT);
+        }
+
+      if (!rounded_clip_fragment_snippet)
+        {
+          rounded_clip_fragment_snippet =
+            cogl_snippet_new (COGL_SNIPPET_HOOK_FRAGMENT,
+                              ROUNDED_CLIP_FRAGMENT_SHADER_DECLARATIONS_DIRECT,
+                              ROUNDED_CLIP_FRAGMENT_SHADER_CODE_DIRECT);
+        }
+
+      cogl_pipeline_add_snippet (pipeline, rounded_clip_vertex_snippet);
+      cogl_pipeline_add_snippet (pipeline, rounded_clip_fragment_snippet);
+    }
+
   stex->base_pipeline = pipeline;
 
   return stex->base_pipeline;
@@ -431,6 +498,93 @@ get_unblended_pipeline (MetaShapedTexture *stex,
   return pipeline;
 }
 
+/* The unblended pipeline without the rounded clip, for painting the parts
+ * of the opaque region the rounded corners can't reach. It shares its
+ * program with unclipped windows.
+ */
+static CoglPipeline *
+get_unclipped_unblended_pipeline (MetaShapedTexture *stex,
+                                  CoglContext       *ctx)
+{
+  CoglPipeline *pipeline;
+
+  if (!stex->has_rounded_clip)
+    return get_unblended_pipeline (stex, ctx);
+
+  if (stex->unclipped_unblended_pipeline)
+    return stex->unclipped_unblended_pipeline;
+
+  pipeline = create_base_pipeline (stex, ctx);
+  cogl_pipeline_set_layer_combine (pipeline, 0,
+                                   "RGBA = REPLACE (TEXTURE)",
+                                   NULL);
+
+  stex->unclipped_unblended_pipeline = pipeline;
+
+  return pipeline;
+}
+
+/* The unblended pipeline applying a corner mask from the shadow factory
+ * on layer 1 instead of computing the rounded clip per pixel.
+ */
+static CoglPipeline *
+get_corner_mask_pipeline (MetaShapedTexture *stex,
+                          CoglContext       *ctx)
+{
+  static CoglSnippet *corner_mask_snippet;
+  CoglPipeline *pipeline;
+  graphene_matrix_t matrix;
+
+  if (stex->corner_mask_pipeline)
+    return stex->corner_mask_pipeline;
+
+  pipeline = create_base_pipeline (stex, ctx);
+  cogl_pipeline_set_layer_combine (pipeline, 0,
+                                   "RGBA = REPLACE (TEXTURE)",
+                                   NULL);
+
+  /* The mask coordinates are given per corner, undo the shape mask
+   * transform create_base_pipeline() sets up on layer 1 */
+  graphene_matrix_init_identity (&matrix);
+  cogl_pipeline_set_layer_matrix (pipeline, 1, &matrix);
+  cogl_pipeline_set_layer_combine (pipeline, 1,
+                                   "RGBA = REPLACE (PREVIOUS)",
+                                   NULL);
+  cogl_pipeline_set_layer_filters (pipeline, 1,
+                                   COGL_PIPELINE_FILTER_LINEAR,
+                                   COGL_PIPELINE_FILTER_LINEAR);
+
+  if (!corner_mask_snippet)
+    {
+      corner_mask_snippet =
+        cogl_snippet_new (COGL_SNIPPET_HOOK_FRAGMENT,
+                          NULL,
+                          ROUNDED_CLIP_FRAGMENT_SHADER_CODE_MASK);
+    }
+
+  cogl_pipeline_add_snippet (pipeline, corner_mask_snippet);
+
+  stex->corner_mask_pipeline = pipeline;
+
+  return pipeline;
+}
+
+static void
+setup_rounded_clip (MetaShapedTexture       *stex,
+                    CoglPipeline            *pipeline,
+                    MetaRoundedClipUniforms *uniforms)
+{
+  if (!stex->has_rounded_clip)
+    return;
+
+  meta_clip_effect_setup_pipeline (pipeline,
+                                   uniforms,
+                                   &stex->rounded_clip_bounds,
+                                   stex->rounded_clip_radius,
+                                   stex->dst_width,
+                                   stex->dst_height);
+}
+
 static CoglPipeline *
 get_opaque_overlay_pipeline (CoglContext *ctx)
 {
@@ -472,11 +626,12 @@ get_blended_overlay_pipeline (CoglContext *ctx)
 }
 
 static void
-paint_clipped_rectangle_node (MetaShapedTexture     *stex,
-                              ClutterPaintNode      *root_node,
-                              CoglPipeline          *pipeline,
-                              cairo_rectangle_int_t *rect,
-                              ClutterActorBox       *alloc)
+paint_rectangle_node (MetaShapedTexture     *stex,
+                      ClutterPaintNode      *root_node,
+                      CoglPipeline          *pipeline,
+                      cairo_rectangle_int_t *rect,
+                      const float           *layer1_coords,
+                      ClutterActorBox       *alloc)
 {
   g_autoptr (ClutterPaintNode) node = NULL;
   float ratio_h, ratio_v;
@@ -501,10 +656,17 @@ paint_clipped_rectangle_node (MetaShapedTexture     *stex,
   coords[2] = (rect->x + rect->width) / alloc_width * ratio_h;
   coords[3] = (rect->y + rect->height) / alloc_height * ratio_v;
 
-  coords[4] = coords[0];
-  coords[5] = coords[1];
-  coords[6] = coords[2];
-  coords[7] = coords[3];
+  if (layer1_coords)
+    {
+      memcpy (coords + 4, layer1_coords, 4 * sizeof (float));
+    }
+  else
+    {
+      coords[4] = coords[0];
+      coords[5] = coords[1];
+      coords[6] = coords[2];
+      coords[7] = coords[3];
+    }
 
   node = clutter_pipeline_node_new (pipeline);
   clutter_paint_node_set_static_name (node, "MetaShapedTexture (clipped)");
@@ -520,6 +682,196 @@ paint_clipped_rectangle_node (MetaShapedTexture     *stex,
                                                  coords, 8);
 }
 
+static void
+paint_clipped_rectangle_node (MetaShapedTexture     *stex,
+                              ClutterPaintNode      *root_node,
+                              CoglPipeline          *pipeline,
+                              cairo_rectangle_int_t *rect,
+                              ClutterActorBox       *alloc)
+{
+  paint_rectangle_node (stex, root_node, pipeline, rect, NULL, alloc);
+}
+
+static void
+paint_opaque_rectangles (MetaShapedTexture *stex,
+                         ClutterPaintNode  *root_node,
+                         CoglPipeline      *pipeline,
+                         cairo_region_t    *region,
+                         ClutterActorBox   *alloc,
+                         CoglContext       *ctx,
+                         gboolean           debug_paint_opaque_region)
+{
+  int n_rects;
+  int i;
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      cairo_region_get_rectangle (region, i, &rect);
+      paint_clipped_rectangle_node (stex, root_node,
+                                    pipeline,
+                                    &rect, alloc);
+
+      if (G_UNLIKELY (debug_paint_opaque_region))
+        {
+          CoglPipeline *opaque_overlay_pipeline;
+
+          opaque_overlay_pipeline = get_opaque_overlay_pipeline (ctx);
+          paint_clipped_rectangle_node (stex, root_node,
+                                        opaque_overlay_pipeline,
+                                        &rect, alloc);
+        }
+    }
+}
+
+/* The size of the square corner patches the rounded clip can affect */
+static int
+get_rounded_clip_corner_size (MetaShapedTexture *stex)
+{
+  return MAX ((int) ceilf (stex->rounded_clip_radius),
+              meta_prefs_get_border_width ());
+}
+
+/*
+ * The part of the rounded clip bounds where the clip shader would leave
+ * every pixel untouched: everything but the corner patches and, if there
+ * is one, the border along the edges. In the same coordinate space as the
+ * opaque region.
+ */
+static cairo_region_t *
+get_rounded_clip_interior_region (MetaShapedTexture *stex)
+{
+  cairo_rectangle_int_t *bounds = &stex->rounded_clip_bounds;
+  cairo_region_t *region;
+  int border;
+  int corner;
+
+  border = meta_prefs_get_border_width ();
+  corner = get_rounded_clip_corner_size (stex);
+
+  region = cairo_region_create ();
+
+  if (bounds->width > 2 * border && bounds->height > 2 * corner)
+    {
+      cairo_region_union_rectangle (region, &(cairo_rectangle_int_t) {
+        .x = bounds->x + border,
+        .y = bounds->y + corner,
+        .width = bounds->width - 2 * border,
+        .height = bounds->height - 2 * corner,
+      });
+    }
+
+  if (bounds->width > 2 * corner && bounds->height > 2 * border)
+    {
+      cairo_region_union_rectangle (region, &(cairo_rectangle_int_t) {
+        .x = bounds->x + corner,
+        .y = bounds->y + border,
+        .width = bounds->width - 2 * corner,
+        .height = bounds->height - 2 * border,
+      });
+    }
+
+  return region;
+}
+
+/*
+ * Paints the parts of @region within the corner patches of the rounded
+ * clip with a pre-rendered corner mask, and removes them from @region.
+ * @scale is the number of device pixels per unit of the region.
+ */
+static void
+paint_rounded_clip_corners (MetaShapedTexture *stex,
+                            ClutterPaintNode  *root_node,
+                            cairo_region_t    *region,
+                            CoglTexture       *paint_tex,
+                            CoglPipelineFilter filter,
+                            float              scale,
+                            ClutterActorBox   *alloc,
+                            CoglContext       *ctx,
+                            gboolean           debug_paint_opaque_region)
+{
+  cairo_rectangle_int_t *bounds = &stex->rounded_clip_bounds;
+  CoglTexture *mask;
+  CoglPipeline *pipeline;
+  float mask_extent;
+  int corner;
+  int i;
+
+  corner = get_rounded_clip_corner_size (stex);
+  if (corner <= 0 ||
+      bounds->width < 2 * corner || bounds->height < 2 * corner)
+    return;
+
+  mask = meta_shadow_factory_get_corner_mask (meta_shadow_factory_get_default (),
+                                              (int) ceilf (stex->rounded_clip_radius),
+                                              meta_prefs_get_border_width (),
+                                              meta_prefs_get_border_brightness (),
+                                              scale);
+  if (!mask)
+    return;
+
+  /* The mask is rounded up to whole texels */
+  mask_extent = corner * scale / cogl_texture_get_width (mask);
+
+  pipeline = get_corner_mask_pipeline (stex, ctx);
+  cogl_pipeline_set_layer_texture (pipeline, 0, paint_tex);
+  cogl_pipeline_set_layer_filters (pipeline, 0, filter, filter);
+  cogl_pipeline_set_layer_texture (pipeline, 1, mask);
+
+  for (i = 0; i < 4; i++)
+    {
+      gboolean right = i == 1 || i == 2;
+      gboolean bottom = i == 2 || i == 3;
+      cairo_rectangle_int_t patch;
+      cairo_region_t *patch_region;
+      float origin_x, origin_y;
+      int n_rects;
+      int j;
+
+      patch = (cairo_rectangle_int_t) {
+        .x = right ? bounds->x + bounds->width - corner : bounds->x,
+        .y = bottom ? bounds->y + bounds->height - corner : bounds->y,
+        .width = corner,
+        .height = corner,
+      };
+
+      patch_region = cairo_region_create_rectangle (&patch);
+      cairo_region_intersect (patch_region, region);
+      cairo_region_subtract (region, patch_region);
+
+      /* The mask is for the top left corner, mirror it for the others */
+      origin_x = right ? bounds->x + bounds->width : bounds->x;
+      origin_y = bottom ? bounds->y + bounds->height : bounds->y;
+
+      n_rects = cairo_region_num_rectangles (patch_region);
+      for (j = 0; j < n_rects; j++)
+        {
+          cairo_rectangle_int_t rect;
+          float mask_coords[4];
+
+          cairo_region_get_rectangle (patch_region, j, &rect);
+
+          mask_coords[0] = fabsf (rect.x - origin_x) / corner * mask_extent;
+          mask_coords[1] = fabsf (rect.y - origin_y) / corner * mask_extent;
+          mask_coords[2] = fabsf (rect.x + rect.width - origin_x) / corner * mask_extent;
+          mask_coords[3] = fabsf (rect.y + rect.height - origin_y) / corner * mask_extent;
+
+          paint_rectangle_node (stex, root_node, pipeline,
+                                &rect, mask_coords, alloc);
+
+          if (G_UNLIKELY (debug_paint_opaque_region))
+            {
+              paint_clipped_rectangle_node (stex, root_node,
+                                            get_opaque_overlay_pipeline (ctx),
+                                            &rect, alloc);
+            }
+        }
+
+      cairo_region_destroy (patch_region);
+    }
+}
+
 static void
 set_cogl_texture (MetaShapedTexture *stex,
                   CoglTexture       *cogl_tex)
@@ -598,6 +950,8 @@ do_paint_content (MetaShapedTexture   *stex,
   CoglPipelineFilter filter;
   CoglFramebuffer *framebuffer;
   int sample_width, sample_height;
+  ClutterStageView *view;
+  float corner_mask_scale;
   gboolean debug_paint_opaque_region;
 
   meta_shaped_texture_ensure_size_valid (stex);
@@ -639,6 +993,13 @@ do_paint_content (MetaShapedTexture   *stex,
   if (meta_monitor_transform_is_rotated (stex->transform))
     flip_ints (&sample_width, &sample_height);
 
+  /* Render corner masks at whichever is denser, the buffer or the view,
+   * in quarter steps so windows on the same monitor share them */
+  view = clutter_paint_context_get_stage_view (paint_context);
+  corner_mask_scale = MAX (view ? clutter_stage_view_get_scale (view) : 1.0f,
+                           sample_width / (float) dst_width);
+  corner_mask_scale = ceilf (corner_mask_scale * 4) / 4;
+
   if (meta_actor_painting_untransformed (framebuffer,
                                          dst_width, dst_height,
                                          sample_width, sample_height,
@@ -688,8 +1049,6 @@ do_paint_content (MetaShapedTexture   *stex,
   if (use_opaque_region)
     {
       cairo_region_t *region;
-      int n_rects;
-      int i;
 
       if (stex->clip_region)
         {
@@ -701,6 +1060,37 @@ do_paint_content (MetaShapedTexture   *stex,
           region = cairo_region_reference (stex->opaque_region);
         }
 
+      if (!cairo_region_is_empty (region) && stex->has_rounded_clip)
+        {
+          cairo_region_t *interior_region;
+          CoglPipeline *interior_pipeline;
+
+          /* Only the edges of the opaque region need the rounded clip
+           * shader, paint the rest with the plain unblended pipeline.
+           */
+          interior_region = get_rounded_clip_interior_region (stex);
+          cairo_region_intersect (interior_region, region);
+          cairo_region_subtract (region, interior_region);
+
+          if (!cairo_region_is_empty (interior_region))
+            {
+              interior_pipeline = get_unclipped_unblended_pipeline (stex, ctx);
+              cogl_pipeline_set_layer_texture (interior_pipeline, 0, paint_tex);
+              cogl_pipeline_set_layer_filters (interior_pipeline, 0,
+                                               filter, filter);
+
+              paint_opaque_rectangles (stex, root_node, interior_pipeline,
+                                       interior_region, alloc, ctx,
+                                       debug_paint_opaque_region);
+            }
+
+          cairo_region_destroy (interior_region);
+
+          paint_rounded_clip_corners (stex, root_node, region,
+                                      paint_tex, filter, corner_mask_scale,
+                                      alloc, ctx, debug_paint_opaque_region);
+        }
+
       if (!cairo_region_is_empty (region))
         {
           CoglPipeline *opaque_pipeline;
@@ -708,26 +1098,12 @@ do_paint_content (MetaShapedTexture   *stex,
           opaque_pipeline = get_unblended_pipeline (stex, ctx);
           cogl_pipeline_set_layer_texture (opaque_pipeline, 0, paint_tex);
           cogl_pipeline_set_layer_filters (opaque_pipeline, 0, filter, filter);
+          setup_rounded_clip (stex, opaque_pipeline,
+                              &stex->unblended_clip_uniforms);
 
-          n_rects = cairo_region_num_rectangles (region);
-          for (i = 0; i < n_rects; i++)
-            {
-              cairo_rectangle_int_t rect;
-              cairo_region_get_rectangle (region, i, &rect);
-              paint_clipped_rectangle_node (stex, root_node,
-                                            opaque_pipeline,
-                                            &rect, alloc);
-
-              if (G_UNLIKELY (debug_paint_opaque_region))
-                {
-                  CoglPipeline *opaque_overlay_pipeline;
-
-                  opaque_overlay_pipeline = get_opaque_overlay_pipeline (ctx);
-                  paint_clipped_rectangle_node (stex, root_node,
-                                                opaque_overlay_pipeline,
-                                                &rect, alloc);
-                }
-            }
+          paint_opaque_rectangles (stex, root_node, opaque_pipeline,
+                                   region, alloc, ctx,
+                                   debug_paint_opaque_region);
         }
 
       cairo_region_destroy (region);
@@ -746,20 +1122,24 @@ do_paint_content (MetaShapedTexture   *stex,
   if (!blended_tex_region || !cairo_region_is_empty (blended_tex_region))
     {
       CoglPipeline *blended_pipeline;
+      MetaRoundedClipUniforms *blended_clip_uniforms;
 
       if (stex->mask_texture == NULL)
         {
           blended_pipeline = get_unmasked_pipeline (stex, ctx);
+          blended_clip_uniforms = &stex->base_clip_uniforms;
         }
       else
         {
           blended_pipeline = get_masked_pipeline (stex, ctx);
+          blended_clip_uniforms = &stex->masked_clip_uniforms;
           cogl_pipeline_set_layer_texture (blended_pipeline, 1, stex->mask_texture);
           cogl_pipeline_set_layer_filters (blended_pipeline, 1, filter, filter);
         }
 
       cogl_pipeline_set_layer_texture (blended_pipeline, 0, paint_tex);
       cogl_pipeline_set_layer_filters (blended_pipeline, 0, filter, filter);
+      setup_rounded_clip (stex, blended_pipeline, blended_clip_uniforms);
 
       CoglColor color;
       cogl_color_init_from_4ub (&color, opacity, opacity, opacity, opacity);
@@ -1175,6 +1555,7 @@ meta_shaped_texture_set_opaque_region (MetaShapedTexture *stex,
                                        cairo_region_t    *opaque_region)
 {
   g_clear_pointer (&stex->opaque_region, cairo_region_destroy);
+  g_clear_pointer (&stex->rounded_clip_opaque_region, cairo_region_destroy);
   if (opaque_region)
     stex->opaque_region = cairo_region_reference (opaque_region);
 }
@@ -1185,6 +1566,88 @@ meta_shaped_texture_get_opaque_region (MetaShapedTexture *stex)
   return stex->opaque_region;
 }
 
+/**
+ * meta_shaped_texture_get_clipped_opaque_region: (skip)
+ * @stex: a #MetaShapedTexture
+ *
+ * Like meta_shaped_texture_get_opaque_region(), but without the pixels
+ * made translucent by the rounded clip, if any. This is the region that
+ * can be used to cull out what is below the texture.
+ *
+ * Returns: (transfer none) (nullable): the clipped opaque region
+ */
+cairo_region_t *
+meta_shaped_texture_get_clipped_opaque_region (MetaShapedTexture *stex)
+{
+  if (!stex->has_rounded_clip || !stex->opaque_region)
+    return stex->opaque_region;
+
+  if (!stex->rounded_clip_opaque_region)
+    {
+      stex->rounded_clip_opaque_region =
+        cairo_region_copy (stex->opaque_region);
+      meta_region_subtract_corners (stex->rounded_clip_opaque_region,
+                                    &stex->rounded_clip_bounds,
+                                    stex->rounded_clip_radius);
+    }
+
+  return stex->rounded_clip_opaque_region;
+}
+
+/**
+ * meta_shaped_texture_set_rounded_clip: (skip)
+ * @stex: a #MetaShapedTexture
+ * @bounds: the rectangle to clip to, in texture coordinates
+ * @radius: the corner radius
+ *
+ * Clips the texture to a rounded rectangle while painting, using the same
+ * shader as #MetaClipEffect but without rendering to an offscreen buffer
+ * first.
+ */
+void
+meta_shaped_texture_set_rounded_clip (MetaShapedTexture           *stex,
+                                      const cairo_rectangle_int_t *bounds,
+                                      float                        radius)
+{
+  if (stex->has_rounded_clip &&
+      stex->rounded_clip_radius == radius &&
+      gdk_rectangle_equal (&stex->rounded_clip_bounds, bounds))
+    return;
+
+  if (!stex->has_rounded_clip)
+    meta_shaped_texture_reset_pipelines (stex);
+
+  stex->has_rounded_clip = TRUE;
+  stex->rounded_clip_bounds = *bounds;
+  stex->rounded_clip_radius = radius;
+  g_clear_pointer (&stex->rounded_clip_opaque_region, cairo_region_destroy);
+
+  clutter_content_invalidate (CLUTTER_CONTENT (stex));
+}
+
+/**
+ * meta_shaped_texture_unset_rounded_clip: (skip)
+ * @stex: a #MetaShapedTexture
+ */
+void
+meta_shaped_texture_unset_rounded_clip (MetaShapedTexture *stex)
+{
+  if (!stex->has_rounded_clip)
+    return;
+
+  stex->has_rounded_clip = FALSE;
+  g_clear_pointer (&stex->rounded_clip_opaque_region, cairo_region_destroy);
+  meta_shaped_texture_reset_pipelines (stex);
+
+  clutter_content_invalidate (CLUTTER_CONTENT (stex));
+}
+
+gboolean
+meta_shaped_texture_has_rounded_clip (MetaShapedTexture *stex)
+{
+  return stex->has_rounded_clip;
+}
+
 gboolean
 meta_shaped_texture_has_alpha (MetaShapedTexture *stex)
 {
@@ -88,6 +88,24 @@ meta_surface_actor_wayland_try_acquire_scanout (MetaSurfaceActorWayland *self,
   return scanout;
 }
 
+CoglScanout *
+meta_surface_actor_wayland_try_acquire_overlay_scanout (MetaSurfaceActorWayland *self,
+                                                        CoglOnscreen            *onscreen)
+{
+  MetaWaylandSurface *surface;
+
+  /* Anything painted on top of the actor would end up below the overlay
+   * plane, so only consider actors that are fully unobscured.
+   */
+  if (meta_surface_actor_is_obscured (META_SURFACE_ACTOR (self)))
+    return NULL;
+
+  surface = meta_surface_actor_wayland_get_surface (self);
+  g_return_val_if_fail (surface, NULL);
+
+  return meta_wayland_surface_try_acquire_overlay_scanout (surface, onscreen);
+}
+
 #define UNOBSCURED_TRESHOLD 0.1
 
 ClutterStageView *
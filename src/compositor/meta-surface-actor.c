@@ -39,6 +39,9 @@ typedef struct _MetaSurfaceActorPrivate
   /* Freeze/thaw accounting */
   cairo_region_t *pending_damage;
   guint frozen : 1;
+
+  /* The view whose overlay plane shows the surface instead of the stage */
+  ClutterStageView *overlay_view;
 } MetaSurfaceActorPrivate;
 
 static void cullable_iface_init (MetaCullableInterface *iface);
@@ -231,6 +234,30 @@ meta_surface_actor_get_paint_volume (ClutterActor       *actor,
   return clutter_paint_volume_set_from_allocation (volume, actor);
 }
 
+static void
+meta_surface_actor_paint (ClutterActor        *actor,
+                          ClutterPaintContext *paint_context)
+{
+  MetaSurfaceActor *surface_actor = META_SURFACE_ACTOR (actor);
+  MetaSurfaceActorPrivate *priv =
+    meta_surface_actor_get_instance_private (surface_actor);
+  ClutterActorClass *actor_class =
+    CLUTTER_ACTOR_CLASS (meta_surface_actor_parent_class);
+
+  /* The overlay plane already shows the buffer above the view, painting it
+   * below as well would only blend it twice. Clones, screen casts and
+   * screenshots paint to other framebuffers and still need it.
+   */
+  if (priv->overlay_view &&
+      !clutter_actor_is_in_clone_paint (actor) &&
+      clutter_paint_context_get_stage_view (paint_context) == priv->overlay_view &&
+      clutter_paint_context_get_framebuffer (paint_context) ==
+      clutter_stage_view_get_framebuffer (priv->overlay_view))
+    return;
+
+  actor_class->paint (actor, paint_context);
+}
+
 static void
 meta_surface_actor_dispose (GObject *object)
 {
@@ -240,6 +267,7 @@ meta_surface_actor_dispose (GObject *object)
 
   g_clear_pointer (&priv->input_region, cairo_region_destroy);
   g_clear_object (&priv->texture);
+  g_clear_weak_pointer (&priv->overlay_view);
 
   set_unobscured_region (self, NULL);
 
@@ -253,6 +281,7 @@ meta_surface_actor_class_init (MetaSurfaceActorClass *klass)
   ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS (klass);
 
   object_class->dispose = meta_surface_actor_dispose;
+  actor_class->paint = meta_surface_actor_paint;
   actor_class->pick = meta_surface_actor_pick;
   actor_class->get_paint_volume = meta_surface_actor_get_paint_volume;
 
@@ -295,7 +324,8 @@ meta_surface_actor_cull_out (MetaCullable   *cullable,
       cairo_region_t *opaque_region;
       cairo_region_t *scaled_opaque_region;
 
-      opaque_region = meta_shaped_texture_get_opaque_region (priv->texture);
+      opaque_region =
+        meta_shaped_texture_get_clipped_opaque_region (priv->texture);
 
       if (!opaque_region)
         return;
@@ -620,3 +650,30 @@ meta_surface_actor_is_frozen (MetaSurfaceActor *self)
 
   return priv->frozen;
 }
+
+/**
+ * meta_surface_actor_set_overlay_view:
+ * @self: a #MetaSurfaceActor
+ * @view: (nullable): the view showing the surface on an overlay plane
+ *
+ * Marks the surface as shown on an overlay plane of @view, so that it is
+ * no longer painted into the framebuffer of @view.
+ */
+void
+meta_surface_actor_set_overlay_view (MetaSurfaceActor *self,
+                                     ClutterStageView *view)
+{
+  MetaSurfaceActorPrivate *priv =
+    meta_surface_actor_get_instance_private (self);
+
+  g_set_weak_pointer (&priv->overlay_view, view);
+}
+
+ClutterStageView *
+meta_surface_actor_get_overlay_view (MetaSurfaceActor *self)
+{
+  MetaSurfaceActorPrivate *priv =
+    meta_surface_actor_get_instance_private (self);
+
+  return priv->overlay_view;
+}
@@ -54,6 +54,10 @@ gboolean meta_surface_actor_is_opaque (MetaSurfaceActor *actor);
 gboolean meta_surface_actor_is_frozen (MetaSurfaceActor *actor);
 void meta_surface_actor_set_frozen (MetaSurfaceActor *actor,
                                     gboolean          frozen);
+
+void meta_surface_actor_set_overlay_view (MetaSurfaceActor *actor,
+                                          ClutterStageView *view);
+ClutterStageView * meta_surface_actor_get_overlay_view (MetaSurfaceActor *actor);
 G_END_DECLS
 
 #endif /* META_SURFACE_ACTOR_PRIVATE_H */
@@ -61,6 +61,7 @@ void meta_window_actor_frame_complete (MetaWindowActor    *self,
                                        ClutterFrameInfo   *frame_info,
                                        gint64              presentation_time);
 
+META_EXPORT_TEST
 gboolean meta_window_actor_effect_in_progress  (MetaWindowActor *self);
 
 MetaWindowActorChanges meta_window_actor_sync_actor_geometry (MetaWindowActor *self,
@@ -110,9 +111,11 @@ void meta_window_actor_update_glsl (MetaWindowActor *self);
 void meta_window_actor_get_corner_rect (MetaWindowActor *self, MetaRectangle *rect);
 void meta_window_actor_update_clip_padding (MetaWindowActor *self);
 void meta_window_actor_create_blur_actor (MetaWindowActor *self);
-void meta_window_actor_set_blur_behind (MetaWindowActor *self);
+ClutterActor * meta_window_actor_get_blur_actor (MetaWindowActor *self);
 void meta_window_actor_update_blur_position_size (MetaWindowActor *self);
 void meta_window_actor_update_blur_sigmal (MetaWindowActor *self);
 void meta_window_actor_update_blur_brightness (MetaWindowActor *self);
 void meta_window_actor_update_blur_window_opacity (MetaWindowActor *self);
+void meta_window_actor_update_blur_algorithm (MetaWindowActor *self);
+void meta_window_actor_update_blur_list (MetaWindowActor *self);
 #endif /* META_WINDOW_ACTOR_PRIVATE_H */
@@ -52,7 +52,6 @@ struct _MetaWindowActorWayland
   MetaShadowFactory *shadow_factory;
   gulong shadow_factory_changed_handler_id;
   gulong size_changed_id;
-  gulong repaint_scheduled_id;
   
 };
 
@@ -102,9 +101,10 @@ meta_window_actor_wayland_rebuild_surface_tree (MetaWindowActor *actor)
   GNode *root_node = surface->subsurface_branch_node;
   SurfaceTreeTraverseData traverse_data;
 
+  /* The blur actor, if any, stays beneath all surfaces */
   traverse_data = (SurfaceTreeTraverseData) {
     .window_actor = actor,
-    .index = 0,
+    .index = meta_window_actor_get_blur_actor (actor) ? 1 : 0,
   };
   g_node_traverse (root_node,
                    G_IN_ORDER,
@@ -122,16 +122,6 @@ surface_size_changed (MetaSurfaceActor *actor,
   actor_wayland->need_reshape = TRUE;
 }
 
-static void
-surface_repaint_scheduled (MetaSurfaceActor *actor,
-                           gpointer          user_data)
-{
-  MetaWindowActorWayland *actor_wayland = META_WINDOW_ACTOR_WAYLAND (user_data);
-  MetaWindow *window = meta_window_actor_get_meta_window (META_WINDOW_ACTOR(actor_wayland));
-  meta_compositor_update_blur_behind( meta_display_get_compositor (window->display));
-}
-
-
 static void
 meta_window_actor_wayland_assign_surface_actor (MetaWindowActor  *actor,
                                                 MetaSurfaceActor *surface_actor)
@@ -157,11 +147,6 @@ meta_window_actor_wayland_assign_surface_actor (MetaWindowActor  *actor,
     g_signal_connect (surface_actor, "size-changed",
                       G_CALLBACK (surface_size_changed),
                       actor_wayland);
-
-  actor_wayland->repaint_scheduled_id = 
-    g_signal_connect (surface_actor, "repaint-scheduled",
-                      G_CALLBACK (surface_repaint_scheduled),
-                      actor_wayland);
 }
 
 static void
@@ -515,7 +500,6 @@ meta_window_actor_wayland_dispose (GObject *object)
   GList *l;
 
   g_clear_signal_handler (&actor_wayland->size_changed_id, surface_actor);
-  g_clear_signal_handler (&actor_wayland->repaint_scheduled_id, surface_actor);
 
   children = clutter_actor_get_children (CLUTTER_ACTOR (window_actor));
   for (l = children; l; l = l->next)
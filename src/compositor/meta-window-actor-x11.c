@@ -142,8 +142,7 @@ surface_repaint_scheduled (MetaSurfaceActor *actor,
                            gpointer          user_data)
 {
   MetaWindowActorX11 *actor_x11 = META_WINDOW_ACTOR_X11 (user_data);
-  MetaWindow *window = meta_window_actor_get_meta_window (META_WINDOW_ACTOR(actor_x11));
-  meta_compositor_update_blur_behind( meta_display_get_compositor (window->display));
+
   actor_x11->repaint_scheduled = TRUE;
 }
 
@@ -61,12 +61,13 @@ typedef struct _MetaWindowActorPrivate
   MetaClipEffect *round_clip_effect;
   gboolean effect_setuped;
   gboolean should_clip;
+  gboolean clip_directly;
+  MetaRectangle corner_rect;
   int clip_padding[4];
   ClutterActor *blur_actor;
   MetaShellBlurEffect *blur_effect;
 
   ulong visible_changed_id;
-  ulong wm_class_changed_id;
   int geometry_scale;
 
   /*
@@ -157,6 +158,15 @@ meta_window_actor_update_blur_position_size(MetaWindowActor *self)
   meta_window_get_frame_rect (priv->window, &frame_rect);
   meta_window_get_buffer_rect (priv->window, &buf_rect);
 
+  if (priv->clip_padding[0] == -1 && priv->window->res_name)
+    meta_prefs_get_clip_edge_padding (priv->window->res_name, priv->clip_padding);
+
+  /* The blur actor is a child of the window actor, which is placed at the
+   * buffer rect, so it follows the frame rect relative to it.
+   */
+  frame_rect.x -= buf_rect.x;
+  frame_rect.y -= buf_rect.y;
+
   if (meta_window_get_maximized (priv->window) ||
       meta_window_is_fullscreen (priv->window))
     {
@@ -180,19 +190,6 @@ meta_window_actor_update_blur_position_size(MetaWindowActor *self)
    }
 }
 
-void
-meta_window_actor_set_blur_behind (MetaWindowActor *self)
-{
-  MetaWindowActorPrivate *priv =
-    meta_window_actor_get_instance_private (self);
-
-  if (!priv->blur_actor)
-    return;
-
-  ClutterActor *parent = clutter_actor_get_parent (CLUTTER_ACTOR(self));
-  clutter_actor_set_child_below_sibling (parent, priv->blur_actor, CLUTTER_ACTOR(self));  
-}
-
 static gboolean
 meta_window_is_normal (MetaWindowActor *actor)
 {
@@ -228,7 +225,7 @@ meta_window_actor_create_blur_actor (MetaWindowActor *self)
   
   if (!meta_window_is_normal (self))
     return;
-  if (!meta_prefs_in_blur_list (priv->window->res_name))
+  if (!meta_window_is_in_blur_list (priv->window))
     return;
   if (priv->blur_actor != NULL)
     return;
@@ -240,30 +237,73 @@ meta_window_actor_create_blur_actor (MetaWindowActor *self)
                                     meta_prefs_get_blur_brightness());
   meta_shell_blur_effect_set_sigma (priv->blur_effect,
                                meta_prefs_get_blur_sigmal());
+  meta_window_actor_update_blur_algorithm (self);
   meta_shell_blur_effect_set_mode (priv->blur_effect, SHELL_BLUR_MODE_BACKGROUND);
   clutter_actor_add_effect_with_name (priv->blur_actor,
                                       "ShellBlurEffect",
                                       CLUTTER_EFFECT(priv->blur_effect));
 
-  ClutterActor *parent = clutter_actor_get_parent (CLUTTER_ACTOR(self));
-  clutter_actor_insert_child_below (parent, priv->blur_actor, CLUTTER_ACTOR(self));
+  /* Being the bottom-most child of the window actor keeps the blur actor
+   * right beneath the window when restacking or moving it.
+   */
+  clutter_actor_insert_child_at_index (CLUTTER_ACTOR (self), priv->blur_actor, 0);
+  meta_window_actor_update_blur_position_size (self);
   int opa = meta_prefs_get_blur_window_opacity();
   meta_window_set_opacity(priv->window, opa);
 }
 
+ClutterActor *
+meta_window_actor_get_blur_actor (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv =
+    meta_window_actor_get_instance_private (self);
+
+  return priv->blur_actor;
+}
+
+/*
+ * The rounded corners are normally drawn directly by the MetaShapedTexture
+ * of the surface. Sliced textures are drawn one slice at a time with
+ * texture coordinates relative to each slice, which the clip shader can't
+ * map back to the window, so those go through the offscreen MetaClipEffect.
+ */
+static gboolean
+can_clip_directly (MetaSurfaceActor *surface)
+{
+  MetaShapedTexture *stex = meta_surface_actor_get_texture (surface);
+  CoglTexture *texture = meta_shaped_texture_get_texture (stex);
+
+  return !texture || !cogl_texture_is_sliced (texture);
+}
+
 static void
 check_meta_window_surface_actor(MetaWindowActor *self)
 {
   MetaWindowActorPrivate *priv = meta_window_actor_get_instance_private(self);
   MetaSurfaceActor *surface = meta_window_actor_get_surface(self);
+  gboolean clip_directly;
+
+  if (!surface || !priv->round_clip_effect)
+    return;
+
+  clip_directly = can_clip_directly (surface);
 
-  if (!priv->effect_setuped && surface && priv->round_clip_effect)
+  if (clip_directly && priv->effect_setuped)
   {
+    clutter_actor_remove_effect(CLUTTER_ACTOR(surface),
+                                CLUTTER_EFFECT(priv->round_clip_effect));
+    priv->effect_setuped = false;
+  }
+  else if (!clip_directly && !priv->effect_setuped)
+  {
+    meta_shaped_texture_unset_rounded_clip(meta_surface_actor_get_texture(surface));
     clutter_actor_add_effect_with_name(CLUTTER_ACTOR(surface),
                                        "Rounded Corners Effect(Surface)",
                                        CLUTTER_EFFECT(priv->round_clip_effect));
     priv->effect_setuped = true;
   }
+
+  priv->clip_directly = clip_directly;
 }
 
 void
@@ -273,15 +313,24 @@ meta_window_actor_update_glsl(MetaWindowActor *self)
   MetaRectangle buf_rect;
   MetaWindow *window = meta_window_actor_get_meta_window(self);
   MetaWindowActorPrivate *priv = meta_window_actor_get_instance_private(self);
+  MetaShapedTexture *stex;
 
   if(!priv->round_clip_effect)
     return;
 
   check_meta_window_surface_actor(self);
 
+  if (!priv->surface)
+    return;
+
+  stex = meta_surface_actor_get_texture(priv->surface);
+
   if (!meta_window_actor_should_clip(self))
   {
-    meta_clip_effect_skip(priv->round_clip_effect);
+    if (priv->clip_directly)
+      meta_shaped_texture_unset_rounded_clip(stex);
+    else
+      meta_clip_effect_skip(priv->round_clip_effect);
     return;
   }
 
@@ -300,7 +349,18 @@ meta_window_actor_update_glsl(MetaWindowActor *self)
   if (priv->clip_padding[0] == -1 && window->res_name)
     meta_prefs_get_clip_edge_padding(window->res_name, priv->clip_padding);
 
-  meta_clip_effect_set_bounds(priv->round_clip_effect, &bounds, priv->clip_padding);
+  // padding: [left, right, top, bottom]
+  priv->corner_rect.x = bounds.x + priv->clip_padding[0];
+  priv->corner_rect.y = bounds.y + priv->clip_padding[2];
+  priv->corner_rect.width = bounds.width - priv->clip_padding[0] - priv->clip_padding[1];
+  priv->corner_rect.height = bounds.height - priv->clip_padding[2] - priv->clip_padding[3];
+
+  if (priv->clip_directly)
+    meta_shaped_texture_set_rounded_clip(stex,
+                                         &priv->corner_rect,
+                                         meta_prefs_get_round_corner_radius());
+  else
+    meta_clip_effect_set_bounds(priv->round_clip_effect, &bounds, priv->clip_padding);
 }
 
 static gboolean
@@ -333,7 +393,7 @@ meta_window_actor_get_corner_rect(MetaWindowActor *self,
 {
   MetaWindowActorPrivate *priv = meta_window_actor_get_instance_private(self);
   g_return_if_fail(priv->round_clip_effect);
-  meta_clip_effect_get_bounds(priv->round_clip_effect, rect);
+  *rect = priv->corner_rect;
 }
 
 void meta_window_actor_update_clip_padding(MetaWindowActor *self)
@@ -362,6 +422,29 @@ meta_window_actor_update_blur_brightness (MetaWindowActor *self)
                                  meta_prefs_get_blur_brightness());
 }
 
+void
+meta_window_actor_update_blur_algorithm (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = meta_window_actor_get_instance_private(self);
+  ClutterBlurAlgorithm algorithm;
+
+  if (!priv->blur_actor)
+    return;
+
+  switch (meta_prefs_get_blur_algorithm ())
+    {
+    case META_BLUR_ALGORITHM_DUAL_KAWASE:
+      algorithm = CLUTTER_BLUR_ALGORITHM_DUAL_KAWASE;
+      break;
+    case META_BLUR_ALGORITHM_GAUSSIAN:
+    default:
+      algorithm = CLUTTER_BLUR_ALGORITHM_GAUSSIAN;
+      break;
+    }
+
+  meta_shell_blur_effect_set_algorithm (priv->blur_effect, algorithm);
+}
+
 void
 meta_window_actor_update_blur_window_opacity (MetaWindowActor *self)
 {
@@ -469,6 +552,7 @@ meta_window_actor_init (MetaWindowActor *self)
 
   priv->geometry_scale = 1;
   priv->effect_setuped = FALSE;
+  priv->clip_directly = TRUE;
   priv->clip_padding[0] = -1;
 
   priv->blur_actor = NULL;
@@ -676,15 +760,20 @@ on_visible_changed (MetaWindowActor *self)
 }
 
 static void
-on_wm_class_changed (MetaWindow *self,
-                     gpointer    user_data)
+on_wm_class_changed (MetaWindow      *window,
+                     GParamSpec      *pspec,
+                     MetaWindowActor *actor)
 {
-  MetaWindowActor *actor = meta_window_actor_from_window (self);
   MetaWindowActorPrivate *priv = meta_window_actor_get_instance_private (actor);
 
-  priv->round_clip_effect = create_clip_effect(actor);
-  meta_window_actor_create_blur_actor(actor);
-  g_clear_signal_handler(&priv->wm_class_changed_id, self);
+  if (window->client_type == META_WINDOW_CLIENT_TYPE_WAYLAND &&
+      !priv->round_clip_effect)
+    priv->round_clip_effect = create_clip_effect(actor);
+
+  /* WM_CLASS may change at any time after map, so attach or detach the
+   * blur actor for the new names each time.
+   */
+  meta_window_actor_update_blur_list (actor);
 }
 
 static void
@@ -694,7 +783,6 @@ meta_window_actor_constructed (GObject *object)
   MetaWindowActorPrivate *priv =
     meta_window_actor_get_instance_private (self);
   MetaWindow *window = priv->window;
-  MetaWindowClientType type = meta_window_get_client_type (window);
 
   priv->compositor = window->display->compositor;
 
@@ -714,11 +802,8 @@ meta_window_actor_constructed (GObject *object)
 
   meta_window_actor_sync_actor_geometry (self, priv->window->placed);
 
-  if (type == META_WINDOW_CLIENT_TYPE_WAYLAND)
-  {
-    priv->wm_class_changed_id =
-      g_signal_connect (window, "notify::wm-class", G_CALLBACK (on_wm_class_changed), object);
-  }
+  g_signal_connect_object (window, "notify::wm-class",
+                           G_CALLBACK (on_wm_class_changed), self, 0);
 
   priv->visible_changed_id = 
     g_signal_connect (object, "notify::visible", G_CALLBACK (on_visible_changed), NULL);
@@ -917,9 +1002,27 @@ meta_window_actor_remove_blur (MetaWindowActor *self)
   if (!priv->blur_actor)
     return;
 
-  ClutterActor *parent = clutter_actor_get_parent (CLUTTER_ACTOR (self));
   clutter_actor_remove_effect (priv->blur_actor, CLUTTER_EFFECT (priv->blur_effect));
-  clutter_actor_remove_child (parent, priv->blur_actor);
+  clutter_actor_remove_child (CLUTTER_ACTOR (self), priv->blur_actor);
+  priv->blur_actor = NULL;
+  priv->blur_effect = NULL;
+}
+
+void
+meta_window_actor_update_blur_list (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv =
+    meta_window_actor_get_instance_private (self);
+
+  if (meta_window_is_in_blur_list (priv->window))
+    {
+      meta_window_actor_create_blur_actor (self);
+    }
+  else if (priv->blur_actor)
+    {
+      meta_window_actor_remove_blur (self);
+      meta_window_set_opacity (priv->window, 0xff);
+    }
 }
 
 static void
@@ -1236,6 +1339,11 @@ meta_window_actor_sync_actor_geometry (MetaWindowActor *self,
   if (changes & META_WINDOW_ACTOR_CHANGE_SIZE)
     clutter_actor_set_size (actor, window_rect.width, window_rect.height);
 
+  /* The frame may move within an unchanged buffer rect, e.g. when the
+   * client side shadow extents change, so always follow the frame rect.
+   */
+  meta_window_actor_update_blur_position_size (self);
+
   return changes;
 }
 
@@ -1873,7 +1981,7 @@ meta_window_actor_get_image (MetaWindowActor *self,
 
   stex = meta_surface_actor_get_texture (priv->surface);
   if (!meta_shaped_texture_should_get_via_offscreen (stex) &&
-      clutter_actor_get_n_children (actor) == 1)
+      clutter_actor_get_n_children (actor) == (priv->blur_actor ? 2 : 1))
     {
       MetaRectangle *surface_clip = NULL;
 
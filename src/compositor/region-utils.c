@@ -456,3 +456,40 @@ meta_region_crop_and_scale (cairo_region_t  *region,
 
   return viewport_region;
 }
+
+/**
+ * meta_region_subtract_corners:
+ * @region: the region to modify
+ * @rect: the rectangle whose corners get rounded
+ * @radius: the corner radius
+ *
+ * Removes from @region everything outside of @rect, and a @radius sized
+ * square at each corner of @rect, i.e. all the pixels a rounded clip of
+ * @rect may make translucent.
+ */
+void
+meta_region_subtract_corners (cairo_region_t              *region,
+                              const cairo_rectangle_int_t *rect,
+                              float                        radius)
+{
+  cairo_rectangle_int_t corner;
+  int r = ceilf (radius);
+  int x1 = rect->x;
+  int y1 = rect->y;
+  int x2 = rect->x + rect->width;
+  int y2 = rect->y + rect->height;
+
+  cairo_region_intersect_rectangle (region, rect);
+
+  if (r <= 0)
+    return;
+
+  corner = (cairo_rectangle_int_t) { x1, y1, r, r };
+  cairo_region_subtract_rectangle (region, &corner);
+  corner = (cairo_rectangle_int_t) { x2 - r, y1, r, r };
+  cairo_region_subtract_rectangle (region, &corner);
+  corner = (cairo_rectangle_int_t) { x1, y2 - r, r, r };
+  cairo_region_subtract_rectangle (region, &corner);
+  corner = (cairo_rectangle_int_t) { x2 - r, y2 - r, r, r };
+  cairo_region_subtract_rectangle (region, &corner);
+}
@@ -116,4 +116,9 @@ cairo_region_t * meta_region_crop_and_scale (cairo_region_t  *region,
                                              int              dst_width,
                                              int              dst_height);
 
+META_EXPORT_TEST
+void meta_region_subtract_corners (cairo_region_t              *region,
+                                   const cairo_rectangle_int_t *rect,
+                                   float                        radius);
+
 #endif /* __META_REGION_UTILS_H__ */
@@ -128,10 +128,15 @@ static int border_brightness = 40;
 static int blur_sigmal = 20;
 static int blur_window_opacity = 80;
 static int blur_brightness = 100;
+static MetaBlurAlgorithm blur_algorithm = META_BLUR_ALGORITHM_GAUSSIAN;
 static JsonNode *clip_edge_padding = NULL;
 /* NULL-terminated array */
 static char **black_list = NULL;
 static char **blur_list = NULL;
+/* blur-list entries, compiled for matching */
+static GHashTable *blur_list_names = NULL;
+static GPtrArray *blur_list_patterns = NULL;
+static unsigned int blur_list_serial = 0;
 
 /* NULL-terminated array */
 static char **workspace_names = NULL;
@@ -166,6 +171,7 @@ static gboolean locate_pointer_key_handler (GVariant*, gpointer*, gpointer);
 static gboolean clip_edge_padding_handler (GVariant*, gpointer*, gpointer);
 
 static gboolean iso_next_group_handler (GVariant*, gpointer*, gpointer);
+static gboolean blur_list_handler (GVariant*, gpointer*, gpointer);
 
 static void     init_bindings             (void);
 
@@ -291,6 +297,13 @@ static MetaEnumPreference preferences_enum[] =
       },
       &action_right_click_titlebar,
     },
+    {
+      { "blur-algorithm",
+        SCHEMA_MUTTER,
+        META_PREF_BLUR_ALGORITHM,
+      },
+      &blur_algorithm,
+    },
     { { NULL, 0, 0 }, NULL },
   };
 
@@ -511,8 +524,8 @@ static MetaStringArrayPreference preferences_string_array[] =
         SCHEMA_MUTTER,
         META_PREF_BLUR_LIST,
       },
+      blur_list_handler,
       NULL,
-      &blur_list,
     },
     { { NULL, 0, 0 }, NULL },
   };
@@ -1783,6 +1796,59 @@ iso_next_group_handler (GVariant *value,
   return TRUE;
 }
 
+static void
+update_blur_list_matches (void)
+{
+  char **p;
+
+  g_clear_pointer (&blur_list_names, g_hash_table_unref);
+  g_clear_pointer (&blur_list_patterns, g_ptr_array_unref);
+
+  /* Plain names are looked up directly, only globs need to be matched one
+   * by one. The names are owned by blur_list.
+   */
+  blur_list_names = g_hash_table_new (g_str_hash, g_str_equal);
+  blur_list_patterns =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) g_pattern_spec_free);
+
+  for (p = blur_list; p && *p; p++)
+    {
+      if (strpbrk (*p, "*?"))
+        g_ptr_array_add (blur_list_patterns, g_pattern_spec_new (*p));
+      else
+        g_hash_table_add (blur_list_names, *p);
+    }
+
+  blur_list_serial++;
+}
+
+static gboolean
+blur_list_handler (GVariant *value,
+                   gpointer *result,
+                   gpointer  data)
+{
+  const char **names;
+
+  *result = NULL; /* ignored */
+  names = g_variant_get_strv (value, NULL);
+
+  if (blur_list_names &&
+      g_strv_equal ((const char * const *) blur_list, names))
+    {
+      g_free (names);
+      return TRUE;
+    }
+
+  g_strfreev (blur_list);
+  blur_list = g_strdupv ((char **) names);
+  g_free (names);
+
+  update_blur_list_matches ();
+  queue_changed (META_PREF_BLUR_LIST);
+
+  return TRUE;
+}
+
 const PangoFontDescription*
 meta_prefs_get_titlebar_font (void)
 {
@@ -1948,6 +2014,9 @@ meta_preference_to_string (MetaPreference pref)
 
     case META_PREF_BLUR_WINDOW_OPACITY:
       return "BLUR_WINDOW_OPACITY";
+
+    case META_PREF_BLUR_ALGORITHM:
+      return "BLUR_ALGORITHM";
     }
 
   return "(unknown)";
@@ -2495,15 +2564,51 @@ meta_prefs_get_blur_window_opacity(void)
   return blur_window_opacity * 255 * 0.01;
 }
 
+/**
+ * meta_prefs_in_blur_list:
+ * @name: (nullable): a `WM_CLASS` instance or class name
+ *
+ * Returns: %TRUE if @name matches an entry of blur-list, either exactly
+ *   or as a glob pattern
+ */
 gboolean
-meta_prefs_in_blur_list(const char *name)
+meta_prefs_in_blur_list (const char *name)
 {
-  g_return_val_if_fail(blur_list, FALSE);
+  unsigned int i;
 
-  int len = g_strv_length(blur_list);
+  g_return_val_if_fail (blur_list_names, FALSE);
+
+  if (!name)
+    return FALSE;
+
+  if (g_hash_table_contains (blur_list_names, name))
+    return TRUE;
+
+  for (i = 0; i < blur_list_patterns->len; i++)
+    {
+      GPatternSpec *pattern = g_ptr_array_index (blur_list_patterns, i);
+
+      if (g_pattern_spec_match_string (pattern, name))
+        return TRUE;
+    }
 
-  for (int i = 0; i < len; i++)
-    if (g_strcmp0(name, blur_list[i]) == 0)
-      return TRUE;
   return FALSE;
 }
+
+/**
+ * meta_prefs_get_blur_list_serial:
+ *
+ * Returns: a number that changes whenever blur-list changes, for caching the
+ *   results of meta_prefs_in_blur_list()
+ */
+unsigned int
+meta_prefs_get_blur_list_serial (void)
+{
+  return blur_list_serial;
+}
+
+MetaBlurAlgorithm
+meta_prefs_get_blur_algorithm(void)
+{
+  return blur_algorithm;
+}
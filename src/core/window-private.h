@@ -199,6 +199,10 @@ struct _MetaWindow
   char *sm_client_id;
   char *wm_client_machine;
 
+  /* Whether res_name or res_class match blur-list, as of blur_list_serial */
+  unsigned int blur_list_serial;
+  gboolean in_blur_list;
+
   char *startup_id;
   char *mutter_hints;
   char *sandboxed_app_id;
@@ -818,6 +822,7 @@ gboolean meta_window_updates_are_frozen (MetaWindow *window);
 
 void meta_window_set_title                (MetaWindow *window,
                                            const char *title);
+META_EXPORT_TEST
 void meta_window_set_wm_class             (MetaWindow *window,
                                            const char *wm_class,
                                            const char *wm_instance);
@@ -914,4 +919,7 @@ gboolean meta_window_unit_cgroup_equal (MetaWindow *window1,
 void meta_window_check_alive_on_event (MetaWindow *window,
                                        uint32_t    timestamp);
 
+META_EXPORT_TEST
+gboolean meta_window_is_in_blur_list (MetaWindow *window);
+
 #endif
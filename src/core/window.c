@@ -8194,10 +8194,27 @@ meta_window_set_wm_class (MetaWindow *window,
 
   window->res_name = g_strdup (wm_instance);
   window->res_class = g_strdup (wm_class);
+  window->blur_list_serial = 0;
 
   g_object_notify_by_pspec (G_OBJECT (window), obj_props[PROP_WM_CLASS]);
 }
 
+gboolean
+meta_window_is_in_blur_list (MetaWindow *window)
+{
+  unsigned int serial = meta_prefs_get_blur_list_serial ();
+
+  /* The serial of the compiled list is never 0 */
+  if (window->blur_list_serial != serial)
+    {
+      window->in_blur_list = (meta_prefs_in_blur_list (window->res_name) ||
+                              meta_prefs_in_blur_list (window->res_class));
+      window->blur_list_serial = serial;
+    }
+
+  return window->in_blur_list;
+}
+
 void
 meta_window_set_gtk_dbus_properties (MetaWindow *window,
                                      const char *application_id,
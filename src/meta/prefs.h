@@ -68,6 +68,20 @@
  * @META_PREF_LOCATE_POINTER: show pointer location
  */
 
+/**
+ * MetaBlurAlgorithm:
+ * @META_BLUR_ALGORITHM_GAUSSIAN: separable gaussian blur
+ * @META_BLUR_ALGORITHM_DUAL_KAWASE: dual kawase blur
+ *
+ * The algorithm used to blur the background of windows.
+ */
+/* Keep in sync with GSettings schemas! */
+typedef enum
+{
+  META_BLUR_ALGORITHM_GAUSSIAN,
+  META_BLUR_ALGORITHM_DUAL_KAWASE,
+} MetaBlurAlgorithm;
+
 /* Keep in sync with GSettings schemas! */
 typedef enum
 {
@@ -116,6 +130,7 @@ typedef enum
   META_PREF_BLUR_BRIGHTNESS,
   META_PREF_BLUR_LIST,
   META_PREF_BLUR_WINDOW_OPACITY,
+  META_PREF_BLUR_ALGORITHM,
 } MetaPreference;
 
 typedef void (* MetaPrefsChangedFunc) (MetaPreference pref,
@@ -268,7 +283,13 @@ META_EXPORT
 int      meta_prefs_get_blur_window_opacity(void);
 
 META_EXPORT
-gboolean meta_prefs_in_blur_list(const char *name);
+gboolean meta_prefs_in_blur_list (const char *name);
+
+META_EXPORT
+unsigned int meta_prefs_get_blur_list_serial (void);
+
+META_EXPORT
+MetaBlurAlgorithm meta_prefs_get_blur_algorithm(void);
 
 /**
  * MetaKeyBindingAction:
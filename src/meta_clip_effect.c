@@ -1,6 +1,11 @@
 // for 40.4
 
 #include "meta_clip_effect.h"
+
+#include <string.h>
+
+#include "compositor/meta-cullable.h"
+#include "compositor/region-utils.h"
 #include "meta/prefs.h"
 #include "shader.h"
 
@@ -8,9 +13,17 @@ typedef struct {
   CoglPipeline *pipeline;
   ClutterActor *actor;
   cairo_rectangle_int_t bounds;
+  float radius;
+  gboolean skip;
+  MetaRoundedClipUniforms uniforms;
 } MetaClipEffectPrivate;
 
-G_DEFINE_TYPE_WITH_PRIVATE(MetaClipEffect, meta_clip_effect, CLUTTER_TYPE_OFFSCREEN_EFFECT)
+static void cullable_effect_iface_init (MetaCullableEffectInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(MetaClipEffect, meta_clip_effect, CLUTTER_TYPE_OFFSCREEN_EFFECT,
+                        G_ADD_PRIVATE(MetaClipEffect)
+                        G_IMPLEMENT_INTERFACE(META_TYPE_CULLABLE_EFFECT,
+                                              cullable_effect_iface_init))
 
 static CoglPipeline *
 meta_clip_effect_class_create_pipeline(ClutterOffscreenEffect *effect,
@@ -55,6 +68,28 @@ meta_clip_effect_pre_paint (ClutterEffect *effect,
   return res;
 }
 
+static cairo_region_t *
+meta_clip_effect_get_opaque_region(MetaCullableEffect *effect)
+{
+  MetaClipEffectPrivate *priv =
+    meta_clip_effect_get_instance_private(META_CLIP_EFFECT(effect));
+  cairo_region_t *region;
+
+  if (priv->skip)
+    return NULL;
+
+  region = cairo_region_create_rectangle(&priv->bounds);
+  meta_region_subtract_corners(region, &priv->bounds, priv->radius);
+
+  return region;
+}
+
+static void
+cullable_effect_iface_init(MetaCullableEffectInterface *iface)
+{
+  iface->get_opaque_region = meta_clip_effect_get_opaque_region;
+}
+
 static void
 meta_clip_effect_dispose(GObject *gobject)
 {
@@ -109,6 +144,8 @@ meta_clip_effect_init(MetaClipEffect *self)
 
   priv->pipeline = cogl_pipeline_copy (klass->base_pipeline);
   priv->actor = NULL;
+  priv->skip = TRUE;
+  meta_rounded_clip_uniforms_reset(&priv->uniforms);
 }
 
 MetaClipEffect *meta_clip_effect_new(void)
@@ -116,6 +153,90 @@ MetaClipEffect *meta_clip_effect_new(void)
   return g_object_new(META_TYPE_CLIP_EFFECT, NULL);
 }
 
+void
+meta_rounded_clip_uniforms_reset(MetaRoundedClipUniforms *uniforms)
+{
+  uniforms->has_skip = FALSE;
+  uniforms->has_params = FALSE;
+}
+
+static void
+get_uniform_locations(CoglPipeline *pipeline,
+                      int          *location_params,
+                      int          *location_skip)
+{
+  static int params = -1;
+  static int skip = -1;
+
+  /* Uniform locations are global to the Cogl context, not per pipeline */
+  if (G_UNLIKELY (params == -1))
+    {
+      params = cogl_pipeline_get_uniform_location(pipeline, "clip_params");
+      skip = cogl_pipeline_get_uniform_location(pipeline, "skip");
+    }
+
+  *location_params = params;
+  *location_skip = skip;
+}
+
+static void
+set_skip(CoglPipeline            *pipeline,
+         MetaRoundedClipUniforms *uniforms,
+         int                      skip)
+{
+  int location_params, location_skip;
+
+  if (uniforms->has_skip && uniforms->skip == skip)
+    return;
+
+  get_uniform_locations(pipeline, &location_params, &location_skip);
+  cogl_pipeline_set_uniform_1i(pipeline, location_skip, skip);
+
+  uniforms->has_skip = TRUE;
+  uniforms->skip = skip;
+}
+
+void
+meta_clip_effect_setup_pipeline(CoglPipeline                *pipeline,
+                                MetaRoundedClipUniforms     *uniforms,
+                                const cairo_rectangle_int_t *bounds,
+                                float                        radius,
+                                float                        width,
+                                float                        height)
+{
+  float border = meta_prefs_get_border_width();
+  float brightness = meta_prefs_get_border_brightness();
+
+  float x1 = bounds->x;
+  float y1 = bounds->y;
+  float x2 = bounds->width + x1;
+  float y2 = bounds->height + y1;
+
+  /* See ROUNDED_CLIP_FRAGMENT_SHADER_VARS for the layout */
+  float params[META_ROUNDED_CLIP_N_PARAMS * 4] = {
+    x1, y1, x2, y2,
+    x1 + radius, y1 + radius, x2 - radius, y1 + radius,
+    x2 - radius, y2 - radius, x1 + radius, y2 - radius,
+    x1 + border, y1 + border, x2 - border, y2 - border,
+    1. / width, 1. / height, border, brightness,
+  };
+  int location_params, location_skip;
+
+  set_skip(pipeline, uniforms, 0);
+
+  if (uniforms->has_params &&
+      memcmp(uniforms->params, params, sizeof (params)) == 0)
+    return;
+
+  get_uniform_locations(pipeline, &location_params, &location_skip);
+  cogl_pipeline_set_uniform_float(pipeline,
+                                  location_params,
+                                  4, META_ROUNDED_CLIP_N_PARAMS,
+                                  params);
+  memcpy(uniforms->params, params, sizeof (params));
+  uniforms->has_params = TRUE;
+}
+
 void
 meta_clip_effect_set_bounds(MetaClipEffect        *effect, 
                             cairo_rectangle_int_t *_bounds,
@@ -126,99 +247,23 @@ meta_clip_effect_set_bounds(MetaClipEffect        *effect,
   MetaClipEffectPrivate *priv = meta_clip_effect_get_instance_private(effect);
 
   g_return_if_fail(priv->pipeline && priv->actor);
-  float radius = meta_prefs_get_round_corner_radius();
-  float border = meta_prefs_get_border_width();
-  float brightness = meta_prefs_get_border_brightness();
+  float w, h;
 
   priv->bounds.x = _bounds->x + padding[0];
   priv->bounds.y = _bounds->y + padding[2];
   priv->bounds.width =  _bounds->width  - padding[1] - padding[0];
   priv->bounds.height = _bounds->height - padding[2] - padding[3];
 
-  float x1 = priv->bounds.x;
-  float y1 = priv->bounds.y;
-  float x2 = priv->bounds.width + x1;
-  float y2 = priv->bounds.height + y1;
-  float w, h;
+  priv->radius = meta_prefs_get_round_corner_radius();
+  priv->skip = FALSE;
 
   clutter_actor_get_size(priv->actor, &w, &h);
 
-  int location_skip = 
-    cogl_pipeline_get_uniform_location(priv->pipeline, "skip");
-  int location_bounds = 
-    cogl_pipeline_get_uniform_location(priv->pipeline, "bounds");
-  int location_corner_centers_1 =
-    cogl_pipeline_get_uniform_location(priv->pipeline, "corner_centers_1");
-  int location_corner_centers_2 =
-    cogl_pipeline_get_uniform_location(priv->pipeline, "corner_centers_2");
-  int location_inner_bounds = 
-    cogl_pipeline_get_uniform_location(priv->pipeline, "inner_bounds");
-  int location_inner_corner_centers_1 =
-    cogl_pipeline_get_uniform_location(priv->pipeline, "inner_corner_centers_1");
-  int location_inner_corner_centers_2 =
-    cogl_pipeline_get_uniform_location(priv->pipeline, "inner_corner_centers_2");
-  int location_pixel_step =
-    cogl_pipeline_get_uniform_location(priv->pipeline, "pixel_step");
-  int location_border_width =
-    cogl_pipeline_get_uniform_location(priv->pipeline, "border_width");
-  int location_border_brightness =
-    cogl_pipeline_get_uniform_location(priv->pipeline, "border_brightness");
-
-
-  float bounds[] = { x1, y1, x2, y2 };
-  float corner_centers_1[] = {
-    x1 + radius,
-    y1 + radius,
-    x2 - radius,
-    y1 + radius
-  };
-  float corner_centers_2[] = {
-    x2 - radius,
-    y2 - radius,
-    x1 + radius,
-    y2 - radius
-  };
-  float inner_bounds[] = { x1 + border, y1 + border, x2 - border, y2 - border };
-  
-  float inner_corner_centers_1[] = {
-    x1 + radius,
-    y1 + radius,
-    x2 - radius,
-    y1 + radius
-  };
-  float inner_corner_centers_2[] = {
-    x2 - radius,
-    y2 - radius,
-    x1 + radius,
-    y2 - radius
-  };
-
-  float pixel_step[] = { 1. / w, 1. / h };
-
-  cogl_pipeline_set_uniform_float(priv->pipeline,
-                                  location_bounds,
-                                  4, 1, bounds);
-  cogl_pipeline_set_uniform_float(priv->pipeline,
-                                  location_corner_centers_1,
-                                  4, 1, corner_centers_1);
-  cogl_pipeline_set_uniform_float(priv->pipeline,
-                                  location_corner_centers_2,
-                                  4, 1, corner_centers_2);
-  cogl_pipeline_set_uniform_float(priv->pipeline,
-                                  location_inner_bounds,
-                                  4, 1, inner_bounds);
-  cogl_pipeline_set_uniform_float(priv->pipeline,
-                                  location_inner_corner_centers_1,
-                                  4, 1, inner_corner_centers_1);
-  cogl_pipeline_set_uniform_float(priv->pipeline,
-                                  location_inner_corner_centers_2,
-                                  4, 1, inner_corner_centers_2);
-  cogl_pipeline_set_uniform_float(priv->pipeline,
-                                  location_pixel_step,
-                                  2, 1, pixel_step);
-  cogl_pipeline_set_uniform_1i(priv->pipeline, location_skip, 0);
-  cogl_pipeline_set_uniform_1f(priv->pipeline, location_border_width, border);
-  cogl_pipeline_set_uniform_1f(priv->pipeline, location_border_brightness, brightness);
+  meta_clip_effect_setup_pipeline(priv->pipeline,
+                                  &priv->uniforms,
+                                  &priv->bounds,
+                                  priv->radius,
+                                  w, h);
 }
 
 void
@@ -228,10 +273,8 @@ meta_clip_effect_skip(MetaClipEffect *effect)
 
   g_return_if_fail(priv->pipeline && priv->actor);
 
-  int location_skip = 
-    cogl_pipeline_get_uniform_location(priv->pipeline, "skip");
-
-  cogl_pipeline_set_uniform_1i(priv->pipeline, location_skip, 1);
+  priv->skip = TRUE;
+  set_skip(priv->pipeline, &priv->uniforms, 1);
 }
 
 void
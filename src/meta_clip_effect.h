@@ -4,6 +4,8 @@
 
 #include <clutter/clutter.h>
 
+#include "core/util-private.h"
+
 #define META_TYPE_CLIP_EFFECT (meta_clip_effect_get_type())
 G_DECLARE_DERIVABLE_TYPE(MetaClipEffect, meta_clip_effect, META, CLIP_EFFECT, ClutterOffscreenEffect)
 
@@ -13,8 +15,39 @@ struct _MetaClipEffectClass {
   gpointer padding[12];
 };
 
+META_EXPORT_TEST
 MetaClipEffect *meta_clip_effect_new(void);
 
+META_EXPORT_TEST
 void meta_clip_effect_set_bounds(MetaClipEffect *effect, cairo_rectangle_int_t *bounds, int padding[4]);
 void meta_clip_effect_get_bounds(MetaClipEffect *effect, cairo_rectangle_int_t *bounds);
-void meta_clip_effect_skip(MetaClipEffect *effect);
\ No newline at end of file
+void meta_clip_effect_skip(MetaClipEffect *effect);
+
+#define META_ROUNDED_CLIP_N_PARAMS 5
+
+/*
+ * The uniform values last applied to one pipeline carrying the rounded
+ * clip snippet, so that unchanged geometry doesn't dirty the pipeline.
+ * Must be reset whenever the pipeline it belongs to is replaced.
+ */
+typedef struct _MetaRoundedClipUniforms
+{
+  gboolean has_skip;
+  gboolean has_params;
+  int skip;
+  float params[META_ROUNDED_CLIP_N_PARAMS * 4];
+} MetaRoundedClipUniforms;
+
+void meta_rounded_clip_uniforms_reset(MetaRoundedClipUniforms *uniforms);
+
+/*
+ * Fill the uniforms of a pipeline carrying the rounded clip snippet from
+ * shader.h, @bounds is in pixels of an actor sized @width x @height.
+ * Shared with MetaShapedTexture, which applies the snippet directly.
+ */
+void meta_clip_effect_setup_pipeline(CoglPipeline                *pipeline,
+                                     MetaRoundedClipUniforms     *uniforms,
+                                     const cairo_rectangle_int_t *bounds,
+                                     float                        radius,
+                                     float                        width,
+                                     float                        height);
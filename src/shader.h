@@ -73,27 +73,35 @@
 "  return 1.0 - dot(vec4(is_out), corner_coverages);                      \n"\
 "}                                                                        \n"
 
+/*
+ * All parameters are packed into one array, so that they are updated at
+ * once, see meta_clip_effect_setup_pipeline():
+ *   [0] bounds: x, y: top left; w, v: bottom right
+ *   [1] corner_centers_1: x, y: top left; w, v: top right
+ *   [2] corner_centers_2: x, y: bottom right; w, v: bottom left
+ *   [3] inner_bounds, the bounds without the border
+ *   [4] x, y: pixel_step; z: border_width; w: border_brightness
+ */
 #define ROUNDED_CLIP_FRAGMENT_SHADER_VARS                                    \
-"uniform vec4 bounds;           // x, y: top left; w, v: bottom right     \n"\
-"uniform vec4 corner_centers_1; // x, y: top left; w, v: top right        \n"\
-"uniform vec4 corner_centers_2; // x, y: bottom right; w, v: bottom left  \n"\
-"uniform vec4 inner_bounds;                                               \n"\
-"uniform vec4 inner_corner_centers_1;                                     \n"\
-"uniform vec4 inner_corner_centers_2;                                     \n"\
-"uniform vec2 pixel_step;                                                 \n"\
-"uniform int skip;                                                        \n"\
-"uniform float border_width;                                              \n"\
-"uniform float border_brightness;                                         \n"
+"uniform vec4 clip_params[5];                                             \n"\
+"uniform int skip;                                                        \n"
 
 /* used by src/meta_clip_effect.c  */
 #define ROUNDED_CLIP_FRAGMENT_SHADER_DECLARATIONS                            \
 ROUNDED_CLIP_FRAGMENT_SHADER_VARS                                            \
 ROUNDED_CLIP_FRAGMENT_SHADER_FUNCS
 
-/* used by src/meta_clip_effect.c  */
-#define ROUNDED_CLIP_FRAGMENT_SHADER_CODE                                    \
-"if (skip == 0) {                                                         \n"\
-"  vec2 texture_coord = cogl_tex_coord0_in.xy / pixel_step;               \n"\
+/*
+ * Expects the fragment position in pixels as `texture_coord`, see
+ * ROUNDED_CLIP_FRAGMENT_SHADER_CODE and ROUNDED_CLIP_FRAGMENT_SHADER_CODE_DIRECT
+ */
+#define ROUNDED_CLIP_FRAGMENT_SHADER_COVERAGE                                \
+"  vec4 bounds = clip_params[0];                                          \n"\
+"  vec4 corner_centers_1 = clip_params[1];                                \n"\
+"  vec4 corner_centers_2 = clip_params[2];                                \n"\
+"  vec4 inner_bounds = clip_params[3];                                    \n"\
+"  float border_width = clip_params[4].z;                                 \n"\
+"  float border_brightness = clip_params[4].w;                            \n"\
 "                                                                         \n"\
 "  float outer_alpha = rounded_rect_coverage (bounds,                     \n"\
 "                                             corner_centers_1,           \n"\
@@ -101,8 +109,8 @@ ROUNDED_CLIP_FRAGMENT_SHADER_FUNCS
 "                                             texture_coord);             \n"\
 "  if (border_width > 0.0) {                                              \n"\
 "    float inner_alpha = rounded_rect_coverage (inner_bounds,             \n"\
-"                                               inner_corner_centers_1,   \n"\
-"                                               inner_corner_centers_2,   \n"\
+"                                               corner_centers_1,         \n"\
+"                                               corner_centers_2,         \n"\
 "                                               texture_coord);           \n"\
 "    float border_alpha = clamp (outer_alpha - inner_alpha, 0.0, 1.0)     \n"\
 "                       * cogl_color_out.a;                               \n"\
@@ -113,9 +121,53 @@ ROUNDED_CLIP_FRAGMENT_SHADER_FUNCS
 "                          border_alpha);                                 \n"\
 "  } else {                                                               \n"\
 "    cogl_color_out = cogl_color_out * outer_alpha;                       \n"\
-"  }                                                                      \n"\
+"  }                                                                      \n"
+
+/* used by src/meta_clip_effect.c  */
+#define ROUNDED_CLIP_FRAGMENT_SHADER_CODE                                    \
+"if (skip == 0) {                                                         \n"\
+"  vec2 texture_coord = cogl_tex_coord0_in.xy / clip_params[4].xy;        \n"\
+"                                                                         \n"\
+ROUNDED_CLIP_FRAGMENT_SHADER_COVERAGE                                        \
+"}                                                                        \n"
+
+/*
+ * used by src/compositor/meta-shaped-texture.c, which paints the window
+ * texture directly instead of going through an offscreen buffer. The
+ * texture coordinates of layer 0 are transformed by the layer matrix
+ * (y-inversion, buffer transform, viewport), so the untransformed
+ * coordinates are passed down from the vertex shader instead.
+ */
+#define ROUNDED_CLIP_VERTEX_SHADER_DECLARATIONS_DIRECT                       \
+"uniform vec4 clip_params[5];                                             \n"\
+"varying vec2 rounded_clip_position;                                      \n"
+
+#define ROUNDED_CLIP_VERTEX_SHADER_CODE_DIRECT                               \
+"rounded_clip_position = cogl_tex_coord0_in.xy / clip_params[4].xy;       \n"
+
+#define ROUNDED_CLIP_FRAGMENT_SHADER_DECLARATIONS_DIRECT                     \
+ROUNDED_CLIP_FRAGMENT_SHADER_VARS                                            \
+"varying vec2 rounded_clip_position;                                      \n"\
+ROUNDED_CLIP_FRAGMENT_SHADER_FUNCS
+
+#define ROUNDED_CLIP_FRAGMENT_SHADER_CODE_DIRECT                             \
+"if (skip == 0) {                                                         \n"\
+"  vec2 texture_coord = rounded_clip_position;                            \n"\
+"                                                                         \n"\
+ROUNDED_CLIP_FRAGMENT_SHADER_COVERAGE                                        \
 "}                                                                        \n"
 
+/*
+ * used by src/compositor/meta-shaped-texture.c for the corner patches of
+ * opaque windows, with the pre-rendered corner mask from the shadow
+ * factory on layer 1: red is what's left of the window, green the border
+ * coverage and blue the premultiplied border color.
+ */
+#define ROUNDED_CLIP_FRAGMENT_SHADER_CODE_MASK                               \
+"vec4 corner_mask = texture2D (cogl_sampler1, cogl_tex_coord1_in.st);     \n"\
+"cogl_color_out = cogl_color_out * corner_mask.r                          \n"\
+"               + vec4 (vec3 (corner_mask.b), corner_mask.g);             \n"
+
 #define ROUNDED_CLIP_FRAGMENT_SHADER_VARS_BLUR                               \
 "uniform vec4 bounds;           // x, y: top left; w, v: bottom right     \n"\
 "uniform vec4 corner_centers_1; // x, y: top left; w, v: top right        \n"\
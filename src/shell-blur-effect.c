@@ -22,6 +22,9 @@
 
 #include "shell-enum-types.h"
 
+#include "clutter/clutter-mutter.h"
+#include "compositor/meta-cullable.h"
+#include "meta/boxes.h"
 #include "meta/prefs.h"
 #include "shader.h"
 
@@ -39,13 +42,31 @@
  * background mode blurs the pixels beneath the actor, but not the actor itself.
  *
  * @SHELL_BLUR_MODE_BACKGROUND can be computationally expensive, since the contents
- * beneath the actor cannot be cached, so beware of the performance implications
- * of using this blur mode.
+ * beneath the actor have to be blurred again whenever they change, so beware of
+ * the performance implications of using this blur mode. The blurred background
+ * is reused as long as the stage damage history shows no damage to actors
+ * painted beneath the actor within its area.
+ *
+ * Background blurs with the same parameters painted onto the same stage view
+ * share a single blur pass when nothing painted in between them would show
+ * up in their blurred backgrounds. The background of all of them is then
+ * blitted and blurred at once, when the first of them is painted, and each
+ * one only samples its own part of the result.
  */
 
 #define MIN_DOWNSCALE_SIZE 256.f
 #define MAX_SIGMA 6.f
 
+/* How far, in multiples of sigma, the blur reads around a pixel */
+#define BLUR_EXTENT_FACTOR 3.f
+
+/* Blurring the union of a group may at most cost this much more than
+ * blurring each background on its own.
+ */
+#define MAX_SHARED_AREA_RATIO 2.f
+
+#define SHARED_BLUR_DATA_KEY "meta-shell-blur-shared"
+
 typedef enum
 {
   ACTOR_PAINTED = 1 << 0,
@@ -59,6 +80,8 @@ typedef struct
   CoglTexture *texture;
 } FramebufferData;
 
+typedef struct _SharedBlurGroup SharedBlurGroup;
+
 struct _MetaShellBlurEffect
 {
   ClutterEffect parent_instance;
@@ -82,19 +105,37 @@ struct _MetaShellBlurEffect
   int skip_uniform;
   gboolean skip;
 
+  /* What the cached blurred background was painted from */
+  ClutterStage *damage_stage;
+  uint64_t damage_serial;
+  ClutterStageView *background_view;
+  CoglFramebuffer *background_framebuffer;
+  ClutterActorBox background_box;
+
+  /* The shared blur pass this background is part of, for the current frame */
+  gboolean registered;
+  SharedBlurGroup *shared_group;
+  unsigned int shared_index;
+
   ShellBlurMode mode;
+  ClutterBlurAlgorithm algorithm;
   float downscale_factor;
   float brightness;
   int sigma;
 };
 
-G_DEFINE_TYPE (MetaShellBlurEffect, meta_shell_blur_effect, CLUTTER_TYPE_EFFECT)
+static void cullable_effect_iface_init (MetaCullableEffectInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (MetaShellBlurEffect, meta_shell_blur_effect, CLUTTER_TYPE_EFFECT,
+                         G_IMPLEMENT_INTERFACE (META_TYPE_CULLABLE_EFFECT,
+                                                cullable_effect_iface_init))
 
 enum {
   PROP_0,
   PROP_SIGMA,
   PROP_BRIGHTNESS,
   PROP_MODE,
+  PROP_ALGORITHM,
   N_PROPS
 };
 
@@ -147,8 +188,11 @@ create_brightness_pipeline (void)
 
 
 static void
-update_brightness (MetaShellBlurEffect *self,
-                   uint8_t          paint_opacity)
+update_brightness_for_area (MetaShellBlurEffect   *self,
+                            uint8_t                paint_opacity,
+                            const graphene_rect_t *area,
+                            float                  texture_width,
+                            float                  texture_height)
 {
   cogl_pipeline_set_color4ub (self->brightness_fb.pipeline,
                               paint_opacity,
@@ -166,23 +210,25 @@ update_brightness (MetaShellBlurEffect *self,
       if (self->skip)
         return;
 
-      float width  = self->tex_width;
-      float height = self->tex_height;
+      float x1 = area->origin.x;
+      float y1 = area->origin.y;
+      float x2 = area->origin.x + area->size.width;
+      float y2 = area->origin.y + area->size.height;
       float radius = meta_prefs_get_round_corner_radius();
-      float bounds[] = { 0.0, 0.0, width, height };
+      float bounds[] = { x1, y1, x2, y2 };
       float corner_centers_1[] = {
-        radius,
-        radius,
-        width - radius,
-        radius
+        x1 + radius,
+        y1 + radius,
+        x2 - radius,
+        y1 + radius
       };
       float corner_centers_2[] = {
-        width - radius,
-        height - radius,
-        radius,
-        height - radius
+        x2 - radius,
+        y2 - radius,
+        x1 + radius,
+        y2 - radius
       };
-      float pixel_step[] = { 1.0 / width, 1.0 / height };
+      float pixel_step[] = { 1.0 / texture_width, 1.0 / texture_height };
 
       cogl_pipeline_set_uniform_float (self->brightness_fb.pipeline,
                                       self->bounds_uniform,
@@ -199,6 +245,23 @@ update_brightness (MetaShellBlurEffect *self,
     }
 }
 
+static void
+update_brightness (MetaShellBlurEffect *self,
+                   uint8_t          paint_opacity)
+{
+  /* The layer might still point at the texture of a shared blur pass */
+  if (self->brightness_fb.texture)
+    cogl_pipeline_set_layer_texture (self->brightness_fb.pipeline, 0,
+                                     self->brightness_fb.texture);
+
+  update_brightness_for_area (self, paint_opacity,
+                              &GRAPHENE_RECT_INIT (0.f, 0.f,
+                                                   self->tex_width,
+                                                   self->tex_height),
+                              self->tex_width,
+                              self->tex_height);
+}
+
 static void
 setup_projection_matrix (CoglFramebuffer *framebuffer,
                          float            width,
@@ -337,6 +400,52 @@ calculate_downscale_factor (float width,
   return downscale_factor;
 }
 
+static void
+untrack_background_damage (MetaShellBlurEffect *self)
+{
+  if (self->damage_stage)
+    clutter_stage_untrack_damage_history (self->damage_stage);
+
+  g_clear_weak_pointer (&self->damage_stage);
+  g_clear_weak_pointer (&self->background_view);
+  g_clear_weak_pointer (&self->background_framebuffer);
+}
+
+/* Background blur effects */
+static GList *background_blur_effects = NULL;
+
+/* SharedBlur of each view painting background blur effects */
+static GList *shared_blurs = NULL;
+
+static void
+leave_shared_group (MetaShellBlurEffect *self);
+
+static void
+drop_shared_blurs (void);
+
+static void
+update_registration (MetaShellBlurEffect *self)
+{
+  gboolean registered;
+
+  registered = self->actor && self->mode == SHELL_BLUR_MODE_BACKGROUND;
+  if (self->registered == registered)
+    return;
+
+  if (registered)
+    {
+      background_blur_effects = g_list_prepend (background_blur_effects, self);
+    }
+  else
+    {
+      background_blur_effects = g_list_remove (background_blur_effects, self);
+      leave_shared_group (self);
+      drop_shared_blurs ();
+    }
+
+  self->registered = registered;
+}
+
 static void
 shell_blur_effect_set_actor (ClutterActorMeta *meta,
                              ClutterActor     *actor)
@@ -351,54 +460,80 @@ shell_blur_effect_set_actor (ClutterActorMeta *meta,
   clear_framebuffer_data (&self->actor_fb);
   clear_framebuffer_data (&self->background_fb);
   clear_framebuffer_data (&self->brightness_fb);
+  self->cache_flags &= ~BLUR_APPLIED;
+  untrack_background_damage (self);
 
   /* we keep a back pointer here, to avoid going through the ActorMeta */
   self->actor = clutter_actor_meta_get_actor (meta);
+
+  update_registration (self);
 }
 
 static void
-update_actor_box (MetaShellBlurEffect     *self,
-                  ClutterPaintContext *paint_context,
-                  ClutterActorBox     *source_actor_box)
+get_background_box (ClutterActor     *actor,
+                    ClutterStageView *stage_view,
+                    ClutterActorBox  *box)
 {
-  ClutterStageView *stage_view;
   float box_scale_factor = 1.0f;
   float origin_x, origin_y;
   float width, height;
 
-  switch (self->mode)
+  clutter_actor_get_transformed_position (actor, &origin_x, &origin_y);
+  clutter_actor_get_transformed_size (actor, &width, &height);
+
+  if (stage_view)
     {
-    case SHELL_BLUR_MODE_ACTOR:
-      clutter_actor_get_allocation_box (self->actor, source_actor_box);
-      break;
+      cairo_rectangle_int_t stage_view_layout;
 
-    case SHELL_BLUR_MODE_BACKGROUND:
-      stage_view = clutter_paint_context_get_stage_view (paint_context);
+      box_scale_factor = clutter_stage_view_get_scale (stage_view);
+      clutter_stage_view_get_layout (stage_view, &stage_view_layout);
 
-      clutter_actor_get_transformed_position (self->actor, &origin_x, &origin_y);
-      clutter_actor_get_transformed_size (self->actor, &width, &height);
+      origin_x -= stage_view_layout.x;
+      origin_y -= stage_view_layout.y;
+    }
+  else
+    {
+      /* If we're drawing off stage, just assume scale = 1, this won't work
+       * with stage-view scaling though.
+       */
+    }
 
-      if (stage_view)
-        {
-          cairo_rectangle_int_t stage_view_layout;
+  clutter_actor_box_set_origin (box, origin_x, origin_y);
+  clutter_actor_box_set_size (box, width, height);
 
-          box_scale_factor = clutter_stage_view_get_scale (stage_view);
-          clutter_stage_view_get_layout (stage_view, &stage_view_layout);
+  clutter_actor_box_scale (box, box_scale_factor);
+}
 
-          origin_x -= stage_view_layout.x;
-          origin_y -= stage_view_layout.y;
-        }
-      else
-        {
-          /* If we're drawing off stage, just assume scale = 1, this won't work
-           * with stage-view scaling though.
-           */
-        }
+static void
+get_stage_rect (ClutterActor          *actor,
+                cairo_rectangle_int_t *rect)
+{
+  float x, y, width, height;
+
+  clutter_actor_get_transformed_position (actor, &x, &y);
+  clutter_actor_get_transformed_size (actor, &width, &height);
+
+  rect->x = floorf (x);
+  rect->y = floorf (y);
+  rect->width = ceilf (x + width) - rect->x;
+  rect->height = ceilf (y + height) - rect->y;
+}
 
-      clutter_actor_box_set_origin (source_actor_box, origin_x, origin_y);
-      clutter_actor_box_set_size (source_actor_box, width, height);
+static void
+update_actor_box (MetaShellBlurEffect     *self,
+                  ClutterPaintContext *paint_context,
+                  ClutterActorBox     *source_actor_box)
+{
+  switch (self->mode)
+    {
+    case SHELL_BLUR_MODE_ACTOR:
+      clutter_actor_get_allocation_box (self->actor, source_actor_box);
+      break;
 
-      clutter_actor_box_scale (source_actor_box, box_scale_factor);
+    case SHELL_BLUR_MODE_BACKGROUND:
+      get_background_box (self->actor,
+                          clutter_paint_context_get_stage_view (paint_context),
+                          source_actor_box);
       break;
     }
 
@@ -455,9 +590,10 @@ create_blur_nodes (MetaShellBlurEffect  *self,
                                       width, height,
                                     });
 
-  blur_node = clutter_blur_node_new (self->tex_width / self->downscale_factor,
-                                     self->tex_height / self->downscale_factor,
-                                     self->sigma / self->downscale_factor);
+  blur_node = clutter_blur_node_new_with_algorithm (self->tex_width / self->downscale_factor,
+                                                    self->tex_height / self->downscale_factor,
+                                                    self->sigma / self->downscale_factor,
+                                                    self->algorithm);
   clutter_paint_node_set_static_name (blur_node, "ShellBlurEffect (blur)");
   clutter_paint_node_add_child (brightness_node, blur_node);
   clutter_paint_node_add_rectangle (blur_node,
@@ -531,7 +667,13 @@ update_framebuffers (MetaShellBlurEffect     *self,
 
   clutter_actor_box_get_size (source_actor_box, &width, &height);
 
-  downscale_factor = calculate_downscale_factor (width, height, self->sigma);
+  /* The dual kawase blur downscales by itself, and benefits from starting
+   * off the full resolution contents.
+   */
+  if (self->algorithm == CLUTTER_BLUR_ALGORITHM_DUAL_KAWASE)
+    downscale_factor = 1.f;
+  else
+    downscale_factor = calculate_downscale_factor (width, height, self->sigma);
 
   updated = update_actor_fbo (self, width, height, downscale_factor) &&
             update_brightness_fbo (self, width, height, downscale_factor);
@@ -616,189 +758,1188 @@ paint_actor_offscreen (MetaShellBlurEffect         *self,
     }
 }
 
+typedef struct
+{
+  ClutterActor *actor;
+  cairo_rectangle_int_t area;
+  gboolean damaged;
+} BackgroundDamage;
+
 static gboolean
-needs_repaint (MetaShellBlurEffect         *self,
-               ClutterEffectPaintFlags  flags)
+is_painted_before (ClutterActor *actor,
+                   ClutterActor *reference)
 {
-  gboolean actor_cached;
-  gboolean blur_cached;
-  gboolean actor_dirty;
+  ClutterActor *reference_branch;
 
-  actor_dirty = (flags & CLUTTER_EFFECT_PAINT_ACTOR_DIRTY) != 0;
-  blur_cached = (self->cache_flags & BLUR_APPLIED) != 0;
-  actor_cached = (self->cache_flags & ACTOR_PAINTED) != 0;
+  if (actor == reference)
+    return FALSE;
 
-  switch (self->mode)
+  /* Ancestors paint themselves before their children */
+  if (clutter_actor_contains (actor, reference))
+    return TRUE;
+
+  if (clutter_actor_contains (reference, actor))
+    return FALSE;
+
+  /* Find the closest common ancestor, and compare the paint order of the
+   * children of it leading to each actor.
+   */
+  for (reference_branch = reference;
+       clutter_actor_get_parent (reference_branch);
+       reference_branch = clutter_actor_get_parent (reference_branch))
     {
-    case SHELL_BLUR_MODE_ACTOR:
-      return actor_dirty || !blur_cached || !actor_cached;
+      ClutterActor *parent = clutter_actor_get_parent (reference_branch);
+      ClutterActor *actor_branch;
+      ClutterActor *sibling;
 
-    case SHELL_BLUR_MODE_BACKGROUND:
-      return TRUE;
+      if (!clutter_actor_contains (parent, actor))
+        continue;
+
+      actor_branch = actor;
+      while (clutter_actor_get_parent (actor_branch) != parent)
+        actor_branch = clutter_actor_get_parent (actor_branch);
+
+      for (sibling = clutter_actor_get_next_sibling (actor_branch);
+           sibling;
+           sibling = clutter_actor_get_next_sibling (sibling))
+        {
+          if (sibling == reference_branch)
+            return TRUE;
+        }
+
+      return FALSE;
     }
 
+  /* Not part of the same scene graph, assume the worst */
   return TRUE;
 }
 
 static void
-shell_blur_effect_paint_node (ClutterEffect           *effect,
-                              ClutterPaintNode        *node,
-                              ClutterPaintContext     *paint_context,
-                              ClutterEffectPaintFlags  flags)
+check_background_damage (ClutterActor                *actor,
+                         const cairo_rectangle_int_t *rect,
+                         gpointer                     user_data)
 {
-  MetaShellBlurEffect *self = META_SHELL_BLUR_EFFECT (effect);
-  uint8_t paint_opacity;
-
-  g_assert (self->actor != NULL);
-
-  if (self->sigma > 0)
-    {
-      g_autoptr (ClutterPaintNode) blur_node = NULL;
+  BackgroundDamage *damage = user_data;
 
-      switch (self->mode)
-        {
-        case SHELL_BLUR_MODE_ACTOR:
-          paint_opacity = clutter_actor_get_paint_opacity (self->actor);
-          break;
+  if (damage->damaged)
+    return;
 
-        case SHELL_BLUR_MODE_BACKGROUND:
-          paint_opacity = 255;
-          break;
+  if (rect &&
+      (rect->x >= damage->area.x + damage->area.width ||
+       rect->y >= damage->area.y + damage->area.height ||
+       rect->x + rect->width <= damage->area.x ||
+       rect->y + rect->height <= damage->area.y))
+    return;
 
-        default:
-          g_assert_not_reached();
-          break;
-        }
+  if (actor && !is_painted_before (actor, damage->actor))
+    return;
 
-      if (needs_repaint (self, flags))
-        {
-          ClutterActorBox source_actor_box;
+  damage->damaged = TRUE;
+}
 
-          update_actor_box (self, paint_context, &source_actor_box);
+static gboolean
+is_background_cached (MetaShellBlurEffect *self,
+                      ClutterPaintContext *paint_context)
+{
+  ClutterActor *stage;
+  ClutterActorBox source_actor_box;
+  BackgroundDamage damage = { 0, };
 
-          /* Failing to create or update the offscreen framebuffers prevents
-           * the entire effect to be applied.
-           */
-          if (!update_framebuffers (self, paint_context, &source_actor_box))
-            goto fail;
+  stage = clutter_actor_get_stage (self->actor);
 
-          blur_node = create_blur_nodes (self, node, paint_opacity);
+  if (!self->damage_stage ||
+      stage != CLUTTER_ACTOR (self->damage_stage) ||
+      !self->background_view ||
+      self->background_view != clutter_paint_context_get_stage_view (paint_context) ||
+      self->background_framebuffer != clutter_paint_context_get_framebuffer (paint_context))
+    return FALSE;
 
-          switch (self->mode)
-            {
-            case SHELL_BLUR_MODE_ACTOR:
-              paint_actor_offscreen (self, blur_node, flags);
-              break;
+  update_actor_box (self, paint_context, &source_actor_box);
+  if (!clutter_actor_box_equal (&source_actor_box, &self->background_box))
+    return FALSE;
 
-            case SHELL_BLUR_MODE_BACKGROUND:
-              paint_background (self, blur_node, paint_context, &source_actor_box);
-              break;
-            }
-        }
-      else
-        {
-          /* Use the cached pipeline if no repaint is needed */
-          add_blurred_pipeline (self, node, paint_opacity);
-        }
+  damage.actor = self->actor;
+  get_stage_rect (self->actor, &damage.area);
 
-      /* Background blur needs to paint the actor after painting the blurred
-       * background.
-       */
-      switch (self->mode)
-        {
-        case SHELL_BLUR_MODE_ACTOR:
-          break;
+  if (!clutter_stage_foreach_damage_since (self->damage_stage,
+                                           self->damage_serial,
+                                           check_background_damage,
+                                           &damage))
+    return FALSE;
 
-        case SHELL_BLUR_MODE_BACKGROUND:
-          add_actor_node (self, node, -1);
-          break;
-        }
+  if (damage.damaged)
+    return FALSE;
 
-      return;
-    }
+  self->damage_serial = clutter_stage_get_damage_serial (self->damage_stage);
 
-fail:
-  /* When no blur is applied, or the offscreen framebuffers
-   * couldn't be created, fallback to simply painting the actor.
-   */
-  add_actor_node (self, node, -1);
+  return TRUE;
 }
 
-static void
-shell_blur_effect_finalize (GObject *object)
+static gboolean
+redraw_clip_contains (ClutterPaintContext         *paint_context,
+                      const cairo_rectangle_int_t *rect)
 {
-  MetaShellBlurEffect *self = (MetaShellBlurEffect *)object;
-
-  clear_framebuffer_data (&self->actor_fb);
-  clear_framebuffer_data (&self->background_fb);
-  clear_framebuffer_data (&self->brightness_fb);
+  const cairo_region_t *redraw_clip;
 
-  g_clear_pointer (&self->actor_fb.pipeline, cogl_object_unref);
-  g_clear_pointer (&self->background_fb.pipeline, cogl_object_unref);
-  g_clear_pointer (&self->brightness_fb.pipeline, cogl_object_unref);
+  redraw_clip = clutter_paint_context_get_redraw_clip (paint_context);
+  if (!redraw_clip)
+    return TRUE;
 
-  G_OBJECT_CLASS (meta_shell_blur_effect_parent_class)->finalize (object);
+  return cairo_region_contains_rectangle ((cairo_region_t *) redraw_clip,
+                                          rect) == CAIRO_REGION_OVERLAP_IN;
 }
 
 static void
-shell_blur_effect_get_property (GObject    *object,
-                                guint       prop_id,
-                                GValue     *value,
-                                GParamSpec *pspec)
+remember_background (MetaShellBlurEffect *self,
+                     ClutterPaintContext *paint_context,
+                     ClutterActorBox     *source_actor_box)
 {
-  MetaShellBlurEffect *self = META_SHELL_BLUR_EFFECT (object);
+  ClutterActor *stage;
+  cairo_rectangle_int_t stage_rect;
 
-  switch (prop_id)
+  stage = clutter_actor_get_stage (self->actor);
+
+  if (stage != CLUTTER_ACTOR (self->damage_stage))
     {
-    case PROP_SIGMA:
-      g_value_set_int (value, self->sigma);
-      break;
+      untrack_background_damage (self);
 
-    case PROP_BRIGHTNESS:
-      g_value_set_float (value, self->brightness);
-      break;
+      if (stage)
+        {
+          g_set_weak_pointer (&self->damage_stage, CLUTTER_STAGE (stage));
+          clutter_stage_track_damage_history (self->damage_stage);
+        }
+    }
 
-    case PROP_MODE:
-      g_value_set_enum (value, self->mode);
-      break;
+  if (!self->damage_stage)
+    return;
 
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+  /* Whatever lies outside of the redraw clip wasn't painted this frame, so
+   * the blurred background isn't valid beyond this frame.
+   */
+  get_stage_rect (self->actor, &stage_rect);
+  if (!redraw_clip_contains (paint_context, &stage_rect))
+    {
+      g_clear_weak_pointer (&self->background_view);
+      return;
     }
+
+  self->damage_serial = clutter_stage_get_damage_serial (self->damage_stage);
+  self->background_box = *source_actor_box;
+  g_set_weak_pointer (&self->background_view,
+                      clutter_paint_context_get_stage_view (paint_context));
+  g_set_weak_pointer (&self->background_framebuffer,
+                      clutter_paint_context_get_framebuffer (paint_context));
 }
 
-static void
-shell_blur_effect_set_property (GObject      *object,
-                                guint         prop_id,
-                                const GValue *value,
-                                GParamSpec   *pspec)
+typedef struct _SharedBlur SharedBlur;
+
+typedef struct
 {
-  MetaShellBlurEffect *self = META_SHELL_BLUR_EFFECT (object);
+  MetaShellBlurEffect *effect;
 
-  switch (prop_id)
-    {
-    case PROP_SIGMA:
-      meta_shell_blur_effect_set_sigma (self, g_value_get_int (value));
-      break;
+  /* In view framebuffer pixels */
+  ClutterActorBox box;
+} SharedBlurMember;
 
-    case PROP_BRIGHTNESS:
-      meta_shell_blur_effect_set_brightness (self, g_value_get_float (value));
-      break;
+struct _SharedBlurGroup
+{
+  SharedBlur *shared;
 
-    case PROP_MODE:
-      meta_shell_blur_effect_set_mode (self, g_value_get_enum (value));
-      break;
+  /* SharedBlurMember, in paint order */
+  GArray *members;
+  float members_area;
 
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
-    }
-}
+  /* Union of all members, in view framebuffer pixels and stage coordinates */
+  ClutterActorBox box;
+  cairo_rectangle_int_t stage_rect;
 
-static void
-meta_shell_blur_effect_class_init (MetaShellBlurEffectClass *klass)
-{
-  GObjectClass *object_class = G_OBJECT_CLASS (klass);
-  ClutterActorMetaClass *meta_class = CLUTTER_ACTOR_META_CLASS (klass);
+  int sigma;
+  ClutterBlurAlgorithm algorithm;
+
+  float fb_width;
+  float fb_height;
+  float downscale_factor;
+  FramebufferData background_fb;
+  FramebufferData blurred_fb;
+
+  /* Whether blurred_fb was updated during this frame */
+  gboolean blurred;
+  /* Whether blurred_fb still holds the current blurred background */
+  gboolean cached;
+};
+
+struct _SharedBlur
+{
+  ClutterStageView *view;
+  ClutterStage *stage;
+  gulong before_paint_handler_id;
+  gulong after_paint_handler_id;
+
+  gboolean in_frame;
+  uint64_t damage_serial;
+  GPtrArray *groups;
+};
+
+static void
+leave_shared_group (MetaShellBlurEffect *self)
+{
+  SharedBlurGroup *group = self->shared_group;
+
+  if (!group)
+    return;
+
+  g_array_index (group->members, SharedBlurMember, self->shared_index).effect = NULL;
+  group->cached = FALSE;
+  self->shared_group = NULL;
+}
+
+static SharedBlurGroup *
+shared_blur_group_new (SharedBlur          *shared,
+                       MetaShellBlurEffect *effect)
+{
+  SharedBlurGroup *group;
+
+  group = g_new0 (SharedBlurGroup, 1);
+  group->shared = shared;
+  group->members = g_array_new (FALSE, FALSE, sizeof (SharedBlurMember));
+  group->sigma = effect->sigma;
+  group->algorithm = effect->algorithm;
+  group->background_fb.pipeline = create_base_pipeline ();
+  group->blurred_fb.pipeline = create_base_pipeline ();
+
+  return group;
+}
+
+static void
+shared_blur_group_free (SharedBlurGroup *group)
+{
+  unsigned int i;
+
+  for (i = 0; i < group->members->len; i++)
+    {
+      SharedBlurMember *member =
+        &g_array_index (group->members, SharedBlurMember, i);
+
+      if (member->effect && member->effect->shared_group == group)
+        member->effect->shared_group = NULL;
+    }
+
+  g_array_unref (group->members);
+
+  clear_framebuffer_data (&group->background_fb);
+  clear_framebuffer_data (&group->blurred_fb);
+  g_clear_pointer (&group->background_fb.pipeline, cogl_object_unref);
+  g_clear_pointer (&group->blurred_fb.pipeline, cogl_object_unref);
+
+  g_free (group);
+}
+
+static void
+shared_blur_group_add (SharedBlurGroup       *group,
+                       MetaShellBlurEffect   *effect,
+                       const ClutterActorBox *box)
+{
+  SharedBlurMember member = { effect, *box };
+  cairo_rectangle_int_t stage_rect;
+
+  get_stage_rect (effect->actor, &stage_rect);
+
+  if (group->members->len == 0)
+    {
+      group->box = *box;
+      group->stage_rect = stage_rect;
+    }
+  else
+    {
+      clutter_actor_box_union (&group->box, box, &group->box);
+      meta_rectangle_union (&group->stage_rect, &stage_rect, &group->stage_rect);
+    }
+
+  group->members_area += clutter_actor_box_get_area (box);
+  g_array_append_val (group->members, member);
+}
+
+static int
+get_blur_extent (int sigma)
+{
+  return ceilf (sigma * BLUR_EXTENT_FACTOR);
+}
+
+/* State of the single pass over the stage in paint order, grouping the
+ * background blur effects of a view.
+ */
+typedef struct _RegroupState
+{
+  SharedBlur *shared;
+  /* ClutterActor -> MetaShellBlurEffect of the shareable effects */
+  GHashTable *candidates;
+  /* Actors containing one of the candidates */
+  GHashTable *branches;
+
+  SharedBlurGroup *group;
+  /* Painted since the first member of the current group */
+  cairo_region_t *painted;
+  gboolean painted_unbounded;
+} RegroupState;
+
+static gboolean
+can_join_group (RegroupState          *state,
+                MetaShellBlurEffect   *effect,
+                const ClutterActorBox *box)
+{
+  SharedBlurGroup *group = state->group;
+  ClutterActorBox union_box;
+  cairo_rectangle_int_t rect;
+  int extent;
+
+  if (effect->sigma != group->sigma || effect->algorithm != group->algorithm)
+    return FALSE;
+
+  clutter_actor_box_union (&group->box, box, &union_box);
+  if (clutter_actor_box_get_area (&union_box) >
+      MAX_SHARED_AREA_RATIO * (group->members_area +
+                               clutter_actor_box_get_area (box)))
+    return FALSE;
+
+  /* Anything painted after the group background was blitted, and visible in
+   * the blurred background of this actor, would be missing from it.
+   */
+  if (state->painted_unbounded)
+    return FALSE;
+
+  extent = get_blur_extent (effect->sigma);
+  get_stage_rect (effect->actor, &rect);
+  rect.x -= extent;
+  rect.y -= extent;
+  rect.width += 2 * extent;
+  rect.height += 2 * extent;
+
+  return cairo_region_contains_rectangle (state->painted, &rect) ==
+         CAIRO_REGION_OVERLAP_OUT;
+}
+
+static void
+mark_painted (RegroupState *state,
+              ClutterActor *actor)
+{
+  ClutterActorBox paint_box;
+  cairo_rectangle_int_t rect;
+
+  if (!state->group || !clutter_actor_is_visible (actor))
+    return;
+
+  if (!clutter_actor_get_paint_box (actor, &paint_box))
+    {
+      state->painted_unbounded = TRUE;
+      return;
+    }
+
+  rect.x = floorf (paint_box.x1);
+  rect.y = floorf (paint_box.y1);
+  rect.width = ceilf (paint_box.x2) - rect.x;
+  rect.height = ceilf (paint_box.y2) - rect.y;
+  cairo_region_union_rectangle (state->painted, &rect);
+}
+
+static void
+add_candidate (RegroupState        *state,
+               MetaShellBlurEffect *effect)
+{
+  SharedBlur *shared = state->shared;
+  ClutterActorBox box;
+
+  get_background_box (effect->actor, shared->view, &box);
+  clutter_actor_box_clamp_to_pixel (&box);
+
+  if (state->group && can_join_group (state, effect, &box))
+    {
+      shared_blur_group_add (state->group, effect, &box);
+      mark_painted (state, effect->actor);
+      return;
+    }
+
+  state->group = shared_blur_group_new (shared, effect);
+  g_ptr_array_add (shared->groups, state->group);
+  shared_blur_group_add (state->group, effect, &box);
+
+  g_clear_pointer (&state->painted, cairo_region_destroy);
+  state->painted = cairo_region_create ();
+  state->painted_unbounded = FALSE;
+}
+
+static void
+regroup_actor (RegroupState *state,
+               ClutterActor *actor)
+{
+  MetaShellBlurEffect *effect;
+  ClutterActor *child;
+
+  effect = g_hash_table_lookup (state->candidates, actor);
+  if (effect)
+    {
+      add_candidate (state, effect);
+      return;
+    }
+
+  /* Nothing inside is blurred, so only whether it's painted matters */
+  if (!g_hash_table_contains (state->branches, actor))
+    {
+      mark_painted (state, actor);
+      return;
+    }
+
+  for (child = clutter_actor_get_first_child (actor);
+       child;
+       child = clutter_actor_get_next_sibling (child))
+    regroup_actor (state, child);
+}
+
+static gboolean
+is_same_group (SharedBlurGroup *group,
+               SharedBlurGroup *old_group)
+{
+  unsigned int i;
+
+  if (group->members->len != old_group->members->len ||
+      group->sigma != old_group->sigma ||
+      group->algorithm != old_group->algorithm ||
+      !clutter_actor_box_equal (&group->box, &old_group->box))
+    return FALSE;
+
+  for (i = 0; i < group->members->len; i++)
+    {
+      SharedBlurMember *member =
+        &g_array_index (group->members, SharedBlurMember, i);
+      SharedBlurMember *old_member =
+        &g_array_index (old_group->members, SharedBlurMember, i);
+
+      if (member->effect != old_member->effect ||
+          !clutter_actor_box_equal (&member->box, &old_member->box))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+adopt_old_group (SharedBlur      *shared,
+                 SharedBlurGroup *group,
+                 GPtrArray       *old_groups)
+{
+  SharedBlurMember *first =
+    &g_array_index (group->members, SharedBlurMember, 0);
+  unsigned int i;
+
+  for (i = 0; i < old_groups->len; i++)
+    {
+      SharedBlurGroup *old_group = g_ptr_array_index (old_groups, i);
+      SharedBlurMember *old_first;
+      FramebufferData background_fb;
+      FramebufferData blurred_fb;
+
+      if (old_group->members->len == 0)
+        continue;
+
+      old_first = &g_array_index (old_group->members, SharedBlurMember, 0);
+      if (old_first->effect != first->effect)
+        continue;
+
+      /* Take over the framebuffers, and the blurred background if nothing
+       * changed.
+       */
+      background_fb = group->background_fb;
+      blurred_fb = group->blurred_fb;
+      group->background_fb = old_group->background_fb;
+      group->blurred_fb = old_group->blurred_fb;
+      old_group->background_fb = background_fb;
+      old_group->blurred_fb = blurred_fb;
+
+      group->fb_width = old_group->fb_width;
+      group->fb_height = old_group->fb_height;
+      group->downscale_factor = old_group->downscale_factor;
+      group->cached = old_group->cached && is_same_group (group, old_group);
+
+      g_array_set_size (old_group->members, 0);
+      break;
+    }
+
+  if (group->cached)
+    {
+      BackgroundDamage damage = { 0, };
+
+      damage.actor = first->effect->actor;
+      damage.area = group->stage_rect;
+
+      if (!clutter_stage_foreach_damage_since (shared->stage,
+                                               shared->damage_serial,
+                                               check_background_damage,
+                                               &damage) ||
+          damage.damaged)
+        group->cached = FALSE;
+    }
+}
+
+static gboolean
+is_shareable (MetaShellBlurEffect         *effect,
+              SharedBlur                  *shared,
+              const cairo_rectangle_int_t *view_layout)
+{
+  cairo_rectangle_int_t rect;
+
+  if (effect->sigma <= 0 ||
+      !clutter_actor_meta_get_enabled (CLUTTER_ACTOR_META (effect)) ||
+      !clutter_actor_is_mapped (effect->actor) ||
+      clutter_actor_get_stage (effect->actor) != CLUTTER_ACTOR (shared->stage))
+    return FALSE;
+
+  /* Backgrounds crossing view boundaries are blitted from several views */
+  get_stage_rect (effect->actor, &rect);
+
+  return rect.x >= view_layout->x &&
+         rect.y >= view_layout->y &&
+         rect.x + rect.width <= view_layout->x + view_layout->width &&
+         rect.y + rect.height <= view_layout->y + view_layout->height;
+}
+
+static void
+regroup_shared_blur (SharedBlur *shared)
+{
+  g_autoptr (GPtrArray) old_groups = NULL;
+  g_autoptr (GHashTable) candidates = NULL;
+  g_autoptr (GHashTable) branches = NULL;
+  cairo_rectangle_int_t view_layout;
+  RegroupState state;
+  SharedBlurGroup *group;
+  unsigned int i, j;
+  GList *l;
+
+  old_groups = g_steal_pointer (&shared->groups);
+  shared->groups =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) shared_blur_group_free);
+
+  clutter_stage_view_get_layout (shared->view, &view_layout);
+
+  candidates = g_hash_table_new (NULL, NULL);
+  branches = g_hash_table_new (NULL, NULL);
+  for (l = background_blur_effects; l; l = l->next)
+    {
+      MetaShellBlurEffect *effect = l->data;
+      gboolean shareable = is_shareable (effect, shared, &view_layout);
+      ClutterActor *ancestor;
+
+      /* Groups of this view are rebuilt below, while a group of another view
+       * has to let go of actors that moved over here.
+       */
+      if (effect->shared_group && effect->shared_group->shared == shared)
+        effect->shared_group = NULL;
+      else if (shareable)
+        leave_shared_group (effect);
+
+      if (!shareable)
+        continue;
+
+      g_hash_table_insert (candidates, effect->actor, effect);
+
+      for (ancestor = clutter_actor_get_parent (effect->actor);
+           ancestor && !g_hash_table_contains (branches, ancestor);
+           ancestor = clutter_actor_get_parent (ancestor))
+        g_hash_table_add (branches, ancestor);
+    }
+
+  /* Group the candidates in a single pass over the stage in paint order */
+  if (g_hash_table_size (candidates) > 0)
+    {
+      state = (RegroupState) {
+        .shared = shared,
+        .candidates = candidates,
+        .branches = branches,
+      };
+      regroup_actor (&state, CLUTTER_ACTOR (shared->stage));
+      g_clear_pointer (&state.painted, cairo_region_destroy);
+    }
+
+  i = 0;
+  while (i < shared->groups->len)
+    {
+      group = g_ptr_array_index (shared->groups, i);
+
+      /* Lone backgrounds are better off with their own blur and cache */
+      if (group->members->len < 2)
+        {
+          g_ptr_array_remove_index (shared->groups, i);
+          continue;
+        }
+
+      adopt_old_group (shared, group, old_groups);
+
+      for (j = 0; j < group->members->len; j++)
+        {
+          SharedBlurMember *member =
+            &g_array_index (group->members, SharedBlurMember, j);
+
+          member->effect->shared_group = group;
+          member->effect->shared_index = j;
+        }
+
+      i++;
+    }
+
+  shared->damage_serial = clutter_stage_get_damage_serial (shared->stage);
+}
+
+static void
+on_before_paint (ClutterStage     *stage,
+                 ClutterStageView *view,
+                 SharedBlur       *shared)
+{
+  if (view != shared->view)
+    return;
+
+  shared->in_frame = TRUE;
+  regroup_shared_blur (shared);
+}
+
+static void
+on_after_paint (ClutterStage     *stage,
+                ClutterStageView *view,
+                SharedBlur       *shared)
+{
+  unsigned int i;
+
+  if (view != shared->view)
+    return;
+
+  shared->in_frame = FALSE;
+
+  for (i = 0; i < shared->groups->len; i++)
+    {
+      SharedBlurGroup *group = g_ptr_array_index (shared->groups, i);
+
+      group->blurred = FALSE;
+    }
+
+  /* The last background blur effect went away during this frame */
+  if (!background_blur_effects)
+    g_object_set_data (G_OBJECT (view), SHARED_BLUR_DATA_KEY, NULL);
+}
+
+static void
+shared_blur_free (SharedBlur *shared)
+{
+  if (shared->stage)
+    {
+      g_clear_signal_handler (&shared->before_paint_handler_id, shared->stage);
+      g_clear_signal_handler (&shared->after_paint_handler_id, shared->stage);
+      clutter_stage_untrack_damage_history (shared->stage);
+      g_clear_weak_pointer (&shared->stage);
+    }
+
+  shared_blurs = g_list_remove (shared_blurs, shared);
+
+  g_ptr_array_unref (shared->groups);
+  g_free (shared);
+}
+
+/* Stops tracking damage and frames of all views once the last background
+ * blur effect is gone. Views in the middle of a frame let go of theirs
+ * once the frame is painted.
+ */
+static void
+drop_shared_blurs (void)
+{
+  GList *l;
+
+  if (background_blur_effects)
+    return;
+
+  l = shared_blurs;
+  while (l)
+    {
+      SharedBlur *shared = l->data;
+
+      l = l->next;
+
+      if (!shared->in_frame)
+        g_object_set_data (G_OBJECT (shared->view), SHARED_BLUR_DATA_KEY, NULL);
+    }
+}
+
+static void
+ensure_shared_blur (ClutterStageView *view,
+                    ClutterStage     *stage)
+{
+  SharedBlur *shared;
+
+  if (g_object_get_data (G_OBJECT (view), SHARED_BLUR_DATA_KEY))
+    return;
+
+  shared = g_new0 (SharedBlur, 1);
+  shared->view = view;
+  shared->groups =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) shared_blur_group_free);
+
+  g_set_weak_pointer (&shared->stage, stage);
+  clutter_stage_track_damage_history (stage);
+  shared->damage_serial = clutter_stage_get_damage_serial (stage);
+  shared->before_paint_handler_id =
+    g_signal_connect (stage, "before-paint",
+                      G_CALLBACK (on_before_paint), shared);
+  shared->after_paint_handler_id =
+    g_signal_connect (stage, "after-paint",
+                      G_CALLBACK (on_after_paint), shared);
+
+  g_object_set_data_full (G_OBJECT (view), SHARED_BLUR_DATA_KEY,
+                          shared, (GDestroyNotify) shared_blur_free);
+  shared_blurs = g_list_prepend (shared_blurs, shared);
+}
+
+static gboolean
+update_shared_framebuffers (SharedBlurGroup *group)
+{
+  float width, height;
+  float downscale_factor;
+
+  clutter_actor_box_get_size (&group->box, &width, &height);
+
+  if (group->algorithm == CLUTTER_BLUR_ALGORITHM_DUAL_KAWASE)
+    downscale_factor = 1.f;
+  else
+    downscale_factor = calculate_downscale_factor (width, height, group->sigma);
+
+  if (group->fb_width == width &&
+      group->fb_height == height &&
+      group->downscale_factor == downscale_factor &&
+      group->blurred_fb.framebuffer)
+    return TRUE;
+
+  group->fb_width = 0.f;
+  group->fb_height = 0.f;
+
+  if (!update_fbo (&group->background_fb, width, height, 1.0) ||
+      !update_fbo (&group->blurred_fb, width, height, downscale_factor))
+    return FALSE;
+
+  group->fb_width = width;
+  group->fb_height = height;
+  group->downscale_factor = downscale_factor;
+
+  return TRUE;
+}
+
+static void
+add_shared_blur_nodes (SharedBlurGroup     *group,
+                       ClutterPaintNode    *node,
+                       ClutterPaintContext *paint_context)
+{
+  g_autoptr (ClutterPaintNode) blurred_node = NULL;
+  g_autoptr (ClutterPaintNode) blur_node = NULL;
+  g_autoptr (ClutterPaintNode) background_node = NULL;
+  g_autoptr (ClutterPaintNode) blit_node = NULL;
+  float scaled_width, scaled_height;
+
+  scaled_width = cogl_texture_get_width (group->blurred_fb.texture);
+  scaled_height = cogl_texture_get_height (group->blurred_fb.texture);
+
+  /* Only renders into the shared texture, nothing is drawn onto the stage */
+  blurred_node =
+    clutter_layer_node_new_to_framebuffer (group->blurred_fb.framebuffer,
+                                           group->blurred_fb.pipeline);
+  clutter_paint_node_set_static_name (blurred_node, "ShellBlurEffect (shared)");
+  clutter_paint_node_add_child (node, blurred_node);
+
+  blur_node = clutter_blur_node_new_with_algorithm (scaled_width,
+                                                    scaled_height,
+                                                    group->sigma / group->downscale_factor,
+                                                    group->algorithm);
+  clutter_paint_node_set_static_name (blur_node, "ShellBlurEffect (shared blur)");
+  clutter_paint_node_add_child (blurred_node, blur_node);
+  clutter_paint_node_add_rectangle (blur_node,
+                                    &(ClutterActorBox) {
+                                      0.f, 0.f,
+                                      scaled_width, scaled_height,
+                                    });
+
+  background_node =
+    clutter_layer_node_new_to_framebuffer (group->background_fb.framebuffer,
+                                           group->background_fb.pipeline);
+  clutter_paint_node_set_static_name (background_node,
+                                      "ShellBlurEffect (shared background)");
+  clutter_paint_node_add_child (blur_node, background_node);
+  clutter_paint_node_add_rectangle (background_node,
+                                    &(ClutterActorBox) {
+                                      0.f, 0.f,
+                                      scaled_width, scaled_height,
+                                    });
+
+  blit_node =
+    clutter_blit_node_new (clutter_paint_context_get_framebuffer (paint_context));
+  clutter_paint_node_set_static_name (blit_node, "ShellBlurEffect (shared blit)");
+  clutter_paint_node_add_child (background_node, blit_node);
+  clutter_blit_node_add_blit_rectangle (CLUTTER_BLIT_NODE (blit_node),
+                                        group->box.x1,
+                                        group->box.y1,
+                                        0, 0,
+                                        group->fb_width,
+                                        group->fb_height);
+}
+
+static gboolean
+paint_shared_background (MetaShellBlurEffect *self,
+                         ClutterPaintNode    *node,
+                         ClutterPaintContext *paint_context)
+{
+  g_autoptr (ClutterPaintNode) pipeline_node = NULL;
+  SharedBlurGroup *group = self->shared_group;
+  SharedBlurMember *member;
+  ClutterStageView *view;
+  float width, height;
+  float x, y;
+
+  view = clutter_paint_context_get_stage_view (paint_context);
+  if (!view)
+    return FALSE;
+
+  ensure_shared_blur (view, CLUTTER_STAGE (clutter_actor_get_stage (self->actor)));
+
+  /* Only painting the view itself goes through the frame the groups were
+   * made for.
+   */
+  if (!group ||
+      !group->shared->in_frame ||
+      group->shared->view != view ||
+      clutter_paint_context_get_framebuffer (paint_context) !=
+      clutter_stage_view_get_framebuffer (view))
+    return FALSE;
+
+  if (!group->blurred && !group->cached)
+    {
+      if (!update_shared_framebuffers (group))
+        return FALSE;
+
+      add_shared_blur_nodes (group, node, paint_context);
+
+      group->blurred = TRUE;
+      group->cached = redraw_clip_contains (paint_context, &group->stage_rect);
+    }
+
+  member = &g_array_index (group->members, SharedBlurMember, self->shared_index);
+
+  /* Use the untransformed actor size here, since the framebuffer itself already
+   * has the actor transform matrix applied.
+   */
+  clutter_actor_get_size (self->actor, &width, &height);
+
+  x = member->box.x1 - group->box.x1;
+  y = member->box.y1 - group->box.y1;
+
+  cogl_pipeline_set_layer_texture (self->brightness_fb.pipeline, 0,
+                                   group->blurred_fb.texture);
+  update_brightness_for_area (self, 255,
+                              &GRAPHENE_RECT_INIT (x, y,
+                                                   clutter_actor_box_get_width (&member->box),
+                                                   clutter_actor_box_get_height (&member->box)),
+                              group->fb_width,
+                              group->fb_height);
+
+  pipeline_node = clutter_pipeline_node_new (self->brightness_fb.pipeline);
+  clutter_paint_node_set_static_name (pipeline_node, "ShellBlurEffect (shared final)");
+  clutter_paint_node_add_child (node, pipeline_node);
+  clutter_paint_node_add_texture_rectangle (pipeline_node,
+                                            &(ClutterActorBox) {
+                                              0.f, 0.f,
+                                              width, height,
+                                            },
+                                            x / group->fb_width,
+                                            y / group->fb_height,
+                                            (x + clutter_actor_box_get_width (&member->box)) /
+                                            group->fb_width,
+                                            (y + clutter_actor_box_get_height (&member->box)) /
+                                            group->fb_height);
+
+  /* The own blurred background isn't kept up to date meanwhile */
+  self->cache_flags &= ~BLUR_APPLIED;
+
+  return TRUE;
+}
+
+static gboolean
+needs_repaint (MetaShellBlurEffect         *self,
+               ClutterPaintContext     *paint_context,
+               ClutterEffectPaintFlags  flags)
+{
+  gboolean actor_cached;
+  gboolean blur_cached;
+  gboolean actor_dirty;
+
+  actor_dirty = (flags & CLUTTER_EFFECT_PAINT_ACTOR_DIRTY) != 0;
+  blur_cached = (self->cache_flags & BLUR_APPLIED) != 0;
+  actor_cached = (self->cache_flags & ACTOR_PAINTED) != 0;
+
+  switch (self->mode)
+    {
+    case SHELL_BLUR_MODE_ACTOR:
+      return actor_dirty || !blur_cached || !actor_cached;
+
+    case SHELL_BLUR_MODE_BACKGROUND:
+      return !blur_cached || !is_background_cached (self, paint_context);
+    }
+
+  return TRUE;
+}
+
+static void
+shell_blur_effect_paint_node (ClutterEffect           *effect,
+                              ClutterPaintNode        *node,
+                              ClutterPaintContext     *paint_context,
+                              ClutterEffectPaintFlags  flags)
+{
+  MetaShellBlurEffect *self = META_SHELL_BLUR_EFFECT (effect);
+  uint8_t paint_opacity;
+
+  g_assert (self->actor != NULL);
+
+  /* The background of a clone isn't where the actor itself is */
+  if (self->mode == SHELL_BLUR_MODE_BACKGROUND &&
+      clutter_actor_is_in_clone_paint (self->actor))
+    goto fail;
+
+  if (self->sigma > 0)
+    {
+      g_autoptr (ClutterPaintNode) blur_node = NULL;
+
+      switch (self->mode)
+        {
+        case SHELL_BLUR_MODE_ACTOR:
+          paint_opacity = clutter_actor_get_paint_opacity (self->actor);
+          break;
+
+        case SHELL_BLUR_MODE_BACKGROUND:
+          paint_opacity = 255;
+          break;
+
+        default:
+          g_assert_not_reached();
+          break;
+        }
+
+      if (self->mode == SHELL_BLUR_MODE_BACKGROUND &&
+          paint_shared_background (self, node, paint_context))
+        {
+          add_actor_node (self, node, -1);
+          return;
+        }
+
+      if (needs_repaint (self, paint_context, flags))
+        {
+          ClutterActorBox source_actor_box;
+
+          update_actor_box (self, paint_context, &source_actor_box);
+
+          /* Failing to create or update the offscreen framebuffers prevents
+           * the entire effect to be applied.
+           */
+          if (!update_framebuffers (self, paint_context, &source_actor_box))
+            goto fail;
+
+          blur_node = create_blur_nodes (self, node, paint_opacity);
+
+          switch (self->mode)
+            {
+            case SHELL_BLUR_MODE_ACTOR:
+              paint_actor_offscreen (self, blur_node, flags);
+              break;
+
+            case SHELL_BLUR_MODE_BACKGROUND:
+              paint_background (self, blur_node, paint_context, &source_actor_box);
+              remember_background (self, paint_context, &source_actor_box);
+              break;
+            }
+        }
+      else
+        {
+          /* Use the cached pipeline if no repaint is needed */
+          add_blurred_pipeline (self, node, paint_opacity);
+        }
+
+      /* Background blur needs to paint the actor after painting the blurred
+       * background.
+       */
+      switch (self->mode)
+        {
+        case SHELL_BLUR_MODE_ACTOR:
+          break;
+
+        case SHELL_BLUR_MODE_BACKGROUND:
+          add_actor_node (self, node, -1);
+          break;
+        }
+
+      return;
+    }
+
+fail:
+  /* When no blur is applied, or the offscreen framebuffers
+   * couldn't be created, fallback to simply painting the actor.
+   */
+  add_actor_node (self, node, -1);
+}
+
+static cairo_region_t *
+shell_blur_effect_get_opaque_region (MetaCullableEffect *effect)
+{
+  MetaShellBlurEffect *self = META_SHELL_BLUR_EFFECT (effect);
+
+  if (self->sigma <= 0)
+    return NULL;
+
+  switch (self->mode)
+    {
+    case SHELL_BLUR_MODE_ACTOR:
+      /* Translucent pixels of the actor bleed into the opaque ones */
+      return cairo_region_create ();
+
+    case SHELL_BLUR_MODE_BACKGROUND:
+      /* The actor itself is painted untouched on top of the background */
+      return NULL;
+    }
+
+  return NULL;
+}
+
+static cairo_region_t *
+shell_blur_effect_get_background_region (MetaCullableEffect *effect)
+{
+  MetaShellBlurEffect *self = META_SHELL_BLUR_EFFECT (effect);
+  float width, height;
+  int extent = 0;
+
+  if (self->sigma <= 0 || self->mode != SHELL_BLUR_MODE_BACKGROUND)
+    return NULL;
+
+  clutter_actor_get_size (self->actor, &width, &height);
+
+  /* A shared blur pass doesn't clamp to the edges of this actor, but reads
+   * from around it as well.
+   */
+  if (self->shared_group)
+    extent = get_blur_extent (self->sigma);
+
+  return cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+                                          .x = -extent,
+                                          .y = -extent,
+                                          .width = ceilf (width) + 2 * extent,
+                                          .height = ceilf (height) + 2 * extent,
+                                        });
+}
+
+static gboolean
+shell_blur_effect_caches_actor (MetaCullableEffect *effect)
+{
+  MetaShellBlurEffect *self = META_SHELL_BLUR_EFFECT (effect);
+
+  return self->sigma > 0 && self->mode == SHELL_BLUR_MODE_ACTOR;
+}
+
+static void
+cullable_effect_iface_init (MetaCullableEffectInterface *iface)
+{
+  iface->get_opaque_region = shell_blur_effect_get_opaque_region;
+  iface->get_background_region = shell_blur_effect_get_background_region;
+  iface->caches_actor = shell_blur_effect_caches_actor;
+}
+
+static void
+shell_blur_effect_finalize (GObject *object)
+{
+  MetaShellBlurEffect *self = (MetaShellBlurEffect *)object;
+
+  if (self->registered)
+    {
+      background_blur_effects = g_list_remove (background_blur_effects, self);
+      leave_shared_group (self);
+      drop_shared_blurs ();
+    }
+
+  untrack_background_damage (self);
+
+  clear_framebuffer_data (&self->actor_fb);
+  clear_framebuffer_data (&self->background_fb);
+  clear_framebuffer_data (&self->brightness_fb);
+
+  g_clear_pointer (&self->actor_fb.pipeline, cogl_object_unref);
+  g_clear_pointer (&self->background_fb.pipeline, cogl_object_unref);
+  g_clear_pointer (&self->brightness_fb.pipeline, cogl_object_unref);
+
+  G_OBJECT_CLASS (meta_shell_blur_effect_parent_class)->finalize (object);
+}
+
+static void
+shell_blur_effect_get_property (GObject    *object,
+                                guint       prop_id,
+                                GValue     *value,
+                                GParamSpec *pspec)
+{
+  MetaShellBlurEffect *self = META_SHELL_BLUR_EFFECT (object);
+
+  switch (prop_id)
+    {
+    case PROP_SIGMA:
+      g_value_set_int (value, self->sigma);
+      break;
+
+    case PROP_BRIGHTNESS:
+      g_value_set_float (value, self->brightness);
+      break;
+
+    case PROP_MODE:
+      g_value_set_enum (value, self->mode);
+      break;
+
+    case PROP_ALGORITHM:
+      g_value_set_enum (value, self->algorithm);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+shell_blur_effect_set_property (GObject      *object,
+                                guint         prop_id,
+                                const GValue *value,
+                                GParamSpec   *pspec)
+{
+  MetaShellBlurEffect *self = META_SHELL_BLUR_EFFECT (object);
+
+  switch (prop_id)
+    {
+    case PROP_SIGMA:
+      meta_shell_blur_effect_set_sigma (self, g_value_get_int (value));
+      break;
+
+    case PROP_BRIGHTNESS:
+      meta_shell_blur_effect_set_brightness (self, g_value_get_float (value));
+      break;
+
+    case PROP_MODE:
+      meta_shell_blur_effect_set_mode (self, g_value_get_enum (value));
+      break;
+
+    case PROP_ALGORITHM:
+      meta_shell_blur_effect_set_algorithm (self, g_value_get_enum (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+meta_shell_blur_effect_class_init (MetaShellBlurEffectClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  ClutterActorMetaClass *meta_class = CLUTTER_ACTOR_META_CLASS (klass);
   ClutterEffectClass *effect_class = CLUTTER_EFFECT_CLASS (klass);
 
   object_class->finalize = shell_blur_effect_finalize;
@@ -831,6 +1972,14 @@ meta_shell_blur_effect_class_init (MetaShellBlurEffectClass *klass)
                        SHELL_BLUR_MODE_ACTOR,
                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_ALGORITHM] =
+    g_param_spec_enum ("algorithm",
+                       "Blur algorithm",
+                       "Blur algorithm",
+                       CLUTTER_TYPE_BLUR_ALGORITHM,
+                       CLUTTER_BLUR_ALGORITHM_GAUSSIAN,
+                       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (object_class, N_PROPS, properties);
 }
 
@@ -838,6 +1987,7 @@ static void
 meta_shell_blur_effect_init (MetaShellBlurEffect *self)
 {
   self->mode = SHELL_BLUR_MODE_ACTOR;
+  self->algorithm = CLUTTER_BLUR_ALGORITHM_GAUSSIAN;
   self->sigma = 0;
   self->brightness = 1.f;
   self->skip = false;
@@ -885,6 +2035,7 @@ meta_shell_blur_effect_set_sigma (MetaShellBlurEffect *self,
 
   self->sigma = sigma;
   self->cache_flags &= ~BLUR_APPLIED;
+  leave_shared_group (self);
 
   if (self->actor)
     clutter_effect_queue_repaint (CLUTTER_EFFECT (self));
@@ -942,6 +2093,7 @@ meta_shell_blur_effect_set_mode (MetaShellBlurEffect *self,
     {
     case SHELL_BLUR_MODE_ACTOR:
       clear_framebuffer_data (&self->background_fb);
+      untrack_background_damage (self);
       break;
 
     case SHELL_BLUR_MODE_BACKGROUND:
@@ -950,12 +2102,41 @@ meta_shell_blur_effect_set_mode (MetaShellBlurEffect *self,
       break;
     }
 
+  update_registration (self);
+
   if (self->actor)
     clutter_effect_queue_repaint (CLUTTER_EFFECT (self));
 
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_MODE]);
 }
 
+ClutterBlurAlgorithm
+meta_shell_blur_effect_get_algorithm (MetaShellBlurEffect *self)
+{
+  g_return_val_if_fail (META_IS_SHELL_BLUR_EFFECT (self), -1);
+
+  return self->algorithm;
+}
+
+void
+meta_shell_blur_effect_set_algorithm (MetaShellBlurEffect  *self,
+                                      ClutterBlurAlgorithm  algorithm)
+{
+  g_return_if_fail (META_IS_SHELL_BLUR_EFFECT (self));
+
+  if (self->algorithm == algorithm)
+    return;
+
+  self->algorithm = algorithm;
+  self->cache_flags &= ~BLUR_APPLIED;
+  leave_shared_group (self);
+
+  if (self->actor)
+    clutter_effect_queue_repaint (CLUTTER_EFFECT (self));
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_ALGORITHM]);
+}
+
 void meta_shell_blur_effect_set_skip (MetaShellBlurEffect *self,
                                       gboolean skip)
 {
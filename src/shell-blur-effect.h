@@ -26,6 +26,8 @@
 
 #include <clutter/clutter.h>
 
+#include "core/util-private.h"
+
 G_BEGIN_DECLS
 
 /**
@@ -44,9 +46,11 @@ typedef enum
 #define META_SHELL_TYPE_BLUR_EFFECT (meta_shell_blur_effect_get_type())
 G_DECLARE_FINAL_TYPE (MetaShellBlurEffect, meta_shell_blur_effect, META, SHELL_BLUR_EFFECT, ClutterEffect)
 
+META_EXPORT_TEST
 MetaShellBlurEffect *meta_shell_blur_effect_new (void);
 
 int meta_shell_blur_effect_get_sigma (MetaShellBlurEffect *self);
+META_EXPORT_TEST
 void meta_shell_blur_effect_set_sigma (MetaShellBlurEffect *self,
                                        int              sigma);
 
@@ -55,9 +59,15 @@ void meta_shell_blur_effect_set_brightness (MetaShellBlurEffect *self,
                                             float            brightness);
 
 ShellBlurMode meta_shell_blur_effect_get_mode (MetaShellBlurEffect *self);
+META_EXPORT_TEST
 void meta_shell_blur_effect_set_mode (MetaShellBlurEffect *self,
                                       ShellBlurMode    mode);
 
+ClutterBlurAlgorithm meta_shell_blur_effect_get_algorithm (MetaShellBlurEffect *self);
+META_EXPORT_TEST
+void meta_shell_blur_effect_set_algorithm (MetaShellBlurEffect  *self,
+                                           ClutterBlurAlgorithm  algorithm);
+
 void meta_shell_blur_effect_set_skip (MetaShellBlurEffect *self,
                                       gboolean skip);
 
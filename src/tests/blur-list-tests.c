@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "tests/blur-list-tests.h"
+
+#include "core/window-private.h"
+#include "meta/prefs.h"
+#include "tests/meta-test-utils.h"
+#include "tests/unit-tests.h"
+
+static void
+set_blur_list (GSettings          *settings,
+               const char * const *names)
+{
+  unsigned int serial = meta_prefs_get_blur_list_serial ();
+
+  g_assert_true (g_settings_set_strv (settings, "blur-list", names));
+
+  /* The compiled list, and with it the serial, changes once prefs.c has
+   * seen the new value. */
+  while (meta_prefs_get_blur_list_serial () == serial)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+clear_blur_list (GSettings *settings)
+{
+  const char * const no_names[] = { NULL };
+
+  set_blur_list (settings, no_names);
+}
+
+static void
+meta_test_blur_list_match (void)
+{
+  g_autoptr (GSettings) settings = NULL;
+  const char * const names[] = {
+    "firefox",
+    "gnome-*",
+    "kitt?",
+    NULL
+  };
+
+  settings = g_settings_new ("org.gnome.mutter");
+  set_blur_list (settings, names);
+
+  /* Plain names are looked up in the hash table, and must match exactly */
+  g_assert_true (meta_prefs_in_blur_list ("firefox"));
+  g_assert_false (meta_prefs_in_blur_list ("Firefox"));
+  g_assert_false (meta_prefs_in_blur_list ("firefox-esr"));
+  g_assert_false (meta_prefs_in_blur_list ("fire"));
+
+  /* Entries with wildcards are matched as glob patterns */
+  g_assert_true (meta_prefs_in_blur_list ("gnome-terminal"));
+  g_assert_true (meta_prefs_in_blur_list ("gnome-"));
+  g_assert_false (meta_prefs_in_blur_list ("org.gnome-terminal"));
+  g_assert_true (meta_prefs_in_blur_list ("kitty"));
+  g_assert_false (meta_prefs_in_blur_list ("kitten"));
+
+  /* A glob doesn't make other plain names match as patterns */
+  g_assert_false (meta_prefs_in_blur_list ("firefox*"));
+
+  g_assert_false (meta_prefs_in_blur_list (NULL));
+
+  clear_blur_list (settings);
+}
+
+static void
+meta_test_blur_list_window (void)
+{
+  g_autoptr (GSettings) settings = NULL;
+  g_autoptr (GError) error = NULL;
+  const char * const names[] = {
+    "blurred-instance",
+    "Blurred*",
+    NULL
+  };
+  const char * const updated_names[] = {
+    "blurred-instance",
+    "Blurred*",
+    "plain-instance",
+    NULL
+  };
+  MetaTestClient *test_client;
+  MetaWindow *window;
+
+  settings = g_settings_new ("org.gnome.mutter");
+  set_blur_list (settings, names);
+
+  test_client = meta_test_client_new (test_context,
+                                      "blur-list-client",
+                                      META_WINDOW_CLIENT_TYPE_WAYLAND,
+                                      &error);
+  if (!test_client)
+    g_error ("Failed to launch test client: %s", error->message);
+
+  if (!meta_test_client_do (test_client, &error,
+                            "create", "1",
+                            NULL))
+    g_error ("Failed to create window: %s", error->message);
+
+  if (!meta_test_client_do (test_client, &error,
+                            "show", "1",
+                            NULL))
+    g_error ("Failed to show the window: %s", error->message);
+
+  window = meta_test_client_find_window (test_client, "1", &error);
+  if (!window)
+    g_error ("Failed to find the window: %s", error->message);
+  meta_test_client_wait_for_window_shown (test_client, window);
+
+  /* Either the instance name or the class name may match */
+  meta_window_set_wm_class (window, "Plain-class", "blurred-instance");
+  g_assert_true (meta_window_is_in_blur_list (window));
+
+  /* Changing WM_CLASS invalidates the cached result */
+  meta_window_set_wm_class (window, "Blurred-class", "plain-instance");
+  g_assert_true (meta_window_is_in_blur_list (window));
+
+  meta_window_set_wm_class (window, "Plain-class", "plain-instance");
+  g_assert_false (meta_window_is_in_blur_list (window));
+
+  /* So does changing blur-list itself */
+  set_blur_list (settings, updated_names);
+  g_assert_true (meta_window_is_in_blur_list (window));
+
+  clear_blur_list (settings);
+  g_assert_false (meta_window_is_in_blur_list (window));
+
+  if (!meta_test_client_quit (test_client, &error))
+    g_error ("Failed to quit test client: %s", error->message);
+
+  meta_test_client_destroy (test_client);
+}
+
+void
+init_blur_list_tests (void)
+{
+  g_test_add_func ("/core/prefs/blur-list/match",
+                   meta_test_blur_list_match);
+  g_test_add_func ("/core/window/blur-list",
+                   meta_test_blur_list_window);
+}
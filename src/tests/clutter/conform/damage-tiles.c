@@ -0,0 +1,315 @@
+#include <string.h>
+#include <clutter/clutter.h>
+#include <clutter/clutter-mutter.h>
+
+#include "tests/clutter-test-utils.h"
+
+#define BPP 4
+
+typedef struct _Framebuffers
+{
+  int width;
+  int height;
+  int stride;
+  uint8_t *prev_data;
+  uint8_t *current_data;
+} Framebuffers;
+
+/* The scanline-by-scanline memcmp() implementation damage detection used
+ * before clutter_damage_tiles_find(), which it must match. */
+static cairo_region_t *
+reference_find_damaged_tiles (const uint8_t        *current_data,
+                              const uint8_t        *prev_data,
+                              int                   width,
+                              int                   height,
+                              int                   stride,
+                              int                   bpp,
+                              const cairo_region_t *damage_region)
+{
+  cairo_region_t *tile_damage_region;
+  cairo_rectangle_int_t damage_extents;
+  const int tile_size = CLUTTER_DAMAGE_TILE_SIZE;
+  int tile_x, tile_y;
+
+  cairo_region_get_extents (damage_region, &damage_extents);
+
+  tile_damage_region = cairo_region_create ();
+
+  for (tile_y = damage_extents.y / tile_size;
+       tile_y * tile_size < damage_extents.y + damage_extents.height;
+       tile_y++)
+    {
+      for (tile_x = damage_extents.x / tile_size;
+           tile_x * tile_size < damage_extents.x + damage_extents.width;
+           tile_x++)
+        {
+          cairo_rectangle_int_t tile = {
+            .x = tile_x * tile_size,
+            .y = tile_y * tile_size,
+            .width = tile_size,
+            .height = tile_size,
+          };
+          int y;
+
+          if (cairo_region_contains_rectangle (damage_region, &tile) ==
+              CAIRO_REGION_OVERLAP_OUT)
+            continue;
+
+          if (tile.x >= width || tile.y >= height)
+            continue;
+
+          tile.width = MIN (tile.width, width - tile.x);
+          tile.height = MIN (tile.height, height - tile.y);
+
+          for (y = tile.y; y < tile.y + tile.height; y++)
+            {
+              if (memcmp (prev_data + y * stride + tile.x * bpp,
+                          current_data + y * stride + tile.x * bpp,
+                          tile.width * bpp) != 0)
+                {
+                  cairo_region_union_rectangle (tile_damage_region, &tile);
+                  break;
+                }
+            }
+        }
+    }
+
+  cairo_region_intersect (tile_damage_region, damage_region);
+
+  return tile_damage_region;
+}
+
+static void
+framebuffers_init (Framebuffers *fbs,
+                   int           width,
+                   int           height,
+                   int           stride)
+{
+  size_t size = (size_t) stride * height;
+  size_t i;
+
+  *fbs = (Framebuffers) {
+    .width = width,
+    .height = height,
+    .stride = stride,
+    .prev_data = g_malloc (size),
+    .current_data = g_malloc (size),
+  };
+
+  for (i = 0; i < size; i++)
+    fbs->prev_data[i] = i * 31;
+  memcpy (fbs->current_data, fbs->prev_data, size);
+}
+
+static void
+framebuffers_clear (Framebuffers *fbs)
+{
+  g_free (fbs->prev_data);
+  g_free (fbs->current_data);
+}
+
+static void
+change_pixel (Framebuffers *fbs,
+              int           x,
+              int           y)
+{
+  g_assert_cmpint (x, <, fbs->width);
+  g_assert_cmpint (y, <, fbs->height);
+
+  fbs->current_data[y * fbs->stride + x * BPP + (x + y) % BPP] ^= 0xff;
+}
+
+static cairo_region_t *
+assert_matches_reference (Framebuffers         *fbs,
+                          const cairo_region_t *damage_region)
+{
+  cairo_region_t *reference_region;
+  cairo_region_t *region;
+
+  reference_region = reference_find_damaged_tiles (fbs->current_data,
+                                                   fbs->prev_data,
+                                                   fbs->width,
+                                                   fbs->height,
+                                                   fbs->stride,
+                                                   BPP,
+                                                   damage_region);
+  region = clutter_damage_tiles_find (fbs->current_data,
+                                      fbs->prev_data,
+                                      fbs->width,
+                                      fbs->height,
+                                      fbs->stride,
+                                      BPP,
+                                      damage_region);
+
+  g_assert_true (cairo_region_equal (reference_region, region));
+
+  cairo_region_destroy (reference_region);
+
+  return region;
+}
+
+static void
+damage_tiles_unchanged (void)
+{
+  Framebuffers fbs;
+  cairo_region_t *damage_region;
+  cairo_region_t *region;
+
+  framebuffers_init (&fbs, 256, 128, 256 * BPP);
+
+  damage_region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+    .width = 256, .height = 128,
+  });
+  region = assert_matches_reference (&fbs, damage_region);
+  g_assert_true (cairo_region_is_empty (region));
+
+  cairo_region_destroy (region);
+  cairo_region_destroy (damage_region);
+  framebuffers_clear (&fbs);
+}
+
+static void
+damage_tiles_unaligned (void)
+{
+  Framebuffers fbs;
+  cairo_region_t *damage_region;
+  cairo_region_t *region;
+  cairo_rectangle_int_t damage = { .x = 5, .y = 7, .width = 37, .height = 29 };
+
+  framebuffers_init (&fbs, 256, 128, 256 * BPP);
+
+  /* Changes inside the damage, in tiles it only partially covers */
+  change_pixel (&fbs, 5, 7);
+  change_pixel (&fbs, 41, 35);
+  /* A change in a tile the damage touches, but outside of the damage */
+  change_pixel (&fbs, 1, 1);
+  /* A change in a tile the damage doesn't touch at all */
+  change_pixel (&fbs, 100, 100);
+
+  damage_region = cairo_region_create_rectangle (&damage);
+  region = assert_matches_reference (&fbs, damage_region);
+
+  g_assert_false (cairo_region_is_empty (region));
+  g_assert_cmpint (cairo_region_contains_point (region, 5, 7), ==, TRUE);
+  g_assert_cmpint (cairo_region_contains_point (region, 41, 35), ==, TRUE);
+  g_assert_cmpint (cairo_region_contains_point (region, 1, 1), ==, FALSE);
+  g_assert_cmpint (cairo_region_contains_point (region, 100, 100), ==, FALSE);
+  g_assert_cmpint (cairo_region_contains_rectangle (region, &damage),
+                   !=,
+                   CAIRO_REGION_OVERLAP_OUT);
+
+  cairo_region_destroy (region);
+  cairo_region_destroy (damage_region);
+  framebuffers_clear (&fbs);
+}
+
+static void
+damage_tiles_partial (void)
+{
+  Framebuffers fbs;
+  cairo_region_t *damage_region;
+  cairo_region_t *region;
+  int i;
+
+  /* Large enough for the scan to be split into parallel bands */
+  framebuffers_init (&fbs, 1024, 768, 1024 * BPP);
+
+  damage_region = cairo_region_create ();
+  for (i = 0; i < 16; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int y;
+
+      rect.width = g_test_rand_int_range (1, 400);
+      rect.height = g_test_rand_int_range (1, 300);
+      rect.x = g_test_rand_int_range (0, fbs.width - rect.width);
+      rect.y = g_test_rand_int_range (0, fbs.height - rect.height);
+      cairo_region_union_rectangle (damage_region, &rect);
+
+      if (i % 3 == 0)
+        continue;
+
+      for (y = rect.y; y < rect.y + rect.height; y += 11)
+        change_pixel (&fbs, rect.x + (y * 7) % rect.width, y);
+    }
+
+  region = assert_matches_reference (&fbs, damage_region);
+  cairo_region_destroy (region);
+
+  /* The same changes with everything damaged */
+  cairo_region_destroy (damage_region);
+  damage_region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+    .width = fbs.width, .height = fbs.height,
+  });
+  region = assert_matches_reference (&fbs, damage_region);
+
+  cairo_region_destroy (region);
+  cairo_region_destroy (damage_region);
+  framebuffers_clear (&fbs);
+}
+
+static void
+damage_tiles_edge_clipped (void)
+{
+  Framebuffers fbs;
+  cairo_region_t *damage_region;
+  cairo_region_t *region;
+  int width = 203;
+  int height = 117;
+  int x, y;
+
+  /* Neither size is a multiple of the tile size, and the rows are padded;
+   * the padding differs but must be ignored. */
+  framebuffers_init (&fbs, width, height, (width + 5) * BPP);
+  for (y = 0; y < height; y++)
+    fbs.current_data[y * fbs.stride + width * BPP] ^= 0xff;
+
+  /* Changes in the partial tiles of the last row and column */
+  change_pixel (&fbs, width - 1, 3);
+  change_pixel (&fbs, 50, height - 1);
+  change_pixel (&fbs, width - 1, height - 1);
+
+  /* Damage reaching past the right and bottom edges */
+  damage_region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+    .x = 190, .y = 0, .width = 40, .height = 200,
+  });
+  cairo_region_union_rectangle (damage_region, &(cairo_rectangle_int_t) {
+    .x = 0, .y = 110, .width = 300, .height = 20,
+  });
+
+  region = assert_matches_reference (&fbs, damage_region);
+
+  g_assert_cmpint (cairo_region_contains_point (region, width - 1, 3),
+                   ==, TRUE);
+  g_assert_cmpint (cairo_region_contains_point (region, 50, height - 1),
+                   ==, TRUE);
+  g_assert_cmpint (cairo_region_contains_point (region,
+                                                width - 1, height - 1),
+                   ==, TRUE);
+
+  cairo_region_destroy (region);
+  cairo_region_destroy (damage_region);
+
+  /* Every pixel of a region only partially inside the framebuffer */
+  for (y = 0; y < height; y++)
+    {
+      for (x = 0; x < width; x++)
+        change_pixel (&fbs, x, y);
+    }
+
+  damage_region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+    .x = 33, .y = 21, .width = 400, .height = 300,
+  });
+  region = assert_matches_reference (&fbs, damage_region);
+
+  cairo_region_destroy (region);
+  cairo_region_destroy (damage_region);
+  framebuffers_clear (&fbs);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/damage-tiles/unchanged", damage_tiles_unchanged)
+  CLUTTER_TEST_UNIT ("/damage-tiles/unaligned", damage_tiles_unaligned)
+  CLUTTER_TEST_UNIT ("/damage-tiles/partial", damage_tiles_partial)
+  CLUTTER_TEST_UNIT ("/damage-tiles/edge-clipped", damage_tiles_edge_clipped)
+)
@@ -16,6 +16,7 @@ typedef struct _FakeHwClock
 
   int64_t next_presentation_time_us;
   gboolean has_pending_present;
+  int64_t pending_presentation_time_us;
 } FakeHwClock;
 
 typedef struct _FrameClockTest
@@ -48,9 +49,17 @@ fake_hw_clock_source_dispatch (GSource     *source,
   if (fake_hw_clock->has_pending_present)
     {
       ClutterFrameInfo frame_info;
+      int64_t presentation_time_us;
 
       fake_hw_clock->has_pending_present = FALSE;
-      init_frame_info (&frame_info, g_source_get_time (source));
+
+      /* Tests may dictate the reported presentation time */
+      presentation_time_us = fake_hw_clock->pending_presentation_time_us;
+      if (presentation_time_us == 0)
+        presentation_time_us = g_source_get_time (source);
+      fake_hw_clock->pending_presentation_time_us = 0;
+
+      init_frame_info (&frame_info, presentation_time_us);
       clutter_frame_clock_notify_presented (frame_clock, &frame_info);
       if (callback)
         callback (user_data);
@@ -823,6 +832,465 @@ frame_clock_notify_ready (void)
   clutter_frame_clock_destroy (frame_clock);
 }
 
+typedef struct _MeasuredPresent
+{
+  int64_t dispatch_time_us;
+  int64_t gpu_rendering_duration_ns;
+} MeasuredPresent;
+
+typedef struct _MeasuredFrameClockTest
+{
+  GSource source;
+
+  ClutterFrameClock *frame_clock;
+
+  int64_t next_presentation_time_us;
+  MeasuredPresent pending_presents[2];
+  int n_pending_presents;
+  int max_pending_presents;
+
+  int64_t gpu_rendering_duration_ns;
+  int64_t slow_frame_count;
+  int64_t slow_gpu_rendering_duration_ns;
+
+  GMainLoop *main_loop;
+} MeasuredFrameClockTest;
+
+static gboolean
+measured_frame_clock_source_dispatch (GSource     *source,
+                                      GSourceFunc  callback,
+                                      gpointer     user_data)
+{
+  MeasuredFrameClockTest *test = (MeasuredFrameClockTest *) source;
+
+  if (test->n_pending_presents > 0)
+    {
+      ClutterFrameInfo frame_info;
+
+      init_frame_info (&frame_info, g_source_get_time (source));
+      frame_info.cpu_time_before_buffer_swap_us =
+        test->pending_presents[0].dispatch_time_us;
+      frame_info.gpu_rendering_duration_ns =
+        test->pending_presents[0].gpu_rendering_duration_ns;
+
+      test->pending_presents[0] = test->pending_presents[1];
+      test->n_pending_presents--;
+      clutter_frame_clock_notify_presented (test->frame_clock, &frame_info);
+    }
+
+  test->next_presentation_time_us += refresh_interval_us;
+  g_source_set_ready_time (source, test->next_presentation_time_us);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs measured_frame_clock_source_funcs = {
+  NULL,
+  NULL,
+  measured_frame_clock_source_dispatch,
+  NULL
+};
+
+static ClutterFrameResult
+measured_frame_clock_frame (ClutterFrameClock *frame_clock,
+                            int64_t            frame_count,
+                            gpointer           user_data)
+{
+  MeasuredFrameClockTest *test = user_data;
+  MeasuredPresent *present;
+
+  g_assert_cmpint (frame_count, ==, expected_frame_count);
+
+  expected_frame_count++;
+
+  if (test_frame_count == 0)
+    {
+      g_main_loop_quit (test->main_loop);
+      return CLUTTER_FRAME_RESULT_IDLE;
+    }
+
+  test_frame_count--;
+
+  g_assert_cmpint (test->n_pending_presents, <, 2);
+  present = &test->pending_presents[test->n_pending_presents++];
+  present->dispatch_time_us = g_get_monotonic_time ();
+  if (frame_count == test->slow_frame_count)
+    present->gpu_rendering_duration_ns = test->slow_gpu_rendering_duration_ns;
+  else
+    present->gpu_rendering_duration_ns = test->gpu_rendering_duration_ns;
+
+  test->max_pending_presents = MAX (test->max_pending_presents,
+                                    test->n_pending_presents);
+
+  clutter_frame_clock_schedule_update (frame_clock);
+
+  return CLUTTER_FRAME_RESULT_PENDING_PRESENTED;
+}
+
+static const ClutterFrameListenerIface measured_frame_clock_listener_iface = {
+  .frame = measured_frame_clock_frame,
+};
+
+static MeasuredFrameClockTest *
+measured_frame_clock_test_new (int64_t gpu_rendering_duration_ns)
+{
+  GSource *source;
+  MeasuredFrameClockTest *test;
+
+  source = g_source_new (&measured_frame_clock_source_funcs,
+                         sizeof (MeasuredFrameClockTest));
+  test = (MeasuredFrameClockTest *) source;
+  test->main_loop = g_main_loop_new (NULL, FALSE);
+  test->gpu_rendering_duration_ns = gpu_rendering_duration_ns;
+  test->slow_frame_count = -1;
+
+  test->frame_clock =
+    clutter_frame_clock_new (refresh_rate,
+                             0,
+                             &measured_frame_clock_listener_iface,
+                             test);
+
+  test->next_presentation_time_us =
+    g_get_monotonic_time () + refresh_interval_us;
+  g_source_set_ready_time (source, test->next_presentation_time_us);
+
+  return test;
+}
+
+static void
+measured_frame_clock_test_run (MeasuredFrameClockTest *test,
+                               int64_t                 n_frames)
+{
+  test_frame_count = n_frames;
+  expected_frame_count = 0;
+
+  g_source_attach (&test->source, NULL);
+
+  clutter_frame_clock_schedule_update (test->frame_clock);
+  g_main_loop_run (test->main_loop);
+}
+
+static void
+measured_frame_clock_test_free (MeasuredFrameClockTest *test)
+{
+  g_main_loop_unref (test->main_loop);
+  clutter_frame_clock_destroy (test->frame_clock);
+  g_source_destroy (&test->source);
+  g_source_unref (&test->source);
+}
+
+static int
+run_triple_buffering_test (gboolean allow_triple_buffering)
+{
+  MeasuredFrameClockTest *test;
+  int max_pending_presents;
+
+  /* Pretend each frame took one and a half refresh cycles to render on the
+   * GPU, which is too slow to keep up with only one frame in flight.
+   */
+  test = measured_frame_clock_test_new (refresh_interval_us * 3 / 2 * 1000);
+  clutter_frame_clock_set_allow_triple_buffering (test->frame_clock,
+                                                  allow_triple_buffering);
+
+  measured_frame_clock_test_run (test, 20);
+
+  max_pending_presents = test->max_pending_presents;
+  measured_frame_clock_test_free (test);
+
+  return max_pending_presents;
+}
+
+static void
+frame_clock_triple_buffering (void)
+{
+  g_assert_cmpint (run_triple_buffering_test (FALSE), ==, 1);
+  g_assert_cmpint (run_triple_buffering_test (TRUE), ==, 2);
+}
+
+static void
+frame_clock_render_time_percentile (void)
+{
+  MeasuredFrameClockTest *test;
+  ClutterFrameTimings timings[64];
+  int64_t fast_render_time_us = 2000;
+  int64_t slow_render_time_us = 12000;
+  int n_timings;
+  int i;
+
+  clutter_debug_set_max_render_time_percentile (95);
+
+  test = measured_frame_clock_test_new (fast_render_time_us * 1000);
+  test->slow_frame_count = 10;
+  test->slow_gpu_rendering_duration_ns = slow_render_time_us * 1000;
+
+  measured_frame_clock_test_run (test, 40);
+
+  n_timings = clutter_frame_clock_get_frame_timings (test->frame_clock,
+                                                     timings,
+                                                     G_N_ELEMENTS (timings));
+  g_assert_cmpint (n_timings, ==, 40);
+
+  for (i = 0; i < n_timings; i++)
+    {
+      g_assert_cmpint (timings[i].frame_count, ==, i);
+      g_assert_cmpint (timings[i].presentation_time_us, >,
+                       timings[i].dispatch_time_us);
+
+      if (i == test->slow_frame_count)
+        {
+          g_assert_cmpint (timings[i].swap_to_rendering_done_us, ==,
+                           slow_render_time_us);
+        }
+      else
+        {
+          g_assert_cmpint (timings[i].swap_to_rendering_done_us, ==,
+                           fast_render_time_us);
+        }
+    }
+
+  /* Once a single slow frame makes up less than 5% of the weighted history,
+   * it no longer pushes back dispatching, even though it is still among the
+   * last 16 frames.
+   */
+  for (i = test->slow_frame_count + 12; i < n_timings; i++)
+    {
+      g_assert_cmpint (timings[i].max_render_time_us, <,
+                       slow_render_time_us);
+    }
+
+  measured_frame_clock_test_free (test);
+}
+
+typedef struct _PredictorData
+{
+  int n_calls;
+  int max_n_render_times;
+  gboolean destroyed;
+} PredictorData;
+
+static int64_t
+constant_render_time_predictor (const int64_t *render_times_us,
+                                int            n_render_times,
+                                gpointer       user_data)
+{
+  PredictorData *data = user_data;
+
+  g_assert_cmpint (n_render_times, >, 0);
+  g_assert_cmpint (render_times_us[0], >=, 2000);
+
+  data->n_calls++;
+  data->max_n_render_times = MAX (data->max_n_render_times, n_render_times);
+
+  return 4000;
+}
+
+static void
+destroy_predictor_data (gpointer user_data)
+{
+  PredictorData *data = user_data;
+
+  data->destroyed = TRUE;
+}
+
+static void
+frame_clock_render_time_predictor (void)
+{
+  MeasuredFrameClockTest *test;
+  PredictorData data = { 0 };
+  ClutterFrameTimings timings[32];
+  int n_timings;
+  int i;
+
+  test = measured_frame_clock_test_new (2000 * 1000);
+  test->slow_frame_count = 10;
+  test->slow_gpu_rendering_duration_ns = 12000 * 1000;
+  clutter_frame_clock_set_render_time_predictor (test->frame_clock,
+                                                 constant_render_time_predictor,
+                                                 &data,
+                                                 destroy_predictor_data);
+
+  measured_frame_clock_test_run (test, 20);
+
+  g_assert_cmpint (data.n_calls, >, 0);
+  g_assert_cmpint (data.max_n_render_times, >, 1);
+
+  n_timings = clutter_frame_clock_get_frame_timings (test->frame_clock,
+                                                     timings,
+                                                     G_N_ELEMENTS (timings));
+  g_assert_cmpint (n_timings, ==, 20);
+
+  /* Once there are measurements, the slow frame no longer matters, as only
+   * the predictor decides.
+   */
+  for (i = 4; i < n_timings; i++)
+    {
+      g_assert_cmpint (timings[i].max_render_time_us, ==,
+                       timings[n_timings - 1].max_render_time_us);
+    }
+  g_assert_cmpint (timings[n_timings - 1].max_render_time_us, >=, 4000);
+
+  measured_frame_clock_test_free (test);
+
+  g_assert_true (data.destroyed);
+}
+
+#define ON_DEADLINE_FRAME_COUNT 3
+#define LATE_FRAME_COUNT 5
+
+static ClutterFrameResult
+missed_deadlines_frame_clock_frame (ClutterFrameClock *frame_clock,
+                                    int64_t            frame_count,
+                                    gpointer           user_data)
+{
+  FrameClockTest *test = user_data;
+  int64_t target_presentation_time_us;
+  int64_t presentation_time_us;
+
+  /* Report every frame as presented right on time, except for one exactly
+   * half a refresh cycle late, which still counts as on time, and one just
+   * past that.
+   */
+  target_presentation_time_us =
+    clutter_frame_clock_get_target_presentation_time_us (frame_clock);
+  if (target_presentation_time_us != 0)
+    {
+      presentation_time_us = target_presentation_time_us;
+      if (frame_count == ON_DEADLINE_FRAME_COUNT)
+        presentation_time_us += refresh_interval_us / 2;
+      else if (frame_count == LATE_FRAME_COUNT)
+        presentation_time_us += refresh_interval_us / 2 + 1;
+
+      test->fake_hw_clock->pending_presentation_time_us = presentation_time_us;
+    }
+
+  return frame_clock_frame (frame_clock, frame_count, user_data);
+}
+
+static const ClutterFrameListenerIface missed_deadlines_listener_iface = {
+  .frame = missed_deadlines_frame_clock_frame,
+};
+
+static void
+frame_clock_missed_deadlines (void)
+{
+  FrameClockTest test;
+  ClutterFrameClock *frame_clock;
+  ClutterFrameTimings timings[16];
+  FakeHwClock *fake_hw_clock;
+  GSource *source;
+  int n_timings;
+
+  test_frame_count = 10;
+  expected_frame_count = 0;
+
+  test.main_loop = g_main_loop_new (NULL, FALSE);
+  frame_clock = clutter_frame_clock_new (refresh_rate,
+                                         0,
+                                         &missed_deadlines_listener_iface,
+                                         &test);
+  fake_hw_clock = fake_hw_clock_new (frame_clock,
+                                     schedule_update_hw_callback,
+                                     frame_clock);
+  source = &fake_hw_clock->source;
+  g_source_attach (source, NULL);
+  test.fake_hw_clock = fake_hw_clock;
+
+  clutter_frame_clock_schedule_update (frame_clock);
+  g_main_loop_run (test.main_loop);
+
+  n_timings = clutter_frame_clock_get_frame_timings (frame_clock,
+                                                     timings,
+                                                     G_N_ELEMENTS (timings));
+  g_assert_cmpint (n_timings, ==, 10);
+
+  /* The first frame is dispatched right away, and thus has no deadline */
+  g_assert_cmpint (timings[0].target_presentation_time_us, ==, 0);
+  g_assert_cmpint (timings[ON_DEADLINE_FRAME_COUNT].target_presentation_time_us,
+                   >, 0);
+  g_assert_cmpint (timings[ON_DEADLINE_FRAME_COUNT].presentation_time_us -
+                   timings[ON_DEADLINE_FRAME_COUNT].target_presentation_time_us,
+                   ==, refresh_interval_us / 2);
+  g_assert_cmpint (timings[LATE_FRAME_COUNT].target_presentation_time_us, >, 0);
+  g_assert_cmpint (timings[LATE_FRAME_COUNT].presentation_time_us -
+                   timings[LATE_FRAME_COUNT].target_presentation_time_us,
+                   ==, refresh_interval_us / 2 + 1);
+  g_assert_cmpuint (clutter_frame_clock_get_missed_deadlines (frame_clock),
+                    ==, 1);
+
+  g_main_loop_unref (test.main_loop);
+  clutter_frame_clock_destroy (frame_clock);
+  g_source_destroy (source);
+  g_source_unref (source);
+}
+
+typedef struct _DispatchFrameClockTest
+{
+  GMainLoop *main_loop;
+  int n_dispatches;
+} DispatchFrameClockTest;
+
+static void
+dispatch_frame_clock_dispatch (ClutterFrameClock *frame_clock,
+                               int64_t            time_us,
+                               gpointer           user_data)
+{
+  DispatchFrameClockTest *test = user_data;
+
+  g_assert_cmpint (clutter_frame_clock_get_next_update_time_us (frame_clock),
+                   <=, time_us);
+  g_assert_cmpint (clutter_frame_clock_get_deadline_us (frame_clock),
+                   >=, clutter_frame_clock_get_next_update_time_us (frame_clock));
+
+  test->n_dispatches++;
+  clutter_frame_clock_dispatch_now (frame_clock, time_us);
+}
+
+static ClutterFrameResult
+dispatch_frame_clock_frame (ClutterFrameClock *frame_clock,
+                            int64_t            frame_count,
+                            gpointer           user_data)
+{
+  DispatchFrameClockTest *test = user_data;
+
+  g_assert_cmpint (test->n_dispatches, ==, frame_count + 1);
+
+  if (frame_count < 2)
+    clutter_frame_clock_schedule_update_now (frame_clock);
+  else
+    g_main_loop_quit (test->main_loop);
+
+  return CLUTTER_FRAME_RESULT_IDLE;
+}
+
+static const ClutterFrameListenerIface dispatch_frame_listener_iface = {
+  .dispatch = dispatch_frame_clock_dispatch,
+  .frame = dispatch_frame_clock_frame,
+};
+
+static void
+frame_clock_dispatch (void)
+{
+  DispatchFrameClockTest test = { 0 };
+  ClutterFrameClock *frame_clock;
+
+  test.main_loop = g_main_loop_new (NULL, FALSE);
+  frame_clock = clutter_frame_clock_new (refresh_rate,
+                                         0,
+                                         &dispatch_frame_listener_iface,
+                                         &test);
+
+  g_assert_cmpint (clutter_frame_clock_get_next_update_time_us (frame_clock),
+                   ==, -1);
+
+  clutter_frame_clock_schedule_update (frame_clock);
+  g_main_loop_run (test.main_loop);
+
+  g_assert_cmpint (test.n_dispatches, ==, 3);
+
+  g_main_loop_unref (test.main_loop);
+  clutter_frame_clock_destroy (frame_clock);
+}
+
 CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/frame-clock/schedule-update", frame_clock_schedule_update)
   CLUTTER_TEST_UNIT ("/frame-clock/immediate-present", frame_clock_immediate_present)
@@ -834,4 +1302,9 @@ CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/frame-clock/reschedule-on-idle", frame_clock_reschedule_on_idle)
   CLUTTER_TEST_UNIT ("/frame-clock/destroy-signal", frame_clock_destroy_signal)
   CLUTTER_TEST_UNIT ("/frame-clock/notify-ready", frame_clock_notify_ready)
+  CLUTTER_TEST_UNIT ("/frame-clock/triple-buffering", frame_clock_triple_buffering)
+  CLUTTER_TEST_UNIT ("/frame-clock/render-time-percentile", frame_clock_render_time_percentile)
+  CLUTTER_TEST_UNIT ("/frame-clock/render-time-predictor", frame_clock_render_time_predictor)
+  CLUTTER_TEST_UNIT ("/frame-clock/missed-deadlines", frame_clock_missed_deadlines)
+  CLUTTER_TEST_UNIT ("/frame-clock/dispatch", frame_clock_dispatch)
 )
@@ -0,0 +1,103 @@
+#include <clutter/clutter.h>
+#include <clutter/clutter-mutter.h>
+
+#include "tests/clutter-test-utils.h"
+
+typedef struct
+{
+  ClutterActor *actor;
+  int n_actor_damages;
+  int n_other_damages;
+} DamageCount;
+
+static void
+on_after_paint (ClutterStage     *stage,
+                ClutterStageView *view,
+                gboolean         *was_painted)
+{
+  *was_painted = TRUE;
+}
+
+static void
+wait_for_paint (ClutterActor *stage)
+{
+  gboolean was_painted = FALSE;
+  gulong handler_id;
+
+  handler_id = g_signal_connect (stage, "after-paint",
+                                 G_CALLBACK (on_after_paint),
+                                 &was_painted);
+  clutter_actor_queue_redraw (stage);
+
+  while (!was_painted)
+    g_main_context_iteration (NULL, FALSE);
+
+  g_signal_handler_disconnect (stage, handler_id);
+}
+
+static void
+count_damage (ClutterActor                *actor,
+              const cairo_rectangle_int_t *rect,
+              gpointer                     user_data)
+{
+  DamageCount *count = user_data;
+
+  if (actor && actor == count->actor)
+    count->n_actor_damages++;
+  else
+    count->n_other_damages++;
+}
+
+static void
+stage_damage_history_weak_actors (void)
+{
+  ClutterActor *stage;
+  ClutterActor *actor;
+  DamageCount count = { 0, };
+  uint64_t serial;
+
+  stage = clutter_test_get_stage ();
+
+  actor = clutter_actor_new ();
+  clutter_actor_set_size (actor, 50, 50);
+  clutter_actor_set_background_color (actor, CLUTTER_COLOR_Red);
+  clutter_actor_add_child (stage, actor);
+  g_object_add_weak_pointer (G_OBJECT (actor), (gpointer *) &actor);
+
+  clutter_actor_show (stage);
+  wait_for_paint (stage);
+
+  clutter_stage_track_damage_history (CLUTTER_STAGE (stage));
+  serial = clutter_stage_get_damage_serial (CLUTTER_STAGE (stage));
+
+  clutter_actor_queue_redraw (actor);
+  wait_for_paint (stage);
+
+  count.actor = actor;
+  g_assert_true (clutter_stage_foreach_damage_since (CLUTTER_STAGE (stage),
+                                                     serial,
+                                                     count_damage,
+                                                     &count));
+  g_assert_cmpint (count.n_actor_damages, >, 0);
+
+  /* The damage history must not keep the actor alive */
+  clutter_actor_destroy (actor);
+  g_assert_null (actor);
+
+  wait_for_paint (stage);
+
+  count = (DamageCount) { .actor = count.actor };
+  g_assert_true (clutter_stage_foreach_damage_since (CLUTTER_STAGE (stage),
+                                                     serial,
+                                                     count_damage,
+                                                     &count));
+  g_assert_cmpint (count.n_actor_damages, ==, 0);
+  g_assert_cmpint (count.n_other_damages, >, 0);
+
+  clutter_stage_untrack_damage_history (CLUTTER_STAGE (stage));
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/stage/damage-history/weak-actors",
+                     stage_damage_history_weak_actors)
+)
@@ -0,0 +1,303 @@
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <clutter/clutter.h>
+#include <clutter/clutter-mutter.h>
+
+#define DEFAULT_WIDTH 3840
+#define DEFAULT_HEIGHT 2160
+#define DEFAULT_N_ITERATIONS 100
+#define BPP 4
+
+typedef struct _Scenario
+{
+  const char *name;
+  void (* prepare) (uint8_t        *prev_data,
+                    uint8_t        *current_data,
+                    int             width,
+                    int             height,
+                    int             stride,
+                    cairo_region_t *damage_region);
+} Scenario;
+
+/* The scanline-by-scanline memcmp() implementation damage detection used
+ * before clutter_damage_tiles_find(), kept as the baseline. */
+static cairo_region_t *
+reference_find_damaged_tiles (const uint8_t        *current_data,
+                              const uint8_t        *prev_data,
+                              int                   width,
+                              int                   height,
+                              int                   stride,
+                              int                   bpp,
+                              const cairo_region_t *damage_region)
+{
+  cairo_region_t *tile_damage_region;
+  cairo_rectangle_int_t damage_extents;
+  const int tile_size = CLUTTER_DAMAGE_TILE_SIZE;
+  int tile_x, tile_y;
+
+  cairo_region_get_extents (damage_region, &damage_extents);
+
+  tile_damage_region = cairo_region_create ();
+
+  for (tile_y = damage_extents.y / tile_size;
+       tile_y * tile_size < damage_extents.y + damage_extents.height;
+       tile_y++)
+    {
+      for (tile_x = damage_extents.x / tile_size;
+           tile_x * tile_size < damage_extents.x + damage_extents.width;
+           tile_x++)
+        {
+          cairo_rectangle_int_t tile = {
+            .x = tile_x * tile_size,
+            .y = tile_y * tile_size,
+            .width = tile_size,
+            .height = tile_size,
+          };
+          int y;
+
+          if (cairo_region_contains_rectangle (damage_region, &tile) ==
+              CAIRO_REGION_OVERLAP_OUT)
+            continue;
+
+          if (tile.x >= width || tile.y >= height)
+            continue;
+
+          tile.width = MIN (tile.width, width - tile.x);
+          tile.height = MIN (tile.height, height - tile.y);
+
+          for (y = tile.y; y < tile.y + tile.height; y++)
+            {
+              if (memcmp (prev_data + y * stride + tile.x * bpp,
+                          current_data + y * stride + tile.x * bpp,
+                          tile.width * bpp) != 0)
+                {
+                  cairo_region_union_rectangle (tile_damage_region, &tile);
+                  break;
+                }
+            }
+        }
+    }
+
+  cairo_region_intersect (tile_damage_region, damage_region);
+
+  return tile_damage_region;
+}
+
+static void
+damage_everything (cairo_region_t *damage_region,
+                   int             width,
+                   int             height)
+{
+  cairo_rectangle_int_t rect = { .width = width, .height = height };
+
+  cairo_region_union_rectangle (damage_region, &rect);
+}
+
+static void
+prepare_unchanged (uint8_t        *prev_data,
+                   uint8_t        *current_data,
+                   int             width,
+                   int             height,
+                   int             stride,
+                   cairo_region_t *damage_region)
+{
+  damage_everything (damage_region, width, height);
+}
+
+static void
+prepare_sparse (uint8_t        *prev_data,
+                uint8_t        *current_data,
+                int             width,
+                int             height,
+                int             stride,
+                cairo_region_t *damage_region)
+{
+  int i;
+
+  damage_everything (damage_region, width, height);
+
+  /* A few changed pixels near the bottom right corner of their tiles, the
+   * worst case for the per tile early exit. */
+  for (i = 0; i < 64; i++)
+    {
+      int x = g_random_int_range (0, width / 16) * 16 + 15;
+      int y = g_random_int_range (0, height / 16) * 16 + 15;
+
+      current_data[y * stride + x * BPP] ^= 0xff;
+    }
+}
+
+static void
+prepare_dense (uint8_t        *prev_data,
+               uint8_t        *current_data,
+               int             width,
+               int             height,
+               int             stride,
+               cairo_region_t *damage_region)
+{
+  int y;
+
+  damage_everything (damage_region, width, height);
+
+  for (y = 0; y < height; y += 16)
+    memset (current_data + y * stride, 0x55, width * BPP);
+}
+
+static void
+prepare_partial (uint8_t        *prev_data,
+                 uint8_t        *current_data,
+                 int             width,
+                 int             height,
+                 int             stride,
+                 cairo_region_t *damage_region)
+{
+  int i;
+
+  /* A handful of unaligned damage rectangles, e.g. a blinking cursor and a
+   * few updating windows. */
+  for (i = 0; i < 8; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int y;
+
+      rect.width = g_random_int_range (8, width / 4);
+      rect.height = g_random_int_range (8, height / 4);
+      rect.x = g_random_int_range (0, width - rect.width);
+      rect.y = g_random_int_range (0, height - rect.height);
+      cairo_region_union_rectangle (damage_region, &rect);
+
+      if (i % 2)
+        continue;
+
+      for (y = rect.y; y < rect.y + rect.height; y += 7)
+        current_data[y * stride + (rect.x + rect.width / 2) * BPP] ^= 0xff;
+    }
+}
+
+static const Scenario scenarios[] = {
+  { "unchanged", prepare_unchanged },
+  { "sparse", prepare_sparse },
+  { "dense", prepare_dense },
+  { "partial", prepare_partial },
+};
+
+static double
+run_benchmark (cairo_region_t * (* find_func) (const uint8_t        *current_data,
+                                               const uint8_t        *prev_data,
+                                               int                   width,
+                                               int                   height,
+                                               int                   stride,
+                                               int                   bpp,
+                                               const cairo_region_t *damage_region),
+               const uint8_t         *current_data,
+               const uint8_t         *prev_data,
+               int                    width,
+               int                    height,
+               int                    stride,
+               const cairo_region_t  *damage_region,
+               int                    n_iterations,
+               cairo_region_t       **result)
+{
+  int64_t start_us;
+  int i;
+
+  start_us = g_get_monotonic_time ();
+
+  for (i = 0; i < n_iterations; i++)
+    {
+      cairo_region_t *region;
+
+      region = find_func (current_data, prev_data,
+                          width, height, stride, BPP,
+                          damage_region);
+      if (i == n_iterations - 1)
+        *result = region;
+      else
+        cairo_region_destroy (region);
+    }
+
+  return (g_get_monotonic_time () - start_us) / 1000.0 / n_iterations;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  int width = DEFAULT_WIDTH;
+  int height = DEFAULT_HEIGHT;
+  int n_iterations = DEFAULT_N_ITERATIONS;
+  int stride;
+  size_t size;
+  uint8_t *prev_data;
+  uint8_t *current_data;
+  gboolean failed = FALSE;
+  size_t i;
+
+  if (argc != 1 && argc != 4)
+    {
+      g_printerr ("Usage: test-damage-tiles [WIDTH HEIGHT ITERATIONS]\n");
+      return EXIT_FAILURE;
+    }
+
+  if (argc == 4)
+    {
+      width = atoi (argv[1]);
+      height = atoi (argv[2]);
+      n_iterations = MAX (atoi (argv[3]), 1);
+    }
+
+  stride = width * BPP;
+  size = (size_t) stride * height;
+  prev_data = g_malloc (size);
+  current_data = g_malloc (size);
+
+  g_print ("%dx%d, %d iterations\n", width, height, n_iterations);
+
+  for (i = 0; i < G_N_ELEMENTS (scenarios); i++)
+    {
+      const Scenario *scenario = &scenarios[i];
+      cairo_region_t *damage_region;
+      cairo_region_t *reference_region = NULL;
+      cairo_region_t *region = NULL;
+      double reference_ms;
+      double ms;
+      size_t j;
+
+      for (j = 0; j < size; j++)
+        prev_data[j] = j * 31;
+      memcpy (current_data, prev_data, size);
+
+      damage_region = cairo_region_create ();
+      scenario->prepare (prev_data, current_data, width, height, stride,
+                         damage_region);
+
+      reference_ms = run_benchmark (reference_find_damaged_tiles,
+                                    current_data, prev_data,
+                                    width, height, stride,
+                                    damage_region, n_iterations,
+                                    &reference_region);
+      ms = run_benchmark (clutter_damage_tiles_find,
+                          current_data, prev_data,
+                          width, height, stride,
+                          damage_region, n_iterations,
+                          &region);
+
+      g_print ("%-10s reference: %8.3f ms  tiles: %8.3f ms  (%.2fx)%s\n",
+               scenario->name, reference_ms, ms, reference_ms / ms,
+               cairo_region_equal (reference_region, region) ?
+               "" : "  MISMATCH");
+
+      if (!cairo_region_equal (reference_region, region))
+        failed = TRUE;
+
+      cairo_region_destroy (reference_region);
+      cairo_region_destroy (region);
+      cairo_region_destroy (damage_region);
+    }
+
+  g_free (prev_data);
+  g_free (current_data);
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
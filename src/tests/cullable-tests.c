@@ -0,0 +1,418 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "tests/cullable-tests.h"
+
+#include "compositor/meta-cullable.h"
+#include "compositor/region-utils.h"
+
+#define STAGE_SIZE 100
+
+/*
+ * A cullable actor that is opaque in its whole allocation, and remembers
+ * the clip region it was given, like MetaSurfaceActor does.
+ */
+#define META_TYPE_TEST_CULLABLE (meta_test_cullable_get_type ())
+G_DECLARE_FINAL_TYPE (MetaTestCullable, meta_test_cullable,
+                      META, TEST_CULLABLE, ClutterActor)
+
+struct _MetaTestCullable
+{
+  ClutterActor parent;
+
+  cairo_region_t *clip_region;
+};
+
+static void cullable_iface_init (MetaCullableInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (MetaTestCullable, meta_test_cullable,
+                         CLUTTER_TYPE_ACTOR,
+                         G_IMPLEMENT_INTERFACE (META_TYPE_CULLABLE,
+                                                cullable_iface_init))
+
+static void
+meta_test_cullable_cull_out (MetaCullable   *cullable,
+                             cairo_region_t *unobscured_region,
+                             cairo_region_t *clip_region)
+{
+  MetaTestCullable *test_cullable = META_TEST_CULLABLE (cullable);
+  ClutterActor *actor = CLUTTER_ACTOR (cullable);
+  cairo_rectangle_int_t rect;
+
+  g_clear_pointer (&test_cullable->clip_region, cairo_region_destroy);
+  if (clip_region)
+    test_cullable->clip_region = cairo_region_copy (clip_region);
+
+  if (clutter_actor_get_n_children (actor) > 0)
+    {
+      meta_cullable_cull_out_children (cullable,
+                                       unobscured_region,
+                                       clip_region);
+      return;
+    }
+
+  if (!unobscured_region || !clip_region)
+    return;
+
+  rect = (cairo_rectangle_int_t) {
+    .width = clutter_actor_get_width (actor),
+    .height = clutter_actor_get_height (actor),
+  };
+  cairo_region_subtract_rectangle (unobscured_region, &rect);
+  cairo_region_subtract_rectangle (clip_region, &rect);
+}
+
+static gboolean
+meta_test_cullable_is_untransformed (MetaCullable *cullable)
+{
+  return TRUE;
+}
+
+static void
+meta_test_cullable_reset_culling (MetaCullable *cullable)
+{
+  MetaTestCullable *test_cullable = META_TEST_CULLABLE (cullable);
+
+  g_clear_pointer (&test_cullable->clip_region, cairo_region_destroy);
+}
+
+static void
+cullable_iface_init (MetaCullableInterface *iface)
+{
+  iface->cull_out = meta_test_cullable_cull_out;
+  iface->is_untransformed = meta_test_cullable_is_untransformed;
+  iface->reset_culling = meta_test_cullable_reset_culling;
+}
+
+static void
+meta_test_cullable_finalize (GObject *object)
+{
+  MetaTestCullable *test_cullable = META_TEST_CULLABLE (object);
+
+  g_clear_pointer (&test_cullable->clip_region, cairo_region_destroy);
+
+  G_OBJECT_CLASS (meta_test_cullable_parent_class)->finalize (object);
+}
+
+static void
+meta_test_cullable_class_init (MetaTestCullableClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = meta_test_cullable_finalize;
+}
+
+static void
+meta_test_cullable_init (MetaTestCullable *test_cullable)
+{
+}
+
+/* An effect describing its painting through fixed regions. */
+#define META_TYPE_TEST_CULLABLE_EFFECT (meta_test_cullable_effect_get_type ())
+G_DECLARE_FINAL_TYPE (MetaTestCullableEffect, meta_test_cullable_effect,
+                      META, TEST_CULLABLE_EFFECT, ClutterEffect)
+
+struct _MetaTestCullableEffect
+{
+  ClutterEffect parent;
+
+  cairo_region_t *opaque_region;
+  cairo_region_t *background_region;
+  gboolean caches_actor;
+};
+
+static void cullable_effect_iface_init (MetaCullableEffectInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (MetaTestCullableEffect, meta_test_cullable_effect,
+                         CLUTTER_TYPE_EFFECT,
+                         G_IMPLEMENT_INTERFACE (META_TYPE_CULLABLE_EFFECT,
+                                                cullable_effect_iface_init))
+
+static cairo_region_t *
+copy_region_or_null (cairo_region_t *region)
+{
+  return region ? cairo_region_copy (region) : NULL;
+}
+
+static cairo_region_t *
+meta_test_cullable_effect_get_opaque_region (MetaCullableEffect *effect)
+{
+  return copy_region_or_null (META_TEST_CULLABLE_EFFECT (effect)->opaque_region);
+}
+
+static cairo_region_t *
+meta_test_cullable_effect_get_background_region (MetaCullableEffect *effect)
+{
+  return copy_region_or_null (META_TEST_CULLABLE_EFFECT (effect)->background_region);
+}
+
+static gboolean
+meta_test_cullable_effect_caches_actor (MetaCullableEffect *effect)
+{
+  return META_TEST_CULLABLE_EFFECT (effect)->caches_actor;
+}
+
+static void
+cullable_effect_iface_init (MetaCullableEffectInterface *iface)
+{
+  iface->get_opaque_region = meta_test_cullable_effect_get_opaque_region;
+  iface->get_background_region =
+    meta_test_cullable_effect_get_background_region;
+  iface->caches_actor = meta_test_cullable_effect_caches_actor;
+}
+
+static void
+meta_test_cullable_effect_finalize (GObject *object)
+{
+  MetaTestCullableEffect *effect = META_TEST_CULLABLE_EFFECT (object);
+
+  g_clear_pointer (&effect->opaque_region, cairo_region_destroy);
+  g_clear_pointer (&effect->background_region, cairo_region_destroy);
+
+  G_OBJECT_CLASS (meta_test_cullable_effect_parent_class)->finalize (object);
+}
+
+static void
+meta_test_cullable_effect_class_init (MetaTestCullableEffectClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = meta_test_cullable_effect_finalize;
+}
+
+static void
+meta_test_cullable_effect_init (MetaTestCullableEffect *effect)
+{
+}
+
+static MetaTestCullable *
+add_test_cullable (ClutterActor *parent,
+                   int           x,
+                   int           y,
+                   int           width,
+                   int           height)
+{
+  ClutterActor *actor;
+
+  actor = g_object_new (META_TYPE_TEST_CULLABLE, NULL);
+  clutter_actor_set_position (actor, x, y);
+  clutter_actor_set_size (actor, width, height);
+  clutter_actor_add_child (parent, actor);
+
+  return META_TEST_CULLABLE (actor);
+}
+
+static MetaTestCullableEffect *
+add_test_cullable_effect (MetaTestCullable *test_cullable)
+{
+  MetaTestCullableEffect *effect;
+
+  effect = g_object_new (META_TYPE_TEST_CULLABLE_EFFECT, NULL);
+  clutter_actor_add_effect (CLUTTER_ACTOR (test_cullable),
+                            CLUTTER_EFFECT (effect));
+
+  return effect;
+}
+
+static void
+cull_group (MetaTestCullable *group)
+{
+  cairo_rectangle_int_t rect = { 0, 0, STAGE_SIZE, STAGE_SIZE };
+  cairo_region_t *unobscured_region;
+  cairo_region_t *clip_region;
+
+  unobscured_region = cairo_region_create_rectangle (&rect);
+  clip_region = cairo_region_create_rectangle (&rect);
+
+  meta_cullable_cull_out (META_CULLABLE (group),
+                          unobscured_region,
+                          clip_region);
+
+  cairo_region_destroy (unobscured_region);
+  cairo_region_destroy (clip_region);
+}
+
+static void
+assert_clip_region (MetaTestCullable *test_cullable,
+                    cairo_region_t   *expected_region)
+{
+  g_assert_nonnull (test_cullable->clip_region);
+  g_assert_true (cairo_region_equal (test_cullable->clip_region,
+                                     expected_region));
+}
+
+static void
+meta_test_cullable_effect_opaque_region (void)
+{
+  cairo_rectangle_int_t rect = { 0, 0, STAGE_SIZE, STAGE_SIZE };
+  MetaTestCullable *group;
+  MetaTestCullable *bottom;
+  MetaTestCullable *top;
+  MetaTestCullableEffect *effect;
+  cairo_region_t *corners;
+
+  group = add_test_cullable (clutter_actor_new (), 0, 0,
+                             STAGE_SIZE, STAGE_SIZE);
+  bottom = add_test_cullable (CLUTTER_ACTOR (group), 0, 0,
+                              STAGE_SIZE, STAGE_SIZE);
+  top = add_test_cullable (CLUTTER_ACTOR (group), 0, 0,
+                           STAGE_SIZE, STAGE_SIZE);
+
+  /* Like a rounded clip, the effect keeps the actor opaque except for the
+   * corners, so only those are left to paint beneath.
+   */
+  effect = add_test_cullable_effect (top);
+  effect->opaque_region = cairo_region_create_rectangle (&rect);
+  meta_region_subtract_corners (effect->opaque_region, &rect, 10);
+
+  cull_group (group);
+
+  corners = cairo_region_create_rectangle (&rect);
+  cairo_region_subtract (corners, effect->opaque_region);
+  assert_clip_region (bottom, corners);
+  cairo_region_destroy (corners);
+
+  clutter_actor_destroy (clutter_actor_get_parent (CLUTTER_ACTOR (group)));
+}
+
+static void
+meta_test_cullable_effect_background_region (void)
+{
+  cairo_rectangle_int_t rect = { 0, 0, STAGE_SIZE, STAGE_SIZE };
+  cairo_rectangle_int_t background_rect = { 0, 0, 40, 40 };
+  MetaTestCullable *group;
+  MetaTestCullable *bottom;
+  MetaTestCullable *middle;
+  MetaTestCullable *top;
+  MetaTestCullableEffect *effect;
+  cairo_region_t *expected_region;
+
+  group = add_test_cullable (clutter_actor_new (), 0, 0,
+                             STAGE_SIZE, STAGE_SIZE);
+  bottom = add_test_cullable (CLUTTER_ACTOR (group), 0, 0,
+                              STAGE_SIZE, STAGE_SIZE);
+  middle = add_test_cullable (CLUTTER_ACTOR (group), 0, 0, 50, 50);
+  top = add_test_cullable (CLUTTER_ACTOR (group), 30, 30, 40, 40);
+
+  /* A background blur reads what is beneath the top actor, so everything
+   * there has to be painted, even where the middle actor covers it.
+   */
+  effect = add_test_cullable_effect (top);
+  effect->background_region = cairo_region_create_rectangle (&background_rect);
+
+  cull_group (group);
+
+  expected_region = cairo_region_create_rectangle (&rect);
+  assert_clip_region (middle, expected_region);
+
+  cairo_region_subtract_rectangle (expected_region,
+                                   &(cairo_rectangle_int_t) { 0, 0, 50, 50 });
+  assert_clip_region (bottom, expected_region);
+  cairo_region_destroy (expected_region);
+
+  clutter_actor_destroy (clutter_actor_get_parent (CLUTTER_ACTOR (group)));
+}
+
+static void
+meta_test_cullable_effect_caches_actor (void)
+{
+  cairo_rectangle_int_t rect = { 0, 0, STAGE_SIZE, STAGE_SIZE };
+  MetaTestCullable *group;
+  MetaTestCullable *bottom;
+  MetaTestCullable *cached;
+  MetaTestCullable *top;
+  MetaTestCullableEffect *effect;
+  cairo_region_t *expected_region;
+
+  group = add_test_cullable (clutter_actor_new (), 0, 0,
+                             STAGE_SIZE, STAGE_SIZE);
+  bottom = add_test_cullable (CLUTTER_ACTOR (group), 0, 0,
+                              STAGE_SIZE, STAGE_SIZE);
+  cached = add_test_cullable (CLUTTER_ACTOR (group), 0, 0, 50, 50);
+  top = add_test_cullable (CLUTTER_ACTOR (group), 0, 0, 20, 20);
+
+  effect = add_test_cullable_effect (cached);
+  effect->caches_actor = TRUE;
+
+  cull_group (group);
+
+  /* The cached actor must paint everything, even what is covered now, but
+   * still hides what is beneath it.
+   */
+  g_assert_nonnull (cached->clip_region);
+  g_assert_cmpint (cairo_region_contains_rectangle (cached->clip_region,
+                                                    &(cairo_rectangle_int_t) {
+                                                      0, 0, 50, 50
+                                                    }),
+                   ==, CAIRO_REGION_OVERLAP_IN);
+
+  expected_region = cairo_region_create_rectangle (&rect);
+  cairo_region_subtract_rectangle (expected_region,
+                                   &(cairo_rectangle_int_t) { 0, 0, 50, 50 });
+  assert_clip_region (bottom, expected_region);
+  cairo_region_destroy (expected_region);
+
+  g_assert_nonnull (top->clip_region);
+
+  clutter_actor_destroy (clutter_actor_get_parent (CLUTTER_ACTOR (group)));
+}
+
+static void
+meta_test_cullable_effect_unknown (void)
+{
+  cairo_rectangle_int_t rect = { 0, 0, STAGE_SIZE, STAGE_SIZE };
+  MetaTestCullable *group;
+  MetaTestCullable *bottom;
+  MetaTestCullable *top;
+  cairo_region_t *expected_region;
+
+  group = add_test_cullable (clutter_actor_new (), 0, 0,
+                             STAGE_SIZE, STAGE_SIZE);
+  bottom = add_test_cullable (CLUTTER_ACTOR (group), 0, 0,
+                              STAGE_SIZE, STAGE_SIZE);
+  top = add_test_cullable (CLUTTER_ACTOR (group), 0, 0,
+                           STAGE_SIZE, STAGE_SIZE);
+
+  /* Effects not describing their painting still prevent culling */
+  clutter_actor_add_effect (CLUTTER_ACTOR (top),
+                            clutter_desaturate_effect_new (1.0));
+
+  cull_group (group);
+
+  g_assert_null (top->clip_region);
+
+  expected_region = cairo_region_create_rectangle (&rect);
+  assert_clip_region (bottom, expected_region);
+  cairo_region_destroy (expected_region);
+
+  clutter_actor_destroy (clutter_actor_get_parent (CLUTTER_ACTOR (group)));
+}
+
+void
+init_cullable_tests (void)
+{
+  g_test_add_func ("/compositor/cullable/effect-opaque-region",
+                   meta_test_cullable_effect_opaque_region);
+  g_test_add_func ("/compositor/cullable/effect-background-region",
+                   meta_test_cullable_effect_background_region);
+  g_test_add_func ("/compositor/cullable/effect-caches-actor",
+                   meta_test_cullable_effect_caches_actor);
+  g_test_add_func ("/compositor/cullable/effect-unknown",
+                   meta_test_cullable_effect_unknown);
+}
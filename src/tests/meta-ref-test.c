@@ -76,6 +76,7 @@
 
 #include "backends/meta-backend-private.h"
 #include "backends/meta-stage-private.h"
+#include "backends/meta-virtual-monitor.h"
 #include "clutter/clutter/clutter-stage-view-private.h"
 
 typedef struct _Range
@@ -445,6 +446,74 @@ visualize_difference (cairo_surface_t *ref_image,
   return diff_image;
 }
 
+static gboolean
+verify_image (cairo_surface_t *ref_image,
+              cairo_surface_t *result_image,
+              const Range     *fuzz,
+              PixelDiffStat   *diff_stat,
+              const char      *test_name,
+              int              test_seq_no)
+{
+  cairo_surface_t *diff_image;
+  const char *build_dir;
+  g_autofree char *ref_image_copy_path = NULL;
+  g_autofree char *result_image_path = NULL;
+  g_autofree char *diff_image_path = NULL;
+
+  if (compare_images (ref_image, result_image, fuzz, diff_stat))
+    return TRUE;
+
+  diff_image = visualize_difference (ref_image, result_image, fuzz);
+
+  build_dir = g_test_get_dir (G_TEST_BUILT);
+  ref_image_copy_path =
+    g_strdup_printf ("%s/meson-logs/tests/ref-tests/%s_%d.ref.png",
+                     build_dir,
+                     test_name, test_seq_no);
+  result_image_path =
+    g_strdup_printf ("%s/meson-logs/tests/ref-tests/%s_%d.result.png",
+                     build_dir,
+                     test_name, test_seq_no);
+  diff_image_path =
+    g_strdup_printf ("%s/meson-logs/tests/ref-tests/%s_%d.diff.png",
+                     build_dir,
+                     test_name, test_seq_no);
+
+  g_mkdir_with_parents (g_path_get_dirname (ref_image_copy_path),
+                        0755);
+
+  g_assert_cmpint (cairo_surface_write_to_png (ref_image,
+                                               ref_image_copy_path),
+                   ==,
+                   CAIRO_STATUS_SUCCESS);
+  g_assert_cmpint (cairo_surface_write_to_png (result_image,
+                                               result_image_path),
+                   ==,
+                   CAIRO_STATUS_SUCCESS);
+  g_assert_cmpint (cairo_surface_write_to_png (diff_image,
+                                               diff_image_path),
+                   ==,
+                   CAIRO_STATUS_SUCCESS);
+
+  g_critical ("Pixel difference exceeds limits "
+              "(min: [%d, %d, %d, %d], "
+              "max: [%d, %d, %d, %d])\n"
+              "See %s, %s, and %s for details.",
+              diff_stat->ch[0].min_diff,
+              diff_stat->ch[1].min_diff,
+              diff_stat->ch[2].min_diff,
+              diff_stat->ch[3].min_diff,
+              diff_stat->ch[0].max_diff,
+              diff_stat->ch[1].max_diff,
+              diff_stat->ch[2].max_diff,
+              diff_stat->ch[3].max_diff,
+              ref_image_copy_path,
+              result_image_path,
+              diff_image_path);
+
+  return FALSE;
+}
+
 void
 meta_ref_test_verify_view (ClutterStageView *view,
                            const char       *test_name_unescaped,
@@ -508,52 +577,54 @@ meta_ref_test_verify_view (ClutterStageView *view,
       g_assert_cmpint (ref_status, ==, CAIRO_STATUS_SUCCESS);
       ensure_expected_format (&ref_image);
 
-      if (!compare_images (ref_image, view_image, &gl_fuzz,
-                           &diff_stat))
-        {
-          cairo_surface_t *diff_image;
-          const char *build_dir;
-          g_autofree char *ref_image_copy_path = NULL;
-          g_autofree char *result_image_path = NULL;
-          g_autofree char *diff_image_path = NULL;
-
-          diff_image = visualize_difference (ref_image, view_image,
-                                             &gl_fuzz);
-
-          build_dir = g_test_get_dir (G_TEST_BUILT);
-          ref_image_copy_path =
-            g_strdup_printf ("%s/meson-logs/tests/ref-tests/%s_%d.ref.png",
-                             build_dir,
-                             test_name, test_seq_no);
-          result_image_path =
-            g_strdup_printf ("%s/meson-logs/tests/ref-tests/%s_%d.result.png",
-                             build_dir,
-                             test_name, test_seq_no);
-          diff_image_path =
-            g_strdup_printf ("%s/meson-logs/tests/ref-tests/%s_%d.diff.png",
-                             build_dir,
-                             test_name, test_seq_no);
-
-          g_mkdir_with_parents (g_path_get_dirname (ref_image_copy_path),
-                                0755);
-
-          g_assert_cmpint (cairo_surface_write_to_png (ref_image,
-                                                       ref_image_copy_path),
-                           ==,
-                           CAIRO_STATUS_SUCCESS);
-          g_assert_cmpint (cairo_surface_write_to_png (view_image,
-                                                       result_image_path),
-                           ==,
-                           CAIRO_STATUS_SUCCESS);
-          g_assert_cmpint (cairo_surface_write_to_png (diff_image,
-                                                       diff_image_path),
-                           ==,
-                           CAIRO_STATUS_SUCCESS);
+      verify_image (ref_image, view_image, &gl_fuzz, &diff_stat,
+                    test_name, test_seq_no);
+    }
+
+  cairo_surface_destroy (view_image);
+  cairo_surface_destroy (ref_image);
+}
+
+cairo_surface_t *
+meta_ref_test_capture_view (ClutterStageView *view)
+{
+  return capture_view (view);
+}
+
+/**
+ * meta_ref_test_verify_image:
+ * @ref_image: the reference image
+ * @result_image: the image to compare against @ref_image
+ * @test_name_unescaped: the test path, used to name the result images
+ * @test_seq_no: the sequence number, used to name the result images
+ * @fuzz_min: smallest allowed difference of each pixel channel
+ * @fuzz_max: largest allowed difference of each pixel channel
+ *
+ * Like meta_ref_test_verify_view(), but compares two images captured by the
+ * test itself, e.g. to compare different implementations of the same
+ * rendering. The observed pixel difference is reported as a test message.
+ */
+void
+meta_ref_test_verify_image (cairo_surface_t *ref_image,
+                            cairo_surface_t *result_image,
+                            const char      *test_name_unescaped,
+                            int              test_seq_no,
+                            int              fuzz_min,
+                            int              fuzz_max)
+{
+  const Range fuzz = { fuzz_min, fuzz_max };
+  PixelDiffStat diff_stat = {};
+  g_autofree char *test_name = NULL;
+
+  test_name = g_strdup (test_name_unescaped + 1);
+  depathify (test_name);
 
-          g_critical ("Pixel difference exceeds limits "
-                      "(min: [%d, %d, %d, %d], "
-                      "max: [%d, %d, %d, %d])\n"
-                      "See %s, %s, and %s for details.",
+  if (verify_image (ref_image, result_image, &fuzz, &diff_stat,
+                    test_name, test_seq_no))
+    {
+      g_test_message ("%s_%d: pixel difference "
+                      "min: [%d, %d, %d, %d], max: [%d, %d, %d, %d]",
+                      test_name, test_seq_no,
                       diff_stat.ch[0].min_diff,
                       diff_stat.ch[1].min_diff,
                       diff_stat.ch[2].min_diff,
@@ -561,15 +632,8 @@ meta_ref_test_verify_view (ClutterStageView *view,
                       diff_stat.ch[0].max_diff,
                       diff_stat.ch[1].max_diff,
                       diff_stat.ch[2].max_diff,
-                      diff_stat.ch[3].max_diff,
-                      ref_image_copy_path,
-                      result_image_path,
-                      diff_image_path);
-        }
+                      diff_stat.ch[3].max_diff);
     }
-
-  cairo_surface_destroy (view_image);
-  cairo_surface_destroy (ref_image);
 }
 
 MetaReftestFlag
@@ -608,3 +672,74 @@ meta_ref_test_determine_ref_test_flag (void)
 
   return flags;
 }
+
+static MetaVirtualMonitor *virtual_monitor;
+
+static void
+setup_virtual_monitor (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaSettings *settings = meta_backend_get_settings (backend);
+  MetaMonitorManager *monitor_manager =
+    meta_backend_get_monitor_manager (backend);
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  g_autoptr (MetaVirtualMonitorInfo) monitor_info = NULL;
+  GError *error = NULL;
+  GList *views;
+
+  meta_settings_override_experimental_features (settings);
+  meta_settings_enable_experimental_feature (
+    settings,
+    META_EXPERIMENTAL_FEATURE_SCALE_MONITOR_FRAMEBUFFER);
+
+  monitor_info = meta_virtual_monitor_info_new (100, 100, 60.0,
+                                                "MetaTestVendor",
+                                                "MetaVirtualMonitor",
+                                                "0x1234");
+  virtual_monitor = meta_monitor_manager_create_virtual_monitor (monitor_manager,
+                                                                 monitor_info,
+                                                                 &error);
+  if (!virtual_monitor)
+    g_error ("Failed to create virtual monitor: %s", error->message);
+
+  meta_monitor_manager_reload (monitor_manager);
+
+  views = meta_renderer_get_views (renderer);
+  g_assert_cmpint (g_list_length (views), ==, 1);
+}
+
+static void
+tear_down_virtual_monitor (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaMonitorManager *monitor_manager =
+    meta_backend_get_monitor_manager (backend);
+
+  g_clear_object (&virtual_monitor);
+  meta_monitor_manager_reload (monitor_manager);
+}
+
+/**
+ * meta_ref_test_init_virtual_monitor:
+ * @context: the test context
+ *
+ * Adds a single 100x100 virtual monitor before the tests of @context run,
+ * and removes it again once they are done.
+ */
+void
+meta_ref_test_init_virtual_monitor (MetaContext *context)
+{
+  g_signal_connect (context, "before-tests",
+                    G_CALLBACK (setup_virtual_monitor), NULL);
+  g_signal_connect (context, "after-tests",
+                    G_CALLBACK (tear_down_virtual_monitor), NULL);
+}
+
+ClutterStageView *
+meta_ref_test_get_view (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+
+  return CLUTTER_STAGE_VIEW (meta_renderer_get_views (renderer)->data);
+}
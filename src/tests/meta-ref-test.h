@@ -18,10 +18,12 @@
 #ifndef META_REF_TEST_H
 #define META_REF_TEST_H
 
+#include <cairo.h>
 #include <glib.h>
 
 #include "clutter/clutter/clutter.h"
 #include "meta/boxes.h"
+#include "meta/meta-context.h"
 
 typedef enum _MetaReftestFlag
 {
@@ -34,6 +36,19 @@ void meta_ref_test_verify_view (ClutterStageView *view,
                                 int               test_seq_no,
                                 MetaReftestFlag   flags);
 
+cairo_surface_t * meta_ref_test_capture_view (ClutterStageView *view);
+
+void meta_ref_test_verify_image (cairo_surface_t *ref_image,
+                                 cairo_surface_t *result_image,
+                                 const char      *test_name,
+                                 int              test_seq_no,
+                                 int              fuzz_min,
+                                 int              fuzz_max);
+
 MetaReftestFlag meta_ref_test_determine_ref_test_flag (void);
 
+void meta_ref_test_init_virtual_monitor (MetaContext *context);
+
+ClutterStageView * meta_ref_test_get_view (void);
+
 #endif /* META_REF_TEST_H */
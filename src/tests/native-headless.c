@@ -21,6 +21,7 @@
 #include "config.h"
 
 #include "meta-test/meta-context-test.h"
+#include "tests/native-kms.h"
 #include "tests/native-screen-cast.h"
 #include "tests/native-virtual-monitor.h"
 
@@ -29,6 +30,7 @@ init_tests (void)
 {
   init_virtual_monitor_tests ();
   init_screen_cast_tests ();
+  init_kms_tests ();
 }
 
 int
@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+#include "config.h"
+
+#include "tests/native-kms.h"
+
+#include <drm_fourcc.h>
+
+#include "backends/native/meta-backend-native.h"
+#include "backends/native/meta-kms-cursor-manager.h"
+#include "backends/native/meta-kms-impl.h"
+#include "backends/native/meta-kms-plane-config-cache.h"
+#include "backends/native/meta-kms-plane-private.h"
+#include "backends/native/meta-kms-private.h"
+#include "backends/native/meta-kms-update.h"
+
+static gpointer
+get_thread_in_impl (MetaKmsImpl  *impl,
+                    gpointer      user_data,
+                    GError      **error)
+{
+  MetaKms *kms = meta_kms_impl_get_kms (impl);
+
+  g_assert_true (meta_kms_in_impl_task (kms));
+  g_assert_true (meta_kms_is_waiting_for_impl_task (kms));
+
+  return g_thread_self ();
+}
+
+static void
+meta_test_kms_impl_thread (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaKms *kms = meta_backend_native_get_kms (META_BACKEND_NATIVE (backend));
+  GThread *impl_thread;
+
+  if (!meta_kms_get_impl_thread_id (kms))
+    {
+      g_test_skip ("KMS impl context runs in the main thread");
+      return;
+    }
+
+  g_assert_false (meta_kms_in_impl_task (kms));
+
+  impl_thread = meta_kms_run_impl_task_sync (kms, get_thread_in_impl,
+                                             NULL, NULL);
+  g_assert_nonnull (impl_thread);
+  g_assert_true (impl_thread != g_thread_self ());
+
+  g_assert_false (meta_kms_in_impl_task (kms));
+  g_assert_false (meta_kms_is_waiting_for_impl_task (kms));
+}
+
+typedef struct
+{
+  GThread *main_thread;
+  gboolean callback_invoked;
+} CallbackData;
+
+static void
+on_callback_in_main (MetaKms  *kms,
+                     gpointer  user_data)
+{
+  CallbackData *data = user_data;
+
+  meta_assert_not_in_kms_impl (kms);
+  g_assert_true (g_thread_self () == data->main_thread);
+
+  data->callback_invoked = TRUE;
+}
+
+static gpointer
+queue_callback_in_impl (MetaKmsImpl  *impl,
+                        gpointer      user_data,
+                        GError      **error)
+{
+  MetaKms *kms = meta_kms_impl_get_kms (impl);
+
+  meta_kms_queue_callback (kms, on_callback_in_main, user_data, NULL);
+
+  return GINT_TO_POINTER (TRUE);
+}
+
+static void
+meta_test_kms_impl_callback (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaKms *kms = meta_backend_native_get_kms (META_BACKEND_NATIVE (backend));
+  CallbackData data = { 0 };
+
+  data.main_thread = g_thread_self ();
+
+  meta_kms_run_impl_task_sync (kms, queue_callback_in_impl, &data, NULL);
+  g_assert_false (data.callback_invoked);
+
+  while (!data.callback_invoked)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+typedef struct
+{
+  MetaKms *kms;
+  GThread *main_thread;
+  GThread *impl_thread;
+  gboolean task_done;
+} AsyncTaskData;
+
+static void
+on_async_task_done_in_main (MetaKms  *kms,
+                            gpointer  user_data)
+{
+  AsyncTaskData *data = user_data;
+
+  g_assert_true (g_thread_self () == data->main_thread);
+
+  data->task_done = TRUE;
+}
+
+static gpointer
+async_task_in_impl (MetaKmsImpl  *impl,
+                    gpointer      user_data,
+                    GError      **error)
+{
+  MetaKms *kms = meta_kms_impl_get_kms (impl);
+  AsyncTaskData *data = user_data;
+
+  g_assert_true (meta_kms_in_impl_task (kms));
+
+  data->impl_thread = g_thread_self ();
+  meta_kms_queue_callback (kms, on_async_task_done_in_main, data, NULL);
+
+  return GINT_TO_POINTER (TRUE);
+}
+
+static gpointer
+queue_async_task_thread_func (gpointer user_data)
+{
+  AsyncTaskData *data = user_data;
+
+  meta_kms_run_impl_task_async (data->kms, async_task_in_impl, data, NULL);
+
+  return NULL;
+}
+
+static void
+meta_test_kms_impl_task_async (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaKms *kms = meta_backend_native_get_kms (META_BACKEND_NATIVE (backend));
+  AsyncTaskData data = { 0 };
+  GThread *thread;
+
+  data.kms = kms;
+  data.main_thread = g_thread_self ();
+
+  thread = g_thread_new ("Test async KMS task",
+                         queue_async_task_thread_func,
+                         &data);
+  g_thread_join (thread);
+
+  while (!data.task_done)
+    g_main_context_iteration (NULL, TRUE);
+
+  if (meta_kms_get_impl_thread_id (kms))
+    g_assert_true (data.impl_thread != data.main_thread);
+  else
+    g_assert_true (data.impl_thread == data.main_thread);
+}
+
+static void
+meta_test_kms_cursor_placement (void)
+{
+  MetaKmsCursorPlacement placement;
+  MetaRectangle rect;
+
+  placement = (MetaKmsCursorPlacement) {
+    .layout = GRAPHENE_RECT_INIT (1920, 0, 1280, 720),
+    .scale = 2.0,
+    .transform = META_MONITOR_TRANSFORM_NORMAL,
+    .mode_width = 2560,
+    .mode_height = 1440,
+    .hotspot = GRAPHENE_POINT_INIT (4, 6),
+    .width = 48,
+    .height = 48,
+  };
+
+  rect = meta_kms_cursor_placement_calculate_rect (&placement,
+                                                   &GRAPHENE_POINT_INIT (2000.5,
+                                                                         100));
+  g_assert_cmpint (rect.x, ==, 153);
+  g_assert_cmpint (rect.y, ==, 188);
+  g_assert_cmpint (rect.width, ==, 48);
+  g_assert_cmpint (rect.height, ==, 48);
+
+  placement.transform = META_MONITOR_TRANSFORM_180;
+  rect = meta_kms_cursor_placement_calculate_rect (&placement,
+                                                   &GRAPHENE_POINT_INIT (2000.5,
+                                                                         100));
+  g_assert_cmpint (rect.x, ==, 2560 - (153 + 48));
+  g_assert_cmpint (rect.y, ==, 1440 - (188 + 48));
+  g_assert_cmpint (rect.width, ==, 48);
+  g_assert_cmpint (rect.height, ==, 48);
+}
+
+static void
+meta_test_kms_find_overlay_plane (void)
+{
+  static const uint32_t formats[] = {
+    DRM_FORMAT_XRGB8888,
+    DRM_FORMAT_NV12,
+  };
+  static const uint32_t rgb_formats[] = {
+    DRM_FORMAT_XRGB8888,
+  };
+  g_autoptr (MetaKmsUpdate) update = NULL;
+  MetaKmsPlane *primary_plane;
+  MetaKmsPlane *other_crtc_overlay_plane;
+  MetaKmsPlane *rgb_overlay_plane;
+  MetaKmsPlane *yuv_overlay_plane;
+  GList *planes = NULL;
+  MetaKmsPlane *plane;
+
+  primary_plane = meta_kms_plane_new_mock (META_KMS_PLANE_TYPE_PRIMARY,
+                                           NULL, 1 << 0 | 1 << 1,
+                                           formats, G_N_ELEMENTS (formats));
+  other_crtc_overlay_plane =
+    meta_kms_plane_new_mock (META_KMS_PLANE_TYPE_OVERLAY,
+                             NULL, 1 << 1,
+                             formats, G_N_ELEMENTS (formats));
+  rgb_overlay_plane =
+    meta_kms_plane_new_mock (META_KMS_PLANE_TYPE_OVERLAY,
+                             NULL, 1 << 0,
+                             rgb_formats, G_N_ELEMENTS (rgb_formats));
+  yuv_overlay_plane =
+    meta_kms_plane_new_mock (META_KMS_PLANE_TYPE_OVERLAY,
+                             NULL, 1 << 0 | 1 << 1,
+                             formats, G_N_ELEMENTS (formats));
+
+  planes = g_list_append (planes, primary_plane);
+  planes = g_list_append (planes, other_crtc_overlay_plane);
+  planes = g_list_append (planes, rgb_overlay_plane);
+  planes = g_list_append (planes, yuv_overlay_plane);
+
+  update = meta_kms_update_new (NULL);
+
+  plane = meta_kms_update_find_overlay_plane (update, planes, 0,
+                                              DRM_FORMAT_XRGB8888,
+                                              DRM_FORMAT_MOD_INVALID);
+  g_assert_true (plane == rgb_overlay_plane);
+
+  plane = meta_kms_update_find_overlay_plane (update, planes, 0,
+                                              DRM_FORMAT_NV12,
+                                              DRM_FORMAT_MOD_INVALID);
+  g_assert_true (plane == yuv_overlay_plane);
+
+  plane = meta_kms_update_find_overlay_plane (update, planes, 1,
+                                              DRM_FORMAT_XRGB8888,
+                                              DRM_FORMAT_MOD_INVALID);
+  g_assert_true (plane == other_crtc_overlay_plane);
+
+  plane = meta_kms_update_find_overlay_plane (update, planes, 0,
+                                              DRM_FORMAT_XRGB8888,
+                                              DRM_FORMAT_MOD_LINEAR);
+  g_assert_true (plane == rgb_overlay_plane);
+
+  /* Planes without a modifier list can't be assumed to handle tiling */
+  plane = meta_kms_update_find_overlay_plane (update, planes, 0,
+                                              DRM_FORMAT_XRGB8888,
+                                              I915_FORMAT_MOD_X_TILED);
+  g_assert_null (plane);
+
+  plane = meta_kms_update_find_overlay_plane (update, planes, 0,
+                                              DRM_FORMAT_ARGB2101010,
+                                              DRM_FORMAT_MOD_INVALID);
+  g_assert_null (plane);
+
+  plane = meta_kms_update_find_overlay_plane (update, planes, 2,
+                                              DRM_FORMAT_XRGB8888,
+                                              DRM_FORMAT_MOD_INVALID);
+  g_assert_null (plane);
+
+  g_list_free_full (planes, g_object_unref);
+}
+
+static void
+meta_test_kms_plane_config_cache (void)
+{
+  g_autoptr (MetaKmsPlaneConfigCache) cache = NULL;
+  MetaKmsPlaneConfig configs[] = {
+    {
+      .crtc_id = 40,
+      .plane_id = 31,
+      .format = DRM_FORMAT_XRGB8888,
+      .modifier = DRM_FORMAT_MOD_LINEAR,
+      .src_width = 1920 << 16,
+      .src_height = 1080 << 16,
+      .dst_width = 1920,
+      .dst_height = 1080,
+      .rotation = 1,
+    },
+    {
+      .crtc_id = 40,
+      .plane_id = 35,
+      .format = DRM_FORMAT_ARGB8888,
+      .modifier = DRM_FORMAT_MOD_LINEAR,
+      .src_width = 640 << 16,
+      .src_height = 480 << 16,
+      .dst_width = 640,
+      .dst_height = 480,
+      .rotation = 1,
+    },
+  };
+  MetaKmsPlaneConfig reordered_configs[2];
+  MetaKmsPlaneConfig other_config;
+
+  cache = meta_kms_plane_config_cache_new ();
+
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache, configs, 2),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_UNKNOWN);
+
+  meta_kms_plane_config_cache_store (cache, configs, 2,
+                                     META_KMS_PLANE_CONFIG_RESULT_PASSED);
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache, configs, 2),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_PASSED);
+
+  reordered_configs[0] = configs[1];
+  reordered_configs[1] = configs[0];
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache,
+                                                       reordered_configs, 2),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_PASSED);
+
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache, configs, 1),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_UNKNOWN);
+
+  /* Accepted configurations hold wherever the planes are placed */
+  configs[1].dst_x = 100;
+  configs[1].dst_y = 50;
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache, configs, 2),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_PASSED);
+
+  /* ... as long as they stay within the CRTC */
+  configs[1].is_partially_offscreen = TRUE;
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache, configs, 2),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_UNKNOWN);
+  configs[1].is_partially_offscreen = FALSE;
+
+  /* Showing another part of the buffer is a different configuration */
+  configs[1].src_x = 10 << 16;
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache, configs, 2),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_UNKNOWN);
+  configs[1].src_x = 0;
+
+  /* Rejections only hold at the rejected position */
+  meta_kms_plane_config_cache_store (cache, configs, 2,
+                                     META_KMS_PLANE_CONFIG_RESULT_REJECTED);
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache, configs, 2),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_REJECTED);
+  configs[1].dst_x = 0;
+  configs[1].dst_y = 0;
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache, configs, 2),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_PASSED);
+
+  other_config = configs[0];
+  other_config.modifier = I915_FORMAT_MOD_X_TILED;
+  meta_kms_plane_config_cache_store (cache, &other_config, 1,
+                                     META_KMS_PLANE_CONFIG_RESULT_REJECTED);
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache,
+                                                       &other_config, 1),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_REJECTED);
+  other_config.dst_x = 10;
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache,
+                                                       &other_config, 1),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_UNKNOWN);
+
+  meta_kms_plane_config_cache_clear (cache);
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache, configs, 2),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_UNKNOWN);
+  g_assert_cmpint (meta_kms_plane_config_cache_lookup (cache,
+                                                       &other_config, 1),
+                   ==,
+                   META_KMS_PLANE_CONFIG_RESULT_UNKNOWN);
+}
+
+void
+init_kms_tests (void)
+{
+  g_test_add_func ("/backends/native/kms/impl-thread",
+                   meta_test_kms_impl_thread);
+  g_test_add_func ("/backends/native/kms/impl-callback",
+                   meta_test_kms_impl_callback);
+  g_test_add_func ("/backends/native/kms/impl-task-async",
+                   meta_test_kms_impl_task_async);
+  g_test_add_func ("/backends/native/kms/cursor-placement",
+                   meta_test_kms_cursor_placement);
+  g_test_add_func ("/backends/native/kms/find-overlay-plane",
+                   meta_test_kms_find_overlay_plane);
+  g_test_add_func ("/backends/native/kms/plane-config-cache",
+                   meta_test_kms_plane_config_cache);
+}
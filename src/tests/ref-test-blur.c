@@ -0,0 +1,402 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "backends/meta-stage-private.h"
+#include "backends/native/meta-renderer-native.h"
+#include "meta-test/meta-context-test.h"
+#include "shell-blur-effect.h"
+#include "tests/meta-ref-test.h"
+
+#define N_MEASURED_FRAMES 20
+#define CHECKER_SIZE 10
+#define BLUR_SIGMA 20
+#define ALGORITHM_BLUR_MARGIN 10
+#define SHARED_BLUR_SIGMA 4
+#define SHARED_BLUR_MARGIN 14
+#define EDGE_DIFF_THRESHOLD 8
+
+typedef struct
+{
+  int64_t paint_start_us;
+  int64_t paint_time_us;
+  int n_painted_frames;
+} PaintTiming;
+
+static ClutterActor *
+create_checkerboard (ClutterActor *stage)
+{
+  ClutterActor *checkerboard;
+  int x, y;
+
+  checkerboard = clutter_actor_new ();
+  clutter_actor_set_size (checkerboard, 100, 100);
+  clutter_actor_set_background_color (checkerboard, CLUTTER_COLOR_Orange);
+  clutter_actor_add_child (stage, checkerboard);
+
+  for (y = 0; y < 100 / CHECKER_SIZE; y++)
+    {
+      for (x = y % 2; x < 100 / CHECKER_SIZE; x += 2)
+        {
+          ClutterActor *square;
+
+          square = clutter_actor_new ();
+          clutter_actor_set_position (square,
+                                      x * CHECKER_SIZE,
+                                      y * CHECKER_SIZE);
+          clutter_actor_set_size (square, CHECKER_SIZE, CHECKER_SIZE);
+          clutter_actor_set_background_color (square, CLUTTER_COLOR_SkyBlue);
+          clutter_actor_add_child (checkerboard, square);
+        }
+    }
+
+  return checkerboard;
+}
+
+static void
+on_before_paint (MetaStage           *stage,
+                 ClutterStageView    *view,
+                 ClutterPaintContext *paint_context,
+                 gpointer             user_data)
+{
+  PaintTiming *timing = user_data;
+
+  cogl_framebuffer_finish (clutter_stage_view_get_framebuffer (view));
+  timing->paint_start_us = g_get_monotonic_time ();
+}
+
+static void
+on_after_paint (MetaStage           *stage,
+                ClutterStageView    *view,
+                ClutterPaintContext *paint_context,
+                gpointer             user_data)
+{
+  PaintTiming *timing = user_data;
+
+  cogl_framebuffer_finish (clutter_stage_view_get_framebuffer (view));
+  timing->paint_time_us += g_get_monotonic_time () - timing->paint_start_us;
+  timing->n_painted_frames++;
+}
+
+static cairo_surface_t *
+capture_blurred_frames (ClutterActor *background,
+                        PaintTiming  *timing)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaStage *stage = META_STAGE (meta_backend_get_stage (backend));
+  ClutterStageView *view = meta_ref_test_get_view ();
+  MetaStageWatch *before_paint_watch;
+  MetaStageWatch *after_paint_watch;
+  cairo_surface_t *image = NULL;
+  int i;
+
+  /* Warm up, so shader compilation isn't part of the measurement */
+  cairo_surface_destroy (meta_ref_test_capture_view (view));
+
+  before_paint_watch = meta_stage_watch_view (stage, view,
+                                              META_STAGE_WATCH_BEFORE_PAINT,
+                                              on_before_paint,
+                                              timing);
+  after_paint_watch = meta_stage_watch_view (stage, view,
+                                             META_STAGE_WATCH_AFTER_PAINT,
+                                             on_after_paint,
+                                             timing);
+
+  for (i = 0; i < N_MEASURED_FRAMES; i++)
+    {
+      /* Damage what's beneath the blurred actor, so that the background
+       * is blurred again on every frame.
+       */
+      clutter_actor_queue_redraw (background);
+
+      g_clear_pointer (&image, cairo_surface_destroy);
+      image = meta_ref_test_capture_view (view);
+    }
+
+  meta_stage_remove_watch (stage, before_paint_watch);
+  meta_stage_remove_watch (stage, after_paint_watch);
+
+  return image;
+}
+
+static cairo_surface_t *
+crop_image (cairo_surface_t *image,
+            int              x,
+            int              y,
+            int              width,
+            int              height)
+{
+  cairo_surface_t *cropped;
+  cairo_t *cr;
+
+  cropped = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+
+  cr = cairo_create (cropped);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface (cr, image, -x, -y);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  return cropped;
+}
+
+static gboolean
+images_differ (cairo_surface_t *image_a,
+               cairo_surface_t *image_b,
+               int              x,
+               int              y,
+               int              width,
+               int              height)
+{
+  cairo_surface_t *area_a;
+  cairo_surface_t *area_b;
+  uint8_t *data_a;
+  uint8_t *data_b;
+  int stride;
+  gboolean differ = FALSE;
+  int row, column;
+
+  area_a = crop_image (image_a, x, y, width, height);
+  area_b = crop_image (image_b, x, y, width, height);
+  cairo_surface_flush (area_a);
+  cairo_surface_flush (area_b);
+
+  data_a = cairo_image_surface_get_data (area_a);
+  data_b = cairo_image_surface_get_data (area_b);
+  stride = cairo_image_surface_get_stride (area_a);
+
+  for (row = 0; row < height && !differ; row++)
+    {
+      for (column = 0; column < width * 4; column++)
+        {
+          int diff = data_a[row * stride + column] -
+                     data_b[row * stride + column];
+
+          if (ABS (diff) > EDGE_DIFF_THRESHOLD)
+            {
+              differ = TRUE;
+              break;
+            }
+        }
+    }
+
+  cairo_surface_destroy (area_a);
+  cairo_surface_destroy (area_b);
+
+  return differ;
+}
+
+static void
+verify_blurred_interior (cairo_surface_t *ref_image,
+                         cairo_surface_t *result_image,
+                         int              x,
+                         int              y,
+                         int              width,
+                         int              height,
+                         int              margin,
+                         int              seq,
+                         int              fuzz)
+{
+  cairo_surface_t *ref_interior;
+  cairo_surface_t *result_interior;
+
+  ref_interior = crop_image (ref_image,
+                             x + margin,
+                             y + margin,
+                             width - 2 * margin,
+                             height - 2 * margin);
+  result_interior = crop_image (result_image,
+                                x + margin,
+                                y + margin,
+                                width - 2 * margin,
+                                height - 2 * margin);
+
+  meta_ref_test_verify_image (ref_interior, result_interior,
+                              g_test_get_path (), seq,
+                              -fuzz, fuzz);
+
+  cairo_surface_destroy (ref_interior);
+  cairo_surface_destroy (result_interior);
+}
+
+static void
+meta_test_ref_test_blur_algorithms (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  ClutterActor *background;
+  ClutterActor *blurred_actor;
+  MetaShellBlurEffect *blur_effect;
+  cairo_surface_t *gaussian_image;
+  cairo_surface_t *kawase_image;
+  PaintTiming gaussian_timing = { 0 };
+  PaintTiming kawase_timing = { 0 };
+
+  background = create_checkerboard (stage);
+
+  blurred_actor = clutter_actor_new ();
+  clutter_actor_set_position (blurred_actor, 20, 20);
+  clutter_actor_set_size (blurred_actor, 60, 60);
+  blur_effect = meta_shell_blur_effect_new ();
+  meta_shell_blur_effect_set_mode (blur_effect, SHELL_BLUR_MODE_BACKGROUND);
+  meta_shell_blur_effect_set_sigma (blur_effect, BLUR_SIGMA);
+  clutter_actor_add_effect (blurred_actor, CLUTTER_EFFECT (blur_effect));
+  clutter_actor_add_child (stage, blurred_actor);
+
+  meta_shell_blur_effect_set_algorithm (blur_effect,
+                                        CLUTTER_BLUR_ALGORITHM_GAUSSIAN);
+  gaussian_image = capture_blurred_frames (background, &gaussian_timing);
+
+  meta_shell_blur_effect_set_algorithm (blur_effect,
+                                        CLUTTER_BLUR_ALGORITHM_DUAL_KAWASE);
+  kawase_image = capture_blurred_frames (background, &kawase_timing);
+
+  g_assert_cmpint (gaussian_timing.n_painted_frames, >=, N_MEASURED_FRAMES);
+  g_assert_cmpint (kawase_timing.n_painted_frames, >=, N_MEASURED_FRAMES);
+
+  g_test_message ("Gaussian blur: %" G_GINT64_FORMAT " µs per frame",
+                  gaussian_timing.paint_time_us /
+                  gaussian_timing.n_painted_frames);
+  g_test_message ("Dual kawase blur: %" G_GINT64_FORMAT " µs per frame",
+                  kawase_timing.paint_time_us /
+                  kawase_timing.n_painted_frames);
+
+  /* The dual kawase blur only approximates the gaussian one, and both
+   * handle the edges of the blurred area differently, so compare the
+   * interiors, where the checkerboard is blurred into a smooth gradient.
+   */
+  verify_blurred_interior (gaussian_image, kawase_image, 20, 20, 60, 60,
+                           ALGORITHM_BLUR_MARGIN, 0, 12);
+
+  cairo_surface_destroy (gaussian_image);
+  cairo_surface_destroy (kawase_image);
+
+  clutter_actor_destroy (blurred_actor);
+  clutter_actor_destroy (background);
+}
+
+static ClutterActor *
+create_blurred_actor (ClutterActor *stage,
+                      float         x,
+                      float         y,
+                      float         width,
+                      float         height)
+{
+  ClutterActor *blurred_actor;
+  MetaShellBlurEffect *blur_effect;
+
+  blurred_actor = clutter_actor_new ();
+  clutter_actor_set_position (blurred_actor, x, y);
+  clutter_actor_set_size (blurred_actor, width, height);
+  blur_effect = meta_shell_blur_effect_new ();
+  meta_shell_blur_effect_set_mode (blur_effect, SHELL_BLUR_MODE_BACKGROUND);
+  meta_shell_blur_effect_set_sigma (blur_effect, SHARED_BLUR_SIGMA);
+  clutter_actor_add_effect (blurred_actor, CLUTTER_EFFECT (blur_effect));
+  clutter_actor_add_child (stage, blurred_actor);
+
+  return blurred_actor;
+}
+
+static void
+meta_test_ref_test_blur_shared (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  ClutterActor *background;
+  ClutterActor *first_actor;
+  ClutterActor *separator;
+  ClutterActor *second_actor;
+  cairo_surface_t *shared_image;
+  cairo_surface_t *separate_image;
+  PaintTiming shared_timing = { 0 };
+  PaintTiming separate_timing = { 0 };
+
+  background = create_checkerboard (stage);
+
+  first_actor = create_blurred_actor (stage, 5, 10, 40, 80);
+  second_actor = create_blurred_actor (stage, 55, 10, 40, 80);
+
+  shared_image = capture_blurred_frames (background, &shared_timing);
+
+  /* Anything painted in between the two blurred actors, overlapping the
+   * second one, keeps them from sharing a blur pass, even if it's invisible.
+   */
+  separator = clutter_actor_new ();
+  clutter_actor_set_size (separator, 100, 100);
+  clutter_actor_set_background_color (separator, CLUTTER_COLOR_Transparent);
+  clutter_actor_insert_child_above (stage, separator, first_actor);
+
+  separate_image = capture_blurred_frames (background, &separate_timing);
+
+  g_assert_cmpint (shared_timing.n_painted_frames, >=, N_MEASURED_FRAMES);
+  g_assert_cmpint (separate_timing.n_painted_frames, >=, N_MEASURED_FRAMES);
+
+  g_test_message ("Shared blur: %" G_GINT64_FORMAT " µs per frame",
+                  shared_timing.paint_time_us /
+                  shared_timing.n_painted_frames);
+  g_test_message ("Separate blurs: %" G_GINT64_FORMAT " µs per frame",
+                  separate_timing.paint_time_us /
+                  separate_timing.n_painted_frames);
+
+  /* Near the edges, a shared blur pass reads the actual surroundings where
+   * a separate one clamps to the edge, so only the interiors must match.
+   * The edge facing the other actor tells whether the pass was shared.
+   */
+  g_assert_true (images_differ (separate_image, shared_image,
+                                45 - SHARED_BLUR_MARGIN, 10,
+                                SHARED_BLUR_MARGIN, 80));
+  verify_blurred_interior (separate_image, shared_image, 5, 10, 40, 80,
+                           SHARED_BLUR_MARGIN, 0, 2);
+  verify_blurred_interior (separate_image, shared_image, 55, 10, 40, 80,
+                           SHARED_BLUR_MARGIN, 1, 2);
+
+  cairo_surface_destroy (shared_image);
+  cairo_surface_destroy (separate_image);
+
+  clutter_actor_destroy (separator);
+  clutter_actor_destroy (second_actor);
+  clutter_actor_destroy (first_actor);
+  clutter_actor_destroy (background);
+}
+
+static void
+init_ref_test_blur_tests (void)
+{
+  g_test_add_func ("/tests/ref-test/blur-algorithms",
+                   meta_test_ref_test_blur_algorithms);
+  g_test_add_func ("/tests/ref-test/blur-shared",
+                   meta_test_ref_test_blur_shared);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_autoptr (MetaContext) context = NULL;
+
+  context = meta_create_test_context (META_CONTEXT_TEST_TYPE_HEADLESS,
+                                      META_CONTEXT_TEST_FLAG_NO_X11);
+  g_assert (meta_context_configure (context, &argc, &argv, NULL));
+
+  init_ref_test_blur_tests ();
+
+  meta_ref_test_init_virtual_monitor (context);
+
+  return meta_context_test_run_tests (META_CONTEXT_TEST (context));
+}
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include "compositor/meta-shaped-texture-private.h"
+#include "meta/prefs.h"
+#include "meta-test/meta-context-test.h"
+#include "meta_clip_effect.h"
+#include "tests/meta-ref-test.h"
+
+#define TEXTURE_SIZE 60
+#define TEXTURE_OFFSET 20
+#define STRIPE_WIDTH 6
+
+static CoglTexture *
+create_striped_texture (void)
+{
+  ClutterBackend *backend = clutter_get_default_backend ();
+  CoglContext *ctx = clutter_backend_get_cogl_context (backend);
+  g_autofree uint8_t *data = NULL;
+  CoglTexture *texture;
+  GError *error = NULL;
+  int x, y;
+
+  data = g_malloc (TEXTURE_SIZE * TEXTURE_SIZE * 3);
+  for (y = 0; y < TEXTURE_SIZE; y++)
+    {
+      for (x = 0; x < TEXTURE_SIZE; x++)
+        {
+          uint8_t *pixel = &data[(y * TEXTURE_SIZE + x) * 3];
+          gboolean is_dark = (x / STRIPE_WIDTH) % 2;
+
+          pixel[0] = is_dark ? 0x20 : 0xe0;
+          pixel[1] = 0x60;
+          pixel[2] = is_dark ? 0xc0 : 0x40;
+        }
+    }
+
+  texture = COGL_TEXTURE (cogl_texture_2d_new_from_data (ctx,
+                                                         TEXTURE_SIZE,
+                                                         TEXTURE_SIZE,
+                                                         COGL_PIXEL_FORMAT_RGB_888,
+                                                         TEXTURE_SIZE * 3,
+                                                         data,
+                                                         &error));
+  if (!texture)
+    g_error ("Failed to create texture: %s", error->message);
+
+  return texture;
+}
+
+static ClutterActor *
+create_textured_actor (ClutterActor       *stage,
+                       MetaShapedTexture **out_stex)
+{
+  ClutterActor *actor;
+  MetaShapedTexture *stex;
+  CoglTexture *texture;
+
+  texture = create_striped_texture ();
+  stex = meta_shaped_texture_new ();
+  meta_shaped_texture_set_texture (stex, texture);
+  cogl_object_unref (texture);
+
+  actor = clutter_actor_new ();
+  clutter_actor_set_position (actor, TEXTURE_OFFSET, TEXTURE_OFFSET);
+  clutter_actor_set_size (actor, TEXTURE_SIZE, TEXTURE_SIZE);
+  clutter_actor_set_content (actor, CLUTTER_CONTENT (stex));
+  clutter_actor_add_child (stage, actor);
+
+  *out_stex = stex;
+  return actor;
+}
+
+static void
+meta_test_ref_test_rounded_clip_direct (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  ClutterStageView *view = meta_ref_test_get_view ();
+  cairo_rectangle_int_t bounds = { 0, 0, TEXTURE_SIZE, TEXTURE_SIZE };
+  int padding[4] = { 0, };
+  float radius = meta_prefs_get_round_corner_radius ();
+  ClutterActor *background;
+  ClutterActor *actor;
+  MetaShapedTexture *stex;
+  MetaClipEffect *clip_effect;
+  cairo_region_t *opaque_region;
+  cairo_surface_t *offscreen_image;
+  cairo_surface_t *blended_image;
+  cairo_surface_t *opaque_image;
+
+  g_assert_cmpfloat (radius, >, 0);
+
+  background = clutter_actor_new ();
+  clutter_actor_set_size (background, 100, 100);
+  clutter_actor_set_background_color (background, CLUTTER_COLOR_Orange);
+  clutter_actor_add_child (stage, background);
+
+  actor = create_textured_actor (stage, &stex);
+
+  /* The offscreen MetaClipEffect is the reference for the direct paths */
+  clip_effect = meta_clip_effect_new ();
+  clutter_actor_add_effect (actor, CLUTTER_EFFECT (clip_effect));
+  meta_clip_effect_set_bounds (clip_effect, &bounds, padding);
+  offscreen_image = meta_ref_test_capture_view (view);
+  clutter_actor_remove_effect (actor, CLUTTER_EFFECT (clip_effect));
+
+  /* Without an opaque region, everything goes through the blended pipeline
+   * carrying the clip shader.
+   */
+  meta_shaped_texture_set_rounded_clip (stex, &bounds, radius);
+  blended_image = meta_ref_test_capture_view (view);
+
+  /* With an opaque region, the interior is painted with the unblended
+   * pipeline and the edges and corners with the clip shader or a corner
+   * mask, which must still blend with the background.
+   */
+  opaque_region = cairo_region_create_rectangle (&bounds);
+  meta_shaped_texture_set_opaque_region (stex, opaque_region);
+  cairo_region_destroy (opaque_region);
+  clutter_actor_queue_redraw (actor);
+  opaque_image = meta_ref_test_capture_view (view);
+
+  meta_ref_test_verify_image (offscreen_image, blended_image,
+                              g_test_get_path (), 0,
+                              -2, 2);
+  meta_ref_test_verify_image (offscreen_image, opaque_image,
+                              g_test_get_path (), 1,
+                              -8, 8);
+
+  cairo_surface_destroy (offscreen_image);
+  cairo_surface_destroy (blended_image);
+  cairo_surface_destroy (opaque_image);
+
+  clutter_actor_destroy (actor);
+  g_object_unref (stex);
+  clutter_actor_destroy (background);
+}
+
+static void
+meta_test_ref_test_rounded_clip_opaque_interior (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  ClutterStageView *view = meta_ref_test_get_view ();
+  cairo_rectangle_int_t bounds = { 0, 0, TEXTURE_SIZE, TEXTURE_SIZE };
+  cairo_rectangle_int_t interior;
+  float radius = meta_prefs_get_round_corner_radius ();
+  ClutterActor *background;
+  ClutterActor *actor;
+  MetaShapedTexture *stex;
+  cairo_region_t *opaque_region;
+  cairo_surface_t *blended_image;
+  cairo_surface_t *interior_image;
+  int corner;
+
+  g_assert_cmpfloat (radius, >, 0);
+
+  corner = MAX ((int) ceilf (radius), meta_prefs_get_border_width ());
+  g_assert_cmpint (TEXTURE_SIZE, >, 2 * corner);
+
+  background = clutter_actor_new ();
+  clutter_actor_set_size (background, 100, 100);
+  clutter_actor_set_background_color (background, CLUTTER_COLOR_Orange);
+  clutter_actor_add_child (stage, background);
+
+  actor = create_textured_actor (stage, &stex);
+  meta_shaped_texture_set_rounded_clip (stex, &bounds, radius);
+  blended_image = meta_ref_test_capture_view (view);
+
+  /* An opaque region that doesn't reach into the corner patches or the
+   * border is painted entirely with the unclipped unblended pipeline, and
+   * must match the clip shader, which leaves those pixels untouched.
+   */
+  interior = (cairo_rectangle_int_t) {
+    .x = corner,
+    .y = corner,
+    .width = TEXTURE_SIZE - 2 * corner,
+    .height = TEXTURE_SIZE - 2 * corner,
+  };
+  opaque_region = cairo_region_create_rectangle (&interior);
+  meta_shaped_texture_set_opaque_region (stex, opaque_region);
+  cairo_region_destroy (opaque_region);
+  clutter_actor_queue_redraw (actor);
+  interior_image = meta_ref_test_capture_view (view);
+
+  meta_ref_test_verify_image (blended_image, interior_image,
+                              g_test_get_path (), 0,
+                              -1, 1);
+
+  cairo_surface_destroy (blended_image);
+  cairo_surface_destroy (interior_image);
+
+  clutter_actor_destroy (actor);
+  g_object_unref (stex);
+  clutter_actor_destroy (background);
+}
+
+static void
+meta_test_ref_test_rounded_clip_corner_mask (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  ClutterStageView *view = meta_ref_test_get_view ();
+  cairo_rectangle_int_t bounds = { 0, 0, TEXTURE_SIZE, TEXTURE_SIZE };
+  float radius = meta_prefs_get_round_corner_radius ();
+  ClutterActor *background;
+  ClutterActor *actor;
+  MetaShapedTexture *stex;
+  cairo_region_t *opaque_region;
+  cairo_surface_t *blended_image;
+  cairo_surface_t *corners_image;
+  int corner;
+  int i;
+
+  g_assert_cmpfloat (radius, >, 0);
+
+  corner = MAX ((int) ceilf (radius), meta_prefs_get_border_width ());
+  g_assert_cmpint (TEXTURE_SIZE, >, 2 * corner);
+
+  background = clutter_actor_new ();
+  clutter_actor_set_size (background, 100, 100);
+  clutter_actor_set_background_color (background, CLUTTER_COLOR_Orange);
+  clutter_actor_add_child (stage, background);
+
+  actor = create_textured_actor (stage, &stex);
+  meta_shaped_texture_set_rounded_clip (stex, &bounds, radius);
+  blended_image = meta_ref_test_capture_view (view);
+
+  /* An opaque region made of the corner patches only is painted entirely
+   * from the shared corner mask, which must blend with the background
+   * like the clip shader does.
+   */
+  opaque_region = cairo_region_create ();
+  for (i = 0; i < 4; i++)
+    {
+      cairo_region_union_rectangle (opaque_region, &(cairo_rectangle_int_t) {
+        .x = i % 2 ? TEXTURE_SIZE - corner : 0,
+        .y = i / 2 ? TEXTURE_SIZE - corner : 0,
+        .width = corner,
+        .height = corner,
+      });
+    }
+  meta_shaped_texture_set_opaque_region (stex, opaque_region);
+  cairo_region_destroy (opaque_region);
+  clutter_actor_queue_redraw (actor);
+  corners_image = meta_ref_test_capture_view (view);
+
+  meta_ref_test_verify_image (blended_image, corners_image,
+                              g_test_get_path (), 0,
+                              -8, 8);
+
+  cairo_surface_destroy (blended_image);
+  cairo_surface_destroy (corners_image);
+
+  clutter_actor_destroy (actor);
+  g_object_unref (stex);
+  clutter_actor_destroy (background);
+}
+
+static void
+init_ref_test_rounded_clip_tests (void)
+{
+  g_test_add_func ("/tests/ref-test/rounded-clip-direct",
+                   meta_test_ref_test_rounded_clip_direct);
+  g_test_add_func ("/tests/ref-test/rounded-clip-opaque-interior",
+                   meta_test_ref_test_rounded_clip_opaque_interior);
+  g_test_add_func ("/tests/ref-test/rounded-clip-corner-mask",
+                   meta_test_ref_test_rounded_clip_corner_mask);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_autoptr (MetaContext) context = NULL;
+
+  context = meta_create_test_context (META_CONTEXT_TEST_TYPE_HEADLESS,
+                                      META_CONTEXT_TEST_FLAG_NO_X11);
+  g_assert (meta_context_configure (context, &argc, &argv, NULL));
+
+  init_ref_test_rounded_clip_tests ();
+
+  meta_ref_test_init_virtual_monitor (context);
+
+  return meta_context_test_run_tests (META_CONTEXT_TEST (context));
+}
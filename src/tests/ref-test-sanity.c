@@ -18,66 +18,10 @@
 
 #include "config.h"
 
-#include "backends/meta-virtual-monitor.h"
 #include "backends/native/meta-renderer-native.h"
 #include "meta-test/meta-context-test.h"
 #include "tests/meta-ref-test.h"
 
-static MetaVirtualMonitor *virtual_monitor;
-
-static void
-setup_test_environment (void)
-{
-  MetaBackend *backend = meta_get_backend ();
-  MetaSettings *settings = meta_backend_get_settings (backend);
-  MetaMonitorManager *monitor_manager =
-    meta_backend_get_monitor_manager (backend);
-  MetaRenderer *renderer = meta_backend_get_renderer (backend);
-  g_autoptr (MetaVirtualMonitorInfo) monitor_info = NULL;
-  GError *error = NULL;
-  GList *views;
-
-  meta_settings_override_experimental_features (settings);
-  meta_settings_enable_experimental_feature (
-    settings,
-    META_EXPERIMENTAL_FEATURE_SCALE_MONITOR_FRAMEBUFFER);
-
-  monitor_info = meta_virtual_monitor_info_new (100, 100, 60.0,
-                                                "MetaTestVendor",
-                                                "MetaVirtualMonitor",
-                                                "0x1234");
-  virtual_monitor = meta_monitor_manager_create_virtual_monitor (monitor_manager,
-                                                                 monitor_info,
-                                                                 &error);
-  if (!virtual_monitor)
-    g_error ("Failed to create virtual monitor: %s", error->message);
-
-  meta_monitor_manager_reload (monitor_manager);
-
-  views = meta_renderer_get_views (renderer);
-  g_assert_cmpint (g_list_length (views), ==, 1);
-}
-
-static void
-tear_down_test_environment (void)
-{
-  MetaBackend *backend = meta_get_backend ();
-  MetaMonitorManager *monitor_manager =
-    meta_backend_get_monitor_manager (backend);
-
-  g_object_unref (virtual_monitor);
-  meta_monitor_manager_reload (monitor_manager);
-}
-
-static ClutterStageView *
-get_view (void)
-{
-  MetaBackend *backend = meta_get_backend ();
-  MetaRenderer *renderer = meta_backend_get_renderer (backend);
-
-  return CLUTTER_STAGE_VIEW (meta_renderer_get_views (renderer)->data);
-}
-
 static void
 meta_test_ref_test_sanity (void)
 {
@@ -86,7 +30,7 @@ meta_test_ref_test_sanity (void)
   ClutterActor *actor1;
   ClutterActor *actor2;
 
-  meta_ref_test_verify_view (get_view (),
+  meta_ref_test_verify_view (meta_ref_test_get_view (),
                              g_test_get_path (), 0,
                              meta_ref_test_determine_ref_test_flag ());
 
@@ -96,7 +40,7 @@ meta_test_ref_test_sanity (void)
   clutter_actor_set_background_color (actor1, CLUTTER_COLOR_Orange);
   clutter_actor_add_child (stage, actor1);
 
-  meta_ref_test_verify_view (get_view (),
+  meta_ref_test_verify_view (meta_ref_test_get_view (),
                              g_test_get_path (), 1,
                              meta_ref_test_determine_ref_test_flag ());
 
@@ -110,7 +54,7 @@ meta_test_ref_test_sanity (void)
                          G_LOG_LEVEL_CRITICAL,
                          "Pixel difference exceeds limits*");
 
-  meta_ref_test_verify_view (get_view (),
+  meta_ref_test_verify_view (meta_ref_test_get_view (),
                              g_test_get_path (), 1,
                              meta_ref_test_determine_ref_test_flag ());
 
@@ -139,10 +83,7 @@ main (int    argc,
 
   init_ref_test_sanity_tests ();
 
-  g_signal_connect (context, "before-tests",
-                    G_CALLBACK (setup_test_environment), NULL);
-  g_signal_connect (context, "after-tests",
-                    G_CALLBACK (tear_down_test_environment), NULL);
+  meta_ref_test_init_virtual_monitor (context);
 
   return meta_context_test_run_tests (META_CONTEXT_TEST (context));
 }
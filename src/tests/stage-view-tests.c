@@ -17,6 +17,7 @@
 
 #include "config.h"
 
+#include "backends/meta-renderer-view.h"
 #include "clutter/clutter.h"
 #include "clutter/clutter-stage-view-private.h"
 #include "compositor/meta-window-actor-private.h"
@@ -1306,6 +1307,206 @@ meta_test_timeline_actor_tree_clear (void)
   clutter_actor_destroy (container2);
 }
 
+static CoglOffscreen *
+create_test_offscreen (CoglContext *cogl_context,
+                       int          width,
+                       int          height)
+{
+  CoglTexture2D *texture_2d;
+  CoglOffscreen *offscreen;
+  GError *error = NULL;
+
+  texture_2d = cogl_texture_2d_new_with_size (cogl_context, width, height);
+  offscreen = cogl_offscreen_new_with_texture (COGL_TEXTURE (texture_2d));
+  cogl_object_unref (texture_2d);
+
+  if (!cogl_framebuffer_allocate (COGL_FRAMEBUFFER (offscreen), &error))
+    g_error ("Failed to allocate offscreen: %s", error->message);
+
+  return offscreen;
+}
+
+static void
+draw_checkerboard (CoglFramebuffer *framebuffer,
+                   CoglPipeline    *pipelines[2],
+                   int              x,
+                   int              y,
+                   int              width,
+                   int              height,
+                   int              cell_size)
+{
+  int i, j;
+
+  for (j = 0; j < height; j += cell_size)
+    {
+      for (i = 0; i < width; i += cell_size)
+        {
+          CoglPipeline *pipeline = pipelines[(i / cell_size +
+                                              j / cell_size) % 2];
+
+          cogl_framebuffer_draw_rectangle (framebuffer, pipeline,
+                                           x + i, y + j,
+                                           x + MIN (i + cell_size, width),
+                                           y + MIN (j + cell_size, height));
+        }
+    }
+}
+
+static uint8_t *
+read_framebuffer (CoglFramebuffer *framebuffer)
+{
+  int width = cogl_framebuffer_get_width (framebuffer);
+  int height = cogl_framebuffer_get_height (framebuffer);
+  uint8_t *pixels;
+
+  pixels = g_malloc0 (width * height * 4);
+  g_assert_true (cogl_framebuffer_read_pixels (framebuffer,
+                                               0, 0, width, height,
+                                               COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                               pixels));
+  return pixels;
+}
+
+static void
+assert_pixels_equal (const uint8_t *pixels,
+                     const uint8_t *expected_pixels,
+                     int            width,
+                     int            height)
+{
+  int x, y;
+
+  for (y = 0; y < height; y++)
+    {
+      for (x = 0; x < width; x++)
+        {
+          const uint8_t *pixel = &pixels[(y * width + x) * 4];
+          const uint8_t *expected_pixel = &expected_pixels[(y * width + x) * 4];
+
+          if (memcmp (pixel, expected_pixel, 4) != 0)
+            {
+              g_error ("Pixel (%d, %d) is %02x%02x%02x%02x, "
+                       "expected %02x%02x%02x%02x",
+                       x, y,
+                       pixel[0], pixel[1], pixel[2], pixel[3],
+                       expected_pixel[0], expected_pixel[1],
+                       expected_pixel[2], expected_pixel[3]);
+            }
+        }
+    }
+}
+
+static void
+meta_test_stage_views_transformed_partial_redraw (void)
+{
+  MetaBackend *backend = meta_context_get_backend (test_context);
+  ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
+  CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  cairo_rectangle_int_t layout = { .x = 20, .y = 10, .width = 80, .height = 60 };
+  /* In stage coordinates; with the 1.5 scale, these cover the offscreen
+   * pixel rectangles (19, 10, 8, 5) and (112, 82, 8, 8), the latter
+   * touching the bottom right corner of the offscreen. */
+  cairo_rectangle_int_t damage_rects[] = {
+    { .x = 33, .y = 17, .width = 5, .height = 3 },
+    { .x = 95, .y = 65, .width = 5, .height = 5 },
+  };
+  cairo_rectangle_int_t offscreen_damage_rects[] = {
+    { .x = 19, .y = 10, .width = 8, .height = 5 },
+    { .x = 112, .y = 82, .width = 8, .height = 8 },
+  };
+  float scale = 1.5f;
+  int offscreen_width = 120;
+  int offscreen_height = 90;
+  CoglOffscreen *offscreen;
+  CoglOffscreen *view_offscreen;
+  CoglFramebuffer *framebuffer;
+  CoglFramebuffer *view_framebuffer;
+  CoglPipeline *initial_pipelines[2];
+  CoglPipeline *damage_pipelines[2];
+  MetaRendererView *view;
+  cairo_region_t *full_region;
+  cairo_region_t *damage_region;
+  g_autofree uint8_t *initial_pixels = NULL;
+  g_autofree uint8_t *partial_pixels = NULL;
+  g_autofree uint8_t *full_pixels = NULL;
+  int i;
+
+  offscreen = create_test_offscreen (cogl_context,
+                                     offscreen_width, offscreen_height);
+  view_offscreen = create_test_offscreen (cogl_context,
+                                          offscreen_height, offscreen_width);
+  framebuffer = COGL_FRAMEBUFFER (offscreen);
+  view_framebuffer = COGL_FRAMEBUFFER (view_offscreen);
+
+  view = g_object_new (META_TYPE_RENDERER_VIEW,
+                       "name", "transformed-partial-redraw",
+                       "stage", stage,
+                       "layout", &layout,
+                       "scale", scale,
+                       "framebuffer", view_framebuffer,
+                       "offscreen", offscreen,
+                       "transform", META_MONITOR_TRANSFORM_90,
+                       NULL);
+
+  for (i = 0; i < 2; i++)
+    {
+      initial_pipelines[i] = cogl_pipeline_new (cogl_context);
+      damage_pipelines[i] = cogl_pipeline_new (cogl_context);
+    }
+  cogl_pipeline_set_color4ub (initial_pipelines[0], 0xff, 0x00, 0x00, 0xff);
+  cogl_pipeline_set_color4ub (initial_pipelines[1], 0x00, 0x00, 0xff, 0xff);
+  cogl_pipeline_set_color4ub (damage_pipelines[0], 0x00, 0xff, 0x00, 0xff);
+  cogl_pipeline_set_color4ub (damage_pipelines[1], 0xff, 0xff, 0xff, 0xff);
+
+  cogl_framebuffer_orthographic (framebuffer,
+                                 0, 0, offscreen_width, offscreen_height,
+                                 -1, 100);
+  cogl_framebuffer_clear4f (view_framebuffer,
+                            COGL_BUFFER_BIT_COLOR, 0, 0, 0, 1);
+
+  full_region = cairo_region_create_rectangle (&layout);
+  damage_region = cairo_region_create_rectangles (damage_rects,
+                                                  G_N_ELEMENTS (damage_rects));
+
+  draw_checkerboard (framebuffer, initial_pipelines,
+                     0, 0, offscreen_width, offscreen_height, 3);
+  clutter_stage_view_after_paint (CLUTTER_STAGE_VIEW (view),
+                                  full_region, full_region);
+  initial_pixels = read_framebuffer (view_framebuffer);
+
+  for (i = 0; i < G_N_ELEMENTS (offscreen_damage_rects); i++)
+    {
+      cairo_rectangle_int_t *rect = &offscreen_damage_rects[i];
+
+      draw_checkerboard (framebuffer, damage_pipelines,
+                         rect->x, rect->y, rect->width, rect->height, 1);
+    }
+
+  clutter_stage_view_after_paint (CLUTTER_STAGE_VIEW (view),
+                                  damage_region, damage_region);
+  partial_pixels = read_framebuffer (view_framebuffer);
+  g_assert_false (memcmp (partial_pixels, initial_pixels,
+                          offscreen_width * offscreen_height * 4) == 0);
+
+  clutter_stage_view_after_paint (CLUTTER_STAGE_VIEW (view),
+                                  full_region, full_region);
+  full_pixels = read_framebuffer (view_framebuffer);
+
+  assert_pixels_equal (partial_pixels, full_pixels,
+                       offscreen_height, offscreen_width);
+
+  cairo_region_destroy (damage_region);
+  cairo_region_destroy (full_region);
+  for (i = 0; i < 2; i++)
+    {
+      cogl_object_unref (initial_pipelines[i]);
+      cogl_object_unref (damage_pipelines[i]);
+    }
+  g_object_unref (view);
+  g_object_unref (view_offscreen);
+  g_object_unref (offscreen);
+}
+
 static void
 init_tests (void)
 {
@@ -1339,6 +1540,8 @@ init_tests (void)
                    meta_test_timeline_actor_destroyed);
   g_test_add_func ("/stage-views/timeline/tree-clear",
                    meta_test_timeline_actor_tree_clear);
+  g_test_add_func ("/stage-views/transformed-partial-redraw",
+                   meta_test_stage_views_transformed_partial_redraw);
 }
 
 int
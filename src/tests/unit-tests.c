@@ -30,7 +30,9 @@
 #include "core/boxes-private.h"
 #include "meta-test/meta-context-test.h"
 #include "meta/meta-context.h"
+#include "tests/blur-list-tests.h"
 #include "tests/boxes-tests.h"
+#include "tests/cullable-tests.h"
 #include "tests/monitor-config-migration-unit-tests.h"
 #include "tests/monitor-unit-tests.h"
 #include "tests/monitor-store-unit-tests.h"
@@ -233,6 +235,8 @@ init_tests (void)
   init_boxes_tests ();
   init_monitor_transform_tests ();
   init_orientation_manager_tests ();
+  init_cullable_tests ();
+  init_blur_list_tests ();
 }
 
 int
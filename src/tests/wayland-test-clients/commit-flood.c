@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Commits new buffers as fast as possible without waiting for frame
+ * callbacks, only reusing buffers once released, and checks that throttled
+ * commits neither leak buffers nor frame callbacks.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+#include "wayland-test-client-utils.h"
+
+#include "xdg-shell-client-protocol.h"
+
+#define BUFFER_WIDTH 100
+#define BUFFER_HEIGHT 100
+#define N_BUFFERS 3
+#define N_COMMITS 500
+
+typedef struct _Buffer
+{
+  struct wl_buffer *buffer;
+  uint32_t *data;
+  gboolean busy;
+} Buffer;
+
+static struct wl_display *display;
+static struct wl_registry *registry;
+static struct wl_compositor *compositor;
+static struct xdg_wm_base *xdg_wm_base;
+static struct wl_shm *shm;
+
+static struct wl_surface *surface;
+static struct xdg_surface *xdg_surface;
+static struct xdg_toplevel *xdg_toplevel;
+
+static Buffer buffers[N_BUFFERS];
+
+static gboolean configured;
+static int n_pending_frame_callbacks;
+
+static void
+handle_buffer_release (void             *data,
+                       struct wl_buffer *wl_buffer)
+{
+  Buffer *buffer = data;
+
+  g_assert_true (buffer->busy);
+  buffer->busy = FALSE;
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+  handle_buffer_release
+};
+
+static void
+create_shm_buffers (void)
+{
+  struct wl_shm_pool *pool;
+  int fd, buffer_size, stride;
+  uint8_t *data;
+  int i;
+
+  stride = BUFFER_WIDTH * 4;
+  buffer_size = stride * BUFFER_HEIGHT;
+
+  fd = create_anonymous_file (buffer_size * N_BUFFERS);
+  if (fd < 0)
+    g_error ("Creating a buffer file failed: %m");
+
+  data = mmap (NULL, buffer_size * N_BUFFERS,
+               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+    g_error ("mmap failed: %m");
+
+  pool = wl_shm_create_pool (shm, fd, buffer_size * N_BUFFERS);
+  for (i = 0; i < N_BUFFERS; i++)
+    {
+      buffers[i].data = (uint32_t *) (data + i * buffer_size);
+      buffers[i].buffer = wl_shm_pool_create_buffer (pool, i * buffer_size,
+                                                     BUFFER_WIDTH,
+                                                     BUFFER_HEIGHT,
+                                                     stride,
+                                                     WL_SHM_FORMAT_XRGB8888);
+      wl_buffer_add_listener (buffers[i].buffer, &buffer_listener,
+                              &buffers[i]);
+    }
+  wl_shm_pool_destroy (pool);
+  close (fd);
+}
+
+static Buffer *
+wait_for_free_buffer (void)
+{
+  while (TRUE)
+    {
+      int i;
+
+      for (i = 0; i < N_BUFFERS; i++)
+        {
+          if (!buffers[i].busy)
+            return &buffers[i];
+        }
+
+      if (wl_display_dispatch (display) == -1)
+        g_error ("Lost connection to the compositor");
+    }
+}
+
+static void
+handle_frame_callback (void               *data,
+                       struct wl_callback *callback,
+                       uint32_t            time)
+{
+  n_pending_frame_callbacks--;
+  wl_callback_destroy (callback);
+}
+
+static const struct wl_callback_listener frame_listener = {
+  handle_frame_callback,
+};
+
+static void
+commit_buffer (int n)
+{
+  Buffer *buffer;
+  struct wl_callback *callback;
+  int i;
+
+  buffer = wait_for_free_buffer ();
+
+  for (i = 0; i < BUFFER_WIDTH * BUFFER_HEIGHT; i++)
+    buffer->data[i] = 0xff000000 | (n * 0x010203);
+
+  callback = wl_surface_frame (surface);
+  wl_callback_add_listener (callback, &frame_listener, NULL);
+  n_pending_frame_callbacks++;
+
+  wl_surface_attach (surface, buffer->buffer, 0, 0);
+  wl_surface_damage_buffer (surface, 0, 0, BUFFER_WIDTH, BUFFER_HEIGHT);
+  wl_surface_commit (surface);
+  buffer->busy = TRUE;
+
+  wl_display_flush (display);
+  if (wl_display_dispatch_pending (display) == -1)
+    g_error ("Lost connection to the compositor");
+}
+
+static void
+handle_xdg_toplevel_configure (void                *data,
+                               struct xdg_toplevel *xdg_toplevel,
+                               int32_t              width,
+                               int32_t              height,
+                               struct wl_array     *state)
+{
+}
+
+static void
+handle_xdg_toplevel_close (void                *data,
+                           struct xdg_toplevel *xdg_toplevel)
+{
+  g_assert_not_reached ();
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+  handle_xdg_toplevel_configure,
+  handle_xdg_toplevel_close,
+};
+
+static void
+handle_xdg_surface_configure (void               *data,
+                              struct xdg_surface *xdg_surface,
+                              uint32_t            serial)
+{
+  xdg_surface_ack_configure (xdg_surface, serial);
+  configured = TRUE;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+  handle_xdg_surface_configure,
+};
+
+static void
+handle_xdg_wm_base_ping (void               *data,
+                         struct xdg_wm_base *xdg_wm_base,
+                         uint32_t            serial)
+{
+  xdg_wm_base_pong (xdg_wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener xdg_wm_base_listener = {
+  handle_xdg_wm_base_ping,
+};
+
+static void
+handle_registry_global (void               *data,
+                        struct wl_registry *registry,
+                        uint32_t            id,
+                        const char         *interface,
+                        uint32_t            version)
+{
+  if (strcmp (interface, "wl_compositor") == 0)
+    {
+      compositor = wl_registry_bind (registry, id, &wl_compositor_interface, 4);
+    }
+  else if (strcmp (interface, "xdg_wm_base") == 0)
+    {
+      xdg_wm_base = wl_registry_bind (registry, id,
+                                      &xdg_wm_base_interface, 1);
+      xdg_wm_base_add_listener (xdg_wm_base, &xdg_wm_base_listener, NULL);
+    }
+  else if (strcmp (interface, "wl_shm") == 0)
+    {
+      shm = wl_registry_bind (registry,
+                              id, &wl_shm_interface, 1);
+    }
+}
+
+static void
+handle_registry_global_remove (void               *data,
+                               struct wl_registry *registry,
+                               uint32_t            name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+  handle_registry_global,
+  handle_registry_global_remove
+};
+
+int
+main (int    argc,
+      char **argv)
+{
+  int i;
+
+  display = wl_display_connect (NULL);
+  registry = wl_display_get_registry (display);
+  wl_registry_add_listener (registry, &registry_listener, NULL);
+  wl_display_roundtrip (display);
+
+  if (!shm)
+    {
+      fprintf (stderr, "No wl_shm global\n");
+      return EXIT_FAILURE;
+    }
+
+  if (!xdg_wm_base)
+    {
+      fprintf (stderr, "No xdg_wm_base global\n");
+      return EXIT_FAILURE;
+    }
+
+  surface = wl_compositor_create_surface (compositor);
+  xdg_surface = xdg_wm_base_get_xdg_surface (xdg_wm_base, surface);
+  xdg_surface_add_listener (xdg_surface, &xdg_surface_listener, NULL);
+  xdg_toplevel = xdg_surface_get_toplevel (xdg_surface);
+  xdg_toplevel_add_listener (xdg_toplevel, &xdg_toplevel_listener, NULL);
+  xdg_toplevel_set_title (xdg_toplevel, "commit-flood");
+  wl_surface_commit (surface);
+
+  while (!configured)
+    {
+      if (wl_display_dispatch (display) == -1)
+        return EXIT_FAILURE;
+    }
+
+  create_shm_buffers ();
+
+  for (i = 0; i < N_COMMITS; i++)
+    commit_buffer (i);
+
+  /* Every frame callback is eventually emitted, throttled or not. */
+  while (n_pending_frame_callbacks > 0)
+    {
+      if (wl_display_dispatch (display) == -1)
+        return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,444 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Queues a 24 fps video worth of frames up front, each committed with a
+ * target presentation time, and checks that every frame is presented, none
+ * before its target time, and with the 3:2 cadence of 24 fps content on a
+ * 60 Hz display. The target times are placed between vblanks, so that the
+ * expected vblank of each frame doesn't depend on timing jitter.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+#include "wayland-test-client-utils.h"
+
+#include "commit-timing-v1-client-protocol.h"
+#include "presentation-time-client-protocol.h"
+#include "xdg-shell-client-protocol.h"
+
+#define BUFFER_WIDTH 64
+#define BUFFER_HEIGHT 64
+#define N_FRAMES 12
+#define FRAME_INTERVAL_US (G_USEC_PER_SEC / 24)
+#define FIRST_FRAME_DELAY_FRAMES 3
+#define REFRESH_INTERVAL_US (G_USEC_PER_SEC / 60)
+#define PRESENTATION_TIME_SLACK_US 1000
+
+typedef struct _Frame
+{
+  struct wl_buffer *buffer;
+  int64_t target_time_us;
+  int64_t presented_time_us;
+  int64_t refresh_interval_us;
+  gboolean presented;
+  gboolean discarded;
+} Frame;
+
+static struct wl_display *display;
+static struct wl_registry *registry;
+static struct wl_compositor *compositor;
+static struct xdg_wm_base *xdg_wm_base;
+static struct wl_shm *shm;
+static struct wp_presentation *presentation;
+static struct wp_commit_timing_manager_v1 *commit_timing_manager;
+
+static struct wl_surface *surface;
+static struct xdg_surface *xdg_surface;
+static struct xdg_toplevel *xdg_toplevel;
+static struct wp_commit_timer_v1 *commit_timer;
+
+static Frame initial_frame;
+static Frame frames[N_FRAMES];
+
+static gboolean configured;
+static gboolean has_monotonic_clock;
+static int n_pending_feedbacks;
+
+static int64_t
+get_monotonic_time_us (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static void
+handle_buffer_release (void             *data,
+                       struct wl_buffer *wl_buffer)
+{
+  wl_buffer_destroy (wl_buffer);
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+  handle_buffer_release
+};
+
+static void
+create_shm_buffers (void)
+{
+  struct wl_shm_pool *pool;
+  int fd, buffer_size, stride;
+  uint8_t *data;
+  int i, j;
+
+  stride = BUFFER_WIDTH * 4;
+  buffer_size = stride * BUFFER_HEIGHT;
+
+  fd = create_anonymous_file (buffer_size * (N_FRAMES + 1));
+  if (fd < 0)
+    g_error ("Creating a buffer file failed: %m");
+
+  data = mmap (NULL, buffer_size * (N_FRAMES + 1),
+               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+    g_error ("mmap failed: %m");
+
+  pool = wl_shm_create_pool (shm, fd, buffer_size * (N_FRAMES + 1));
+  for (i = 0; i < N_FRAMES + 1; i++)
+    {
+      Frame *frame = i < N_FRAMES ? &frames[i] : &initial_frame;
+      uint32_t *pixels = (uint32_t *) (data + i * buffer_size);
+
+      for (j = 0; j < BUFFER_WIDTH * BUFFER_HEIGHT; j++)
+        pixels[j] = 0xff000000 | (i * 0x151515);
+
+      frame->buffer = wl_shm_pool_create_buffer (pool, i * buffer_size,
+                                                 BUFFER_WIDTH,
+                                                 BUFFER_HEIGHT,
+                                                 stride,
+                                                 WL_SHM_FORMAT_XRGB8888);
+      wl_buffer_add_listener (frame->buffer, &buffer_listener, NULL);
+    }
+  wl_shm_pool_destroy (pool);
+  munmap (data, buffer_size * (N_FRAMES + 1));
+  close (fd);
+}
+
+static void
+handle_feedback_sync_output (void                            *data,
+                             struct wp_presentation_feedback *feedback,
+                             struct wl_output                *output)
+{
+}
+
+static void
+handle_feedback_presented (void                            *data,
+                           struct wp_presentation_feedback *feedback,
+                           uint32_t                         tv_sec_hi,
+                           uint32_t                         tv_sec_lo,
+                           uint32_t                         tv_nsec,
+                           uint32_t                         refresh,
+                           uint32_t                         seq_hi,
+                           uint32_t                         seq_lo,
+                           uint32_t                         flags)
+{
+  Frame *frame = data;
+  uint64_t tv_sec;
+
+  tv_sec = ((uint64_t) tv_sec_hi << 32) | tv_sec_lo;
+  frame->presented_time_us = tv_sec * G_USEC_PER_SEC + tv_nsec / 1000;
+  frame->refresh_interval_us = refresh ? refresh / 1000
+                                       : REFRESH_INTERVAL_US;
+  frame->presented = TRUE;
+
+  n_pending_feedbacks--;
+  wp_presentation_feedback_destroy (feedback);
+}
+
+static void
+handle_feedback_discarded (void                            *data,
+                           struct wp_presentation_feedback *feedback)
+{
+  Frame *frame = data;
+
+  frame->discarded = TRUE;
+
+  n_pending_feedbacks--;
+  wp_presentation_feedback_destroy (feedback);
+}
+
+static const struct wp_presentation_feedback_listener feedback_listener = {
+  handle_feedback_sync_output,
+  handle_feedback_presented,
+  handle_feedback_discarded,
+};
+
+static void
+commit_frame (Frame *frame)
+{
+  struct wp_presentation_feedback *feedback;
+  uint64_t tv_sec;
+  uint32_t tv_nsec;
+
+  if (frame->target_time_us)
+    {
+      tv_sec = frame->target_time_us / G_USEC_PER_SEC;
+      tv_nsec = (frame->target_time_us % G_USEC_PER_SEC) * 1000;
+      wp_commit_timer_v1_set_timestamp (commit_timer,
+                                        tv_sec >> 32, tv_sec & 0xffffffff,
+                                        tv_nsec);
+    }
+
+  feedback = wp_presentation_feedback (presentation, surface);
+  wp_presentation_feedback_add_listener (feedback, &feedback_listener, frame);
+  n_pending_feedbacks++;
+
+  wl_surface_attach (surface, frame->buffer, 0, 0);
+  wl_surface_damage_buffer (surface, 0, 0, BUFFER_WIDTH, BUFFER_HEIGHT);
+  wl_surface_commit (surface);
+}
+
+static void
+handle_xdg_toplevel_configure (void                *data,
+                               struct xdg_toplevel *xdg_toplevel,
+                               int32_t              width,
+                               int32_t              height,
+                               struct wl_array     *state)
+{
+}
+
+static void
+handle_xdg_toplevel_close (void                *data,
+                           struct xdg_toplevel *xdg_toplevel)
+{
+  g_assert_not_reached ();
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+  handle_xdg_toplevel_configure,
+  handle_xdg_toplevel_close,
+};
+
+static void
+handle_xdg_surface_configure (void               *data,
+                              struct xdg_surface *xdg_surface,
+                              uint32_t            serial)
+{
+  xdg_surface_ack_configure (xdg_surface, serial);
+  configured = TRUE;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+  handle_xdg_surface_configure,
+};
+
+static void
+handle_xdg_wm_base_ping (void               *data,
+                         struct xdg_wm_base *xdg_wm_base,
+                         uint32_t            serial)
+{
+  xdg_wm_base_pong (xdg_wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener xdg_wm_base_listener = {
+  handle_xdg_wm_base_ping,
+};
+
+static void
+handle_presentation_clock_id (void                   *data,
+                              struct wp_presentation *presentation,
+                              uint32_t                clock_id)
+{
+  has_monotonic_clock = clock_id == CLOCK_MONOTONIC;
+}
+
+static const struct wp_presentation_listener presentation_listener = {
+  handle_presentation_clock_id,
+};
+
+static void
+handle_registry_global (void               *data,
+                        struct wl_registry *registry,
+                        uint32_t            id,
+                        const char         *interface,
+                        uint32_t            version)
+{
+  if (strcmp (interface, "wl_compositor") == 0)
+    {
+      compositor = wl_registry_bind (registry, id, &wl_compositor_interface, 4);
+    }
+  else if (strcmp (interface, "xdg_wm_base") == 0)
+    {
+      xdg_wm_base = wl_registry_bind (registry, id,
+                                      &xdg_wm_base_interface, 1);
+      xdg_wm_base_add_listener (xdg_wm_base, &xdg_wm_base_listener, NULL);
+    }
+  else if (strcmp (interface, "wl_shm") == 0)
+    {
+      shm = wl_registry_bind (registry,
+                              id, &wl_shm_interface, 1);
+    }
+  else if (strcmp (interface, "wp_presentation") == 0)
+    {
+      presentation = wl_registry_bind (registry, id,
+                                       &wp_presentation_interface, 1);
+      wp_presentation_add_listener (presentation, &presentation_listener,
+                                    NULL);
+    }
+  else if (strcmp (interface, "wp_commit_timing_manager_v1") == 0)
+    {
+      commit_timing_manager =
+        wl_registry_bind (registry, id,
+                          &wp_commit_timing_manager_v1_interface, 1);
+    }
+}
+
+static void
+handle_registry_global_remove (void               *data,
+                               struct wl_registry *registry,
+                               uint32_t            name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+  handle_registry_global,
+  handle_registry_global_remove
+};
+
+int
+main (int    argc,
+      char **argv)
+{
+  int64_t refresh_interval_us;
+  int64_t start_time_us;
+  int prev_n_vblanks = 0;
+  int i;
+
+  display = wl_display_connect (NULL);
+  registry = wl_display_get_registry (display);
+  wl_registry_add_listener (registry, &registry_listener, NULL);
+  wl_display_roundtrip (display);
+  wl_display_roundtrip (display);
+
+  if (!shm)
+    {
+      fprintf (stderr, "No wl_shm global\n");
+      return EXIT_FAILURE;
+    }
+
+  if (!xdg_wm_base)
+    {
+      fprintf (stderr, "No xdg_wm_base global\n");
+      return EXIT_FAILURE;
+    }
+
+  if (!presentation || !has_monotonic_clock)
+    {
+      fprintf (stderr, "No wp_presentation global with a monotonic clock\n");
+      return EXIT_FAILURE;
+    }
+
+  if (!commit_timing_manager)
+    {
+      fprintf (stderr, "No wp_commit_timing_manager_v1 global\n");
+      return EXIT_FAILURE;
+    }
+
+  surface = wl_compositor_create_surface (compositor);
+  xdg_surface = xdg_wm_base_get_xdg_surface (xdg_wm_base, surface);
+  xdg_surface_add_listener (xdg_surface, &xdg_surface_listener, NULL);
+  xdg_toplevel = xdg_surface_get_toplevel (xdg_surface);
+  xdg_toplevel_add_listener (xdg_toplevel, &xdg_toplevel_listener, NULL);
+  xdg_toplevel_set_title (xdg_toplevel, "commit-timing");
+  commit_timer = wp_commit_timing_manager_v1_get_timer (commit_timing_manager,
+                                                        surface);
+  wl_surface_commit (surface);
+
+  while (!configured)
+    {
+      if (wl_display_dispatch (display) == -1)
+        return EXIT_FAILURE;
+    }
+
+  create_shm_buffers ();
+
+  /* Find out when the vblanks are. */
+  commit_frame (&initial_frame);
+  while (n_pending_feedbacks > 0)
+    {
+      if (wl_display_dispatch (display) == -1)
+        return EXIT_FAILURE;
+    }
+  g_assert_true (initial_frame.presented);
+
+  refresh_interval_us = initial_frame.refresh_interval_us;
+  g_assert_cmpint (ABS (refresh_interval_us - REFRESH_INTERVAL_US), <, 100);
+
+  /* Queue every frame at once, like a video player with a decoded backlog.
+   * Starting a quarter of a refresh interval after a vblank, every target
+   * time is that far away from the closest vblank. */
+  start_time_us = initial_frame.presented_time_us +
+                  FIRST_FRAME_DELAY_FRAMES * refresh_interval_us +
+                  refresh_interval_us / 4;
+  while (start_time_us < get_monotonic_time_us () + refresh_interval_us)
+    start_time_us += 2 * refresh_interval_us;
+
+  for (i = 0; i < N_FRAMES; i++)
+    {
+      frames[i].target_time_us = start_time_us + i * FRAME_INTERVAL_US;
+      commit_frame (&frames[i]);
+    }
+  wl_display_flush (display);
+
+  while (n_pending_feedbacks > 0)
+    {
+      if (wl_display_dispatch (display) == -1)
+        return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < N_FRAMES; i++)
+    {
+      Frame *frame = &frames[i];
+
+      g_assert_false (frame->discarded);
+      g_assert_true (frame->presented);
+
+      g_message ("Frame %d presented %+.1f ms from its target time", i,
+                 (frame->presented_time_us - frame->target_time_us) / 1000.0);
+
+      /* Never before the target time */
+      g_assert_cmpint (frame->presented_time_us,
+                       >=, frame->target_time_us - PRESENTATION_TIME_SLACK_US);
+
+      if (i > 0)
+        {
+          int n_vblanks;
+
+          /* 24 fps on 60 Hz: frames alternately last 3 and 2 vblanks. */
+          n_vblanks = (frame->presented_time_us -
+                       frames[i - 1].presented_time_us +
+                       refresh_interval_us / 2) / refresh_interval_us;
+          g_assert_cmpint (n_vblanks, >=, 2);
+          g_assert_cmpint (n_vblanks, <=, 3);
+          if (i > 1)
+            g_assert_cmpint (n_vblanks + prev_n_vblanks, ==, 5);
+          prev_n_vblanks = n_vblanks;
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,367 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Replays the damage patterns a terminal emulator typically produces, i.e.
+ * many small per character cell or per line rectangles, onto a SHM buffer
+ * and measures how long the compositor takes to process each commit.
+ *
+ * Usage: shm-damage-benchmark [FRAMES]
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+#include "wayland-test-client-utils.h"
+
+#include "xdg-shell-client-protocol.h"
+
+#define N_COLUMNS 80
+#define N_ROWS 24
+#define CELL_WIDTH 10
+#define CELL_HEIGHT 20
+#define BUFFER_WIDTH (N_COLUMNS * CELL_WIDTH)
+#define BUFFER_HEIGHT (N_ROWS * CELL_HEIGHT)
+#define BPP 4
+
+#define DEFAULT_N_FRAMES 100
+
+typedef struct _Pattern
+{
+  const char *name;
+  void (* damage_frame) (int frame);
+} Pattern;
+
+static struct wl_display *display;
+static struct wl_registry *registry;
+static struct wl_compositor *compositor;
+static struct xdg_wm_base *xdg_wm_base;
+static struct wl_shm *shm;
+
+static struct wl_surface *surface;
+static struct xdg_surface *xdg_surface;
+static struct xdg_toplevel *xdg_toplevel;
+
+static struct wl_buffer *buffer;
+static uint32_t *buffer_data;
+
+static gboolean configured;
+
+static int n_damage_rects;
+
+static void
+damage_cells (int column,
+              int row,
+              int n_cells)
+{
+  int x, y;
+
+  for (y = row * CELL_HEIGHT; y < (row + 1) * CELL_HEIGHT; y++)
+    {
+      for (x = column * CELL_WIDTH; x < (column + n_cells) * CELL_WIDTH; x++)
+        buffer_data[y * BUFFER_WIDTH + x] ^= 0x00ffffff;
+    }
+
+  wl_surface_damage_buffer (surface,
+                            column * CELL_WIDTH, row * CELL_HEIGHT,
+                            n_cells * CELL_WIDTH, CELL_HEIGHT);
+  n_damage_rects++;
+}
+
+/* A character typed at the prompt, and the cursor moving along. */
+static void
+damage_typing (int frame)
+{
+  int column = frame % (N_COLUMNS - 1);
+
+  damage_cells (column, N_ROWS - 1, 1);
+  damage_cells (column + 1, N_ROWS - 1, 1);
+}
+
+/* A line being redrawn, e.g. by a shell prompt, one cell at a time. */
+static void
+damage_line_redraw (int frame)
+{
+  int column;
+
+  for (column = 0; column < N_COLUMNS; column++)
+    damage_cells (column, frame % N_ROWS, 1);
+}
+
+/* Output scrolling by, redrawing every line. */
+static void
+damage_scroll (int frame)
+{
+  int row;
+
+  for (row = 0; row < N_ROWS; row++)
+    damage_cells (0, row, N_COLUMNS);
+}
+
+/* A process monitor updating a few numbers in every row. */
+static void
+damage_process_monitor (int frame)
+{
+  int row;
+
+  for (row = 2; row < N_ROWS; row++)
+    {
+      damage_cells (6, row, 5);
+      damage_cells (41 + frame % 3, row, 4);
+      damage_cells (47, row, 4);
+      damage_cells (62, row, 8);
+    }
+}
+
+static const Pattern patterns[] = {
+  { "typing", damage_typing },
+  { "line-redraw", damage_line_redraw },
+  { "scroll", damage_scroll },
+  { "process-monitor", damage_process_monitor },
+};
+
+static void
+create_shm_buffer (void)
+{
+  struct wl_shm_pool *pool;
+  int fd, size, stride;
+
+  stride = BUFFER_WIDTH * BPP;
+  size = stride * BUFFER_HEIGHT;
+
+  /* Not a sealed memfd, so the buffer is never imported, and it's the damage
+   * uploads that are measured. */
+  fd = create_anonymous_file (size);
+  if (fd < 0)
+    g_error ("Creating a buffer file for %d B failed: %m", size);
+
+  buffer_data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (buffer_data == MAP_FAILED)
+    g_error ("mmap failed: %m");
+
+  memset (buffer_data, 0xff, size);
+
+  pool = wl_shm_create_pool (shm, fd, size);
+  buffer = wl_shm_pool_create_buffer (pool, 0,
+                                      BUFFER_WIDTH, BUFFER_HEIGHT,
+                                      stride,
+                                      WL_SHM_FORMAT_XRGB8888);
+  wl_shm_pool_destroy (pool);
+  close (fd);
+}
+
+static int
+compare_durations (gconstpointer a,
+                   gconstpointer b)
+{
+  int64_t duration_a = *(const int64_t *) a;
+  int64_t duration_b = *(const int64_t *) b;
+
+  return (duration_a > duration_b) - (duration_a < duration_b);
+}
+
+static void
+run_pattern (const Pattern *pattern,
+             int            n_frames)
+{
+  g_autofree int64_t *durations_us = NULL;
+  int64_t total_us = 0;
+  int frame;
+
+  durations_us = g_new0 (int64_t, n_frames);
+  n_damage_rects = 0;
+
+  for (frame = 0; frame < n_frames; frame++)
+    {
+      int64_t start_us;
+
+      pattern->damage_frame (frame);
+
+      /* The commit, including the texture upload, is processed before the
+       * compositor answers the sync request of the roundtrip. */
+      start_us = g_get_monotonic_time ();
+      wl_surface_attach (surface, buffer, 0, 0);
+      wl_surface_commit (surface);
+      if (wl_display_roundtrip (display) == -1)
+        g_error ("Lost connection to the compositor");
+
+      durations_us[frame] = g_get_monotonic_time () - start_us;
+      total_us += durations_us[frame];
+    }
+
+  qsort (durations_us, n_frames, sizeof (int64_t), compare_durations);
+
+  g_print ("%-16s %5d rects/frame  mean: %6" G_GINT64_FORMAT " us  "
+           "median: %6" G_GINT64_FORMAT " us  "
+           "p95: %6" G_GINT64_FORMAT " us\n",
+           pattern->name,
+           n_damage_rects / n_frames,
+           total_us / n_frames,
+           durations_us[n_frames / 2],
+           durations_us[n_frames * 95 / 100]);
+}
+
+static void
+handle_xdg_toplevel_configure (void                *data,
+                               struct xdg_toplevel *xdg_toplevel,
+                               int32_t              width,
+                               int32_t              height,
+                               struct wl_array     *state)
+{
+}
+
+static void
+handle_xdg_toplevel_close (void                *data,
+                           struct xdg_toplevel *xdg_toplevel)
+{
+  g_assert_not_reached ();
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+  handle_xdg_toplevel_configure,
+  handle_xdg_toplevel_close,
+};
+
+static void
+handle_xdg_surface_configure (void               *data,
+                              struct xdg_surface *xdg_surface,
+                              uint32_t            serial)
+{
+  xdg_surface_ack_configure (xdg_surface, serial);
+  configured = TRUE;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+  handle_xdg_surface_configure,
+};
+
+static void
+handle_xdg_wm_base_ping (void               *data,
+                         struct xdg_wm_base *xdg_wm_base,
+                         uint32_t            serial)
+{
+  xdg_wm_base_pong (xdg_wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener xdg_wm_base_listener = {
+  handle_xdg_wm_base_ping,
+};
+
+static void
+handle_registry_global (void               *data,
+                        struct wl_registry *registry,
+                        uint32_t            id,
+                        const char         *interface,
+                        uint32_t            version)
+{
+  if (strcmp (interface, "wl_compositor") == 0)
+    {
+      compositor = wl_registry_bind (registry, id, &wl_compositor_interface, 4);
+    }
+  else if (strcmp (interface, "xdg_wm_base") == 0)
+    {
+      xdg_wm_base = wl_registry_bind (registry, id,
+                                      &xdg_wm_base_interface, 1);
+      xdg_wm_base_add_listener (xdg_wm_base, &xdg_wm_base_listener, NULL);
+    }
+  else if (strcmp (interface, "wl_shm") == 0)
+    {
+      shm = wl_registry_bind (registry,
+                              id, &wl_shm_interface, 1);
+    }
+}
+
+static void
+handle_registry_global_remove (void               *data,
+                               struct wl_registry *registry,
+                               uint32_t            name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+  handle_registry_global,
+  handle_registry_global_remove
+};
+
+int
+main (int    argc,
+      char **argv)
+{
+  int n_frames = DEFAULT_N_FRAMES;
+  size_t i;
+
+  if (argc > 2)
+    {
+      fprintf (stderr, "Usage: shm-damage-benchmark [FRAMES]\n");
+      return EXIT_FAILURE;
+    }
+
+  if (argc == 2)
+    n_frames = MAX (atoi (argv[1]), 1);
+
+  display = wl_display_connect (NULL);
+  registry = wl_display_get_registry (display);
+  wl_registry_add_listener (registry, &registry_listener, NULL);
+  wl_display_roundtrip (display);
+
+  if (!shm)
+    {
+      fprintf (stderr, "No wl_shm global\n");
+      return EXIT_FAILURE;
+    }
+
+  if (!xdg_wm_base)
+    {
+      fprintf (stderr, "No xdg_wm_base global\n");
+      return EXIT_FAILURE;
+    }
+
+  surface = wl_compositor_create_surface (compositor);
+  xdg_surface = xdg_wm_base_get_xdg_surface (xdg_wm_base, surface);
+  xdg_surface_add_listener (xdg_surface, &xdg_surface_listener, NULL);
+  xdg_toplevel = xdg_surface_get_toplevel (xdg_surface);
+  xdg_toplevel_add_listener (xdg_toplevel, &xdg_toplevel_listener, NULL);
+  xdg_toplevel_set_title (xdg_toplevel, "shm-damage-benchmark");
+  wl_surface_commit (surface);
+
+  while (!configured)
+    {
+      if (wl_display_dispatch (display) == -1)
+        return EXIT_FAILURE;
+    }
+
+  create_shm_buffer ();
+
+  wl_surface_attach (surface, buffer, 0, 0);
+  wl_surface_damage_buffer (surface, 0, 0, BUFFER_WIDTH, BUFFER_HEIGHT);
+  wl_surface_commit (surface);
+  wl_display_roundtrip (display);
+
+  g_print ("%dx%d, %d frames per pattern\n",
+           BUFFER_WIDTH, BUFFER_HEIGHT, n_frames);
+
+  for (i = 0; i < G_N_ELEMENTS (patterns); i++)
+    run_pattern (&patterns[i], n_frames);
+
+  return EXIT_SUCCESS;
+}
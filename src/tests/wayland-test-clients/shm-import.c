@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Draws two frames from a sealed memfd backed SHM pool, the second one from
+ * a buffer at a non-zero pool offset and only partially damaged, with a sync
+ * point after each commit so the compositor can check how they are shown.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+#include "wayland-test-client-utils.h"
+
+#include "test-driver-client-protocol.h"
+#include "xdg-shell-client-protocol.h"
+
+#define BUFFER_WIDTH 100
+#define BUFFER_HEIGHT 100
+#define BPP 4
+
+static struct wl_display *display;
+static struct wl_registry *registry;
+static struct wl_compositor *compositor;
+static struct xdg_wm_base *xdg_wm_base;
+static struct wl_shm *shm;
+static struct test_driver *test_driver;
+
+static struct wl_surface *surface;
+static struct xdg_surface *xdg_surface;
+static struct xdg_toplevel *xdg_toplevel;
+
+static struct wl_buffer *buffers[2];
+static uint32_t *buffer_data[2];
+
+static gboolean waiting_for_configure;
+static gboolean running;
+
+static void
+create_shm_buffers (void)
+{
+  struct wl_shm_pool *pool;
+  int fd, size, stride;
+  void *data;
+  int i;
+
+  stride = BUFFER_WIDTH * BPP;
+  size = stride * BUFFER_HEIGHT;
+
+  fd = create_sealed_anonymous_file (size * G_N_ELEMENTS (buffers));
+  if (fd < 0)
+    g_error ("Creating a sealed buffer file for %d B failed: %m", size);
+
+  data = mmap (NULL, size * G_N_ELEMENTS (buffers),
+               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+    g_error ("mmap failed: %m");
+
+  pool = wl_shm_create_pool (shm, fd, size * G_N_ELEMENTS (buffers));
+  for (i = 0; i < G_N_ELEMENTS (buffers); i++)
+    {
+      buffers[i] = wl_shm_pool_create_buffer (pool, size * i,
+                                              BUFFER_WIDTH, BUFFER_HEIGHT,
+                                              stride,
+                                              WL_SHM_FORMAT_XRGB8888);
+      buffer_data[i] = (uint32_t *) ((uint8_t *) data + size * i);
+    }
+  wl_shm_pool_destroy (pool);
+  close (fd);
+}
+
+static void
+fill_rect (uint32_t *pixels,
+           int       x,
+           int       y,
+           int       width,
+           int       height,
+           uint32_t  color)
+{
+  int i, j;
+
+  for (j = y; j < y + height; j++)
+    {
+      for (i = x; i < x + width; i++)
+        pixels[j * BUFFER_WIDTH + i] = color;
+    }
+}
+
+static void
+fill_quadrants (uint32_t *pixels)
+{
+  int half_width = BUFFER_WIDTH / 2;
+  int half_height = BUFFER_HEIGHT / 2;
+
+  fill_rect (pixels, 0, 0, half_width, half_height, 0xffff0000);
+  fill_rect (pixels, half_width, 0, half_width, half_height, 0xff00ff00);
+  fill_rect (pixels, 0, half_height, half_width, half_height, 0xff0000ff);
+  fill_rect (pixels, half_width, half_height, half_width, half_height,
+             0xffffffff);
+}
+
+static void
+draw_first_frame (void)
+{
+  fill_quadrants (buffer_data[0]);
+
+  wl_surface_attach (surface, buffers[0], 0, 0);
+  wl_surface_damage (surface, 0, 0, BUFFER_WIDTH, BUFFER_HEIGHT);
+  wl_surface_commit (surface);
+  test_driver_sync_point (test_driver, 0, surface);
+}
+
+static void
+draw_second_frame (void)
+{
+  fill_quadrants (buffer_data[1]);
+  fill_rect (buffer_data[1], 30, 40, 30, 20, 0xffffff00);
+
+  wl_surface_attach (surface, buffers[1], 0, 0);
+  wl_surface_damage (surface, 30, 40, 30, 20);
+  wl_surface_commit (surface);
+  test_driver_sync_point (test_driver, 1, surface);
+}
+
+static void
+test_driver_handle_sync_event (void               *data,
+                               struct test_driver *test_driver,
+                               uint32_t            serial)
+{
+  switch (serial)
+    {
+    case 0:
+      draw_second_frame ();
+      break;
+    case 1:
+      running = FALSE;
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+static const struct test_driver_listener test_driver_listener = {
+  test_driver_handle_sync_event,
+};
+
+static void
+handle_xdg_toplevel_configure (void                *data,
+                               struct xdg_toplevel *xdg_toplevel,
+                               int32_t              width,
+                               int32_t              height,
+                               struct wl_array     *state)
+{
+}
+
+static void
+handle_xdg_toplevel_close (void                *data,
+                           struct xdg_toplevel *xdg_toplevel)
+{
+  g_assert_not_reached ();
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+  handle_xdg_toplevel_configure,
+  handle_xdg_toplevel_close,
+};
+
+static void
+handle_xdg_surface_configure (void               *data,
+                              struct xdg_surface *xdg_surface,
+                              uint32_t            serial)
+{
+  xdg_surface_ack_configure (xdg_surface, serial);
+
+  if (!waiting_for_configure)
+    return;
+
+  waiting_for_configure = FALSE;
+  draw_first_frame ();
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+  handle_xdg_surface_configure,
+};
+
+static void
+handle_xdg_wm_base_ping (void               *data,
+                         struct xdg_wm_base *xdg_wm_base,
+                         uint32_t            serial)
+{
+  xdg_wm_base_pong (xdg_wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener xdg_wm_base_listener = {
+  handle_xdg_wm_base_ping,
+};
+
+static void
+handle_registry_global (void               *data,
+                        struct wl_registry *registry,
+                        uint32_t            id,
+                        const char         *interface,
+                        uint32_t            version)
+{
+  if (strcmp (interface, "wl_compositor") == 0)
+    {
+      compositor = wl_registry_bind (registry, id, &wl_compositor_interface, 1);
+    }
+  else if (strcmp (interface, "xdg_wm_base") == 0)
+    {
+      xdg_wm_base = wl_registry_bind (registry, id,
+                                      &xdg_wm_base_interface, 1);
+      xdg_wm_base_add_listener (xdg_wm_base, &xdg_wm_base_listener, NULL);
+    }
+  else if (strcmp (interface, "wl_shm") == 0)
+    {
+      shm = wl_registry_bind (registry,
+                              id, &wl_shm_interface, 1);
+    }
+  else if (strcmp (interface, "test_driver") == 0)
+    {
+      test_driver = wl_registry_bind (registry, id, &test_driver_interface, 1);
+      test_driver_add_listener (test_driver, &test_driver_listener, NULL);
+    }
+}
+
+static void
+handle_registry_global_remove (void               *data,
+                               struct wl_registry *registry,
+                               uint32_t            name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+  handle_registry_global,
+  handle_registry_global_remove
+};
+
+int
+main (int    argc,
+      char **argv)
+{
+  display = wl_display_connect (NULL);
+  registry = wl_display_get_registry (display);
+  wl_registry_add_listener (registry, &registry_listener, NULL);
+  wl_display_roundtrip (display);
+
+  if (!shm)
+    {
+      fprintf (stderr, "No wl_shm global\n");
+      return EXIT_FAILURE;
+    }
+
+  if (!xdg_wm_base)
+    {
+      fprintf (stderr, "No xdg_wm_base global\n");
+      return EXIT_FAILURE;
+    }
+
+  g_assert_nonnull (test_driver);
+
+  create_shm_buffers ();
+
+  surface = wl_compositor_create_surface (compositor);
+  xdg_surface = xdg_wm_base_get_xdg_surface (xdg_wm_base, surface);
+  xdg_surface_add_listener (xdg_surface, &xdg_surface_listener, NULL);
+  xdg_toplevel = xdg_surface_get_toplevel (xdg_surface);
+  xdg_toplevel_add_listener (xdg_toplevel, &xdg_toplevel_listener, NULL);
+  xdg_toplevel_set_title (xdg_toplevel, "shm-import");
+  wl_surface_commit (surface);
+  waiting_for_configure = TRUE;
+
+  running = TRUE;
+  while (running)
+    {
+      if (wl_display_dispatch (display) == -1)
+        return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -23,12 +23,15 @@
  * SOFTWARE.
  */
 
+#include "config.h"
+
 #include "wayland-test-client-utils.h"
 
 #include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 static int
@@ -43,14 +46,13 @@ create_tmpfile_cloexec (char *tmpname)
   return fd;
 }
 
-int
-create_anonymous_file (off_t size)
+static int
+create_tmpfile (void)
 {
   static const char template[] = "/wayland-test-client-shared-XXXXXX";
   const char *path;
   char *name;
   int fd;
-  int ret;
 
   path = getenv ("XDG_RUNTIME_DIR");
   if (!path)
@@ -70,6 +72,16 @@ create_anonymous_file (off_t size)
 
   free (name);
 
+  return fd;
+}
+
+int
+create_anonymous_file (off_t size)
+{
+  int fd;
+  int ret;
+
+  fd = create_tmpfile ();
   if (fd < 0)
     return -1;
 
@@ -86,3 +98,35 @@ create_anonymous_file (off_t size)
 
   return fd;
 }
+
+/*
+ * Like most toolkits, use a memfd sealed against shrinking, which lets the
+ * compositor import the buffers without copying them, where enabled.
+ */
+int
+create_sealed_anonymous_file (off_t size)
+{
+#if defined(HAVE_MEMFD_CREATE)
+  int fd;
+
+  fd = memfd_create ("wayland-test-client-shared",
+                     MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0)
+    return -1;
+
+  if (ftruncate (fd, size) < 0 ||
+      fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK) < 0)
+    {
+      int errsv = errno;
+
+      close (fd);
+      errno = errsv;
+      return -1;
+    }
+
+  return fd;
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
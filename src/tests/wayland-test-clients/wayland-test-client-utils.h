@@ -5,4 +5,6 @@
 
 int create_anonymous_file (off_t size);
 
+int create_sealed_anonymous_file (off_t size);
+
 #endif /* WAYLAND_TEST_CLIENT_UTILS_H */
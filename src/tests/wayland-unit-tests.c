@@ -24,8 +24,13 @@
 #include "core/display-private.h"
 #include "core/window-private.h"
 #include "meta-test/meta-context-test.h"
+#include "tests/meta-ref-test.h"
 #include "tests/meta-wayland-test-driver.h"
 #include "wayland/meta-wayland.h"
+#include "wayland/meta-wayland-buffer.h"
+#include "wayland/meta-wayland-private.h"
+#include "wayland/meta-wayland-shm-importer.h"
+#include "wayland/meta-wayland-shm-uploader.h"
 #include "wayland/meta-wayland-surface.h"
 
 typedef struct _WaylandTestClient
@@ -448,6 +453,296 @@ toplevel_activation (void)
   g_test_assert_expected_messages ();
 }
 
+static cairo_region_t *
+region_from_rects (GArray *rects)
+{
+  return cairo_region_create_rectangles ((cairo_rectangle_int_t *) rects->data,
+                                         rects->len);
+}
+
+static void
+assert_coalesced_damage_covers (const cairo_region_t *region,
+                                GArray               *rects,
+                                int                   width)
+{
+  cairo_region_t *coalesced_region;
+  cairo_region_t *uncovered_region;
+  unsigned int i;
+
+  for (i = 0; i < rects->len; i++)
+    {
+      cairo_rectangle_int_t *rect =
+        &g_array_index (rects, cairo_rectangle_int_t, i);
+
+      g_assert_cmpint (rect->x, >=, 0);
+      g_assert_cmpint (rect->x + rect->width, <=, width);
+      g_assert_cmpint (rect->width, >, 0);
+      g_assert_cmpint (rect->height, >, 0);
+    }
+
+  coalesced_region = region_from_rects (rects);
+  uncovered_region = cairo_region_copy (region);
+  cairo_region_subtract (uncovered_region, coalesced_region);
+  g_assert_true (cairo_region_is_empty (uncovered_region));
+
+  cairo_region_destroy (uncovered_region);
+  cairo_region_destroy (coalesced_region);
+}
+
+static void
+shm_damage_coalescing (void)
+{
+  const int bpp = 4;
+  cairo_region_t *region;
+  GArray *rects;
+  cairo_rectangle_int_t *rect;
+  int i;
+
+  /* Nothing to upload */
+  region = cairo_region_create ();
+  rects = meta_wayland_shm_uploader_coalesce_damage (region, 800, bpp);
+  g_assert_cmpuint (rects->len, ==, 0);
+  g_array_unref (rects);
+  cairo_region_destroy (region);
+
+  /* Character cells typed on one line, with gaps between them, become a
+   * single upload, not widened to the whole row, which would upload a lot
+   * more */
+  region = cairo_region_create ();
+  for (i = 0; i < 10; i++)
+    {
+      cairo_region_union_rectangle (region, &(cairo_rectangle_int_t) {
+        .x = 100 + i * 10, .y = 32, .width = 8, .height = 16,
+      });
+    }
+  g_assert_cmpint (cairo_region_num_rectangles (region), ==, 10);
+  rects = meta_wayland_shm_uploader_coalesce_damage (region, 1920, bpp);
+  assert_coalesced_damage_covers (region, rects, 1920);
+  g_assert_cmpuint (rects->len, ==, 1);
+  rect = &g_array_index (rects, cairo_rectangle_int_t, 0);
+  g_assert_cmpint (rect->x, ==, 100);
+  g_assert_cmpint (rect->width, ==, 98);
+  g_array_unref (rects);
+  cairo_region_destroy (region);
+
+  /* A damaged span of a narrow buffer is widened to contiguous rows */
+  region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+    .x = 10, .y = 5, .width = 80, .height = 20,
+  });
+  rects = meta_wayland_shm_uploader_coalesce_damage (region, 100, bpp);
+  assert_coalesced_damage_covers (region, rects, 100);
+  g_assert_cmpuint (rects->len, ==, 1);
+  rect = &g_array_index (rects, cairo_rectangle_int_t, 0);
+  g_assert_cmpint (rect->x, ==, 0);
+  g_assert_cmpint (rect->width, ==, 100);
+  g_assert_cmpint (rect->y, ==, 5);
+  g_assert_cmpint (rect->height, ==, 20);
+  g_array_unref (rects);
+  cairo_region_destroy (region);
+
+  /* Damage far apart is cheaper to upload separately */
+  region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+    .x = 0, .y = 0, .width = 10, .height = 10,
+  });
+  cairo_region_union_rectangle (region, &(cairo_rectangle_int_t) {
+    .x = 3000, .y = 2000, .width = 10, .height = 10,
+  });
+  rects = meta_wayland_shm_uploader_coalesce_damage (region, 3840, bpp);
+  assert_coalesced_damage_covers (region, rects, 3840);
+  g_assert_cmpuint (rects->len, ==, 2);
+  g_array_unref (rects);
+  cairo_region_destroy (region);
+
+  /* Scattered damage is always covered, within the buffer, by no more
+   * rectangles than it had */
+  region = cairo_region_create ();
+  for (i = 0; i < 200; i++)
+    {
+      cairo_rectangle_int_t damage;
+
+      damage.width = g_test_rand_int_range (1, 64);
+      damage.height = g_test_rand_int_range (1, 32);
+      damage.x = g_test_rand_int_range (0, 1280 - damage.width);
+      damage.y = g_test_rand_int_range (0, 720 - damage.height);
+      cairo_region_union_rectangle (region, &damage);
+    }
+  rects = meta_wayland_shm_uploader_coalesce_damage (region, 1280, bpp);
+  assert_coalesced_damage_covers (region, rects, 1280);
+  g_assert_cmpuint (rects->len, <=, cairo_region_num_rectangles (region));
+  g_array_unref (rects);
+  cairo_region_destroy (region);
+}
+
+typedef struct _ShmImportData
+{
+  gboolean import_enabled;
+  cairo_surface_t *images[2];
+  unsigned int n_images;
+} ShmImportData;
+
+typedef struct _ShmImportSyncPoint
+{
+  ShmImportData *data;
+  unsigned int sequence;
+  MetaWaylandSurface *surface;
+} ShmImportSyncPoint;
+
+static cairo_surface_t *
+crop_image (cairo_surface_t *image,
+            MetaRectangle   *rect)
+{
+  cairo_surface_t *cropped_image;
+  cairo_t *cr;
+
+  cropped_image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                              rect->width, rect->height);
+  cr = cairo_create (cropped_image);
+  cairo_set_source_surface (cr, image, -rect->x, -rect->y);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  return cropped_image;
+}
+
+static gboolean
+capture_shm_import_frame_idle (gpointer user_data)
+{
+  ShmImportSyncPoint *sync_point = user_data;
+  ShmImportData *data = sync_point->data;
+  MetaBackend *backend = meta_context_get_backend (test_context);
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  MetaWaylandBuffer *buffer;
+  MetaWindow *window;
+  MetaWindowActor *window_actor;
+  MetaRectangle buffer_rect;
+  cairo_surface_t *image;
+
+  window = find_client_window ("shm-import");
+  g_assert_nonnull (window);
+  meta_window_move_frame (window, FALSE, 0, 0);
+
+  window_actor = meta_window_actor_from_window (window);
+  while (meta_window_actor_effect_in_progress (window_actor))
+    g_main_context_iteration (NULL, TRUE);
+
+  buffer = meta_wayland_surface_get_buffer (sync_point->surface);
+  g_assert_nonnull (buffer);
+  g_assert_cmpint (meta_wayland_buffer_is_copied (buffer),
+                   ==,
+                   !data->import_enabled);
+
+  clutter_actor_queue_redraw (stage);
+  clutter_stage_schedule_update (CLUTTER_STAGE (stage));
+  wait_for_paint (stage);
+
+  /* Only compare the window, as the window of the previous run may still be
+   * fading out around it. */
+  meta_window_get_buffer_rect (window, &buffer_rect);
+  image = meta_ref_test_capture_view (meta_ref_test_get_view ());
+  g_assert_cmpuint (sync_point->sequence, ==, data->n_images);
+  data->images[data->n_images++] = crop_image (image, &buffer_rect);
+  cairo_surface_destroy (image);
+
+  meta_wayland_test_driver_emit_sync_event (test_driver,
+                                            sync_point->sequence);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+on_shm_import_sync_point (MetaWaylandTestDriver *test_driver,
+                          unsigned int           sequence,
+                          struct wl_resource    *surface_resource,
+                          struct wl_client      *wl_client,
+                          ShmImportData         *data)
+{
+  ShmImportSyncPoint *sync_point;
+
+  sync_point = g_new0 (ShmImportSyncPoint, 1);
+  sync_point->data = data;
+  sync_point->sequence = sequence;
+  sync_point->surface = wl_resource_get_user_data (surface_resource);
+
+  g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                   capture_shm_import_frame_idle,
+                   sync_point, g_free);
+}
+
+static void
+run_shm_import_client (ShmImportData *data)
+{
+  WaylandTestClient *wayland_test_client;
+  gulong handler_id;
+
+  handler_id = g_signal_connect (test_driver, "sync-point",
+                                 G_CALLBACK (on_shm_import_sync_point),
+                                 data);
+  wayland_test_client = wayland_test_client_new ("shm-import");
+  wayland_test_client_finish (wayland_test_client);
+  g_signal_handler_disconnect (test_driver, handler_id);
+
+  g_assert_cmpuint (data->n_images, ==, G_N_ELEMENTS (data->images));
+
+  while (find_client_window ("shm-import"))
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+shm_import (void)
+{
+  MetaWaylandCompositor *compositor =
+    meta_context_get_wayland_compositor (test_context);
+  MetaWaylandShmImporter *importer = compositor->shm_importer;
+  gboolean was_enabled;
+  ShmImportData uploaded = {};
+  ShmImportData imported = {};
+  unsigned int i;
+
+  was_enabled = meta_wayland_shm_importer_is_enabled (importer);
+
+  meta_wayland_shm_importer_set_enabled (importer, FALSE);
+  uploaded.import_enabled = FALSE;
+  run_shm_import_client (&uploaded);
+
+  meta_wayland_shm_importer_set_enabled (importer, TRUE);
+  imported.import_enabled = meta_wayland_shm_importer_is_enabled (importer);
+  if (!imported.import_enabled)
+    g_test_message ("Importing SHM buffers is not supported, only testing the fallback");
+  run_shm_import_client (&imported);
+
+  meta_wayland_shm_importer_set_enabled (importer, was_enabled);
+
+  /* Sampling the buffers directly must look exactly like uploading them. */
+  for (i = 0; i < G_N_ELEMENTS (imported.images); i++)
+    {
+      meta_ref_test_verify_image (uploaded.images[i],
+                                  imported.images[i],
+                                  g_test_get_path (), i,
+                                  0, 0);
+      cairo_surface_destroy (uploaded.images[i]);
+      cairo_surface_destroy (imported.images[i]);
+    }
+}
+
+static void
+commit_flood (void)
+{
+  WaylandTestClient *wayland_test_client;
+
+  wayland_test_client = wayland_test_client_new ("commit-flood");
+  wayland_test_client_finish (wayland_test_client);
+}
+
+static void
+commit_timing (void)
+{
+  WaylandTestClient *wayland_test_client;
+
+  wayland_test_client = wayland_test_client_new ("commit-timing");
+  wayland_test_client_finish (wayland_test_client);
+}
+
 static void
 on_before_tests (void)
 {
@@ -495,6 +790,14 @@ init_tests (void)
                    toplevel_apply_limits);
   g_test_add_func ("/wayland/toplevel/activation",
                    toplevel_activation);
+  g_test_add_func ("/wayland/buffer/shm-damage-coalescing",
+                   shm_damage_coalescing);
+  g_test_add_func ("/wayland/buffer/shm-import",
+                   shm_import);
+  g_test_add_func ("/wayland/surface/commit-flood",
+                   commit_flood);
+  g_test_add_func ("/wayland/surface/commit-timing",
+                   commit_timing);
 }
 
 int
@@ -58,6 +58,8 @@
 #include "meta/util.h"
 #include "wayland/meta-wayland-dma-buf.h"
 #include "wayland/meta-wayland-private.h"
+#include "wayland/meta-wayland-shm-importer.h"
+#include "wayland/meta-wayland-shm-uploader.h"
 
 #ifdef HAVE_NATIVE_BACKEND
 #include "backends/native/meta-drm-buffer-gbm.h"
@@ -306,6 +308,36 @@ shm_format_to_string (MetaDrmFormatBuf *format_buf,
   return result;
 }
 
+static gboolean
+try_import_shm_buffer (MetaWaylandBuffer *buffer)
+{
+  MetaWaylandCompositor *compositor = meta_wayland_compositor_get_default ();
+  g_autoptr (GError) error = NULL;
+
+  if (buffer->shm.imported_texture)
+    return TRUE;
+
+  if (buffer->shm.import_failed ||
+      !meta_wayland_shm_importer_is_enabled (compositor->shm_importer))
+    return FALSE;
+
+  buffer->shm.imported_texture =
+    meta_wayland_shm_importer_import (compositor->shm_importer,
+                                      buffer,
+                                      &error);
+  if (!buffer->shm.imported_texture)
+    {
+      meta_topic (META_DEBUG_WAYLAND,
+                  "[wl-shm] wl_buffer@%u not imported: %s",
+                  wl_resource_get_id (buffer->resource),
+                  error->message);
+      buffer->shm.import_failed = TRUE;
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
 static gboolean
 shm_buffer_attach (MetaWaylandBuffer  *buffer,
                    CoglTexture       **texture,
@@ -340,7 +372,16 @@ shm_buffer_attach (MetaWaylandBuffer  *buffer,
                                     wl_shm_buffer_get_format (shm_buffer)),
               cogl_pixel_format_to_string (format));
 
+  if (try_import_shm_buffer (buffer))
+    {
+      cogl_clear_object (texture);
+      *texture = cogl_object_ref (buffer->shm.imported_texture);
+      buffer->is_y_inverted = TRUE;
+      return TRUE;
+    }
+
   if (*texture &&
+      !meta_wayland_shm_importer_is_imported_texture (*texture) &&
       cogl_texture_get_width (*texture) == width &&
       cogl_texture_get_height (*texture) == height &&
       cogl_texture_get_components (*texture) == components &&
@@ -593,18 +634,68 @@ meta_wayland_buffer_is_y_inverted (MetaWaylandBuffer *buffer)
   return buffer->is_y_inverted;
 }
 
+/**
+ * meta_wayland_buffer_inc_use_count:
+ * @buffer: A #MetaWaylandBuffer object
+ *
+ * Marks @buffer as being in use. It is released to the client once every use
+ * has been dropped using meta_wayland_buffer_dec_use_count(), no matter what
+ * surface or pending content update it was used by.
+ */
+void
+meta_wayland_buffer_inc_use_count (MetaWaylandBuffer *buffer)
+{
+  g_warn_if_fail (buffer->resource);
+
+  buffer->use_count++;
+}
+
+/**
+ * meta_wayland_buffer_dec_use_count:
+ * @buffer: A #MetaWaylandBuffer object
+ *
+ * Drops a use of @buffer added using meta_wayland_buffer_inc_use_count(),
+ * releasing it to the client if it was the last one.
+ */
+void
+meta_wayland_buffer_dec_use_count (MetaWaylandBuffer *buffer)
+{
+  g_return_if_fail (buffer->use_count > 0);
+
+  buffer->use_count--;
+
+  if (buffer->use_count == 0 && buffer->resource)
+    wl_buffer_send_release (buffer->resource);
+}
+
+/**
+ * meta_wayland_buffer_is_copied:
+ * @buffer: A #MetaWaylandBuffer object
+ *
+ * Returns: %TRUE if the contents of @buffer were copied when attaching it,
+ *   meaning it can be released right away, %FALSE if it is accessed directly
+ */
+gboolean
+meta_wayland_buffer_is_copied (MetaWaylandBuffer *buffer)
+{
+  return (buffer->type == META_WAYLAND_BUFFER_TYPE_SHM &&
+          !buffer->shm.imported_texture);
+}
+
 static gboolean
 process_shm_buffer_damage (MetaWaylandBuffer *buffer,
                            CoglTexture       *texture,
                            cairo_region_t    *region,
                            GError           **error)
 {
+  MetaWaylandCompositor *compositor = meta_wayland_compositor_get_default ();
   struct wl_shm_buffer *shm_buffer;
-  int i, n_rectangles;
-  gboolean set_texture_failed = FALSE;
   CoglPixelFormat format;
+  gboolean uploaded;
 
-  n_rectangles = cairo_region_num_rectangles (region);
+  /* The texture samples the buffer memory directly. */
+  if (buffer->shm.imported_texture)
+    return TRUE;
 
   shm_buffer = wl_shm_buffer_get (buffer->resource);
 
@@ -613,33 +704,18 @@ process_shm_buffer_damage (MetaWaylandBuffer *buffer,
 
   wl_shm_buffer_begin_access (shm_buffer);
 
-  for (i = 0; i < n_rectangles; i++)
-    {
-      const uint8_t *data = wl_shm_buffer_get_data (shm_buffer);
-      int32_t stride = wl_shm_buffer_get_stride (shm_buffer);
-      cairo_rectangle_int_t rect;
-      int bpp;
-
-      bpp = cogl_pixel_format_get_bytes_per_pixel (format, 0);
-      cairo_region_get_rectangle (region, i, &rect);
-
-      if (!_cogl_texture_set_region (texture,
-                                     rect.width, rect.height,
-                                     format,
-                                     stride,
-                                     data + rect.x * bpp + rect.y * stride,
-                                     rect.x, rect.y,
-                                     0,
-                                     error))
-        {
-          set_texture_failed = TRUE;
-          break;
-        }
-    }
+  uploaded =
+    meta_wayland_shm_uploader_upload (compositor->shm_uploader,
+                                      texture,
+                                      format,
+                                      wl_shm_buffer_get_data (shm_buffer),
+                                      wl_shm_buffer_get_stride (shm_buffer),
+                                      region,
+                                      error);
 
   wl_shm_buffer_end_access (shm_buffer);
 
-  return !set_texture_failed;
+  return uploaded;
 }
 
 void
@@ -771,11 +847,28 @@ meta_wayland_buffer_try_acquire_scanout (MetaWaylandBuffer *buffer,
   return NULL;
 }
 
+CoglScanout *
+meta_wayland_buffer_try_acquire_overlay_scanout (MetaWaylandBuffer *buffer,
+                                                 CoglOnscreen      *onscreen)
+{
+  MetaWaylandDmaBufBuffer *dma_buf;
+
+  if (buffer->type != META_WAYLAND_BUFFER_TYPE_DMA_BUF)
+    return NULL;
+
+  dma_buf = meta_wayland_dma_buf_from_buffer (buffer);
+  if (!dma_buf)
+    return NULL;
+
+  return meta_wayland_dma_buf_try_acquire_overlay_scanout (dma_buf, onscreen);
+}
+
 static void
 meta_wayland_buffer_finalize (GObject *object)
 {
   MetaWaylandBuffer *buffer = META_WAYLAND_BUFFER (object);
 
+  g_clear_pointer (&buffer->shm.imported_texture, cogl_object_unref);
   g_clear_pointer (&buffer->egl_image.texture, cogl_object_unref);
 #ifdef HAVE_WAYLAND_EGLSTREAM
   g_clear_pointer (&buffer->egl_stream.texture, cogl_object_unref);
@@ -837,6 +930,9 @@ meta_wayland_init_shm (MetaWaylandCompositor *compositor)
 
   wl_display_init_shm (compositor->wayland_display);
 
+  compositor->shm_uploader = meta_wayland_shm_uploader_new (compositor);
+  compositor->shm_importer = meta_wayland_shm_importer_new (compositor);
+
   for (i = 0; i < G_N_ELEMENTS (shm_formats); i++)
     {
       CoglPixelFormat cogl_format;
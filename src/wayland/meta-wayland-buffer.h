@@ -29,6 +29,7 @@
 #include <wayland-server.h>
 
 #include "cogl/cogl.h"
+#include "core/util-private.h"
 #include "wayland/meta-wayland-types.h"
 #include "wayland/meta-wayland-egl-stream.h"
 #include "wayland/meta-wayland-dma-buf.h"
@@ -50,11 +51,17 @@ struct _MetaWaylandBuffer
 
   struct wl_resource *resource;
   struct wl_listener destroy_listener;
+  unsigned int use_count;
 
   gboolean is_y_inverted;
 
   MetaWaylandBufferType type;
 
+  struct {
+    CoglTexture *imported_texture;
+    gboolean import_failed;
+  } shm;
+
   struct {
     CoglTexture *texture;
   } egl_image;
@@ -85,11 +92,17 @@ gboolean                meta_wayland_buffer_attach              (MetaWaylandBuff
                                                                  GError               **error);
 CoglSnippet *           meta_wayland_buffer_create_snippet      (MetaWaylandBuffer     *buffer);
 gboolean                meta_wayland_buffer_is_y_inverted       (MetaWaylandBuffer     *buffer);
+void                    meta_wayland_buffer_inc_use_count       (MetaWaylandBuffer     *buffer);
+void                    meta_wayland_buffer_dec_use_count       (MetaWaylandBuffer     *buffer);
+META_EXPORT_TEST
+gboolean                meta_wayland_buffer_is_copied           (MetaWaylandBuffer     *buffer);
 void                    meta_wayland_buffer_process_damage      (MetaWaylandBuffer     *buffer,
                                                                  CoglTexture           *texture,
                                                                  cairo_region_t        *region);
 CoglScanout *           meta_wayland_buffer_try_acquire_scanout (MetaWaylandBuffer     *buffer,
                                                                  CoglOnscreen          *onscreen);
+CoglScanout *           meta_wayland_buffer_try_acquire_overlay_scanout (MetaWaylandBuffer *buffer,
+                                                                         CoglOnscreen      *onscreen);
 
 void meta_wayland_init_shm (MetaWaylandCompositor *compositor);
 
@@ -518,22 +518,16 @@ import_scanout_gbm_bo (MetaWaylandDmaBufBuffer *dma_buf,
                             GBM_BO_USE_SCANOUT);
     }
 }
-#endif
 
-CoglScanout *
-meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
-                                          CoglOnscreen            *onscreen)
+static CoglScanout *
+import_scanout_buffer (MetaWaylandDmaBufBuffer *dma_buf)
 {
-#ifdef HAVE_NATIVE_BACKEND
   MetaBackend *backend = meta_get_backend ();
   MetaRenderer *renderer = meta_backend_get_renderer (backend);
   MetaRendererNative *renderer_native = META_RENDERER_NATIVE (renderer);
   MetaDeviceFile *device_file;
   MetaGpuKms *gpu_kms;
   int n_planes;
-  uint32_t drm_format;
-  uint64_t drm_modifier;
-  uint32_t stride;
   struct gbm_bo *gbm_bo;
   gboolean use_modifier;
   g_autoptr (GError) error = NULL;
@@ -546,15 +540,6 @@ meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
         break;
     }
 
-  drm_format = dma_buf->drm_format;
-  drm_modifier = dma_buf->drm_modifier;
-  stride = dma_buf->strides[0];
-  if (!meta_onscreen_native_is_buffer_scanout_compatible (onscreen,
-                                                          drm_format,
-                                                          drm_modifier,
-                                                          stride))
-    return NULL;
-
   device_file = meta_renderer_native_get_primary_device_file (renderer_native);
   gpu_kms = meta_renderer_native_get_primary_gpu (renderer_native);
   gbm_bo = import_scanout_gbm_bo (dma_buf, gpu_kms, n_planes, &use_modifier);
@@ -577,6 +562,37 @@ meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
     }
 
   return COGL_SCANOUT (fb);
+}
+#endif
+
+CoglScanout *
+meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
+                                          CoglOnscreen            *onscreen)
+{
+#ifdef HAVE_NATIVE_BACKEND
+  if (!meta_onscreen_native_is_buffer_scanout_compatible (onscreen,
+                                                          dma_buf->drm_format,
+                                                          dma_buf->drm_modifier,
+                                                          dma_buf->strides[0]))
+    return NULL;
+
+  return import_scanout_buffer (dma_buf);
+#else
+  return NULL;
+#endif
+}
+
+CoglScanout *
+meta_wayland_dma_buf_try_acquire_overlay_scanout (MetaWaylandDmaBufBuffer *dma_buf,
+                                                  CoglOnscreen            *onscreen)
+{
+#ifdef HAVE_NATIVE_BACKEND
+  if (!meta_onscreen_native_is_buffer_overlay_compatible (onscreen,
+                                                          dma_buf->drm_format,
+                                                          dma_buf->drm_modifier))
+    return NULL;
+
+  return import_scanout_buffer (dma_buf);
 #else
   return NULL;
 #endif
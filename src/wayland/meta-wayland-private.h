@@ -91,6 +91,15 @@ struct _MetaWaylandCompositor
   GHashTable *outputs;
   GList *frame_callback_surfaces;
 
+  struct {
+    uint64_t tick_serial;
+    GHashTable *client_commits;
+    GList *throttled_surfaces;
+  } commit_budget;
+
+  GList *timed_surfaces;
+  guint timed_surfaces_timeout_id;
+
   MetaXWaylandManager xwayland_manager;
 
   MetaWaylandSeat *seat;
@@ -101,6 +110,8 @@ struct _MetaWaylandCompositor
 
   MetaWaylandPresentationTime presentation_time;
   MetaWaylandDmaBufManager *dma_buf_manager;
+  MetaWaylandShmUploader *shm_uploader;
+  MetaWaylandShmImporter *shm_importer;
 };
 
 #define META_TYPE_WAYLAND_COMPOSITOR (meta_wayland_compositor_get_type ())
@@ -0,0 +1,650 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Most software rendering clients allocate their wl_shm pools from a memfd
+ * sealed against shrinking. Such memory can be turned into a dma-buf using
+ * udmabuf, and the dma-buf imported as an EGLImage, letting the GPU sample
+ * the client buffer directly instead of having every damaged pixel copied
+ * into a texture on each commit.
+ *
+ * libwayland does not expose the file descriptor of a wl_shm_pool, so the
+ * importer duplicates it from the wl_shm.create_pool request using a protocol
+ * logger, and tracks what pool each wl_shm_pool.create_buffer request was
+ * issued on. Buffers of pools that are not sealed memfds, unsupported formats
+ * and failing imports all use the regular upload path instead.
+ *
+ * Imported buffers are held until replaced rather than released right after
+ * the commit, which stalls clients waiting for the release of their single
+ * buffer. The import is thus only enabled on request, using
+ * MUTTER_DEBUG_ENABLE_SHM_IMPORT=1, and the protocol logger is only installed
+ * while it is enabled and supported.
+ */
+
+#include "config.h"
+
+#include "wayland/meta-wayland-shm-importer.h"
+
+#include <drm_fourcc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/udmabuf.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "backends/meta-backend-private.h"
+#include "backends/meta-egl-ext.h"
+#include "backends/meta-egl.h"
+#include "cogl/cogl-egl.h"
+#include "meta/util.h"
+#include "wayland/meta-wayland-buffer.h"
+#include "wayland/meta-wayland-private.h"
+
+#define ALIGN_UP(value, alignment) \
+  (((value) + (alignment) - 1) / (alignment) * (alignment))
+
+/* Request opcodes, which only the client protocol header defines */
+#define SHM_CREATE_POOL_OPCODE 0
+#define SHM_POOL_CREATE_BUFFER_OPCODE 0
+#define SHM_POOL_DESTROY_OPCODE 1
+
+typedef struct _ShmPoolFile
+{
+  int fd;
+} ShmPoolFile;
+
+typedef struct _ShmClient ShmClient;
+
+typedef struct _ShmBufferFile
+{
+  ShmClient *shm_client;
+  uint32_t buffer_id;
+  struct wl_listener resource_destroy_listener;
+
+  ShmPoolFile *pool_file;
+  int32_t offset;
+} ShmBufferFile;
+
+struct _ShmClient
+{
+  MetaWaylandShmImporter *importer;
+  struct wl_listener client_destroy_listener;
+  struct wl_listener resource_created_listener;
+
+  GHashTable *pool_files;
+  GHashTable *buffer_files;
+};
+
+struct _MetaWaylandShmImporter
+{
+  GObject parent;
+
+  MetaWaylandCompositor *compositor;
+
+  int udmabuf_fd;
+  struct wl_protocol_logger *protocol_logger;
+  GList *shm_clients;
+};
+
+G_DEFINE_TYPE (MetaWaylandShmImporter, meta_wayland_shm_importer,
+               G_TYPE_OBJECT)
+
+static CoglUserDataKey imported_texture_key;
+
+static void
+shm_pool_file_clear (ShmPoolFile *pool_file)
+{
+  close (pool_file->fd);
+}
+
+static void
+shm_pool_file_unref (ShmPoolFile *pool_file)
+{
+  g_rc_box_release_full (pool_file, (GDestroyNotify) shm_pool_file_clear);
+}
+
+static void
+shm_buffer_file_free (ShmBufferFile *buffer_file)
+{
+  wl_list_remove (&buffer_file->resource_destroy_listener.link);
+  shm_pool_file_unref (buffer_file->pool_file);
+  g_free (buffer_file);
+}
+
+static void
+shm_client_free (ShmClient *shm_client)
+{
+  wl_list_remove (&shm_client->client_destroy_listener.link);
+  wl_list_remove (&shm_client->resource_created_listener.link);
+  g_hash_table_unref (shm_client->pool_files);
+  g_hash_table_unref (shm_client->buffer_files);
+  g_free (shm_client);
+}
+
+static void
+shm_client_destroyed (struct wl_listener *listener,
+                      void               *data)
+{
+  ShmClient *shm_client = wl_container_of (listener, shm_client,
+                                           client_destroy_listener);
+  MetaWaylandShmImporter *importer = shm_client->importer;
+
+  importer->shm_clients = g_list_remove (importer->shm_clients, shm_client);
+  shm_client_free (shm_client);
+}
+
+static void
+buffer_resource_destroyed (struct wl_listener *listener,
+                           void               *data)
+{
+  ShmBufferFile *buffer_file = wl_container_of (listener, buffer_file,
+                                                resource_destroy_listener);
+
+  g_hash_table_remove (buffer_file->shm_client->buffer_files,
+                       GUINT_TO_POINTER (buffer_file->buffer_id));
+}
+
+/* Don't keep pool files open past the lifetime of their buffers. */
+static void
+shm_client_resource_created (struct wl_listener *listener,
+                             void               *data)
+{
+  ShmClient *shm_client = wl_container_of (listener, shm_client,
+                                           resource_created_listener);
+  struct wl_resource *resource = data;
+  ShmBufferFile *buffer_file;
+
+  if (!g_str_equal (wl_resource_get_class (resource), "wl_buffer"))
+    return;
+
+  buffer_file =
+    g_hash_table_lookup (shm_client->buffer_files,
+                         GUINT_TO_POINTER (wl_resource_get_id (resource)));
+  if (!buffer_file)
+    return;
+
+  wl_list_remove (&buffer_file->resource_destroy_listener.link);
+  wl_resource_add_destroy_listener (resource,
+                                    &buffer_file->resource_destroy_listener);
+}
+
+static ShmClient *
+get_shm_client (MetaWaylandShmImporter *importer,
+                struct wl_client       *client,
+                gboolean                create)
+{
+  struct wl_listener *listener;
+  ShmClient *shm_client;
+
+  listener = wl_client_get_destroy_listener (client, shm_client_destroyed);
+  if (listener)
+    return wl_container_of (listener, shm_client, client_destroy_listener);
+
+  if (!create)
+    return NULL;
+
+  shm_client = g_new0 (ShmClient, 1);
+  shm_client->importer = importer;
+  shm_client->pool_files =
+    g_hash_table_new_full (NULL, NULL,
+                           NULL, (GDestroyNotify) shm_pool_file_unref);
+  shm_client->buffer_files =
+    g_hash_table_new_full (NULL, NULL,
+                           NULL, (GDestroyNotify) shm_buffer_file_free);
+  shm_client->client_destroy_listener.notify = shm_client_destroyed;
+  wl_client_add_destroy_listener (client,
+                                  &shm_client->client_destroy_listener);
+  shm_client->resource_created_listener.notify = shm_client_resource_created;
+  wl_client_add_resource_created_listener (client,
+                                           &shm_client->resource_created_listener);
+
+  importer->shm_clients = g_list_prepend (importer->shm_clients, shm_client);
+
+  return shm_client;
+}
+
+static void
+handle_create_pool (MetaWaylandShmImporter *importer,
+                    struct wl_resource     *shm_resource,
+                    uint32_t                pool_id,
+                    int                     fd)
+{
+  ShmClient *shm_client;
+  ShmPoolFile *pool_file;
+  int seals;
+  int pool_fd;
+
+  shm_client = get_shm_client (importer,
+                               wl_resource_get_client (shm_resource),
+                               TRUE);
+
+  /* The id may have belonged to a since destroyed pool. */
+  g_hash_table_remove (shm_client->pool_files, GUINT_TO_POINTER (pool_id));
+
+  /* udmabuf only accepts memfds that can't shrink underneath it. */
+  seals = fcntl (fd, F_GET_SEALS);
+  if (seals == -1 || !(seals & F_SEAL_SHRINK) || (seals & F_SEAL_WRITE))
+    return;
+
+  pool_fd = fcntl (fd, F_DUPFD_CLOEXEC, 0);
+  if (pool_fd == -1)
+    return;
+
+  pool_file = g_rc_box_new0 (ShmPoolFile);
+  pool_file->fd = pool_fd;
+  g_hash_table_insert (shm_client->pool_files,
+                       GUINT_TO_POINTER (pool_id),
+                       pool_file);
+}
+
+static void
+handle_create_buffer (MetaWaylandShmImporter *importer,
+                      struct wl_resource     *pool_resource,
+                      uint32_t                buffer_id,
+                      int32_t                 offset)
+{
+  ShmClient *shm_client;
+  ShmPoolFile *pool_file;
+  ShmBufferFile *buffer_file;
+
+  shm_client = get_shm_client (importer,
+                               wl_resource_get_client (pool_resource),
+                               FALSE);
+  if (!shm_client)
+    return;
+
+  g_hash_table_remove (shm_client->buffer_files,
+                       GUINT_TO_POINTER (buffer_id));
+
+  pool_file =
+    g_hash_table_lookup (shm_client->pool_files,
+                         GUINT_TO_POINTER (wl_resource_get_id (pool_resource)));
+  if (!pool_file)
+    return;
+
+  buffer_file = g_new0 (ShmBufferFile, 1);
+  buffer_file->shm_client = shm_client;
+  buffer_file->buffer_id = buffer_id;
+  buffer_file->resource_destroy_listener.notify = buffer_resource_destroyed;
+  wl_list_init (&buffer_file->resource_destroy_listener.link);
+  buffer_file->pool_file = g_rc_box_acquire (pool_file);
+  buffer_file->offset = offset;
+  g_hash_table_insert (shm_client->buffer_files,
+                       GUINT_TO_POINTER (buffer_id),
+                       buffer_file);
+}
+
+static void
+handle_destroy_pool (MetaWaylandShmImporter *importer,
+                     struct wl_resource     *pool_resource)
+{
+  ShmClient *shm_client;
+
+  shm_client = get_shm_client (importer,
+                               wl_resource_get_client (pool_resource),
+                               FALSE);
+  if (!shm_client)
+    return;
+
+  /* Buffers created from the pool keep the file open. */
+  g_hash_table_remove (shm_client->pool_files,
+                       GUINT_TO_POINTER (wl_resource_get_id (pool_resource)));
+}
+
+static void
+protocol_logger_func (void                                    *user_data,
+                      enum wl_protocol_logger_type             type,
+                      const struct wl_protocol_logger_message *message)
+{
+  MetaWaylandShmImporter *importer = user_data;
+  const char *interface_name;
+
+  if (type != WL_PROTOCOL_LOGGER_REQUEST)
+    return;
+
+  /* This sees every request of every client, so avoid string comparisons:
+   * resources of an interface share the name string of its description. */
+  interface_name = wl_resource_get_class (message->resource);
+
+  if (interface_name == wl_shm_interface.name)
+    {
+      if (message->message ==
+          &wl_shm_interface.methods[SHM_CREATE_POOL_OPCODE])
+        {
+          handle_create_pool (importer,
+                              message->resource,
+                              message->arguments[0].n,
+                              message->arguments[1].h);
+        }
+    }
+  else if (interface_name == wl_shm_pool_interface.name)
+    {
+      if (message->message ==
+          &wl_shm_pool_interface.methods[SHM_POOL_CREATE_BUFFER_OPCODE])
+        {
+          handle_create_buffer (importer,
+                                message->resource,
+                                message->arguments[0].n,
+                                message->arguments[1].i);
+        }
+      else if (message->message ==
+               &wl_shm_pool_interface.methods[SHM_POOL_DESTROY_OPCODE])
+        {
+          handle_destroy_pool (importer, message->resource);
+        }
+    }
+}
+
+static gboolean
+shm_format_to_drm_format (uint32_t         shm_format,
+                          uint32_t        *out_drm_format,
+                          CoglPixelFormat *out_cogl_format)
+{
+  /* As for dma-bufs, the cogl format only describes the channel swizzling. */
+  switch (shm_format)
+    {
+    case WL_SHM_FORMAT_ARGB8888:
+      *out_drm_format = DRM_FORMAT_ARGB8888;
+      *out_cogl_format = COGL_PIXEL_FORMAT_ARGB_8888_PRE;
+      return TRUE;
+    case WL_SHM_FORMAT_XRGB8888:
+      *out_drm_format = DRM_FORMAT_XRGB8888;
+      *out_cogl_format = COGL_PIXEL_FORMAT_RGB_888;
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+/**
+ * meta_wayland_shm_importer_import:
+ * @importer: a #MetaWaylandShmImporter
+ * @buffer: a SHM #MetaWaylandBuffer
+ * @error: return location for a #GError
+ *
+ * Creates a texture sampling the memory of @buffer directly. The buffer must
+ * not be released to the client while the texture is in use.
+ *
+ * Returns: (transfer full) (nullable): the texture, or %NULL if @buffer
+ *   can't be imported, in which case it needs to be uploaded instead
+ */
+CoglTexture *
+meta_wayland_shm_importer_import (MetaWaylandShmImporter  *importer,
+                                  MetaWaylandBuffer       *buffer,
+                                  GError                 **error)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaEgl *egl = meta_backend_get_egl (backend);
+  ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
+  CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
+  EGLDisplay egl_display = cogl_egl_context_get_egl_display (cogl_context);
+  struct wl_resource *resource = meta_wayland_buffer_get_resource (buffer);
+  struct wl_shm_buffer *shm_buffer;
+  ShmClient *shm_client;
+  ShmBufferFile *buffer_file;
+  uint32_t drm_format;
+  CoglPixelFormat cogl_format;
+  int width, height, stride;
+  long page_size;
+  off_t aligned_offset;
+  size_t size;
+  struct stat pool_stat;
+  struct udmabuf_create create = { 0 };
+  int dma_buf_fd;
+  uint32_t strides[1];
+  uint32_t offsets[1];
+  EGLImageKHR egl_image;
+  CoglTexture2D *texture;
+
+  if (!importer->protocol_logger)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                   "Importing SHM buffers is disabled");
+      return NULL;
+    }
+
+  shm_buffer = wl_shm_buffer_get (resource);
+
+  shm_client = get_shm_client (importer, wl_resource_get_client (resource),
+                               FALSE);
+  buffer_file =
+    shm_client ? g_hash_table_lookup (shm_client->buffer_files,
+                                      GUINT_TO_POINTER (wl_resource_get_id (resource)))
+               : NULL;
+  if (!buffer_file)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                   "Buffer pool is not a sealed memfd");
+      return NULL;
+    }
+
+  if (!shm_format_to_drm_format (wl_shm_buffer_get_format (shm_buffer),
+                                 &drm_format, &cogl_format))
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                   "Unsupported SHM format %u",
+                   wl_shm_buffer_get_format (shm_buffer));
+      return NULL;
+    }
+
+  width = wl_shm_buffer_get_width (shm_buffer);
+  height = wl_shm_buffer_get_height (shm_buffer);
+  stride = wl_shm_buffer_get_stride (shm_buffer);
+
+  page_size = sysconf (_SC_PAGESIZE);
+  aligned_offset = buffer_file->offset - buffer_file->offset % page_size;
+  size = ALIGN_UP ((size_t) (buffer_file->offset - aligned_offset) +
+                   (size_t) stride * height,
+                   (size_t) page_size);
+
+  if (fstat (buffer_file->pool_file->fd, &pool_stat) != 0 ||
+      aligned_offset + size > (size_t) pool_stat.st_size)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                   "Buffer pages exceed the pool file");
+      return NULL;
+    }
+
+  create.memfd = buffer_file->pool_file->fd;
+  create.flags = UDMABUF_FLAGS_CLOEXEC;
+  create.offset = aligned_offset;
+  create.size = size;
+
+  dma_buf_fd = ioctl (importer->udmabuf_fd, UDMABUF_CREATE, &create);
+  if (dma_buf_fd < 0)
+    {
+      int errsv = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+                   "Failed to create udmabuf: %s", g_strerror (errsv));
+      return NULL;
+    }
+
+  strides[0] = stride;
+  offsets[0] = buffer_file->offset - aligned_offset;
+  egl_image = meta_egl_create_dmabuf_image (egl,
+                                            egl_display,
+                                            width,
+                                            height,
+                                            drm_format,
+                                            1,
+                                            &dma_buf_fd,
+                                            strides,
+                                            offsets,
+                                            NULL,
+                                            error);
+  close (dma_buf_fd);
+  if (egl_image == EGL_NO_IMAGE_KHR)
+    return NULL;
+
+  texture = cogl_egl_texture_2d_new_from_image (cogl_context,
+                                                width, height,
+                                                cogl_format,
+                                                egl_image,
+                                                COGL_EGL_IMAGE_FLAG_NO_GET_DATA,
+                                                error);
+
+  meta_egl_destroy_image (egl, egl_display, egl_image, NULL);
+
+  if (!texture)
+    return NULL;
+
+  cogl_object_set_user_data (COGL_OBJECT (texture), &imported_texture_key,
+                             GINT_TO_POINTER (TRUE), NULL);
+
+  return COGL_TEXTURE (texture);
+}
+
+/**
+ * meta_wayland_shm_importer_is_imported_texture:
+ * @texture: a #CoglTexture
+ *
+ * Returns: %TRUE if @texture samples the memory of a SHM buffer directly,
+ *   and thus must not be uploaded to
+ */
+gboolean
+meta_wayland_shm_importer_is_imported_texture (CoglTexture *texture)
+{
+  return !!cogl_object_get_user_data (COGL_OBJECT (texture),
+                                      &imported_texture_key);
+}
+
+static gboolean
+init_udmabuf (MetaWaylandShmImporter *importer)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaEgl *egl = meta_backend_get_egl (backend);
+  ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
+  CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
+
+  if (importer->udmabuf_fd >= 0)
+    return TRUE;
+
+  if (!meta_egl_has_extensions (egl,
+                                cogl_egl_context_get_egl_display (cogl_context),
+                                NULL,
+                                "EGL_EXT_image_dma_buf_import",
+                                NULL))
+    {
+      meta_topic (META_DEBUG_WAYLAND,
+                  "[wl-shm] EGL can't import dma-bufs, not importing SHM "
+                  "buffers");
+      return FALSE;
+    }
+
+  importer->udmabuf_fd = open ("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+  if (importer->udmabuf_fd < 0)
+    {
+      meta_topic (META_DEBUG_WAYLAND,
+                  "[wl-shm] udmabuf unavailable, not importing SHM buffers: %s",
+                  g_strerror (errno));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * meta_wayland_shm_importer_set_enabled:
+ * @importer: a #MetaWaylandShmImporter
+ * @enabled: whether to import SHM buffers
+ *
+ * Enables or disables importing the SHM buffers created from now on. Enabling
+ * has no effect where importing is not supported.
+ */
+void
+meta_wayland_shm_importer_set_enabled (MetaWaylandShmImporter *importer,
+                                       gboolean                enabled)
+{
+  if (!!enabled == meta_wayland_shm_importer_is_enabled (importer))
+    return;
+
+  if (enabled)
+    {
+      if (!init_udmabuf (importer))
+        return;
+
+      importer->protocol_logger =
+        wl_display_add_protocol_logger (importer->compositor->wayland_display,
+                                        protocol_logger_func,
+                                        importer);
+    }
+  else
+    {
+      g_clear_pointer (&importer->protocol_logger, wl_protocol_logger_destroy);
+      g_list_free_full (importer->shm_clients,
+                        (GDestroyNotify) shm_client_free);
+      importer->shm_clients = NULL;
+    }
+}
+
+/**
+ * meta_wayland_shm_importer_is_enabled:
+ * @importer: a #MetaWaylandShmImporter
+ *
+ * Returns: %TRUE if SHM buffers are imported, which requires importing to be
+ *   both enabled and supported
+ */
+gboolean
+meta_wayland_shm_importer_is_enabled (MetaWaylandShmImporter *importer)
+{
+  return !!importer->protocol_logger;
+}
+
+static void
+meta_wayland_shm_importer_finalize (GObject *object)
+{
+  MetaWaylandShmImporter *importer = META_WAYLAND_SHM_IMPORTER (object);
+
+  g_clear_pointer (&importer->protocol_logger, wl_protocol_logger_destroy);
+  g_list_free_full (importer->shm_clients, (GDestroyNotify) shm_client_free);
+  if (importer->udmabuf_fd >= 0)
+    close (importer->udmabuf_fd);
+
+  G_OBJECT_CLASS (meta_wayland_shm_importer_parent_class)->finalize (object);
+}
+
+static void
+meta_wayland_shm_importer_init (MetaWaylandShmImporter *importer)
+{
+  importer->udmabuf_fd = -1;
+}
+
+static void
+meta_wayland_shm_importer_class_init (MetaWaylandShmImporterClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = meta_wayland_shm_importer_finalize;
+}
+
+MetaWaylandShmImporter *
+meta_wayland_shm_importer_new (MetaWaylandCompositor *compositor)
+{
+  MetaWaylandShmImporter *importer;
+
+  importer = g_object_new (META_TYPE_WAYLAND_SHM_IMPORTER, NULL);
+  importer->compositor = compositor;
+
+  if (g_strcmp0 (getenv ("MUTTER_DEBUG_ENABLE_SHM_IMPORT"), "1") == 0)
+    meta_wayland_shm_importer_set_enabled (importer, TRUE);
+
+  return importer;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_WAYLAND_SHM_IMPORTER_H
+#define META_WAYLAND_SHM_IMPORTER_H
+
+#include <glib-object.h>
+
+#include "cogl/cogl.h"
+#include "core/util-private.h"
+#include "wayland/meta-wayland-types.h"
+
+#define META_TYPE_WAYLAND_SHM_IMPORTER (meta_wayland_shm_importer_get_type ())
+G_DECLARE_FINAL_TYPE (MetaWaylandShmImporter, meta_wayland_shm_importer,
+                      META, WAYLAND_SHM_IMPORTER, GObject)
+
+CoglTexture * meta_wayland_shm_importer_import (MetaWaylandShmImporter  *importer,
+                                                MetaWaylandBuffer       *buffer,
+                                                GError                 **error);
+
+gboolean meta_wayland_shm_importer_is_imported_texture (CoglTexture *texture);
+
+META_EXPORT_TEST
+void meta_wayland_shm_importer_set_enabled (MetaWaylandShmImporter *importer,
+                                            gboolean                enabled);
+
+META_EXPORT_TEST
+gboolean meta_wayland_shm_importer_is_enabled (MetaWaylandShmImporter *importer);
+
+MetaWaylandShmImporter * meta_wayland_shm_importer_new (MetaWaylandCompositor *compositor);
+
+#endif /* META_WAYLAND_SHM_IMPORTER_H */
@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Uploading SHM buffer damage straight from client memory makes the driver
+ * copy the pixels before the texture upload call returns, and possibly wait
+ * for the GPU to finish using the texture first. For large damage, the
+ * uploader instead copies the damaged rectangles into a pixel buffer object,
+ * taken from a small ring of them, and has the GPU pull the texture update
+ * from there asynchronously. The wl_buffer can be released as soon as the
+ * copy completed, and rendering the next frame implicitly waits for the
+ * upload.
+ *
+ * The copy itself stays on the main thread: libwayland only protects
+ * accesses to client memory against SIGBUS on the thread that called
+ * wl_shm_buffer_begin_access(), and resizing SHM pools isn't thread safe.
+ */
+
+#include "config.h"
+
+#include "wayland/meta-wayland-shm-uploader.h"
+
+#include <string.h>
+
+#include "backends/meta-backend-private.h"
+#include "clutter/clutter.h"
+#include "wayland/meta-wayland-private.h"
+
+#define N_PIXEL_BUFFERS 3
+
+/* Smaller damage, e.g. a blinking cursor, is cheaper to upload directly than
+ * to map a pixel buffer for. */
+#define MIN_STREAMING_UPLOAD_SIZE (256 * 1024)
+#define MAX_STREAMING_UPLOAD_SIZE (256 * 1024 * 1024)
+
+/* Rough cost of a single texture upload call, in bytes worth of copying.
+ * Damage rectangles are merged as long as that wastes less than this. */
+#define UPLOAD_CALL_COST_BYTES (32 * 1024)
+
+#define PIXEL_BUFFER_SIZE_ALIGNMENT (1024 * 1024)
+#define RECTANGLE_OFFSET_ALIGNMENT 64
+
+#define ALIGN_UP(value, alignment) \
+  (((value) + (alignment) - 1) / (alignment) * (alignment))
+
+struct _MetaWaylandShmUploader
+{
+  GObject parent;
+
+  MetaWaylandCompositor *compositor;
+
+  CoglPixelBuffer *pixel_buffers[N_PIXEL_BUFFERS];
+  int next_pixel_buffer;
+};
+
+G_DEFINE_TYPE (MetaWaylandShmUploader, meta_wayland_shm_uploader,
+               G_TYPE_OBJECT)
+
+static int64_t
+rectangle_area (const cairo_rectangle_int_t *rect)
+{
+  return (int64_t) rect->width * rect->height;
+}
+
+/*
+ * Clients such as terminals damage many small and thin rectangles per commit,
+ * e.g. a rectangle per changed character cell, each of which would otherwise
+ * be a texture upload call of its own. Merge them into fewer, larger
+ * rectangles whenever the additionally uploaded pixels are cheaper than the
+ * calls saved, and prefer uploading whole rows, as they are contiguous in
+ * memory. The rectangles of @region are sorted by bands, top to bottom, so
+ * merging with the previous one is enough to merge both neighbours on the
+ * same row band and adjacent rows.
+ */
+GArray *
+meta_wayland_shm_uploader_coalesce_damage (const cairo_region_t *region,
+                                           int                   width,
+                                           int                   bpp)
+{
+  GArray *rects;
+  int i, n_rectangles;
+
+  n_rectangles = cairo_region_num_rectangles (region);
+  rects = g_array_sized_new (FALSE, FALSE,
+                             sizeof (cairo_rectangle_int_t),
+                             n_rectangles);
+
+  for (i = 0; i < n_rectangles; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      if ((int64_t) (width - rect.width) * rect.height * bpp <=
+          UPLOAD_CALL_COST_BYTES)
+        {
+          rect.x = 0;
+          rect.width = width;
+        }
+
+      if (rects->len > 0)
+        {
+          cairo_rectangle_int_t *last =
+            &g_array_index (rects, cairo_rectangle_int_t, rects->len - 1);
+          cairo_rectangle_int_t merged;
+          int64_t wasted_area;
+
+          merged.x = MIN (last->x, rect.x);
+          merged.y = MIN (last->y, rect.y);
+          merged.width = MAX (last->x + last->width,
+                              rect.x + rect.width) - merged.x;
+          merged.height = MAX (last->y + last->height,
+                               rect.y + rect.height) - merged.y;
+
+          wasted_area = (rectangle_area (&merged) -
+                         rectangle_area (last) -
+                         rectangle_area (&rect));
+          if (wasted_area * bpp <= UPLOAD_CALL_COST_BYTES)
+            {
+              *last = merged;
+              continue;
+            }
+        }
+
+      g_array_append_val (rects, rect);
+    }
+
+  return rects;
+}
+
+static gboolean
+upload_rectangles_directly (CoglTexture           *texture,
+                            CoglPixelFormat        format,
+                            const uint8_t         *data,
+                            int                    stride,
+                            GArray                *rects,
+                            GError               **error)
+{
+  int bpp;
+  unsigned int i;
+
+  bpp = cogl_pixel_format_get_bytes_per_pixel (format, 0);
+
+  for (i = 0; i < rects->len; i++)
+    {
+      cairo_rectangle_int_t *rect =
+        &g_array_index (rects, cairo_rectangle_int_t, i);
+
+      if (!_cogl_texture_set_region (texture,
+                                     rect->width, rect->height,
+                                     format,
+                                     stride,
+                                     data + rect->x * bpp + rect->y * stride,
+                                     rect->x, rect->y,
+                                     0,
+                                     error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static CoglPixelBuffer *
+get_pixel_buffer (MetaWaylandShmUploader *uploader,
+                  size_t                  size)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
+  CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
+  CoglPixelBuffer **pixel_buffer;
+
+  pixel_buffer = &uploader->pixel_buffers[uploader->next_pixel_buffer];
+  uploader->next_pixel_buffer =
+    (uploader->next_pixel_buffer + 1) % N_PIXEL_BUFFERS;
+
+  if (*pixel_buffer &&
+      cogl_buffer_get_size (COGL_BUFFER (*pixel_buffer)) >= size)
+    return *pixel_buffer;
+
+  cogl_clear_object (pixel_buffer);
+
+  *pixel_buffer =
+    cogl_pixel_buffer_new (cogl_context,
+                           ALIGN_UP (size, PIXEL_BUFFER_SIZE_ALIGNMENT),
+                           NULL);
+  cogl_buffer_set_update_hint (COGL_BUFFER (*pixel_buffer),
+                               COGL_BUFFER_UPDATE_HINT_STREAM);
+
+  return *pixel_buffer;
+}
+
+/**
+ * meta_wayland_shm_uploader_upload:
+ * @uploader: a #MetaWaylandShmUploader
+ * @texture: the texture to update
+ * @format: the pixel format of @data
+ * @data: the SHM buffer contents
+ * @stride: the stride of @data
+ * @region: the damaged part of @data
+ * @error: return location for a #GError
+ *
+ * Uploads the damaged part of a SHM buffer to @texture. Must be called between
+ * wl_shm_buffer_begin_access() and wl_shm_buffer_end_access(); @data is not
+ * accessed anymore once this returns.
+ *
+ * Returns: %TRUE if the upload was queued successfully
+ */
+gboolean
+meta_wayland_shm_uploader_upload (MetaWaylandShmUploader  *uploader,
+                                  CoglTexture             *texture,
+                                  CoglPixelFormat          format,
+                                  const uint8_t           *data,
+                                  int                      stride,
+                                  const cairo_region_t    *region,
+                                  GError                 **error)
+{
+  g_autoptr (GArray) rects = NULL;
+  CoglPixelBuffer *pixel_buffer;
+  uint8_t *mapped_data;
+  size_t size = 0;
+  size_t offset;
+  int bpp;
+  unsigned int i;
+
+  bpp = cogl_pixel_format_get_bytes_per_pixel (format, 0);
+  rects = meta_wayland_shm_uploader_coalesce_damage (region,
+                                                     cogl_texture_get_width (texture),
+                                                     bpp);
+
+  for (i = 0; i < rects->len; i++)
+    {
+      cairo_rectangle_int_t *rect =
+        &g_array_index (rects, cairo_rectangle_int_t, i);
+
+      size = ALIGN_UP (size, RECTANGLE_OFFSET_ALIGNMENT);
+      size += (size_t) rect->width * bpp * rect->height;
+    }
+
+  if (size < MIN_STREAMING_UPLOAD_SIZE || size > MAX_STREAMING_UPLOAD_SIZE)
+    {
+      return upload_rectangles_directly (texture, format, data, stride, rects,
+                                         error);
+    }
+
+  pixel_buffer = get_pixel_buffer (uploader, size);
+
+  /* Discarding the previous contents lets the driver hand out fresh storage
+   * if the GPU still reads from the buffer, instead of waiting for it. */
+  mapped_data = cogl_buffer_map (COGL_BUFFER (pixel_buffer),
+                                 COGL_BUFFER_ACCESS_WRITE,
+                                 COGL_BUFFER_MAP_HINT_DISCARD);
+  if (!mapped_data)
+    {
+      return upload_rectangles_directly (texture, format, data, stride, rects,
+                                         error);
+    }
+
+  offset = 0;
+  for (i = 0; i < rects->len; i++)
+    {
+      cairo_rectangle_int_t *rect =
+        &g_array_index (rects, cairo_rectangle_int_t, i);
+      const uint8_t *src = data + rect->y * stride + rect->x * bpp;
+      size_t rect_stride;
+      int y;
+
+      offset = ALIGN_UP (offset, RECTANGLE_OFFSET_ALIGNMENT);
+      rect_stride = (size_t) rect->width * bpp;
+
+      if (rect_stride == (size_t) stride)
+        {
+          memcpy (mapped_data + offset, src, rect_stride * rect->height);
+        }
+      else
+        {
+          for (y = 0; y < rect->height; y++)
+            {
+              memcpy (mapped_data + offset + y * rect_stride,
+                      src + y * stride,
+                      rect_stride);
+            }
+        }
+
+      offset += rect_stride * rect->height;
+    }
+
+  cogl_buffer_unmap (COGL_BUFFER (pixel_buffer));
+
+  offset = 0;
+  for (i = 0; i < rects->len; i++)
+    {
+      cairo_rectangle_int_t *rect =
+        &g_array_index (rects, cairo_rectangle_int_t, i);
+      CoglBitmap *bitmap;
+      gboolean uploaded;
+
+      offset = ALIGN_UP (offset, RECTANGLE_OFFSET_ALIGNMENT);
+
+      /* The rectangles are tightly packed, so that drivers without support
+       * for unpacking sub images can take them straight from the buffer. */
+      bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (pixel_buffer),
+                                            format,
+                                            rect->width, rect->height,
+                                            rect->width * bpp,
+                                            offset);
+      uploaded = cogl_texture_set_region_from_bitmap (texture,
+                                                      0, 0,
+                                                      rect->x, rect->y,
+                                                      rect->width,
+                                                      rect->height,
+                                                      bitmap);
+      cogl_object_unref (bitmap);
+
+      if (!uploaded)
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                       "Failed to upload %dx%d damage from pixel buffer",
+                       rect->width, rect->height);
+          return FALSE;
+        }
+
+      offset += (size_t) rect->width * bpp * rect->height;
+    }
+
+  return TRUE;
+}
+
+static void
+meta_wayland_shm_uploader_finalize (GObject *object)
+{
+  MetaWaylandShmUploader *uploader = META_WAYLAND_SHM_UPLOADER (object);
+  int i;
+
+  for (i = 0; i < N_PIXEL_BUFFERS; i++)
+    cogl_clear_object (&uploader->pixel_buffers[i]);
+
+  G_OBJECT_CLASS (meta_wayland_shm_uploader_parent_class)->finalize (object);
+}
+
+static void
+meta_wayland_shm_uploader_init (MetaWaylandShmUploader *uploader)
+{
+}
+
+static void
+meta_wayland_shm_uploader_class_init (MetaWaylandShmUploaderClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = meta_wayland_shm_uploader_finalize;
+}
+
+MetaWaylandShmUploader *
+meta_wayland_shm_uploader_new (MetaWaylandCompositor *compositor)
+{
+  MetaWaylandShmUploader *uploader;
+
+  uploader = g_object_new (META_TYPE_WAYLAND_SHM_UPLOADER, NULL);
+  uploader->compositor = compositor;
+
+  return uploader;
+}
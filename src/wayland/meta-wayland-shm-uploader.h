@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_WAYLAND_SHM_UPLOADER_H
+#define META_WAYLAND_SHM_UPLOADER_H
+
+#include <cairo.h>
+#include <glib-object.h>
+
+#include "cogl/cogl.h"
+#include "core/util-private.h"
+#include "wayland/meta-wayland-types.h"
+
+#define META_TYPE_WAYLAND_SHM_UPLOADER (meta_wayland_shm_uploader_get_type ())
+G_DECLARE_FINAL_TYPE (MetaWaylandShmUploader, meta_wayland_shm_uploader,
+                      META, WAYLAND_SHM_UPLOADER, GObject)
+
+gboolean meta_wayland_shm_uploader_upload (MetaWaylandShmUploader  *uploader,
+                                           CoglTexture             *texture,
+                                           CoglPixelFormat          format,
+                                           const uint8_t           *data,
+                                           int                      stride,
+                                           const cairo_region_t    *region,
+                                           GError                 **error);
+
+MetaWaylandShmUploader * meta_wayland_shm_uploader_new (MetaWaylandCompositor *compositor);
+
+META_EXPORT_TEST
+GArray * meta_wayland_shm_uploader_coalesce_damage (const cairo_region_t *region,
+                                                    int                   width,
+                                                    int                   bpp);
+
+#endif /* META_WAYLAND_SHM_UPLOADER_H */
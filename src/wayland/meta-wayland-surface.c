@@ -56,6 +56,9 @@
 #include "wayland/meta-xwayland-private.h"
 #include "wayland/meta-xwayland-private.h"
 
+/* About a second of video at the usual frame rates */
+#define MAX_TIMED_STATES 32
+
 enum
 {
   SURFACE_STATE_SIGNAL_APPLIED,
@@ -172,9 +175,9 @@ static void
 meta_wayland_buffer_ref_inc_use_count (MetaWaylandBufferRef *buffer_ref)
 {
   g_return_if_fail (buffer_ref->buffer);
-  g_warn_if_fail (buffer_ref->buffer->resource);
 
   buffer_ref->use_count++;
+  meta_wayland_buffer_inc_use_count (buffer_ref->buffer);
 }
 
 static void
@@ -186,9 +189,7 @@ meta_wayland_buffer_ref_dec_use_count (MetaWaylandBufferRef *buffer_ref)
   g_return_if_fail (buffer);
 
   buffer_ref->use_count--;
-
-  if (buffer_ref->use_count == 0 && buffer->resource)
-    wl_buffer_send_release (buffer->resource);
+  meta_wayland_buffer_dec_use_count (buffer);
 }
 
 static void
@@ -457,10 +458,36 @@ meta_wayland_surface_unref_buffer_use_count (MetaWaylandSurface *surface)
   meta_wayland_buffer_ref_dec_use_count (surface->buffer_ref);
 }
 
+/*
+ * Deferred content updates, i.e. throttled or timed ones, keep their newly
+ * attached buffer in use until they are applied or replaced, so that it is
+ * released only once nothing else uses it either.
+ */
+static void
+meta_wayland_surface_state_use_buffer (MetaWaylandSurfaceState *state)
+{
+  if (!state->newly_attached || !state->buffer || state->buffer_in_use)
+    return;
+
+  meta_wayland_buffer_inc_use_count (state->buffer);
+  state->buffer_in_use = TRUE;
+}
+
+static void
+meta_wayland_surface_state_unuse_buffer (MetaWaylandSurfaceState *state)
+{
+  if (!state->buffer_in_use)
+    return;
+
+  meta_wayland_buffer_dec_use_count (state->buffer);
+  state->buffer_in_use = FALSE;
+}
+
 static void
 pending_buffer_resource_destroyed (MetaWaylandBuffer       *buffer,
                                    MetaWaylandSurfaceState *pending)
 {
+  meta_wayland_surface_state_unuse_buffer (pending);
   g_clear_signal_handler (&pending->buffer_destroy_handler_id, buffer);
   pending->buffer = NULL;
 }
@@ -471,6 +498,7 @@ meta_wayland_surface_state_set_default (MetaWaylandSurfaceState *state)
   state->newly_attached = FALSE;
   state->buffer = NULL;
   state->buffer_destroy_handler_id = 0;
+  state->buffer_in_use = FALSE;
   state->dx = 0;
   state->dy = 0;
   state->scale = 0;
@@ -496,6 +524,8 @@ meta_wayland_surface_state_set_default (MetaWaylandSurfaceState *state)
   state->subsurface_placement_ops = NULL;
 
   wl_list_init (&state->presentation_feedback_list);
+
+  state->has_target_presentation_time = FALSE;
 }
 
 static void
@@ -520,6 +550,7 @@ meta_wayland_surface_state_clear (MetaWaylandSurfaceState *state)
   g_clear_pointer (&state->input_region, cairo_region_destroy);
   g_clear_pointer (&state->opaque_region, cairo_region_destroy);
 
+  meta_wayland_surface_state_unuse_buffer (state);
   if (state->buffer)
     g_clear_signal_handler (&state->buffer_destroy_handler_id, state->buffer);
 
@@ -549,13 +580,27 @@ meta_wayland_surface_state_merge_into (MetaWaylandSurfaceState *from,
 {
   if (from->newly_attached)
     {
+      MetaWaylandBuffer *replaced_buffer = to->buffer;
+      gboolean replaced_buffer_in_use = to->buffer_in_use;
+
       if (to->buffer)
         g_clear_signal_handler (&to->buffer_destroy_handler_id, to->buffer);
 
       to->newly_attached = TRUE;
       to->buffer = from->buffer;
+      to->buffer_in_use = from->buffer_in_use;
+      from->buffer_in_use = FALSE;
       to->dx = from->dx;
       to->dy = from->dy;
+
+      /* The replaced buffer will never be shown, unless attached again. */
+      if (replaced_buffer_in_use)
+        {
+          if (to->buffer == replaced_buffer && !to->buffer_in_use)
+            to->buffer_in_use = TRUE;
+          else
+            meta_wayland_buffer_dec_use_count (replaced_buffer);
+        }
     }
 
   wl_list_insert_list (&to->frame_callback_list, &from->frame_callback_list);
@@ -663,6 +708,12 @@ meta_wayland_surface_state_merge_into (MetaWaylandSurfaceState *from,
                        &from->presentation_feedback_list);
   wl_list_init (&from->presentation_feedback_list);
 
+  if (from->has_target_presentation_time)
+    {
+      to->has_target_presentation_time = TRUE;
+      to->target_presentation_time_us = from->target_presentation_time_us;
+    }
+
   meta_wayland_surface_state_reset (from);
 }
 
@@ -777,12 +828,13 @@ meta_wayland_surface_apply_state (MetaWaylandSurface      *surface,
         }
 
       /* If the newly attached buffer is going to be accessed directly without
-       * making a copy, such as an EGL buffer, mark it as in-use don't release
-       * it until is replaced by a subsequent wl_surface.commit or when the
+       * making a copy, such as an EGL buffer, or a SHM buffer imported with
+       * MUTTER_DEBUG_ENABLE_SHM_IMPORT=1, mark it as in-use don't release it
+       * until is replaced by a subsequent wl_surface.commit or when the
        * wl_surface is destroyed.
        */
       surface->buffer_held = (state->buffer &&
-                              !wl_shm_buffer_get (state->buffer->resource));
+                              !meta_wayland_buffer_is_copied (state->buffer));
     }
 
   if (state->scale > 0)
@@ -965,6 +1017,141 @@ meta_wayland_surface_apply_cached_state (MetaWaylandSurface *surface)
   meta_wayland_surface_apply_state (surface, surface->cached_state);
 }
 
+static void
+apply_deferred_state (MetaWaylandSurface      *surface,
+                      MetaWaylandSurfaceState *state)
+{
+  if (meta_wayland_surface_should_cache_state (surface))
+    {
+      MetaWaylandSurfaceState *cached_state;
+
+      cached_state = meta_wayland_surface_ensure_cached_state (surface);
+      meta_wayland_surface_state_discard_presentation_feedback (cached_state);
+      meta_wayland_surface_state_merge_into (state, cached_state);
+    }
+  else
+    {
+      meta_wayland_surface_apply_state (surface, state);
+    }
+}
+
+void
+meta_wayland_surface_apply_throttled_state (MetaWaylandSurface *surface)
+{
+  g_autoptr (MetaWaylandSurfaceState) throttled_state = NULL;
+
+  throttled_state = g_steal_pointer (&surface->throttled_state);
+  if (!throttled_state)
+    return;
+
+  apply_deferred_state (surface, throttled_state);
+}
+
+/**
+ * meta_wayland_surface_apply_timed_states:
+ * @surface: a #MetaWaylandSurface
+ * @presentation_time_us: the expected presentation time of the next frame
+ *
+ * Applies the queued states of @surface, in commit order, up to the first
+ * one with a target presentation time later than @presentation_time_us.
+ *
+ * Returns: %TRUE if states are still left in the queue
+ */
+gboolean
+meta_wayland_surface_apply_timed_states (MetaWaylandSurface *surface,
+                                         int64_t             presentation_time_us)
+{
+  while (!g_queue_is_empty (&surface->timed_states))
+    {
+      g_autoptr (MetaWaylandSurfaceState) state = NULL;
+      MetaWaylandSurfaceState *head;
+
+      head = g_queue_peek_head (&surface->timed_states);
+      if (head->has_target_presentation_time &&
+          head->target_presentation_time_us > presentation_time_us)
+        return TRUE;
+
+      state = g_queue_pop_head (&surface->timed_states);
+      apply_deferred_state (surface, state);
+    }
+
+  return FALSE;
+}
+
+/**
+ * meta_wayland_surface_get_next_target_presentation_time:
+ * @surface: a #MetaWaylandSurface
+ *
+ * Returns: the target presentation time of the first queued state of
+ *   @surface, or 0 if it is to be applied in the next frame
+ */
+int64_t
+meta_wayland_surface_get_next_target_presentation_time (MetaWaylandSurface *surface)
+{
+  MetaWaylandSurfaceState *head;
+
+  head = g_queue_peek_head (&surface->timed_states);
+  if (!head || !head->has_target_presentation_time)
+    return 0;
+
+  return head->target_presentation_time_us;
+}
+
+static void
+queue_pending_state (MetaWaylandSurface *surface)
+{
+  MetaWaylandSurfaceState *state;
+
+  /* Keep the order of the content updates. */
+  if (surface->throttled_state)
+    {
+      meta_wayland_compositor_remove_throttled_surface (surface->compositor,
+                                                        surface);
+      g_queue_push_tail (&surface->timed_states,
+                         g_steal_pointer (&surface->throttled_state));
+    }
+
+  /* Each queued state holds on to its buffer; rather than letting a client
+   * pile them up, show the oldest ones early. */
+  while (g_queue_get_length (&surface->timed_states) >= MAX_TIMED_STATES)
+    {
+      g_autoptr (MetaWaylandSurfaceState) head = NULL;
+
+      head = g_queue_pop_head (&surface->timed_states);
+      apply_deferred_state (surface, head);
+    }
+
+  state = g_object_new (META_TYPE_WAYLAND_SURFACE_STATE, NULL);
+  meta_wayland_surface_state_merge_into (surface->pending_state, state);
+  meta_wayland_surface_state_use_buffer (state);
+  g_queue_push_tail (&surface->timed_states, state);
+
+  meta_wayland_compositor_add_timed_surface (surface->compositor, surface);
+}
+
+static void
+throttle_pending_state (MetaWaylandSurface *surface)
+{
+  MetaWaylandSurfaceState *pending = surface->pending_state;
+  MetaWaylandSurfaceState *throttled;
+
+  if (!surface->throttled_state)
+    {
+      surface->throttled_state = g_object_new (META_TYPE_WAYLAND_SURFACE_STATE,
+                                               NULL);
+    }
+  throttled = surface->throttled_state;
+
+  /* The replaced content update will never be shown. */
+  meta_wayland_surface_state_discard_presentation_feedback (throttled);
+
+  meta_wayland_surface_state_merge_into (pending, throttled);
+  meta_wayland_surface_state_use_buffer (throttled);
+
+  meta_wayland_compositor_add_throttled_surface (surface->compositor,
+                                                 surface);
+}
+
 MetaWaylandSurfaceState *
 meta_wayland_surface_get_pending_state (MetaWaylandSurface *surface)
 {
@@ -1004,6 +1191,20 @@ meta_wayland_surface_commit (MetaWaylandSurface *surface)
     {
       MetaWaylandSurfaceState *cached_state;
 
+      /* Keep the order of the content updates. */
+      if (surface->throttled_state)
+        {
+          meta_wayland_compositor_remove_throttled_surface (surface->compositor,
+                                                            surface);
+          meta_wayland_surface_apply_throttled_state (surface);
+        }
+      if (!g_queue_is_empty (&surface->timed_states))
+        {
+          meta_wayland_compositor_remove_timed_surface (surface->compositor,
+                                                        surface);
+          meta_wayland_surface_apply_timed_states (surface, G_MAXINT64);
+        }
+
       cached_state = meta_wayland_surface_ensure_cached_state (surface);
 
       /*
@@ -1014,6 +1215,21 @@ meta_wayland_surface_commit (MetaWaylandSurface *surface)
 
       meta_wayland_surface_state_merge_into (pending, cached_state);
     }
+  else if (pending->has_target_presentation_time ||
+           !g_queue_is_empty (&surface->timed_states))
+    {
+      /*
+       * A content update with a target presentation time, and every one
+       * committed after it, waits until the frame it is due for.
+       */
+      queue_pending_state (surface);
+    }
+  else if (surface->throttled_state ||
+           meta_wayland_compositor_is_commit_over_budget (surface->compositor,
+                                                          surface))
+    {
+      throttle_pending_state (surface);
+    }
   else
     {
       meta_wayland_surface_apply_state (surface, surface->pending_state);
@@ -1439,6 +1655,8 @@ wl_surface_destructor (struct wl_resource *resource)
 
   g_clear_object (&surface->cached_state);
   g_clear_object (&surface->pending_state);
+  g_clear_object (&surface->throttled_state);
+  g_queue_clear_full (&surface->timed_states, g_object_unref);
 
   if (surface->opaque_region)
     cairo_region_destroy (surface->opaque_region);
@@ -1446,6 +1664,8 @@ wl_surface_destructor (struct wl_resource *resource)
     cairo_region_destroy (surface->input_region);
 
   meta_wayland_compositor_remove_frame_callback_surface (compositor, surface);
+  meta_wayland_compositor_remove_throttled_surface (compositor, surface);
+  meta_wayland_compositor_remove_timed_surface (compositor, surface);
   meta_wayland_compositor_remove_presentation_feedback_surface (compositor,
                                                                 surface);
 
@@ -1697,6 +1917,7 @@ static void
 meta_wayland_surface_init (MetaWaylandSurface *surface)
 {
   surface->pending_state = g_object_new (META_TYPE_WAYLAND_SURFACE_STATE, NULL);
+  g_queue_init (&surface->timed_states);
 
   surface->buffer_ref = meta_wayland_buffer_ref_new ();
 
@@ -2118,12 +2339,24 @@ scanout_destroyed (gpointer  data,
   meta_wayland_buffer_ref_unref (buffer_ref);
 }
 
+static CoglScanout *
+track_scanout (MetaWaylandSurface *surface,
+               CoglScanout        *scanout)
+{
+  MetaWaylandBufferRef *buffer_ref;
+
+  buffer_ref = meta_wayland_buffer_ref_ref (surface->buffer_ref);
+  meta_wayland_buffer_ref_inc_use_count (buffer_ref);
+  g_object_weak_ref (G_OBJECT (scanout), scanout_destroyed, buffer_ref);
+
+  return scanout;
+}
+
 CoglScanout *
 meta_wayland_surface_try_acquire_scanout (MetaWaylandSurface *surface,
                                           CoglOnscreen       *onscreen)
 {
   CoglScanout *scanout;
-  MetaWaylandBufferRef *buffer_ref;
 
   if (!surface->buffer_ref->buffer)
     return NULL;
@@ -2136,11 +2369,28 @@ meta_wayland_surface_try_acquire_scanout (MetaWaylandSurface *surface,
   if (!scanout)
     return NULL;
 
-  buffer_ref = meta_wayland_buffer_ref_ref (surface->buffer_ref);
-  meta_wayland_buffer_ref_inc_use_count (buffer_ref);
-  g_object_weak_ref (G_OBJECT (scanout), scanout_destroyed, buffer_ref);
+  return track_scanout (surface, scanout);
+}
 
-  return scanout;
+CoglScanout *
+meta_wayland_surface_try_acquire_overlay_scanout (MetaWaylandSurface *surface,
+                                                  CoglOnscreen       *onscreen)
+{
+  CoglScanout *scanout;
+
+  if (!surface->buffer_ref->buffer)
+    return NULL;
+
+  if (surface->buffer_ref->use_count == 0)
+    return NULL;
+
+  scanout =
+    meta_wayland_buffer_try_acquire_overlay_scanout (surface->buffer_ref->buffer,
+                                                     onscreen);
+  if (!scanout)
+    return NULL;
+
+  return track_scanout (surface, scanout);
 }
 
 MetaCrtc *
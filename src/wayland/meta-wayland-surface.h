@@ -81,6 +81,7 @@ struct _MetaWaylandSurfaceState
   gboolean newly_attached;
   MetaWaylandBuffer *buffer;
   gulong buffer_destroy_handler_id;
+  gboolean buffer_in_use;
   int32_t dx;
   int32_t dy;
 
@@ -125,6 +126,10 @@ struct _MetaWaylandSurfaceState
 
   /* presentation-time */
   struct wl_list presentation_feedback_list;
+
+  /* commit-timing */
+  gboolean has_target_presentation_time;
+  int64_t target_presentation_time_us;
 };
 
 struct _MetaWaylandDragDestFuncs
@@ -189,6 +194,16 @@ struct _MetaWaylandSurface
   MetaWaylandSurfaceState *pending_state;
   /* State cached due to inter-surface synchronization such. */
   MetaWaylandSurfaceState *cached_state;
+  /* State of commits exceeding the commit budget, applied next frame. */
+  MetaWaylandSurfaceState *throttled_state;
+
+  struct {
+    uint64_t tick_serial;
+    int n_commits;
+  } commit_budget;
+
+  /* States waiting for their target presentation time, in commit order. */
+  GQueue timed_states;
 
   /* Extension resources. */
   struct wl_resource *wl_subsurface;
@@ -229,6 +244,12 @@ struct _MetaWaylandSurface
     int dst_height;
   } viewport;
 
+  /* wp_commit_timer */
+  struct {
+    struct wl_resource *resource;
+    gulong destroy_handler_id;
+  } commit_timer;
+
   /* table of seats for which shortcuts are inhibited */
   GHashTable *shortcut_inhibited_seats;
 
@@ -267,6 +288,13 @@ MetaWaylandSurfaceState *
 
 void                meta_wayland_surface_apply_cached_state (MetaWaylandSurface *surface);
 
+void                meta_wayland_surface_apply_throttled_state (MetaWaylandSurface *surface);
+
+gboolean            meta_wayland_surface_apply_timed_states (MetaWaylandSurface *surface,
+                                                             int64_t             presentation_time_us);
+
+int64_t             meta_wayland_surface_get_next_target_presentation_time (MetaWaylandSurface *surface);
+
 gboolean            meta_wayland_surface_is_effectively_synchronized (MetaWaylandSurface *surface);
 
 gboolean            meta_wayland_surface_assign_role (MetaWaylandSurface *surface,
@@ -274,6 +302,7 @@ gboolean            meta_wayland_surface_assign_role (MetaWaylandSurface *surfac
                                                       const char         *first_property_name,
                                                       ...);
 
+META_EXPORT_TEST
 MetaWaylandBuffer  *meta_wayland_surface_get_buffer (MetaWaylandSurface *surface);
 
 void                meta_wayland_surface_ref_buffer_use_count (MetaWaylandSurface *surface);
@@ -366,6 +395,9 @@ int                 meta_wayland_surface_get_height (MetaWaylandSurface *surface
 CoglScanout *       meta_wayland_surface_try_acquire_scanout (MetaWaylandSurface *surface,
                                                               CoglOnscreen       *onscreen);
 
+CoglScanout *       meta_wayland_surface_try_acquire_overlay_scanout (MetaWaylandSurface *surface,
+                                                                      CoglOnscreen       *onscreen);
+
 MetaCrtc * meta_wayland_surface_get_scanout_candidate (MetaWaylandSurface *surface);
 
 void meta_wayland_surface_set_scanout_candidate (MetaWaylandSurface *surface,
@@ -65,4 +65,7 @@ typedef struct _MetaWaylandActivation MetaWaylandActivation;
 
 typedef struct _MetaWaylandDmaBufManager MetaWaylandDmaBufManager;
 
+typedef struct _MetaWaylandShmUploader MetaWaylandShmUploader;
+typedef struct _MetaWaylandShmImporter MetaWaylandShmImporter;
+
 #endif
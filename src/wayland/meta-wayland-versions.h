@@ -58,5 +58,6 @@
 #define META_ZWP_PRIMARY_SELECTION_V1_VERSION 1
 #define META_WP_PRESENTATION_VERSION        1
 #define META_XDG_ACTIVATION_V1_VERSION 1
+#define META_WP_COMMIT_TIMING_V1_VERSION 1
 
 #endif
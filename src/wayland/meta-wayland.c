@@ -29,11 +29,13 @@
 #include <wayland-server.h>
 
 #include "clutter/clutter.h"
+#include "clutter/clutter-mutter.h"
 #include "cogl/cogl-egl.h"
 #include "compositor/meta-surface-actor-wayland.h"
 #include "core/meta-context-private.h"
 #include "wayland/meta-wayland-activation.h"
 #include "wayland/meta-wayland-buffer.h"
+#include "wayland/meta-wayland-commit-timing.h"
 #include "wayland/meta-wayland-data-device.h"
 #include "wayland/meta-wayland-dma-buf.h"
 #include "wayland/meta-wayland-egl-stream.h"
@@ -198,6 +200,286 @@ meta_wayland_compositor_update (MetaWaylandCompositor *compositor,
     meta_wayland_seat_update (compositor->seat, event);
 }
 
+/*
+ * Clients are expected to commit about once per frame and surface. Further
+ * commits, e.g. from a client rendering at 1000 Hz, are merged and applied
+ * at the beginning of the next frame instead, so that flooding clients
+ * can't make the compositor spend the main loop on applying states that
+ * never make it to the screen, at the expense of input handling and other
+ * clients.
+ */
+#define MAX_SURFACE_COMMITS_PER_FRAME 4
+#define MAX_CLIENT_COMMITS_PER_FRAME 64
+
+/*
+ * Views start updating for a queued state this many refresh intervals ahead
+ * of its target presentation time, so that the frame it is due for isn't
+ * missed.
+ */
+#define TIMED_STATE_LEAD_FRAMES 2
+#define DEFAULT_REFRESH_RATE 60.0f
+
+static ClutterStageView *
+get_surface_primary_view (MetaWaylandSurface *surface,
+                          ClutterStage       *stage)
+{
+  MetaSurfaceActor *actor;
+
+  actor = meta_wayland_surface_get_actor (surface);
+  if (!actor)
+    return NULL;
+
+  return meta_surface_actor_wayland_get_current_primary_view (actor, stage);
+}
+
+static void schedule_timed_surfaces (MetaWaylandCompositor *compositor);
+
+static gboolean
+on_timed_surfaces_timeout (gpointer user_data)
+{
+  MetaWaylandCompositor *compositor = user_data;
+
+  compositor->timed_surfaces_timeout_id = 0;
+  schedule_timed_surfaces (compositor);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * Only update the views showing surfaces with queued states, and only once
+ * their first target presentation time is near, instead of updating every
+ * view on every refresh while states wait.
+ */
+static void
+schedule_timed_surfaces (MetaWaylandCompositor *compositor)
+{
+  MetaBackend *backend = meta_context_get_backend (compositor->context);
+  ClutterStage *stage = CLUTTER_STAGE (meta_backend_get_stage (backend));
+  int64_t now_us;
+  int64_t wakeup_time_us = G_MAXINT64;
+  GList *l;
+
+  g_clear_handle_id (&compositor->timed_surfaces_timeout_id, g_source_remove);
+
+  now_us = g_get_monotonic_time ();
+
+  for (l = compositor->timed_surfaces; l; l = l->next)
+    {
+      MetaWaylandSurface *surface = l->data;
+      ClutterStageView *view;
+      float refresh_rate = DEFAULT_REFRESH_RATE;
+      int64_t lead_time_us;
+      int64_t update_time_us;
+
+      view = get_surface_primary_view (surface, stage);
+      if (view && clutter_stage_view_get_refresh_rate (view) > 0.0f)
+        refresh_rate = clutter_stage_view_get_refresh_rate (view);
+
+      lead_time_us = (int64_t) (TIMED_STATE_LEAD_FRAMES *
+                                G_USEC_PER_SEC / refresh_rate);
+      update_time_us =
+        meta_wayland_surface_get_next_target_presentation_time (surface) -
+        lead_time_us;
+
+      if (update_time_us > now_us)
+        {
+          wakeup_time_us = MIN (wakeup_time_us, update_time_us);
+          continue;
+        }
+
+      /* Surfaces not shown yet are latched by whichever view updates first. */
+      if (view)
+        clutter_stage_view_schedule_update (view);
+      else
+        clutter_stage_schedule_update (stage);
+    }
+
+  if (wakeup_time_us != G_MAXINT64)
+    {
+      compositor->timed_surfaces_timeout_id =
+        g_timeout_add ((wakeup_time_us - now_us + 999) / 1000,
+                       on_timed_surfaces_timeout,
+                       compositor);
+      g_source_set_name_by_id (compositor->timed_surfaces_timeout_id,
+                               "[mutter] Wayland timed surface states");
+    }
+}
+
+static void
+apply_timed_states (MetaWaylandCompositor *compositor,
+                    ClutterStage          *stage,
+                    ClutterStageView      *stage_view)
+{
+  ClutterFrameClock *frame_clock;
+  int64_t presentation_time_us;
+  GList *l;
+
+  frame_clock = clutter_stage_view_get_frame_clock (stage_view);
+  presentation_time_us =
+    clutter_frame_clock_get_target_presentation_time_us (frame_clock);
+  if (presentation_time_us == 0)
+    presentation_time_us = g_get_monotonic_time ();
+
+  l = compositor->timed_surfaces;
+  while (l)
+    {
+      GList *l_cur = l;
+      MetaWaylandSurface *surface = l->data;
+      ClutterStageView *surface_primary_view;
+
+      l = l->next;
+
+      /* Surfaces not shown yet are latched by whichever view updates first. */
+      surface_primary_view = get_surface_primary_view (surface, stage);
+      if (surface_primary_view && surface_primary_view != stage_view)
+        continue;
+
+      if (!meta_wayland_surface_apply_timed_states (surface,
+                                                    presentation_time_us))
+        {
+          compositor->timed_surfaces =
+            g_list_delete_link (compositor->timed_surfaces, l_cur);
+        }
+    }
+
+  schedule_timed_surfaces (compositor);
+}
+
+static void
+on_before_update (ClutterStage          *stage,
+                  ClutterStageView      *stage_view,
+                  MetaWaylandCompositor *compositor)
+{
+  uint64_t tick_serial;
+  GList *throttled_surfaces;
+  GList *l;
+
+  apply_timed_states (compositor, stage, stage_view);
+
+  tick_serial = clutter_stage_get_tick_serial (stage);
+  if (compositor->commit_budget.tick_serial == tick_serial)
+    return;
+
+  compositor->commit_budget.tick_serial = tick_serial;
+  g_hash_table_remove_all (compositor->commit_budget.client_commits);
+
+  throttled_surfaces =
+    g_list_reverse (g_steal_pointer (&compositor->commit_budget.throttled_surfaces));
+  for (l = throttled_surfaces; l; l = l->next)
+    {
+      MetaWaylandSurface *surface = l->data;
+
+      meta_wayland_surface_apply_throttled_state (surface);
+    }
+  g_list_free (throttled_surfaces);
+}
+
+/**
+ * meta_wayland_compositor_is_commit_over_budget:
+ * @compositor: the #MetaWaylandCompositor instance
+ * @surface: the committing #MetaWaylandSurface
+ *
+ * Accounts a commit of @surface against the commit budgets of the surface
+ * and its client for the current frame.
+ *
+ * Returns: %TRUE if the commit exceeds a budget and should be throttled
+ */
+gboolean
+meta_wayland_compositor_is_commit_over_budget (MetaWaylandCompositor *compositor,
+                                               MetaWaylandSurface    *surface)
+{
+  MetaBackend *backend = meta_context_get_backend (compositor->context);
+  ClutterStage *stage = CLUTTER_STAGE (meta_backend_get_stage (backend));
+  struct wl_client *client;
+  int n_client_commits;
+
+  /* Throttled states are applied at the next frame, so there must be one. */
+  if (!clutter_stage_peek_stage_views (stage))
+    return FALSE;
+
+  if (surface->commit_budget.tick_serial != compositor->commit_budget.tick_serial)
+    {
+      surface->commit_budget.tick_serial = compositor->commit_budget.tick_serial;
+      surface->commit_budget.n_commits = 0;
+    }
+  surface->commit_budget.n_commits++;
+
+  client = wl_resource_get_client (surface->resource);
+  n_client_commits =
+    GPOINTER_TO_INT (g_hash_table_lookup (compositor->commit_budget.client_commits,
+                                          client)) + 1;
+  g_hash_table_insert (compositor->commit_budget.client_commits,
+                       client, GINT_TO_POINTER (n_client_commits));
+
+  return (surface->commit_budget.n_commits > MAX_SURFACE_COMMITS_PER_FRAME ||
+          n_client_commits > MAX_CLIENT_COMMITS_PER_FRAME);
+}
+
+void
+meta_wayland_compositor_add_throttled_surface (MetaWaylandCompositor *compositor,
+                                               MetaWaylandSurface    *surface)
+{
+  MetaBackend *backend = meta_context_get_backend (compositor->context);
+  ClutterActor *stage = meta_backend_get_stage (backend);
+
+  if (g_list_find (compositor->commit_budget.throttled_surfaces, surface))
+    return;
+
+  compositor->commit_budget.throttled_surfaces =
+    g_list_prepend (compositor->commit_budget.throttled_surfaces, surface);
+
+  clutter_stage_schedule_update (CLUTTER_STAGE (stage));
+}
+
+void
+meta_wayland_compositor_remove_throttled_surface (MetaWaylandCompositor *compositor,
+                                                  MetaWaylandSurface    *surface)
+{
+  compositor->commit_budget.throttled_surfaces =
+    g_list_remove (compositor->commit_budget.throttled_surfaces, surface);
+}
+
+/**
+ * meta_wayland_compositor_add_timed_surface:
+ * @compositor: the #MetaWaylandCompositor instance
+ * @surface: a #MetaWaylandSurface with queued timed states
+ *
+ * Makes the frame clock of the view showing @surface latch the queued
+ * states of @surface once their target presentation time is reached.
+ */
+void
+meta_wayland_compositor_add_timed_surface (MetaWaylandCompositor *compositor,
+                                           MetaWaylandSurface    *surface)
+{
+  MetaBackend *backend = meta_context_get_backend (compositor->context);
+  ClutterStage *stage = CLUTTER_STAGE (meta_backend_get_stage (backend));
+
+  /* Without any view there is no frame to wait for. */
+  if (!clutter_stage_peek_stage_views (stage))
+    {
+      meta_wayland_surface_apply_timed_states (surface, G_MAXINT64);
+      return;
+    }
+
+  /* The first queued state may have changed even if the surface was already
+   * waiting, e.g. when a full queue had its oldest state applied early. */
+  if (!g_list_find (compositor->timed_surfaces, surface))
+    {
+      compositor->timed_surfaces =
+        g_list_prepend (compositor->timed_surfaces, surface);
+    }
+
+  schedule_timed_surfaces (compositor);
+}
+
+void
+meta_wayland_compositor_remove_timed_surface (MetaWaylandCompositor *compositor,
+                                              MetaWaylandSurface    *surface)
+{
+  compositor->timed_surfaces =
+    g_list_remove (compositor->timed_surfaces, surface);
+}
+
 static void
 on_after_update (ClutterStage          *stage,
                  ClutterStageView      *stage_view,
@@ -438,6 +720,12 @@ meta_wayland_compositor_finalize (GObject *object)
   MetaWaylandCompositor *compositor = META_WAYLAND_COMPOSITOR (object);
 
   g_clear_object (&compositor->dma_buf_manager);
+  g_clear_object (&compositor->shm_uploader);
+  g_clear_object (&compositor->shm_importer);
+
+  g_clear_handle_id (&compositor->timed_surfaces_timeout_id, g_source_remove);
+  g_clear_pointer (&compositor->commit_budget.client_commits,
+                   g_hash_table_unref);
 
   g_clear_pointer (&compositor->seat, meta_wayland_seat_free);
 
@@ -452,6 +740,7 @@ static void
 meta_wayland_compositor_init (MetaWaylandCompositor *compositor)
 {
   compositor->scheduled_surface_associations = g_hash_table_new (NULL, NULL);
+  compositor->commit_budget.client_commits = g_hash_table_new (NULL, NULL);
 
   wl_log_set_handler_server (meta_wayland_log_func);
 
@@ -576,6 +865,8 @@ meta_wayland_compositor_new (MetaContext *context)
   compositor->source = wayland_event_source;
   g_source_unref (wayland_event_source);
 
+  g_signal_connect (stage, "before-update",
+                    G_CALLBACK (on_before_update), compositor);
   g_signal_connect (stage, "after-update",
                     G_CALLBACK (on_after_update), compositor);
   g_signal_connect (stage, "presented",
@@ -608,6 +899,7 @@ meta_wayland_compositor_new (MetaContext *context)
   meta_wayland_text_input_init (compositor);
   meta_wayland_gtk_text_input_init (compositor);
   meta_wayland_init_presentation_time (compositor);
+  meta_wayland_init_commit_timing (compositor);
   meta_wayland_activation_init (compositor);
 
   /* Xwayland specific protocol, needs to be filtered out for all other clients */
@@ -64,6 +64,21 @@ void                    meta_wayland_compositor_add_frame_callback_surface (Meta
 void                    meta_wayland_compositor_remove_frame_callback_surface (MetaWaylandCompositor *compositor,
                                                                                MetaWaylandSurface    *surface);
 
+gboolean                meta_wayland_compositor_is_commit_over_budget (MetaWaylandCompositor *compositor,
+                                                                       MetaWaylandSurface    *surface);
+
+void                    meta_wayland_compositor_add_throttled_surface (MetaWaylandCompositor *compositor,
+                                                                       MetaWaylandSurface    *surface);
+
+void                    meta_wayland_compositor_remove_throttled_surface (MetaWaylandCompositor *compositor,
+                                                                          MetaWaylandSurface    *surface);
+
+void                    meta_wayland_compositor_add_timed_surface (MetaWaylandCompositor *compositor,
+                                                                   MetaWaylandSurface    *surface);
+
+void                    meta_wayland_compositor_remove_timed_surface (MetaWaylandCompositor *compositor,
+                                                                      MetaWaylandSurface    *surface);
+
 void                    meta_wayland_compositor_add_presentation_feedback_surface (MetaWaylandCompositor *compositor,
                                                                                    MetaWaylandSurface    *surface);
 